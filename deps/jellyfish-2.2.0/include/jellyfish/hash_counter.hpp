@@ -53,6 +53,7 @@ protected:
   volatile uint16_t       size_thid_, done_threads_;
   bool                    do_size_doubling_;
   dumper_t<array>*        dumper_;
+  locks::pthread::mutex   swap_mutex_;
 
 public:
   hash_counter(size_t size, // Size of hash. To be rounded up to a power of 2
@@ -89,6 +90,10 @@ public:
   /// Set whether we attempt to double the size of the hash when full.
   void do_size_doubling(bool v) { do_size_doubling_ = v; }
 
+  /// Held while the array is replaced after doubling. Lock it to
+  /// read the current array from another thread while counting.
+  locks::pthread::mutex& swap_mutex() { return swap_mutex_; }
+
   /// Set dumper responsible for cleaning out the array.
   void dumper(dumper_t<array> *d) { dumper_ = d; }
 
@@ -233,6 +238,7 @@ protected:
     size_barrier_.wait();
 
     if(serial_thread) { // Set new ary to be current and free old
+      locks::pthread::mutex_lock lock(swap_mutex_);
       delete ary_;
       ary_ = new_ary_;
     }
@@ -32,6 +32,8 @@ namespace jellyfish {
 struct sequence_ptr {
   char* start;
   char* end;
+  size_t seam; // Number of leading characters copied from the end of the previous buffer
+  size_t file_index; // Index of the file this buffer was read from, in the order given to the stream manager
 };
 
 template<typename StreamIterator>
@@ -46,9 +48,10 @@ class mer_overlap_sequence_parser : public jellyfish::cooperative_pool2<mer_over
     bool        have_seam;
     file_type   type;
     uint16_t    trim5p;
+    size_t      file_index;
     stream_type stream;
 
-    stream_status() : seam(0), seq_len(0), have_seam(false), type(DONE_TYPE) { }
+    stream_status() : seam(0), seq_len(0), have_seam(false), type(DONE_TYPE), file_index(0) { }
   };
 
   uint16_t                 mer_len_;
@@ -83,7 +86,11 @@ public:
     files_read_(0), reads_read_(0)
     {
         for(sequence_ptr* it = super::element_begin(); it != super::element_end(); ++it)
+        {
             it->start = it->end = buffer + (it - super::element_begin()) * buf_size;
+            it->seam = 0;
+            it->file_index = 0;
+        }
         for(uint32_t i = 0; i < max_producers; ++i) {
             streams_.init(i);
             streams_[i].seam = seam_buffer + i * (mer_len - 1);
@@ -111,7 +118,11 @@ public:
     files_read_(0), reads_read_(0)
     {
         for(sequence_ptr* it = super::element_begin(); it != super::element_end(); ++it)
+        {
             it->start = it->end = buffer + (it - super::element_begin()) * buf_size;
+            it->seam = 0;
+            it->file_index = 0;
+        }
         for (auto& t5p : trim5p_list) {
             trim5p_list_.push_back(t5p);
         }
@@ -161,13 +172,19 @@ protected:
     // streams_iterator_ noticed that we closed that stream before
     // requesting a new one.
     st.stream.reset();
-    st.stream = streams_iterator_.next();
-    if(!st.stream) {
-      st.type = DONE_TYPE;
-      return false;
+    {
+      // Several producers may open files at once, so keep the file index in step
+      // with the order the stream manager hands out files
+      locks::pthread::mutex_lock lock(streams_mutex);
+      st.stream = streams_iterator_.next();
+      if(!st.stream) {
+        st.type = DONE_TYPE;
+        return false;
+      }
+      st.file_index = files_read_;
+      ++files_read_;
     }
-    st.trim5p = trim5p_list_.empty() ? 0 : trim5p_list_[files_read_];
-    ++files_read_;
+    st.trim5p = trim5p_list_.size() > st.file_index ? trim5p_list_[st.file_index] : 0;
     switch(st.stream->peek()) {
     case EOF: return open_next_file(st);
     case '>':
@@ -192,6 +209,8 @@ protected:
       memcpy(buff.start, st.seam, mer_len_ - 1);
       read = mer_len_ - 1;
     }
+    buff.seam = read;
+    buff.file_index = st.file_index;
 
     // Here, the current stream is assumed to always point to some
     // sequence (or EOF). Never at header.
@@ -221,6 +240,8 @@ protected:
       memcpy(buff.start, st.seam, mer_len_ - 1);
       read = mer_len_ - 1;
     }
+    buff.seam = read;
+    buff.file_index = st.file_index;
 
     // Here, the st.stream is assumed to always point to some
     // sequence (or EOF). Never at header.
@@ -0,0 +1,164 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+#include <boost/exception/all.hpp>
+#include <boost/filesystem/path.hpp>
+using boost::filesystem::path;
+
+#include <jellyfish/mapped_file.hpp>
+
+#include <kat/byte_order.hpp>
+
+namespace kat {
+
+typedef boost::error_info<struct BinaryMatrixError,string> BinaryMatrixErrorInfo;
+struct BinaryMatrixException: virtual boost::exception, virtual std::exception { };
+
+/**
+ * Layout of a binary KAT matrix file.  All values are little endian, whatever
+ * the host, and are converted to and from host order on reading and writing.
+ *
+ *   0  char[8]  magic ("KATBINMX")
+ *   8  uint32   format version
+ *  12  uint32   storage (0 = dense, 1 = sparse)
+ *  16  uint64   number of rows
+ *  24  uint64   number of columns
+ *  32  uint64   number of non-zero cells
+ *  40  uint64   offset of the metadata block
+ *  48  uint64   length of the metadata block
+ *  56  uint64   offset of the payload (64 byte aligned)
+ *
+ * The metadata block holds exactly the same "# Key:value" lines, terminated
+ * by "###", that are written at the top of a text matrix file.  A dense payload
+ * is a row-major array of uint64 cells, so it can be mapped directly as a
+ * (rows, cols) numpy array.  A sparse payload is an array of BinaryMatrixEntry
+ * records, sorted by row then column.
+ */
+struct BinaryMatrixHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t storage;
+    uint64_t rows;
+    uint64_t cols;
+    uint64_t nnz;
+    uint64_t meta_offset;
+    uint64_t meta_len;
+    uint64_t data_offset;
+};
+
+struct BinaryMatrixEntry {
+    uint32_t row;
+    uint32_t col;
+    uint64_t val;
+};
+
+/**
+ * Read only view over a binary KAT matrix file.  The file is memory mapped so
+ * no cells are copied when the matrix is opened.
+ */
+class BinaryMatrix {
+public:
+
+    enum class Storage : uint32_t {
+        DENSE = 0,
+        SPARSE = 1
+    };
+
+    static const char MAGIC[8];
+    static const uint32_t VERSION = 1;
+    static const uint64_t ALIGNMENT = 64;
+
+    BinaryMatrix(const path& file);
+
+    uint64_t rows() const { return header.rows; }
+    uint64_t cols() const { return header.cols; }
+    uint64_t nnz() const { return header.nnz; }
+    Storage storage() const { return static_cast<Storage>(header.storage); }
+    bool isDense() const { return storage() == Storage::DENSE; }
+
+    /**
+     * Returns the metadata block, formatted identically to a text matrix header
+     */
+    string getMetadata() const {
+        return string(mxFile.base() + header.meta_offset, header.meta_len);
+    }
+
+    /**
+     * Row-major cell array, as stored in the file (little endian).  Only valid
+     * for dense matrices.
+     */
+    const uint64_t* denseData() const {
+        return isDense() ? reinterpret_cast<const uint64_t*>(mxFile.base() + header.data_offset) : nullptr;
+    }
+
+    /**
+     * Sorted non-zero entries, as stored in the file (little endian).  Only
+     * valid for sparse matrices.
+     */
+    const BinaryMatrixEntry* sparseData() const {
+        return isDense() ? nullptr : reinterpret_cast<const BinaryMatrixEntry*>(mxFile.base() + header.data_offset);
+    }
+
+    /**
+     * The k'th cell of a dense matrix, in host order
+     */
+    uint64_t cell(uint64_t k) const {
+        return littleEndian(denseData()[k]);
+    }
+
+    /**
+     * The k'th non-zero entry of a sparse matrix, in host order
+     */
+    BinaryMatrixEntry entry(uint64_t k) const {
+        const BinaryMatrixEntry& e = sparseData()[k];
+        return BinaryMatrixEntry{littleEndian(e.row), littleEndian(e.col), littleEndian(e.val)};
+    }
+
+    uint64_t get(uint64_t i, uint64_t j) const;
+
+    /**
+     * Returns true if the given file starts with the binary matrix magic
+     */
+    static bool isBinaryMatrix(const path& file);
+
+    /**
+     * Writes a matrix to file in binary format.  Entries must be sorted by row
+     * then column and must not contain zero values.  Dense or sparse storage is
+     * selected depending on which produces the smaller file.
+     * @param file Output file
+     * @param rows Number of rows in the matrix
+     * @param cols Number of columns in the matrix
+     * @param entries Non-zero cells in the matrix
+     * @param metadata Metadata block, as would be written at the top of a text matrix
+     */
+    static void write(const path& file, uint64_t rows, uint64_t cols,
+            const vector<BinaryMatrixEntry>& entries, const string& metadata);
+
+private:
+    jellyfish::mapped_file mxFile;
+    BinaryMatrixHeader header;      // Converted to host order
+};
+
+}
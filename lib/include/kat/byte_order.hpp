@@ -0,0 +1,42 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#pragma once
+
+#include <stdint.h>
+
+namespace kat {
+
+/**
+ * KAT's binary file formats store all integers little endian, whatever the
+ * host.  These convert between host order and little endian.  Each conversion
+ * is its own inverse, so the same call is used for reading and writing.
+ */
+inline bool isLittleEndianHost() {
+    const uint16_t v = 1;
+    return *reinterpret_cast<const uint8_t*>(&v) == 1;
+}
+
+inline uint32_t littleEndian(uint32_t v) {
+    return isLittleEndianHost() ? v : __builtin_bswap32(v);
+}
+
+inline uint64_t littleEndian(uint64_t v) {
+    return isLittleEndianHost() ? v : __builtin_bswap64(v);
+}
+
+}
@@ -56,6 +56,8 @@ public:
     path hash2_path;
     path hash3_path;
 
+    double sample_fraction;     // Fraction of distinct K-mers that were sampled (1.0 for exact counts)
+
     CompCounters();
 	
 	CompCounters(const size_t _dm_size);
@@ -74,6 +76,20 @@ public:
 
     static void updateSpectrum(vector<uint64_t>& spectrum, const uint64_t count);
 
+    /**
+     * Scales all counts up by 1 / sampleFraction, turning counts gathered from a
+     * FracMinHash sample into estimates for the full dataset.  Also records the
+     * fraction so that the estimation error can be reported.
+     */
+    void scale(const double sampleFraction);
+
+    /**
+     * Relative standard error of a distinct K-mer count estimated from a sample.
+     * Each distinct K-mer is kept independently with probability f, so the
+     * sampled count is binomial and the error of the estimate N is sqrt((1-f)/(N*f)).
+     */
+    static double relativeStdError(const uint64_t estimate, const double sampleFraction);
+
     void printCounts(ostream &out);
 
     vector<uint64_t>& getSpectrum1() { return spectrum1; }
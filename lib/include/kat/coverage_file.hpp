@@ -0,0 +1,184 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#pragma once
+
+#include <stdint.h>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+using std::ofstream;
+using std::string;
+using std::unordered_map;
+using std::vector;
+
+#include <boost/exception/all.hpp>
+#include <boost/filesystem/path.hpp>
+using boost::filesystem::path;
+
+#include <jellyfish/mapped_file.hpp>
+
+#include <kat/byte_order.hpp>
+
+namespace kat {
+
+typedef boost::error_info<struct CoverageFileError,string> CoverageFileErrorInfo;
+struct CoverageFileException: virtual boost::exception, virtual std::exception { };
+
+/**
+ * Layout of a binary K-mer coverage file.  All values are little endian, whatever
+ * the host, and are converted to and from host order on reading and writing.
+ *
+ *   0  char[8]  magic ("KATBINCV")
+ *   8  uint32   format version
+ *  12  uint32   block size, in K-mer positions
+ *  16  uint32   K-mer length
+ *  20  uint32   reserved
+ *  24  uint64   number of sequences
+ *  32  uint64   offset of the index
+ *
+ * The header is followed by the encoded blocks of each sequence in turn.  Each
+ * sequence's counts are split into blocks of the block size (the last one may be
+ * shorter), and each block is encoded independently as a list of (count, run
+ * length) pairs, both as LEB128 variable byte integers.  The index at the end
+ * of the file holds, for each sequence in file order:
+ *
+ *   uint32   length of the name
+ *   char[]   name
+ *   uint64   number of K-mer positions
+ *   uint64   number of blocks
+ *   uint64[] file offset of each block, plus the offset just past the last block
+ *
+ * So any interval of any sequence can be decoded without touching the rest of
+ * the file.
+ */
+struct CoverageFileHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t block_size;
+    uint32_t mer_len;
+    uint32_t reserved;
+    uint64_t nb_seqs;
+    uint64_t index_offset;
+};
+
+/**
+ * Read only view over a binary K-mer coverage file.  The file is memory mapped
+ * and only the blocks covering a requested interval are decoded.
+ */
+class CoverageFile {
+public:
+
+    static const char MAGIC[8];
+    static const uint32_t VERSION = 1;
+    static const uint32_t DEFAULT_BLOCK_SIZE = 65536;
+
+    CoverageFile(const path& file);
+
+    size_t size() const { return seqs.size(); }
+    uint32_t getMerLen() const { return header.mer_len; }
+    uint32_t getBlockSize() const { return header.block_size; }
+
+    const string& getName(size_t index) const { return seqs[index].name; }
+
+    /**
+     * Number of K-mer positions in the sequence
+     */
+    uint64_t getLength(size_t index) const { return seqs[index].length; }
+
+    /**
+     * Looks up a sequence by its full name, or by the first word of its name
+     * @return The index of the sequence, or -1 if not found
+     */
+    int64_t find(const string& name) const;
+
+    /**
+     * Decodes the counts for K-mer positions [start, end) of a sequence
+     */
+    void get(size_t index, uint64_t start, uint64_t end, vector<uint64_t>& counts) const;
+
+    void get(size_t index, vector<uint64_t>& counts) const {
+        get(index, 0, getLength(index), counts);
+    }
+
+    /**
+     * Returns true if the given file starts with the binary coverage magic
+     */
+    static bool isCoverageFile(const path& file);
+
+    /**
+     * Encodes a block of counts as run length, variable byte pairs
+     */
+    static string encodeBlock(const uint64_t* counts, size_t n);
+
+    /**
+     * Decodes a block, appending the counts to the output vector.  Throws if the
+     * block holds more than maxCounts counts, so a corrupt file can't ask for more
+     * memory than a block needs.
+     */
+    static void decodeBlock(const char* data, size_t len, uint64_t maxCounts, vector<uint64_t>& counts);
+
+private:
+
+    struct Entry {
+        string name;
+        uint64_t length;
+        vector<uint64_t> offsets;
+    };
+
+    jellyfish::mapped_file cvgFile;
+    CoverageFileHeader header;      // Converted to host order
+    vector<Entry> seqs;
+    unordered_map<string, size_t> byName;
+    path file;
+};
+
+/**
+ * Writes a binary K-mer coverage file.  Blocks are encoded up front, typically
+ * in parallel, with CoverageFile::encodeBlock and then appended one sequence at
+ * a time in file order.  The index is written by close().
+ */
+class CoverageFileWriter {
+public:
+
+    CoverageFileWriter(const path& file, uint32_t merLen, uint32_t blockSize = CoverageFile::DEFAULT_BLOCK_SIZE);
+
+    uint32_t getBlockSize() const { return blockSize; }
+
+    /**
+     * Appends a sequence
+     * @param name Name of the sequence
+     * @param length Number of K-mer positions in the sequence
+     * @param blocks The encoded blocks of counts, each holding blockSize positions except the last
+     */
+    void add(const string& name, uint64_t length, const vector<string>& blocks);
+
+    void close();
+
+private:
+
+    path file;
+    ofstream out;
+    uint32_t merLen;
+    uint32_t blockSize;
+    uint64_t offset;
+    string index;
+    uint64_t nbSeqs;
+};
+
+}
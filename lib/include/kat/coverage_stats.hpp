@@ -0,0 +1,119 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+namespace kat {
+
+    /**
+     * Streaming summary of the K-mer counts along a sequence.  Counts are added one
+     * at a time, and the median, mean, number of non-zero and number of invalid
+     * K-mers are available at the end, without keeping the per K-mer counts.
+     *
+     * The median is taken from a histogram of counts, which only grows as large as
+     * the highest count seen, up to MAX_HIST.  The rare counts above that are kept
+     * and searched with nth_element if the median falls amongst them.  So both time
+     * and memory are linear at worst, rather than needing a full copy and sort.
+     *
+     * Stats for separate parts of a sequence can be merged.
+     */
+    class CoverageStats {
+    public:
+
+        static const uint64_t MAX_HIST = 65536;
+
+        CoverageStats() : n(0), sum(0), nonZero(0), invalid(0) {}
+
+        void add(uint64_t count) {
+            n++;
+            sum += count;
+            if (count != 0) nonZero++;
+            if (count < MAX_HIST) {
+                if (count >= hist.size()) {
+                    hist.resize(count + 1, 0);
+                }
+                hist[count]++;
+            }
+            else {
+                high.push_back(count);
+            }
+        }
+
+        /**
+         * Adds a K-mer that couldn't be looked up.  Like the text outputs, these
+         * count as zero coverage for the median and mean.
+         */
+        void addInvalid() {
+            add(0);
+            invalid++;
+        }
+
+        void merge(const CoverageStats& other) {
+            n += other.n;
+            sum += other.sum;
+            nonZero += other.nonZero;
+            invalid += other.invalid;
+            if (other.hist.size() > hist.size()) {
+                hist.resize(other.hist.size(), 0);
+            }
+            for (size_t i = 0; i < other.hist.size(); i++) {
+                hist[i] += other.hist[i];
+            }
+            high.insert(high.end(), other.high.begin(), other.high.end());
+        }
+
+        uint64_t size() const { return n; }
+        uint64_t getSum() const { return sum; }
+        uint64_t getNonZero() const { return nonZero; }
+        uint64_t getInvalid() const { return invalid; }
+
+        double mean() const {
+            return n == 0 ? 0.0 : (double)sum / (double)n;
+        }
+
+        /**
+         * The count at position size() / 2 in the sorted counts, or 0 if there are
+         * no counts
+         */
+        uint64_t median() {
+            if (n == 0) {
+                return 0;
+            }
+            uint64_t rank = n / 2;
+            for (size_t i = 0; i < hist.size(); i++) {
+                if (rank < hist[i]) {
+                    return i;
+                }
+                rank -= hist[i];
+            }
+            std::nth_element(high.begin(), high.begin() + rank, high.end());
+            return high[rank];
+        }
+
+    private:
+        std::vector<uint64_t> hist;
+        std::vector<uint64_t> high;
+        uint64_t n;
+        uint64_t sum;
+        uint64_t nonZero;
+        uint64_t invalid;
+    };
+}
@@ -0,0 +1,102 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+#include <boost/exception/all.hpp>
+#include <boost/filesystem/path.hpp>
+using boost::filesystem::path;
+
+#include <jellyfish/mapped_file.hpp>
+
+#include <kat/sequence_index.hpp>
+
+namespace kat {
+
+typedef boost::error_info<struct FastaIndexError,string> FastaIndexErrorInfo;
+struct FastaIndexException: virtual boost::exception, virtual std::exception { };
+
+/**
+ * One line of a samtools style .fai index
+ */
+struct FastaIndexEntry {
+    string name;            // First word of the header
+    uint64_t length;        // Number of bases
+    uint64_t offset;        // File offset of the first base
+    uint64_t lineBases;     // Bases per line
+    uint64_t lineWidth;     // Bytes per line, including the line terminator
+};
+
+/**
+ * Random access to the records of an uncompressed FastA file, via a samtools
+ * compatible .fai index.  The FastA file is memory mapped, so records can be
+ * extracted from any thread, in any order, without parsing the rest of the file.
+ *
+ * If <fasta>.fai exists and is newer than the FastA file it is used, otherwise
+ * the index is built by scanning the file once, and saved alongside it if
+ * possible.  Files that can't be indexed, because they are compressed, not FastA,
+ * or have lines of inconsistent length within a record, cause a
+ * FastaIndexException, so callers can fall back to reading the file sequentially.
+ */
+class FastaIndex : public SequenceIndex {
+public:
+
+    FastaIndex(const path& fastaFile);
+
+    size_t size() const { return entries.size(); }
+
+    const FastaIndexEntry& operator[](size_t index) const { return entries[index]; }
+
+    uint64_t getLength(size_t index) const { return entries[index].length; }
+
+    /**
+     * Returns the full header line of a record, without the leading '>'
+     */
+    string getHeader(size_t index) const;
+
+    /**
+     * Returns the bases of a record, without line breaks
+     */
+    string getSequence(size_t index) const;
+
+    /**
+     * Writes the index in .fai format
+     */
+    void save(const path& faiFile) const;
+
+    static path indexPath(const path& fastaFile) {
+        return path(fastaFile.string() + ".fai");
+    }
+
+private:
+
+    path fastaFile;
+    jellyfish::mapped_file fa;
+    vector<FastaIndexEntry> entries;
+
+    void build();
+
+    bool load(const path& faiFile);
+};
+
+}
@@ -17,7 +17,9 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
+using std::function;
 using std::shared_ptr;
 
 #include <kat/jellyfish_helper.hpp>
@@ -40,7 +42,7 @@ namespace kat {
             COUNT
         };
 
-        uint16_t index;
+        uint16_t index = 1;
         vector<path> input;
         vector<uint16_t> trim5p;
         vector<uint16_t> trim3p;
@@ -50,11 +52,23 @@ namespace kat {
         uint16_t merLen = DEFAULT_MER_LEN;
         bool dumpHash = false;
         bool disableHashGrow = false;
+        double sampleFraction = 1.0;            // Fraction of distinct K-mers to keep (FracMinHash)
+        path seedHash;                          // If set, counts from this dump are added to the new counts
+        shared_ptr<PackedSequences> packed = nullptr;   // If set, these in memory copies of the input sequences are counted instead of reading the files
         HashCounterPtr hashCounter = nullptr;
         shared_ptr<HashLoader> hashLoader = nullptr;
         LargeHashArrayPtr hash = nullptr;
         shared_ptr<file_header> header;         // Only applicable if loaded
 
+        // Online mode: while counting, snapshot is called every snapshotInterval seconds
+        // with the live hash and the seconds elapsed.  It runs in its own thread, with
+        // counting carrying on around it, so the counts it sees are only approximate.
+        // The hash can't be doubled while snapshot runs, so it should only take what it
+        // needs from the hash and return a function to do anything slow, such as writing
+        // to disk, which is called once the hash is released.
+        uint32_t snapshotInterval = 0;
+        function<function<void()>(const LargeHashArray&, uint64_t)> snapshot = nullptr;
+
         void setSingleInput(const path& p) { input.clear(); input.push_back(p); trim5p.clear(); trim5p.push_back(0); }
         void setMultipleInputs(const vector<path>& inputs);
         path getSingleInput() { return input[0]; }
@@ -76,6 +90,8 @@ namespace kat {
 
     private:
         static int globerr(const char *path, int eerrno);
+
+        void seed(const uint16_t threads, uint64_t size);   // Creates the hash counter, prefilled from seedHash
     };
 
 }
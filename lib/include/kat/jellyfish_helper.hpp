@@ -20,7 +20,9 @@
 #include <string>
 #include <iostream>
 #include <memory>
+#include <utility>
 #include <vector>
+#include <string.h>
 using std::ifstream;
 using std::ostream;
 using std::string;
@@ -29,6 +31,7 @@ using std::cerr;
 using std::endl;
 using std::shared_ptr;
 using std::make_shared;
+using std::pair;
 using std::vector;
 
 #include <boost/exception/exception.hpp>
@@ -53,6 +56,9 @@ using boost::timer::auto_cpu_timer;
 #include <jellyfish/mer_overlap_sequence_parser.hpp>
 #include <jellyfish/storage.hpp>
 #include <jellyfish/stream_manager.hpp>
+
+#include <kat/packed_sequences.hpp>
+#include <kat/two_bit.hpp>
 using jellyfish::mer_dna;
 using jellyfish::file_header;
 using jellyfish::mapped_file;
@@ -75,6 +81,20 @@ namespace kat {
     const uint64_t DEFAULT_HASH_SIZE = 100000000;
     const uint16_t DEFAULT_MER_LEN = 27;
 
+    /**
+     * Sequence inputs split into the files read by jellyfish's parser, and .2bit
+     * files, which are read record by record.  The parser paths point into the
+     * input path list, so that must outlive this.
+     */
+    struct SeqInputs {
+        vector<const char*> paths;                      // Files for jellyfish's parser
+        vector<uint16_t> pathTrim5p;                    // 5' trim for each parser file
+        vector<size_t> pathFiles;                       // Index in the input of each parser file
+        vector<shared_ptr<TwoBitFile>> twoBits;
+        vector<size_t> twoBitFiles;                     // Index in the input of each .2bit file
+        vector<pair<size_t, size_t>> twoBitRecords;     // (index in twoBits, record)
+    };
+
     class HashLoader {
 
     private:
@@ -103,9 +123,11 @@ namespace kat {
          * which is also returned from this function.
          * @param jfHashPath Path to the jellyfish hash file
          * @param verbose Output additional information to cout
+         * @param sampleFraction Only keep K-mers within this fraction of the hash space (see
+         * JellyfishHelper::inSample).  1.0 keeps everything.
          * @return The hash array
          */
-        LargeHashArrayPtr loadHash(const path& jfHashPath, bool verbose);
+        LargeHashArrayPtr loadHash(const path& jfHashPath, bool verbose, double sampleFraction = 1.0);
 
         LargeHashArrayPtr getHash() { return hash; }
 
@@ -117,6 +139,66 @@ namespace kat {
     };
 
 
+    /**
+     * Read only, memory mapped view over the records in a binary jellyfish dump.
+     * Unlike HashLoader this doesn't build a hash, so it is the cheapest way to
+     * make a single pass over every K-mer and count in a dump.  Records can be
+     * accessed in any order, so the file can easily be split between threads.
+     */
+    class MappedDump {
+
+    private:
+
+        path dumpPath;
+        file_header header;
+        mapped_file mapped;
+        const char* data;
+        size_t keyBytes;
+        size_t recordBytes;
+        uint64_t nbRecords;
+
+    public:
+
+        MappedDump(const path& jfHashPath);
+
+        const file_header& getHeader() const { return header; }
+
+        uint16_t getMerLen() const { return header.key_len() / 2; }
+
+        bool getCanonical() const { return header.canonical(); }
+
+        uint64_t size() const { return nbRecords; }
+
+        /**
+         * Returns the count for the i'th record
+         */
+        uint64_t val(uint64_t i) const {
+            uint64_t v = 0;
+            memcpy(&v, data + i * recordBytes + keyBytes, recordBytes - keyBytes);
+            return v;
+        }
+
+        /**
+         * Copies the K-mer for the i'th record into kmer, which must already be
+         * sized for this dump's K-mer length
+         */
+        void key(uint64_t i, mer_dna& kmer) const {
+            kmer.polyA();
+            memcpy(kmer.data__(), data + i * recordBytes, keyBytes);
+        }
+
+        /**
+         * Returns the [start, end) range of records to process for slice th_id of
+         * nb_slices, so that each record is assigned to exactly one slice
+         */
+        pair<uint64_t, uint64_t> slice(uint16_t th_id, uint16_t nb_slices) const {
+            return pair<uint64_t, uint64_t>(
+                    (nbRecords * th_id) / nb_slices,
+                    (nbRecords * (th_id + 1)) / nb_slices);
+        }
+    };
+
+
     class JellyfishHelper {
 
 
@@ -124,13 +206,116 @@ namespace kat {
 
         static uint64_t getCount(LargeHashArrayPtr hash, const mer_dna& kmer, bool canonical);
 
+        /**
+         * Hashes a K-mer to a uniformly distributed 64 bit value.  Used for FracMinHash
+         * style sampling, so it must not change between runs or versions.
+         */
+        static uint64_t hashKmer(const mer_dna& kmer) {
+            uint64_t h = 0x9E3779B97F4A7C15ULL ^ kmer.k();
+            for (unsigned int i = 0; i < kmer.nb_words(); i++) {
+                // Murmur3 64 bit finaliser
+                h ^= kmer.word(i);
+                h ^= h >> 33;
+                h *= 0xFF51AFD7ED558CCDULL;
+                h ^= h >> 33;
+                h *= 0xC4CEB9FE1A85EC53ULL;
+                h ^= h >> 33;
+            }
+            return h;
+        }
+
+        /**
+         * Number of G or C bases in a single word of 2-bit encoded bases.  Jellyfish
+         * encodes A, C, G and T as 0, 1, 2 and 3, so a base is G or C exactly when its
+         * two bits differ.  Unused bits must be 0, i.e. A.
+         */
+        static uint32_t gcCount(uint64_t word) {
+            uint64_t x = (word ^ (word >> 1)) & 0x5555555555555555ULL;
+            // Popcount of the low bit of each pair
+            x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+            x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+            return (uint32_t)((x * 0x0101010101010101ULL) >> 56);
+        }
+
+        /**
+         * Number of G or C bases in the K-mer, counted straight from its 2-bit
+         * encoding rather than converting it to a string first
+         */
+        static uint32_t gcCount(const mer_dna& kmer) {
+            uint32_t gc = 0;
+            for (unsigned int i = 0; i < kmer.nb_words(); i++) {
+                gc += gcCount(kmer.word(i));
+            }
+            return gc;
+        }
+
+        /**
+         * Batch version of gcCount for K-mers that fit in a single word (K <= 32).
+         * Uses AVX2 where the CPU supports it.
+         * @param words First word of each K-mer
+         * @param n Number of K-mers
+         * @param gc Receives the GC count of each K-mer
+         */
+        static void gcCountBatch(const uint64_t* words, size_t n, uint8_t* gc);
+
+        /**
+         * Converts a sampling fraction into the hash threshold used by inSample
+         * @param sampleFraction Fraction of K-mers to keep, between 0 and 1
+         */
+        static uint64_t sampleThreshold(double sampleFraction) {
+            return sampleFraction >= 1.0 ? UINT64_MAX : (uint64_t)(sampleFraction * 18446744073709551616.0);
+        }
+
+        /**
+         * Whether or not the K-mer falls within the sample, i.e. its hash is below
+         * the threshold.  The decision is made on the canonical K-mer, so the same
+         * K-mers are kept from every input, whether or not it stores them canonically.
+         */
+        static bool inSample(const mer_dna& kmer, uint64_t threshold) {
+            return threshold == UINT64_MAX || hashKmer(kmer.get_canonical()) < threshold;
+        }
+
         /**
         * Simple count routine
         * @param ary Hash array which contains the counted kmers
         * @param parser The parser that handles the input stream and chunking
         * @param canonical whether or not the kmers should be treated as canonical or not
+        * @param threshold Only count kmers whose hash is below this threshold (see inSample)
         */
-        static void countSlice(HashCounter& ary, SequenceParser& parser, bool canonical);
+        static void countSlice(HashCounter& ary, SequenceParser& parser, bool canonical, uint64_t threshold);
+
+        /**
+        * Counts the kmers in one record of a .2bit file.  Kmers are built straight
+        * from the packed bases, skipping N blocks, with no ASCII conversion.
+        * Unlike countSlice this doesn't call done() on the hash.
+        * @param ary Hash array which contains the counted kmers
+        * @param file The .2bit file
+        * @param index The record to count
+        * @param canonical whether or not the kmers should be treated as canonical or not
+        * @param threshold Only count kmers whose hash is below this threshold (see inSample)
+        */
+        static void countTwoBitRecord(HashCounter& ary, const TwoBitFile& file, size_t index, bool canonical, uint64_t threshold) {
+            countPackedRecord(ary, file[index], file.getPacked(index), canonical, threshold);
+        }
+
+        /**
+        * As countTwoBitRecord, but for a record in the .2bit layout held anywhere, e.g. in memory
+        * @param ary Hash array which contains the counted kmers
+        * @param record The record, with its N blocks
+        * @param packed The packed bases of the record
+        * @param canonical whether or not the kmers should be treated as canonical or not
+        * @param threshold Only count kmers whose hash is below this threshold (see inSample)
+        */
+        static void countPackedRecord(HashCounter& ary, const TwoBitRecord& record, const uint8_t* packed, bool canonical, uint64_t threshold);
+
+        /**
+         * Counts kmers in sequences already packed in memory, returning a hash
+         * array of those kmers.  Records are shared out between the threads.
+         * @param seqs Sequences to count
+         * @param sampleFraction Only count this fraction of distinct kmers.  1.0 counts everything.
+         * @return The hash array counter
+         */
+        static LargeHashArrayPtr countPackedSequences(const PackedSequences& seqs, HashCounter& hashCounter, bool canonical, uint16_t threads, double sampleFraction = 1.0);
 
         /**
          * Counts kmers in the given sequence file (Fasta or Fastq) returning
@@ -149,12 +334,13 @@ namespace kat {
         }
 
         /**
-         * Counts kmers in the given sequence file (Fasta or Fastq) returning
+         * Counts kmers in the given sequence files (Fasta, Fastq or .2bit) returning
          * a hash array of those kmers
          * @param seqFile Sequence file to count
+         * @param sampleFraction Only count this fraction of distinct kmers.  1.0 counts everything.
          * @return The hash array counter
          */
-        static LargeHashArrayPtr countSeqFile(const vector<path>& seqFiles, HashCounter& hashCounter, bool canonical, uint16_t threads, const vector<uint16_t>& trim5p, const vector<uint16_t>& trim3p);
+        static LargeHashArrayPtr countSeqFile(const vector<path>& seqFiles, HashCounter& hashCounter, bool canonical, uint16_t threads, const vector<uint16_t>& trim5p, const vector<uint16_t>& trim3p, double sampleFraction = 1.0);
 
 
 
@@ -174,6 +360,16 @@ namespace kat {
         */
         static void printHeader(const file_header& header, ostream& out);
 
+        /**
+         * Splits the inputs into files for jellyfish's parser and .2bit files.  Pipes
+         * always go to the parser.  5' trimming isn't supported for .2bit files, so a
+         * JellyfishException is thrown if one is given a non-zero trim.
+         * @param seqFiles Sequence files to split
+         * @param trim5p 5' trim for each input, if any
+         * @return The split inputs
+         */
+        static SeqInputs splitSeqInputs(const vector<path>& seqFiles, const vector<uint16_t>& trim5p);
+
 		/**
 		 * Checks if path refers to a pipe rather than a real file
 		 * @param filename Path to input file
@@ -183,8 +379,8 @@ namespace kat {
 
         /**
          * Returns whether or not the specified file path looks like it belongs to
-         * a sequence file (either FastA or FastQ).  Gzipped sequence files are
-         * also supported.
+         * a sequence file (FastA, FastQ or .2bit).  Gzipped FastA and FastQ files
+         * are also supported.
          * @param filename Path to file
          * @return Whether or not the file is a seqeunce file
          */
@@ -192,6 +388,8 @@ namespace kat {
 
     protected:
 
+        // Counts the kmers from the parser, without calling done() on the hash
+        static void addMers(HashCounter& ary, SequenceParser& parser, bool canonical, uint64_t threshold);
 
     };
 }
@@ -0,0 +1,271 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#pragma once
+
+#include <stdint.h>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+using std::pair;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+#include <boost/exception/all.hpp>
+
+#include <jellyfish/mer_dna.hpp>
+using jellyfish::mer_dna;
+
+#include <kat/jellyfish_helper.hpp>
+#include <kat/sparse_matrix.hpp>
+
+namespace kat {
+
+typedef boost::error_info<struct KmerAnalysisError,string> KmerAnalysisErrorInfo;
+struct KmerAnalysisException: virtual boost::exception, virtual std::exception { };
+
+/**
+ * A batch of K-mers from the hash along with their counts, and any values derived
+ * from them that several analyses share
+ */
+struct KmerBatch {
+
+    static const size_t CAPACITY = 256;
+
+    size_t size = 0;
+    mer_dna kmers[CAPACITY];
+    uint64_t counts[CAPACITY];
+    uint8_t gc[CAPACITY];      // Only filled in if an analysis needs GC
+};
+
+/**
+ * An analysis that can be driven by AnalysisEngine.  Each analysis keeps per thread
+ * results while visiting and combines them in finish().
+ */
+class KmerAnalysis {
+public:
+
+    virtual ~KmerAnalysis() {}
+
+    virtual bool needsGC() const { return false; }
+
+    /**
+     * Called before the pass, once the K value and number of threads are known
+     */
+    virtual void init(uint16_t merLen, uint16_t threads) = 0;
+
+    /**
+     * Called for every batch of K-mers.  Threads only ever pass their own id.
+     */
+    virtual void visit(uint16_t th_id, const KmerBatch& batch) = 0;
+
+    /**
+     * Called once all threads have finished visiting
+     */
+    virtual void finish() = 0;
+};
+
+/**
+ * Runs any number of analyses over a hash, or a jellyfish dump, in a single
+ * parallel pass.  GC is only counted once per K-mer, however many analyses use it.
+ */
+class AnalysisEngine {
+public:
+
+    void add(shared_ptr<KmerAnalysis> analysis) {
+        analyses.push_back(analysis);
+    }
+
+    size_t size() const { return analyses.size(); }
+
+    void run(const LargeHashArray& hash, uint16_t merLen, uint16_t threads);
+
+    /**
+     * Streams the K-mers straight from the dump, without loading it into a hash
+     */
+    void run(const MappedDump& dump, uint16_t threads);
+
+private:
+    vector<shared_ptr<KmerAnalysis>> analyses;
+
+    void init(uint16_t merLen, uint16_t threads);
+    void visit(uint16_t th_id, KmerBatch& batch, uint16_t merLen) const;
+    void finish();
+
+    void runSlice(const LargeHashArray& hash, uint16_t merLen, uint16_t th_id, uint16_t threads) const;
+    void runDumpSlice(const MappedDump& dump, uint16_t th_id, uint16_t threads) const;
+};
+
+/**
+ * K-mer spectrum, binned in the same way as "kat hist"
+ */
+class SpectrumAnalysis : public KmerAnalysis {
+public:
+
+    SpectrumAnalysis(uint64_t low, uint64_t high, uint64_t inc);
+
+    void init(uint16_t merLen, uint16_t threads);
+    void visit(uint16_t th_id, const KmerBatch& batch);
+    void finish();
+
+    uint64_t getBase() const { return base; }
+    uint64_t getInc() const { return inc; }
+    const vector<uint64_t>& getHistogram() const { return hist; }
+
+    /**
+     * Lowest count in the histogram, for the given lower limit
+     */
+    static uint64_t calcBase(uint64_t low) {
+        return low > 1 ? low - 1 : 1;
+    }
+
+    /**
+     * Highest count in the histogram, for the given upper limit
+     */
+    static uint64_t calcCeil(uint64_t high) {
+        return high + 1;
+    }
+
+    /**
+     * Bucket for the given count.  Counts below the base go in the first bucket
+     * and counts above the ceiling in the last.
+     */
+    static uint64_t bucket(uint64_t val, uint64_t base, uint64_t ceil, uint64_t inc) {
+        if (val < base)
+            return 0;
+        else if (val > ceil)
+            return ceil - base;
+        else
+            return (val - base) / inc;
+    }
+
+private:
+    uint64_t base, ceil, inc, nb_buckets;
+    vector<vector<uint64_t>> threadedHists;
+    vector<uint64_t> hist;
+};
+
+/**
+ * Number of distinct K-mers for each GC count and (scaled) K-mer count, as in
+ * "kat gcp"
+ */
+class GcpAnalysis : public KmerAnalysis {
+public:
+
+    GcpAnalysis(uint16_t cvgBins, double cvgScale);
+
+    bool needsGC() const { return true; }
+
+    void init(uint16_t merLen, uint16_t threads);
+    void visit(uint16_t th_id, const KmerBatch& batch);
+    void finish();
+
+    /**
+     * GC count by coverage matrix, with K+1 rows and cvgBins+1 columns
+     */
+    const SM64& getMatrix() const { return matrix; }
+
+    /**
+     * Column for the given K-mer count, once scaled
+     */
+    static uint64_t cvgPos(uint64_t count, double cvgScale, uint16_t cvgBins) {
+        const uint64_t cvg_pos = count == 0 ? 0 : std::ceil((double)count * cvgScale);
+        return cvg_pos > cvgBins ? cvgBins : cvg_pos;
+    }
+
+private:
+    uint16_t cvgBins;
+    double cvgScale;
+    uint16_t merLen;
+    vector<vector<uint64_t>> threadedCells;
+    SM64 matrix;
+};
+
+/**
+ * Counts the K-mers inside and outside of coverage and GC limits, as used by
+ * "kat filter kmer"
+ */
+class BoundsAnalysis : public KmerAnalysis {
+public:
+
+    struct Counts {
+        uint64_t distinct = 0;
+        uint64_t total = 0;
+    };
+
+    BoundsAnalysis(uint64_t lowCount, uint64_t highCount, uint16_t lowGC, uint16_t highGC);
+
+    bool needsGC() const { return true; }
+
+    void init(uint16_t merLen, uint16_t threads);
+    void visit(uint16_t th_id, const KmerBatch& batch);
+    void finish();
+
+    uint64_t getLowCount() const { return lowCount; }
+    uint64_t getHighCount() const { return highCount; }
+    uint16_t getLowGC() const { return lowGC; }
+    uint16_t getHighGC() const { return highGC; }
+
+    const Counts& getAll() const { return all; }
+    const Counts& getIn() const { return in; }
+    const Counts& getOut() const { return out; }
+
+    /**
+     * Whether a K-mer's GC and count are both within the limits, which are inclusive
+     */
+    static bool inBounds(uint32_t gc, uint64_t count, uint64_t lowCount, uint64_t highCount,
+            uint32_t lowGC, uint32_t highGC) {
+        return lowGC <= gc && gc <= highGC && lowCount <= count && count <= highCount;
+    }
+
+private:
+    uint64_t lowCount, highCount;
+    uint16_t lowGC, highGC;
+    vector<pair<Counts, Counts>> threadedCounts;  // In and out for each thread
+    Counts all, in, out;
+};
+
+/**
+ * The N most abundant K-mers.  Ties are broken by K-mer, so the result doesn't
+ * depend on the number of threads.
+ */
+class TopAnalysis : public KmerAnalysis {
+public:
+
+    typedef pair<uint64_t, mer_dna> Entry;
+
+    TopAnalysis(size_t n);
+
+    void init(uint16_t merLen, uint16_t threads);
+    void visit(uint16_t th_id, const KmerBatch& batch);
+    void finish();
+
+    /**
+     * Most abundant K-mers, highest count first
+     */
+    const vector<Entry>& getTop() const { return top; }
+
+private:
+    size_t n;
+    vector<vector<Entry>> heaps;
+    vector<Entry> top;
+};
+
+}
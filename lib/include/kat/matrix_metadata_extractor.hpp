@@ -36,6 +36,10 @@ namespace mme {
     const string KEY_TITLE = "# Title:";
     const string KEY_MAX_VAL = "# MaxVal:";
     const string KEY_TRANSPOSE = "# Transpose:";
+    const string KEY_APPROXIMATE = "# Approximate:";
+    const string KEY_MAX_OVERCOUNT = "# Max overcount:";
+    const string KEY_DISTINCT_ESTIMATE = "# Distinct estimate:";
+    const string KEY_DISTINCT_SCALE = "# Distinct scale:";
     const string MX_META_END = "###";
 
     void trim(string& str);
@@ -0,0 +1,133 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+using std::shared_ptr;
+using std::vector;
+
+#include <boost/exception/all.hpp>
+#include <boost/filesystem/path.hpp>
+using boost::filesystem::path;
+
+#include <jellyfish/large_hash_array.hpp>
+#include <jellyfish/mer_dna.hpp>
+
+#include <kat/jellyfish_helper.hpp>
+#include <kat/two_bit.hpp>
+
+namespace kat {
+
+typedef boost::error_info<struct MultiKCounterError,string> MultiKCounterErrorInfo;
+struct MultiKCounterException: virtual boost::exception, virtual std::exception { };
+
+// Each K value needs its own mer class (jellyfish stores K statically per class), so
+// there is a fixed number of slots available
+const uint16_t MAX_MULTI_K = 8;
+
+/**
+ * Counts K-mers of a single length.  Instances are created through KCounter::create,
+ * which hides the mer class used for this counter's slot.
+ */
+class KCounter {
+public:
+
+    virtual ~KCounter() {}
+
+    virtual uint16_t getMerLen() const = 0;
+
+    /**
+     * Counts all K-mers in the given sequence buffer, ignoring those which end
+     * within the first "seam" characters, as they were already counted from the
+     * previous buffer.  Thread safe.
+     */
+    virtual void count(const char* start, const char* end, size_t seam) = 0;
+
+    /**
+     * Adds the counts of this thread's slice of the hash to the spectrum.  Counts
+     * that are too large for the spectrum are added to the last element.
+     */
+    virtual void spectrum(uint16_t th_id, uint16_t nb_slices, vector<uint64_t>& spectrum) const = 0;
+
+    /**
+     * Creates a counter for K-mers of length merLen using the given slot.  Counters
+     * in use at the same time for different K values must have different slots.
+     */
+    static shared_ptr<KCounter> create(uint16_t slot, uint16_t merLen, uint64_t hashSize, bool canonical, bool growHash);
+};
+
+/**
+ * Counts K-mers for several K values from a single pass over the input.  The input
+ * is parsed once, with an overlap between buffers suitable for the largest K, and
+ * every worker thread feeds each buffer to all the counters.
+ *
+ * Optionally, the input files can also be assigned to groups (e.g. one per lane or
+ * library).  Each buffer is then also counted into a separate hash for its file's
+ * group, so per-group spectra come from the same pass as the merged one.
+ *
+ * .2bit files can't go through the parser, so their records are unpacked one at a
+ * time and shared out between the threads once the other files are done.
+ */
+class MultiKCounter {
+public:
+
+    MultiKCounter(const vector<uint16_t>& merLens, uint64_t hashSize, bool canonical, bool growHash);
+
+    /**
+     * @param fileGroups Group index for each input file, from 0.  Empty disables grouping.
+     */
+    MultiKCounter(const vector<uint16_t>& merLens, uint64_t hashSize, bool canonical, bool growHash,
+            const vector<uint16_t>& fileGroups);
+
+    void count(const vector<path>& seqFiles, uint16_t threads, const vector<uint16_t>& trim5p);
+
+    size_t size() const { return counters.size(); }
+
+    const KCounter& getCounter(size_t index) const { return *counters[index]; }
+
+    size_t nbGroups() const { return groupCounters.empty() ? 0 : groupCounters[0].size(); }
+
+    /**
+     * Counter for the given group, for the K value at index
+     */
+    const KCounter& getGroupCounter(size_t index, size_t group) const { return *groupCounters[index][group]; }
+
+private:
+
+    vector<shared_ptr<KCounter>> counters;
+    vector<vector<shared_ptr<KCounter>>> groupCounters;
+    vector<uint16_t> fileGroups;
+    uint16_t maxMerLen;
+
+    /**
+     * Counts buffers from the parser.  parserFiles gives the index in the input
+     * files of each file the parser reads.
+     */
+    void countSlice(SequenceParser& parser, const vector<size_t>& parserFiles);
+
+    /**
+     * Counts a buffer from the input file at index "file" into all counters
+     */
+    void countBuffer(const char* start, const char* end, size_t seam, size_t file);
+};
+
+}
@@ -0,0 +1,70 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+using std::pair;
+using std::string;
+using std::vector;
+
+#include <kat/sequence_index.hpp>
+#include <kat/two_bit.hpp>
+
+namespace kat {
+
+/**
+ * Sequences held in memory, packed four bases per byte in the same layout as
+ * the records of a .2bit file, so that they take a quarter of the space of the
+ * text and K-mers can be counted straight from the packed bases.  Runs of
+ * anything other than ACGT are held as N blocks, and runs of lower case as mask
+ * blocks.  Characters other than ACGTN are kept aside, so sequences come back
+ * exactly as they were added.
+ */
+class PackedSequences : public SequenceIndex {
+public:
+
+    /**
+     * Packs a sequence and appends it.  Not thread safe.
+     */
+    void add(const string& header, const string& seq);
+
+    size_t size() const { return records.size(); }
+
+    const TwoBitRecord& operator[](size_t index) const { return records[index]; }
+
+    uint64_t getLength(size_t index) const { return records[index].length; }
+
+    string getHeader(size_t index) const { return records[index].name; }
+
+    string getSequence(size_t index) const;
+
+    const uint8_t* getPacked(size_t index) const {
+        return packed.data() + records[index].dnaOffset;
+    }
+
+private:
+
+    vector<TwoBitRecord> records;
+    vector<vector<pair<uint64_t, char>>> others;   // Position and value of characters other than ACGTN, for each record
+    vector<uint8_t> packed;
+};
+
+}
@@ -0,0 +1,571 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace kat {
+
+    /**
+     * A fixed capacity FIFO shared between threads.  Producers block while the queue
+     * is full and consumers block while it is empty.  Once closed, pushes are refused
+     * and pops drain whatever is left before reporting the end of the stream.
+     */
+    template<typename T>
+    class BoundedQueue {
+    private:
+        std::deque<T> items;
+        size_t capacity;
+        bool closed;
+        std::mutex mtx;
+        std::condition_variable notFull;
+        std::condition_variable notEmpty;
+
+    public:
+
+        BoundedQueue(size_t _capacity) : capacity(_capacity < 1 ? 1 : _capacity), closed(false) {}
+
+        /**
+         * Adds an item to the back of the queue, waiting for space if necessary
+         * @return false if the queue was closed and the item was dropped
+         */
+        bool push(T item) {
+            std::unique_lock<std::mutex> lock(mtx);
+            notFull.wait(lock, [this]{ return closed || items.size() < capacity; });
+            if (closed) {
+                return false;
+            }
+            items.push_back(std::move(item));
+            notEmpty.notify_one();
+            return true;
+        }
+
+        /**
+         * Takes the item from the front of the queue, waiting for one if necessary
+         * @return false if the queue is closed and empty
+         */
+        bool pop(T& item) {
+            std::unique_lock<std::mutex> lock(mtx);
+            notEmpty.wait(lock, [this]{ return closed || !items.empty(); });
+            if (items.empty()) {
+                return false;
+            }
+            item = std::move(items.front());
+            items.pop_front();
+            notFull.notify_one();
+            return true;
+        }
+
+        /**
+         * Takes the item from the front of the queue if there is one, without waiting
+         * @return false if the queue is empty
+         */
+        bool tryPop(T& item) {
+            std::unique_lock<std::mutex> lock(mtx);
+            if (items.empty()) {
+                return false;
+            }
+            item = std::move(items.front());
+            items.pop_front();
+            notFull.notify_one();
+            return true;
+        }
+
+        /**
+         * True once the queue is closed and empty
+         */
+        bool isDone() {
+            std::unique_lock<std::mutex> lock(mtx);
+            return closed && items.empty();
+        }
+
+        void close() {
+            std::unique_lock<std::mutex> lock(mtx);
+            closed = true;
+            notFull.notify_all();
+            notEmpty.notify_all();
+        }
+    };
+
+
+    /**
+     * Lets a fixed set of threads share out the work of a large job between them.  A
+     * thread with a large range to process splits it into chunks with run(), and any
+     * other thread that would otherwise be idle claims chunks with help().  No threads
+     * are created, so the number doing the work never goes above the number calling
+     * run() and help(), and a slow chunk never holds the others up.
+     *
+     * Threads with nothing to do can wait() for a change, i.e. new chunks, a job
+     * finishing or a call to notify().  To avoid missing a change they should read
+     * getGeneration() before looking for work and pass it to wait().
+     */
+    class ChunkPool {
+    public:
+        typedef std::function<void(uint64_t, uint64_t)> ChunkFn;   // Processes the range [start, end)
+
+    private:
+
+        struct Job {
+            uint64_t n;
+            uint64_t chunkSize;
+            uint64_t nbChunks;
+            const ChunkFn* fn;
+            uint64_t claimed;
+            uint64_t finished;
+            std::exception_ptr error;
+        };
+
+        std::mutex mtx;
+        std::condition_variable changed;
+        std::deque<std::shared_ptr<Job>> jobs;     // Jobs with chunks left to claim
+        uint64_t generation;
+
+    public:
+
+        ChunkPool() : generation(0) {}
+
+        /**
+         * Splits the range [0, n) into chunks of at most chunkSize and processes them
+         * with the calling thread and any helping threads.  Small ranges that fit in a
+         * single chunk are processed directly.  Returns once every chunk is done, and
+         * rethrows the first exception thrown by fn.
+         */
+        void run(uint64_t n, uint64_t chunkSize, const ChunkFn& fn) {
+
+            chunkSize = chunkSize < 1 ? 1 : chunkSize;
+            const uint64_t nbChunks = (n + chunkSize - 1) / chunkSize;
+
+            if (nbChunks <= 1) {
+                if (n > 0) {
+                    fn(0, n);
+                }
+                return;
+            }
+
+            std::shared_ptr<Job> job = std::make_shared<Job>();
+            job->n = n;
+            job->chunkSize = chunkSize;
+            job->nbChunks = nbChunks;
+            job->fn = &fn;
+            job->claimed = 0;
+            job->finished = 0;
+
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                jobs.push_back(job);
+                generation++;
+            }
+            changed.notify_all();
+
+            // Work through our own chunks first, then help with anything else until
+            // the helpers have finished the last of ours
+            while (runChunk(job)) {}
+            while (true) {
+                const uint64_t gen = getGeneration();
+                {
+                    std::unique_lock<std::mutex> lock(mtx);
+                    if (job->finished == job->nbChunks) {
+                        break;
+                    }
+                }
+                if (!help()) {
+                    wait(gen);
+                }
+            }
+
+            if (job->error) {
+                std::rethrow_exception(job->error);
+            }
+        }
+
+        /**
+         * Processes a chunk of the oldest job with chunks left
+         * @return false if there was nothing to do
+         */
+        bool help() {
+            std::shared_ptr<Job> job;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                if (jobs.empty()) {
+                    return false;
+                }
+                job = jobs.front();
+            }
+            runChunk(job);
+            return true;
+        }
+
+        uint64_t getGeneration() {
+            std::unique_lock<std::mutex> lock(mtx);
+            return generation;
+        }
+
+        /**
+         * Wakes any waiting threads, e.g. when there's other work for them
+         */
+        void notify() {
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                generation++;
+            }
+            changed.notify_all();
+        }
+
+        /**
+         * Waits until something has changed since the given generation
+         */
+        void wait(uint64_t gen) {
+            std::unique_lock<std::mutex> lock(mtx);
+            changed.wait(lock, [&]{ return generation != gen; });
+        }
+
+    private:
+
+        // Claims and processes the next chunk of the job.  Chunks are skipped once the
+        // job has failed.  Returns false if all the job's chunks are already claimed.
+        bool runChunk(const std::shared_ptr<Job>& job) {
+
+            uint64_t c;
+            bool skip;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                if (job->claimed == job->nbChunks) {
+                    return false;
+                }
+                c = job->claimed++;
+                if (job->claimed == job->nbChunks) {
+                    jobs.erase(std::find(jobs.begin(), jobs.end(), job));
+                }
+                skip = job->error != nullptr;
+            }
+
+            std::exception_ptr error = nullptr;
+            if (!skip) {
+                try {
+                    (*job->fn)(c * job->chunkSize, std::min(job->n, (c + 1) * job->chunkSize));
+                }
+                catch(...) {
+                    error = std::current_exception();
+                }
+            }
+
+            bool last;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                if (error && !job->error) {
+                    job->error = error;
+                }
+                last = ++job->finished == job->nbChunks;
+                if (last) {
+                    generation++;
+                }
+            }
+            if (last) {
+                changed.notify_all();
+            }
+            return true;
+        }
+    };
+
+
+    /**
+     * Streams items through a reader, a pool of workers and any number of writers,
+     * each running in its own thread.  The reader fills items one after the other,
+     * workers process them in any order, and every writer then sees the items in
+     * the order they were read.  If ordering is turned off, writers see items as
+     * soon as they are processed instead, but still all in the same order.  At most
+     * maxInFlight items exist at once, so memory use is bounded however large the
+     * input is.
+     *
+     * Workers can be given a ChunkPool, which lets a worker split up a large item
+     * with ChunkPool::run().  The other workers then help with its chunks whenever
+     * they are between items or have none to take, so no extra threads are needed.
+     *
+     * The first exception thrown by any stage stops the pipeline and is rethrown
+     * from run().
+     */
+    template<typename T>
+    class Pipeline {
+    public:
+        typedef std::function<bool(T&)> Reader;                  // Fills the next item; false when the input is exhausted
+        typedef std::function<void(T&, uint16_t)> Worker;        // Processes an item on the given worker thread
+        typedef std::function<void(const T&)> Writer;            // Consumes items in input order
+
+    private:
+
+        struct Slot {
+            uint64_t id;
+            std::shared_ptr<T> item;
+            std::shared_ptr<std::atomic<size_t>> pending;
+        };
+
+        uint16_t workers;
+        size_t maxInFlight;
+        bool ordered;
+        std::vector<Writer> writers;
+        std::shared_ptr<ChunkPool> chunkPool;
+
+        // Run state
+        std::mutex mtx;
+        std::condition_variable slotFree;
+        size_t inFlight;
+        bool aborted;
+        std::exception_ptr error;
+        std::vector<std::shared_ptr<BoundedQueue<Slot>>> queues;
+
+    public:
+
+        Pipeline(uint16_t _workers, size_t _maxInFlight) :
+            workers(_workers < 1 ? 1 : _workers),
+            maxInFlight(_maxInFlight < 1 ? 1 : _maxInFlight),
+            ordered(true) {}
+
+        /**
+         * Whether writers see items in input order (the default) or as soon as
+         * they are processed.  Without ordering, a slow item never holds back the
+         * items read after it.
+         */
+        void setOrdered(bool ordered) {
+            this->ordered = ordered;
+        }
+
+        /**
+         * Workers help with the chunks of this pool whenever they are between items
+         */
+        void setChunkPool(std::shared_ptr<ChunkPool> chunkPool) {
+            this->chunkPool = chunkPool;
+        }
+
+        /**
+         * Adds a writer stage.  Each writer gets its own thread, so writers to
+         * different outputs don't hold each other up.
+         */
+        void addWriter(Writer writer) {
+            writers.push_back(writer);
+        }
+
+        void run(Reader read, Worker work) {
+
+            inFlight = 0;
+            aborted = false;
+            error = nullptr;
+
+            auto workQ = std::make_shared<BoundedQueue<Slot>>(maxInFlight);
+            auto doneQ = std::make_shared<BoundedQueue<Slot>>(maxInFlight);
+            std::vector<std::shared_ptr<BoundedQueue<Slot>>> writeQs;
+            for (size_t i = 0; i < writers.size(); i++) {
+                writeQs.push_back(std::make_shared<BoundedQueue<Slot>>(maxInFlight));
+            }
+
+            queues = writeQs;
+            queues.push_back(workQ);
+            queues.push_back(doneQ);
+
+            std::vector<std::thread> threads;
+
+            // Reader
+            threads.push_back(std::thread([&]() {
+                try {
+                    for (uint64_t id = 0; acquire(); id++) {
+                        Slot s;
+                        s.id = id;
+                        s.item = std::make_shared<T>();
+                        if (!read(*s.item)) {
+                            release();
+                            break;
+                        }
+                        if (!workQ->push(s)) {
+                            break;
+                        }
+                        if (chunkPool) chunkPool->notify();
+                    }
+                }
+                catch(...) {
+                    fail(std::current_exception());
+                }
+                workQ->close();
+                if (chunkPool) chunkPool->notify();
+            }));
+
+            // Workers
+            std::atomic<uint16_t> running(workers);
+            std::atomic<uint16_t> busy(0);      // Workers processing an item, which might add chunks
+            for (uint16_t i = 0; i < workers; i++) {
+                threads.push_back(std::thread([&, i]() {
+                    try {
+                        Slot s;
+                        if (!chunkPool) {
+                            while (workQ->pop(s)) {
+                                work(*s.item, i);
+                                if (!doneQ->push(s)) {
+                                    break;
+                                }
+                            }
+                        }
+                        else {
+                            // Chunks of items already in progress come first.  Workers
+                            // keep helping until no item is left that could add more.
+                            while (true) {
+                                const uint64_t gen = chunkPool->getGeneration();
+                                if (chunkPool->help()) {
+                                    continue;
+                                }
+                                busy++;
+                                if (workQ->tryPop(s)) {
+                                    try {
+                                        work(*s.item, i);
+                                    }
+                                    catch(...) {
+                                        busy--;
+                                        chunkPool->notify();
+                                        throw;
+                                    }
+                                    busy--;
+                                    chunkPool->notify();
+                                    if (!doneQ->push(s)) {
+                                        break;
+                                    }
+                                    continue;
+                                }
+                                if (--busy == 0 && workQ->isDone()) {
+                                    // Wake anyone else waiting to find the same
+                                    chunkPool->notify();
+                                    break;
+                                }
+                                chunkPool->wait(gen);
+                            }
+                        }
+                    }
+                    catch(...) {
+                        fail(std::current_exception());
+                    }
+                    if (--running == 0) {
+                        doneQ->close();
+                    }
+                }));
+            }
+
+            // Collector, which puts items back into input order for the writers
+            threads.push_back(std::thread([&]() {
+                try {
+                    std::map<uint64_t, Slot> waiting;
+                    uint64_t next = 0;
+                    Slot s;
+                    while (doneQ->pop(s)) {
+                        // Without ordering, every item is next
+                        if (!ordered) {
+                            s.id = next;
+                        }
+                        waiting[s.id] = s;
+                        for (auto it = waiting.find(next); it != waiting.end(); it = waiting.find(++next)) {
+                            Slot ready = it->second;
+                            waiting.erase(it);
+                            if (writeQs.empty()) {
+                                release();
+                                continue;
+                            }
+                            ready.pending = std::make_shared<std::atomic<size_t>>(writeQs.size());
+                            for (auto& q : writeQs) {
+                                q->push(ready);
+                            }
+                        }
+                    }
+                }
+                catch(...) {
+                    fail(std::current_exception());
+                }
+                for (auto& q : writeQs) {
+                    q->close();
+                }
+            }));
+
+            // Writers
+            for (size_t i = 0; i < writers.size(); i++) {
+                threads.push_back(std::thread([&, i]() {
+                    try {
+                        Slot s;
+                        while (writeQs[i]->pop(s)) {
+                            writers[i](*s.item);
+                            if (--(*s.pending) == 0) {
+                                release();
+                            }
+                        }
+                    }
+                    catch(...) {
+                        fail(std::current_exception());
+                    }
+                }));
+            }
+
+            for (auto& t : threads) {
+                t.join();
+            }
+
+            queues.clear();
+
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+
+    private:
+
+        bool acquire() {
+            std::unique_lock<std::mutex> lock(mtx);
+            slotFree.wait(lock, [this]{ return aborted || inFlight < maxInFlight; });
+            if (aborted) {
+                return false;
+            }
+            inFlight++;
+            return true;
+        }
+
+        void release() {
+            std::unique_lock<std::mutex> lock(mtx);
+            inFlight--;
+            slotFree.notify_one();
+        }
+
+        void fail(std::exception_ptr e) {
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                if (!error) {
+                    error = e;
+                }
+                aborted = true;
+                slotFree.notify_all();
+            }
+            for (auto& q : queues) {
+                q->close();
+            }
+            if (chunkPool) chunkPool->notify();
+        }
+    };
+
+}
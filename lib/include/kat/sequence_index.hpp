@@ -0,0 +1,65 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+using std::shared_ptr;
+using std::string;
+
+#include <boost/filesystem/path.hpp>
+using boost::filesystem::path;
+
+namespace kat {
+
+/**
+ * A sequence file whose records can be extracted in any order, and from any
+ * thread, once opened.
+ */
+class SequenceIndex {
+public:
+
+    virtual ~SequenceIndex() {}
+
+    virtual size_t size() const = 0;
+
+    /**
+     * Number of bases in a record
+     */
+    virtual uint64_t getLength(size_t index) const = 0;
+
+    /**
+     * Returns the full name line of a record
+     */
+    virtual string getHeader(size_t index) const = 0;
+
+    /**
+     * Returns the bases of a record, as they would appear in FastA
+     */
+    virtual string getSequence(size_t index) const = 0;
+
+    /**
+     * Opens a .2bit file or an uncompressed FastA file for random access.
+     * Throws a TwoBitException if a .2bit file is corrupt, or a
+     * FastaIndexException if the file is a pipe or can't be indexed as FastA.
+     */
+    static shared_ptr<SequenceIndex> open(const path& file);
+};
+
+}
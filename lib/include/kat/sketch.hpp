@@ -0,0 +1,172 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+using std::function;
+using std::unique_ptr;
+using std::vector;
+
+#include <boost/exception/all.hpp>
+#include <boost/filesystem/path.hpp>
+using boost::filesystem::path;
+
+#include <jellyfish/mer_dna.hpp>
+using jellyfish::mer_dna;
+
+namespace kat {
+
+typedef boost::error_info<struct SketchError,string> SketchErrorInfo;
+struct SketchException: virtual boost::exception, virtual std::exception { };
+
+/**
+ * Count-min sketch with conservative update.  Counts are never underestimated,
+ * and each count is overestimated by at most epsilon() * getTotal() with
+ * probability 1 - delta().  Items are identified by a 64 bit hash, which must
+ * be uniformly distributed.  Thread safe.
+ */
+class CountMinSketch {
+public:
+
+    /**
+     * @param memory Maximum number of bytes to use for the counters
+     * @param depth Number of rows, i.e. hash functions
+     */
+    CountMinSketch(uint64_t memory, uint16_t depth = 4);
+
+    void add(uint64_t hash) {
+        update(hash);
+        addTotal(1);
+    }
+
+    /**
+     * Adds an item without adding it to the total.  Threads adding many items
+     * should count them locally and call addTotal once, rather than all updating
+     * the shared total for every item.
+     */
+    void update(uint64_t hash);
+
+    void addTotal(uint64_t n) { total.fetch_add(n, std::memory_order_relaxed); }
+
+    uint32_t estimate(uint64_t hash) const;
+
+    uint64_t getWidth() const { return mask + 1; }
+    uint16_t getDepth() const { return depth; }
+
+    /**
+     * Total number of items added
+     */
+    uint64_t getTotal() const { return total.load(); }
+
+    double epsilon() const;
+    double delta() const;
+
+    /**
+     * Maximum overestimate of any count, with probability 1 - delta()
+     */
+    uint64_t errorBound() const;
+
+private:
+
+    // Conservative update must not race with another update of the same item,
+    // otherwise both could read the same minimum and one increment would be lost
+    static const uint32_t NB_LOCKS = 4096;
+
+    uint16_t depth;
+    uint64_t mask;
+    unique_ptr<std::atomic<uint32_t>[]> cells;
+    unique_ptr<std::atomic_flag[]> locks;
+    std::atomic<uint64_t> total;
+
+    uint64_t cell(uint64_t hash, uint16_t row) const;
+};
+
+/**
+ * HyperLogLog estimator for the number of distinct items.  Items are identified
+ * by a 64 bit hash, which must be uniformly distributed.  Thread safe.
+ */
+class HyperLogLog {
+public:
+
+    HyperLogLog(uint16_t precision = 14);
+
+    void add(uint64_t hash);
+
+    uint64_t estimate() const;
+
+    /**
+     * Relative standard error of the estimate
+     */
+    double standardError() const;
+
+private:
+    uint16_t precision;
+    vector<std::atomic<uint8_t>> registers;
+};
+
+/**
+ * Approximate K-mer counting in a fixed amount of memory.  K-mers are counted
+ * into a count-min sketch on a first pass over the input, then visit() reads the
+ * input again, reporting each K-mer occurrence along with its estimated count.
+ * Every occurrence of a K-mer receives the same estimate, so a spectrum can be
+ * built by adding 1/count for each occurrence.  That only adds one per distinct
+ * K-mer when its estimate is exact.  A K-mer seen t times but estimated at c > t
+ * adds t/c to bin c, so on a sketch with collisions the low bins and the total are
+ * biased down.  distinctScale() corrects the total.  The input must be regular
+ * files, as they are read twice.
+ */
+class ApproxCounter {
+public:
+
+    ApproxCounter(uint16_t merLen, uint64_t memory, bool canonical);
+
+    /**
+     * First pass, counts all K-mers in the input
+     */
+    void count(const vector<path>& seqFiles, uint16_t threads, const vector<uint16_t>& trim5p);
+
+    /**
+     * Second pass, calls visitor with the thread id, K-mer and estimated count for
+     * each K-mer occurrence in the input.
+     */
+    void visit(const vector<path>& seqFiles, uint16_t threads, const vector<uint16_t>& trim5p,
+            function<void(uint16_t, const mer_dna&, uint32_t)> visitor) const;
+
+    /**
+     * Factor that scales a spectrum built from visit(), whose 1/count weights sum to
+     * weightTotal, so that its total matches the HyperLogLog estimate of distinct
+     * K-mers.  1 if there are no weights, or if they fall short of the estimate by
+     * no more than its standard error.
+     */
+    double distinctScale(double weightTotal) const;
+
+    const CountMinSketch& getSketch() const { return cms; }
+    const HyperLogLog& getDistinct() const { return hll; }
+
+private:
+    uint16_t merLen;
+    bool canonical;
+    CountMinSketch cms;
+    HyperLogLog hll;
+};
+
+}
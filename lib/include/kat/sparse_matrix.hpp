@@ -17,8 +17,11 @@
 
 #pragma once
 
+#include <cmath>
 #include <cstdlib>
+#include <atomic>
 #include <map>
+#include <memory>
 #include <vector>
 #include <iostream>
 #include <fstream>
@@ -31,6 +34,8 @@ using bfs::path;
 using boost::lexical_cast;
 
 #include <kat/str_utils.hpp>
+#include <kat/binary_matrix.hpp>
+#include <kat/text_parser.hpp>
 
 using std::cout;
 using std::endl;
@@ -39,6 +44,7 @@ using std::ifstream;
 using std::string;
 using std::vector;
 using std::map;
+using std::shared_ptr;
 
 namespace kat{
 
@@ -67,35 +73,26 @@ public:
 
     /**
      * @brief SparseMatrix Loads a sparse matrix from file.  NOTE, matrix must contain uint64_t!!
+     * Both text and binary matrix files are supported.
      * @param file_path path to the file containing the sparse matrix
      */
     SparseMatrix(const path& file_path) {
-        ifstream infile;
-        infile.open(file_path.c_str());
 
-        string line("");
-
-        uint32_t i = 0;
-        while (!infile.eof()) {
-            getline(infile, line);
-
-            // Only do something if the start of the line isn't a #
-            if (!line.empty() && line[0] != '#') {
-                vector<uint64_t> parts = kat::splitUInt64(line, ' ');
+        if (BinaryMatrix::isBinaryMatrix(file_path)) {
+            loadBinary(file_path);
+            return;
+        }
 
-                n = parts.size();
+        vector<uint64_t> cells;
+        TextParser::parseMatrix(file_path, cells, m, n);
 
-                for (uint32_t j = 0; j < parts.size(); j++) {
-                    mat[i][j] = parts[j];
+        for (uint32_t i = 0; i < m; i++) {
+            for (uint32_t j = 0; j < n; j++) {
+                if (cells[(uint64_t)i * n + j] != 0) {
+                    mat[i][j] = cells[(uint64_t)i * n + j];
                 }
-
-                i++;
             }
         }
-
-        infile.close();
-
-        m = i;
     }
 
     inline
@@ -151,6 +148,18 @@ public:
 
     }
 
+    /**
+     * Multiplies every cell by the given factor, rounding to the nearest integer.
+     * Used to scale up counts derived from a sample.
+     */
+    void scale(double factor) {
+        for (auto& row : mat) {
+            for (auto& cell : row.second) {
+                cell.second = (T)std::llround((double)cell.second * factor);
+            }
+        }
+    }
+
     uint32_t width() const {
         return m;
     }
@@ -252,6 +261,24 @@ public:
         printMatrix(out, false);
     }
 
+    /**
+     * Saves this matrix to file in binary format
+     * @param file_path Output file
+     * @param metadata Metadata block, as would be written at the top of a text matrix
+     */
+    void saveBinary(const path& file_path, const string& metadata) const {
+        vector<BinaryMatrixEntry> entries;
+        for (auto& row : mat) {
+            for (auto& cell : row.second) {
+                if (cell.second != 0) {
+                    entries.push_back(BinaryMatrixEntry{row.first, cell.first, (uint64_t)cell.second});
+                }
+            }
+        }
+
+        BinaryMatrix::write(file_path, m, n, entries, metadata);
+    }
+
     void printMatrix(ostream &out, bool transpose) const {
         if (transpose) {
             // Transpose matrix
@@ -282,51 +309,159 @@ private:
     mat_t mat;
     uint32_t m;
     uint32_t n;
+
+    void loadBinary(const path& file_path) {
+        BinaryMatrix bm(file_path);
+
+        m = bm.rows();
+        n = bm.cols();
+
+        if (bm.isDense()) {
+            for (uint32_t i = 0; i < m; i++) {
+                for (uint32_t j = 0; j < n; j++) {
+                    const uint64_t v = bm.cell((uint64_t)i * n + j);
+                    if (v != 0) {
+                        mat[i][j] = v;
+                    }
+                }
+            }
+        }
+        else {
+            for (uint64_t k = 0; k < bm.nnz(); k++) {
+                const BinaryMatrixEntry e = bm.entry(k);
+                mat[e.row][e.col] = e.val;
+            }
+        }
+    }
 };
 
 typedef SparseMatrix<uint64_t> SM64;
 
+/**
+ * Collects matrix increments from multiple threads.  There are two strategies:
+ *
+ *  - PER_THREAD: each thread gets its own sparse matrix which are summed when
+ *    merging.  Cheap for small matrices or few threads, but memory scales with
+ *    the thread count.
+ *  - SHARED: a single dense matrix updated with relaxed atomic increments.  To
+ *    avoid hammering the same cache lines from every thread, each thread first
+ *    accumulates into a small direct-mapped write-combining buffer, which
+ *    captures the hot, low count cells.  Memory is independent of thread count.
+ *
+ * By default the strategy is chosen from the matrix size and thread count.
+ */
 class ThreadedSparseMatrix {
+public:
+
+    enum class Mode {
+        AUTO,
+        PER_THREAD,
+        SHARED
+    };
+
+    // Use the shared matrix once per thread copies would cover more than this many cells
+    static const uint64_t SHARED_MODE_CELLS = 1 << 24;
+
+    // Number of entries in each thread's write-combining buffer (must be a power of 2)
+    static const uint32_t WC_BUFFER_SIZE = 256;
+
 private:
 
+    struct WCSlot {
+        uint64_t cell = UINT64_MAX;
+        uint64_t count = 0;
+    };
+
     uint16_t width;
     uint16_t height;
     uint16_t threads;
+    bool shared;
 
     SM64 final_matrix;
     vector<SM64> threaded_matricies;
 
+    // Shared mode only
+    shared_ptr<std::atomic<uint64_t>> shared_cells;
+    vector<vector<WCSlot>> wc_buffers;
+
+    void flush(WCSlot& slot) {
+        if (slot.count > 0) {
+            (shared_cells.get() + slot.cell)->fetch_add(slot.count, std::memory_order_relaxed);
+            slot.count = 0;
+        }
+    }
+
 public:
 
     ThreadedSparseMatrix() : ThreadedSparseMatrix(0, 0, 0) {};
 
-    ThreadedSparseMatrix(uint16_t _width, uint16_t _height, uint16_t _threads) :
+    ThreadedSparseMatrix(uint16_t _width, uint16_t _height, uint16_t _threads, Mode mode = Mode::AUTO) :
     width(_width), height(_height), threads(_threads) {
         final_matrix = SM64(width, height);
-        threaded_matricies = vector<SM64>(threads);
 
-        for (int i = 0; i < threads; i++) {
-            threaded_matricies[i] = SM64(width, height);
+        const uint64_t cells = (uint64_t)width * (uint64_t)height;
+        shared = mode == Mode::SHARED ||
+                (mode == Mode::AUTO && threads > 1 && cells * threads > SHARED_MODE_CELLS);
+
+        if (shared) {
+            // Value initialisation zeroes the atomics
+            shared_cells = shared_ptr<std::atomic<uint64_t>>(new std::atomic<uint64_t>[cells](),
+                    std::default_delete<std::atomic<uint64_t>[]>());
+            wc_buffers = vector<vector<WCSlot>>(threads, vector<WCSlot>(WC_BUFFER_SIZE));
+        }
+        else {
+            threaded_matricies = vector<SM64>(threads);
+
+            for (int i = 0; i < threads; i++) {
+                threaded_matricies[i] = SM64(width, height);
+            }
         }
     }
 
     virtual ~ThreadedSparseMatrix() {
     }
 
+    bool isShared() const {
+        return shared;
+    }
+
     const SM64& getFinalMatrix() const {
         return final_matrix;
     }
 
+    /**
+     * Returns the matrix for the given thread.  Only populated in PER_THREAD mode.
+     */
     const SM64& getThreadMatrix(uint16_t index) const {
         return threaded_matricies[index];
     }
 
     const SM64& mergeThreadedMatricies() {
-		// Merge matrix
-        for (int i = 0; i < width; i++) {
-            for (int j = 0; j < height; j++) {
-                for (int k = 0; k < threads; k++) {
-                    final_matrix.inc(i, j, threaded_matricies[k].get(i, j));
+
+        if (shared) {
+            for (auto& buffer : wc_buffers) {
+                for (auto& slot : buffer) {
+                    flush(slot);
+                }
+            }
+
+            const std::atomic<uint64_t>* cells = shared_cells.get();
+            for (uint32_t i = 0; i < width; i++) {
+                for (uint32_t j = 0; j < height; j++) {
+                    const uint64_t val = cells[(uint64_t)i * height + j].load(std::memory_order_relaxed);
+                    if (val > 0) {
+                        final_matrix.inc(i, j, val);
+                    }
+                }
+            }
+        }
+        else {
+            // Merge matrix
+            for (int i = 0; i < width; i++) {
+                for (int j = 0; j < height; j++) {
+                    for (int k = 0; k < threads; k++) {
+                        final_matrix.inc(i, j, threaded_matricies[k].get(i, j));
+                    }
                 }
             }
         }
@@ -334,8 +469,33 @@ public:
         return final_matrix;
     }
 
-    uint64_t incTM(uint16_t index, size_t i, size_t j, uint64_t val) {
-        return threaded_matricies[index].inc(i, j, val);
+    /**
+     * Adds val to cell (i, j) on behalf of the given thread.  Increments outside the
+     * bounds of the matrix are dropped, as they would never make it into the final
+     * matrix.
+     */
+    void incTM(uint16_t index, size_t i, size_t j, uint64_t val) {
+
+        if (!shared) {
+            threaded_matricies[index].inc(i, j, val);
+            return;
+        }
+
+        if (i >= width || j >= height) {
+            return;
+        }
+
+        const uint64_t cell = (uint64_t)i * height + j;
+        WCSlot& slot = wc_buffers[index][cell & (WC_BUFFER_SIZE - 1)];
+        if (slot.cell != cell) {
+            flush(slot);
+            slot.cell = cell;
+        }
+        slot.count += val;
+    }
+
+    void scaleFinalMatrix(double factor) {
+        final_matrix.scale(factor);
     }
 
 };
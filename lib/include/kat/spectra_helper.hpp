@@ -40,6 +40,8 @@ namespace bfs = boost::filesystem;
 using bfs::path;
 using boost::lexical_cast;
 
+#include <kat/text_parser.hpp>
+
 typedef pair<uint32_t, uint64_t> Pos;
 typedef pair<uint32_t, uint32_t> Coord;
 
@@ -152,23 +154,12 @@ namespace kat {
 
         static void loadHist(const path& histFile, vector<Pos>& histo) {
 
-            ifstream in(histFile.c_str());
-            string line;
-            uint64_t linenb = 0;
-            while (getline(in, line)) {
-                istringstream iss(line);
-                uint32_t bin;
-                uint64_t val;
-                linenb++;
-
-                if (line[0] != '#') {
-                    if (!(iss >> bin >> val)) {
-                        BOOST_THROW_EXCEPTION(SpectraHelperException() << SpectraHelperErrorInfo(string(
-                            "Encountered unexpected syntax on line ") + lexical_cast<string>(linenb)));
-                    }
-
-                    histo.push_back(Pos(bin,val));
-                }
+            try {
+                TextParser::parseHistogram(histFile, histo);
+            }
+            catch(TextParserException& e) {
+                BOOST_THROW_EXCEPTION(SpectraHelperException() << SpectraHelperErrorInfo(
+                    *boost::get_error_info<TextParserErrorInfo>(e)));
             }
         }
 
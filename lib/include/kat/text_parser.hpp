@@ -0,0 +1,161 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <utility>
+#include <vector>
+using std::pair;
+using std::string;
+using std::vector;
+
+#include <boost/exception/all.hpp>
+#include <boost/filesystem/path.hpp>
+using boost::filesystem::path;
+
+#include <jellyfish/mapped_file.hpp>
+
+#include <kat/byte_order.hpp>
+
+namespace kat {
+
+typedef boost::error_info<struct TextParserError,string> TextParserErrorInfo;
+struct TextParserException: virtual boost::exception, virtual std::exception { };
+
+/**
+ * Parses an unsigned decimal integer starting at p, leaving p pointing at the
+ * first character after the number.  Eight digits are converted at a time
+ * where possible (SWAR), which matters for the large counts found in KAT
+ * matrices and histograms.
+ * @return false if p does not point at a digit or the value overflows
+ */
+inline bool parseUInt64(const char*& p, const char* end, uint64_t& val) {
+
+    const char* start = p;
+    uint64_t v = 0;
+
+    while (end - p >= 8) {
+        // Load the bytes little endian whatever the host, so the first character is
+        // always in the lowest byte
+        uint64_t chunk;
+        memcpy(&chunk, p, sizeof(chunk));
+        chunk = littleEndian(chunk);
+
+        // Stop unless all 8 bytes are in the range '0' to '9'
+        if ((((chunk & 0xF0F0F0F0F0F0F0F0ULL) |
+                (((chunk + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4))) != 0x3333333333333333ULL) {
+            break;
+        }
+
+        // Combine digit pairs, then pairs of pairs, then pairs of quads
+        chunk = ((chunk & 0x0F0F0F0F0F0F0F0FULL) * 2561) >> 8;
+        chunk = ((chunk & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;
+        chunk = ((chunk & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32;
+
+        v = v * 100000000ULL + chunk;
+        p += 8;
+    }
+
+    while (p < end && *p >= '0' && *p <= '9') {
+        v = v * 10 + (*p - '0');
+        p++;
+    }
+
+    val = v;
+
+    // 20 digits is the most a uint64 can hold; treat anything longer as an error
+    return p != start && (p - start < 20 || (p - start == 20 && memcmp(start, "18446744073709551615", 20) <= 0));
+}
+
+/**
+ * Read only view over a KAT text output file (matrix or histogram).  Regular
+ * files are memory mapped, anything that can't be mapped, such as a pipe, is
+ * read into memory instead.
+ */
+class MappedTextFile {
+public:
+
+    MappedTextFile(const path& file);
+
+    const char* begin() const { return data; }
+    const char* end() const { return data + length; }
+
+    /**
+     * Returns the first byte after the leading block of '#' lines
+     */
+    const char* dataBegin() const;
+
+    /**
+     * Returns the leading block of '#' lines, i.e. the file's metadata
+     */
+    string header() const {
+        return string(begin(), dataBegin());
+    }
+
+    /**
+     * Splits the data section into at most n chunks of roughly equal size.  Each
+     * chunk starts at the beginning of a line and ends after a newline or at the
+     * end of the file.
+     */
+    vector<pair<const char*, const char*>> chunks(size_t n) const;
+
+    /**
+     * Returns the 1-based line number containing the given position.  Only
+     * intended for error reporting.
+     */
+    uint64_t lineNumber(const char* pos) const;
+
+    const path& getPath() const { return file; }
+
+private:
+    path file;
+    jellyfish::mapped_file mapped;
+    string buffer;
+    const char* data;
+    size_t length;
+};
+
+class TextParser {
+public:
+
+    // Don't bother splitting files smaller than this across threads
+    static const size_t MIN_CHUNK_SIZE = 1 << 20;
+
+    /**
+     * Parses a whitespace separated matrix of unsigned integers, ignoring any
+     * lines starting with '#'.  Large files are parsed in parallel.
+     * @param file Text matrix file
+     * @param cells Receives the cells in row-major order
+     * @param rows Receives the number of rows
+     * @param cols Receives the number of columns
+     * @param threads Maximum number of threads to use.  0 uses all available cores.
+     */
+    static void parseMatrix(const path& file, vector<uint64_t>& cells, uint32_t& rows, uint32_t& cols, uint16_t threads = 0);
+
+    /**
+     * Parses a KAT histogram file, i.e. "bin count" lines, ignoring any lines
+     * starting with '#'
+     * @param file Text histogram file
+     * @param histo Receives the (bin, count) pairs
+     */
+    static void parseHistogram(const path& file, vector<pair<uint32_t, uint64_t>>& histo);
+};
+
+}
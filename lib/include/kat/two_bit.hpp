@@ -0,0 +1,103 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+using std::pair;
+using std::string;
+using std::vector;
+
+#include <boost/exception/all.hpp>
+#include <boost/filesystem/path.hpp>
+using boost::filesystem::path;
+
+#include <jellyfish/mapped_file.hpp>
+
+#include <kat/sequence_index.hpp>
+
+namespace kat {
+
+typedef boost::error_info<struct TwoBitError,string> TwoBitErrorInfo;
+struct TwoBitException: virtual boost::exception, virtual std::exception { };
+
+/**
+ * A record in a .2bit file.  Blocks are (start, length) pairs, sorted by start.
+ */
+struct TwoBitRecord {
+    string name;
+    uint64_t length;                            // Number of bases
+    vector<pair<uint64_t, uint64_t>> nBlocks;   // Runs of Ns
+    vector<pair<uint64_t, uint64_t>> maskBlocks;// Runs of soft masked (lower case) bases
+    uint64_t dnaOffset;                         // File offset of the packed bases
+};
+
+/**
+ * Read only view over a UCSC .2bit file.  The file is memory mapped and the
+ * packed bases of each record are available directly, four bases per byte with
+ * the first base in the two most significant bits, coded T=0, C=1, A=2, G=3.
+ * Positions within N blocks hold T in the packed data.  Both byte orders and
+ * the 64 bit offset variant (version 1) of the format are supported.
+ */
+class TwoBitFile : public SequenceIndex {
+public:
+
+    static const uint32_t SIGNATURE = 0x1A412743;
+
+    TwoBitFile(const path& file);
+
+    size_t size() const { return records.size(); }
+
+    const TwoBitRecord& operator[](size_t index) const { return records[index]; }
+
+    uint64_t getLength(size_t index) const { return records[index].length; }
+
+    /**
+     * .2bit records only have a name
+     */
+    string getHeader(size_t index) const { return records[index].name; }
+
+    /**
+     * Unpacks a record to upper case bases, with Ns and lower case masking restored
+     */
+    string getSequence(size_t index) const;
+
+    /**
+     * Unpacks the bases of any record in the .2bit layout, e.g. one held in memory
+     */
+    static string unpack(const TwoBitRecord& record, const uint8_t* packed);
+
+    const uint8_t* getPacked(size_t index) const {
+        return reinterpret_cast<const uint8_t*>(twoBit.base()) + records[index].dnaOffset;
+    }
+
+    /**
+     * Returns true if the given file starts with the .2bit signature, in either byte order
+     */
+    static bool isTwoBit(const path& file);
+
+private:
+
+    path file;
+    jellyfish::mapped_file twoBit;
+    vector<TwoBitRecord> records;
+};
+
+}
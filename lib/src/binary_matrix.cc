@@ -0,0 +1,194 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#include <algorithm>
+#include <fstream>
+#include <string.h>
+using std::ifstream;
+using std::ofstream;
+
+#include <boost/lexical_cast.hpp>
+using boost::lexical_cast;
+
+#include <kat/binary_matrix.hpp>
+
+const char kat::BinaryMatrix::MAGIC[8] = {'K', 'A', 'T', 'B', 'I', 'N', 'M', 'X'};
+const uint32_t kat::BinaryMatrix::VERSION;
+const uint64_t kat::BinaryMatrix::ALIGNMENT;
+
+namespace {
+
+    // Converts every integer in the header between host order and little endian
+    kat::BinaryMatrixHeader convertHeader(kat::BinaryMatrixHeader h) {
+        using kat::littleEndian;
+        h.version = littleEndian(h.version);
+        h.storage = littleEndian(h.storage);
+        h.rows = littleEndian(h.rows);
+        h.cols = littleEndian(h.cols);
+        h.nnz = littleEndian(h.nnz);
+        h.meta_offset = littleEndian(h.meta_offset);
+        h.meta_len = littleEndian(h.meta_len);
+        h.data_offset = littleEndian(h.data_offset);
+        return h;
+    }
+}
+
+kat::BinaryMatrix::BinaryMatrix(const path& file) {
+
+    try {
+        mxFile.map(file.c_str());
+    }
+    catch(jellyfish::mapped_file::ErrorMMap& e) {
+        BOOST_THROW_EXCEPTION(BinaryMatrixException() << BinaryMatrixErrorInfo(string(
+                "Could not map binary matrix file: ") + file.string() + "; " + e.what()));
+    }
+
+    if (mxFile.length() < sizeof(BinaryMatrixHeader) || memcmp(mxFile.base(), MAGIC, sizeof(MAGIC)) != 0) {
+        BOOST_THROW_EXCEPTION(BinaryMatrixException() << BinaryMatrixErrorInfo(string(
+                "Not a binary KAT matrix file: ") + file.string()));
+    }
+
+    memcpy(&header, mxFile.base(), sizeof(header));
+    header = convertHeader(header);
+
+    if (header.version > VERSION) {
+        BOOST_THROW_EXCEPTION(BinaryMatrixException() << BinaryMatrixErrorInfo(string(
+                "Binary matrix file ") + file.string() + " has format version " +
+                lexical_cast<string>(header.version) + " which is newer than the supported version: " +
+                lexical_cast<string>(VERSION)));
+    }
+
+    // Check each step by division, so that a corrupt header can't overflow its
+    // way past the checks
+    const uint64_t len = mxFile.length();
+    bool valid = header.meta_offset <= header.data_offset &&
+            header.meta_len <= header.data_offset - header.meta_offset &&
+            header.data_offset <= len;
+    if (valid) {
+        const uint64_t avail = len - header.data_offset;
+        valid = isDense() ?
+            header.cols == 0 || header.rows <= avail / sizeof(uint64_t) / header.cols :
+            header.nnz <= avail / sizeof(BinaryMatrixEntry);
+    }
+
+    if (!valid) {
+        BOOST_THROW_EXCEPTION(BinaryMatrixException() << BinaryMatrixErrorInfo(string(
+                "Binary matrix file is truncated or corrupt: ") + file.string()));
+    }
+}
+
+uint64_t kat::BinaryMatrix::get(uint64_t i, uint64_t j) const {
+
+    if (i >= rows() || j >= cols()) {
+        BOOST_THROW_EXCEPTION(BinaryMatrixException() << BinaryMatrixErrorInfo(string(
+                "Requested coords exceed limits of matrix.  Coords: ") +
+                lexical_cast<string>(i) + "," + lexical_cast<string>(j) + ".  Limits: " +
+                lexical_cast<string>(rows()) + "," + lexical_cast<string>(cols())));
+    }
+
+    if (isDense()) {
+        return cell(i * cols() + j);
+    }
+
+    // Binary search over the sorted entries
+    uint64_t lo = 0, hi = nnz();
+    while (lo < hi) {
+        const uint64_t mid = lo + (hi - lo) / 2;
+        const BinaryMatrixEntry e = entry(mid);
+        if (e.row < i || (e.row == i && e.col < j)) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+
+    if (lo == nnz()) {
+        return 0;
+    }
+    const BinaryMatrixEntry e = entry(lo);
+    return e.row == i && e.col == j ? e.val : 0;
+}
+
+bool kat::BinaryMatrix::isBinaryMatrix(const path& file) {
+    char magic[sizeof(MAGIC)];
+    ifstream in(file.c_str(), std::ios::binary);
+    if (!in.read(magic, sizeof(magic))) {
+        return false;
+    }
+    return memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+void kat::BinaryMatrix::write(const path& file, uint64_t rows, uint64_t cols,
+        const vector<BinaryMatrixEntry>& entries, const string& metadata) {
+
+    // Use whichever payload is smaller
+    const bool dense = entries.size() * sizeof(BinaryMatrixEntry) >= rows * cols * sizeof(uint64_t);
+
+    BinaryMatrixHeader h;
+    memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = VERSION;
+    h.storage = static_cast<uint32_t>(dense ? Storage::DENSE : Storage::SPARSE);
+    h.rows = rows;
+    h.cols = cols;
+    h.nnz = entries.size();
+    h.meta_offset = sizeof(BinaryMatrixHeader);
+    h.meta_len = metadata.size();
+    h.data_offset = ((h.meta_offset + h.meta_len + ALIGNMENT - 1) / ALIGNMENT) * ALIGNMENT;
+
+    ofstream out(file.c_str(), std::ios::binary | std::ios::trunc);
+    if (!out) {
+        BOOST_THROW_EXCEPTION(BinaryMatrixException() << BinaryMatrixErrorInfo(string(
+                "Could not open binary matrix file for writing: ") + file.string()));
+    }
+
+    const BinaryMatrixHeader le = convertHeader(h);
+    out.write(reinterpret_cast<const char*>(&le), sizeof(le));
+    out.write(metadata.data(), metadata.size());
+
+    const string padding(h.data_offset - h.meta_offset - h.meta_len, '\0');
+    out.write(padding.data(), padding.size());
+
+    if (dense) {
+        // Write out one row at a time so we never hold the full dense matrix
+        vector<uint64_t> row(cols);
+        auto e = entries.begin();
+        for (uint64_t i = 0; i < rows; i++) {
+            std::fill(row.begin(), row.end(), 0);
+            for (; e != entries.end() && e->row == i; ++e) {
+                row[e->col] = littleEndian(e->val);
+            }
+            out.write(reinterpret_cast<const char*>(row.data()), cols * sizeof(uint64_t));
+        }
+    }
+    else if (isLittleEndianHost()) {
+        out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(BinaryMatrixEntry));
+    }
+    else {
+        for (auto& e : entries) {
+            const BinaryMatrixEntry le{littleEndian(e.row), littleEndian(e.col), littleEndian(e.val)};
+            out.write(reinterpret_cast<const char*>(&le), sizeof(le));
+        }
+    }
+
+    if (!out) {
+        BOOST_THROW_EXCEPTION(BinaryMatrixException() << BinaryMatrixErrorInfo(string(
+                "Error writing binary matrix file: ") + file.string()));
+    }
+
+    out.close();
+}
@@ -57,6 +57,7 @@ kat::CompCounters::CompCounters(const path& _hash1_path, const path& _hash2_path
     shared_hash1_total = 0;
     shared_hash2_total = 0;
     shared_distinct = 0;
+    sample_fraction = 1.0;
     
     spectrum1.resize(_dm_size, 0);
     spectrum2.resize(_dm_size, 0);
@@ -86,6 +87,7 @@ kat::CompCounters::CompCounters(const CompCounters& o) {
     spectrum2 = o.spectrum2;
     shared_spectrum1 = o.shared_spectrum1;
     shared_spectrum2 = o.shared_spectrum2;
+    sample_fraction = o.sample_fraction;
 }
 
 void kat::CompCounters::updateHash1Counters(const uint64_t hash1_count, const uint64_t hash2_count) {
@@ -141,6 +143,38 @@ void kat::CompCounters::updateSpectrum(vector<uint64_t>& spectrum, const uint64_
 
 
 
+void kat::CompCounters::scale(const double sampleFraction) {
+
+    sample_fraction = sampleFraction;
+
+    if (sampleFraction >= 1.0)
+        return;
+
+    const double factor = 1.0 / sampleFraction;
+
+    for (uint64_t* c : {&hash1_total, &hash2_total, &hash3_total,
+                        &hash1_distinct, &hash2_distinct, &hash3_distinct,
+                        &hash1_only_total, &hash2_only_total,
+                        &hash1_only_distinct, &hash2_only_distinct,
+                        &shared_hash1_total, &shared_hash2_total, &shared_distinct}) {
+        *c = (uint64_t)std::llround((double)*c * factor);
+    }
+
+    for (vector<uint64_t>* s : {&spectrum1, &spectrum2, &shared_spectrum1, &shared_spectrum2}) {
+        for (auto& c : *s) {
+            c = (uint64_t)std::llround((double)c * factor);
+        }
+    }
+}
+
+double kat::CompCounters::relativeStdError(const uint64_t estimate, const double sampleFraction) {
+
+    if (sampleFraction >= 1.0 || estimate == 0)
+        return 0.0;
+
+    return std::sqrt((1.0 - sampleFraction) / ((double)estimate * sampleFraction));
+}
+
 void kat::CompCounters::printCounts(ostream &out) {
 
     out << "K-mer statistics for: " << endl;
@@ -152,6 +186,18 @@ void kat::CompCounters::printCounts(ostream &out) {
 
     out << endl;
 
+    if (sample_fraction < 1.0) {
+        out << "Estimated from a sample of " << sample_fraction * 100.0 << "% of distinct K-mers." << endl;
+        out << "All counts below are scaled up by 1/" << sample_fraction << "." << endl;
+        out << "Relative standard error of distinct K-mer estimates:" << endl;
+        out << " - Hash 1: " << relativeStdError(hash1_distinct, sample_fraction) << endl;
+        out << " - Hash 2: " << relativeStdError(hash2_distinct, sample_fraction) << endl;
+        if (hash3_total > 0)
+            out << " - Hash 3: " << relativeStdError(hash3_distinct, sample_fraction) << endl;
+        out << " - Shared: " << relativeStdError(shared_distinct, sample_fraction) << endl;
+        out << endl;
+    }
+
     out << "Total K-mers in: " << endl;
     out << " - Hash 1: " << hash1_total << endl;
     out << " - Hash 2: " << hash2_total << endl;
@@ -0,0 +1,316 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#include <algorithm>
+#include <fstream>
+#include <string.h>
+using std::ifstream;
+
+#include <boost/lexical_cast.hpp>
+using boost::lexical_cast;
+
+#include <kat/coverage_file.hpp>
+
+const char kat::CoverageFile::MAGIC[8] = {'K', 'A', 'T', 'B', 'I', 'N', 'C', 'V'};
+const uint32_t kat::CoverageFile::VERSION;
+const uint32_t kat::CoverageFile::DEFAULT_BLOCK_SIZE;
+
+namespace {
+
+    void putVarint(string& out, uint64_t v) {
+        while (v >= 0x80) {
+            out.push_back((char)((v & 0x7F) | 0x80));
+            v >>= 7;
+        }
+        out.push_back((char)v);
+    }
+
+    // Returns false if the varint runs past the end of the data
+    bool getVarint(const char*& p, const char* end, uint64_t& v) {
+        v = 0;
+        for (uint32_t shift = 0; p < end && shift < 64; shift += 7) {
+            const uint8_t b = (uint8_t)*p++;
+            v |= (uint64_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Fixed size integers are stored little endian
+    template<typename T>
+    void putRaw(string& out, T v) {
+        v = kat::littleEndian(v);
+        out.append(reinterpret_cast<const char*>(&v), sizeof(T));
+    }
+
+    template<typename T>
+    T getRaw(const char*& p) {
+        T v;
+        memcpy(&v, p, sizeof(T));
+        p += sizeof(T);
+        return kat::littleEndian(v);
+    }
+
+    // Converts every integer in the header between host order and little endian
+    kat::CoverageFileHeader convertHeader(kat::CoverageFileHeader h) {
+        using kat::littleEndian;
+        h.version = littleEndian(h.version);
+        h.block_size = littleEndian(h.block_size);
+        h.mer_len = littleEndian(h.mer_len);
+        h.reserved = littleEndian(h.reserved);
+        h.nb_seqs = littleEndian(h.nb_seqs);
+        h.index_offset = littleEndian(h.index_offset);
+        return h;
+    }
+}
+
+kat::CoverageFile::CoverageFile(const path& _file) : file(_file) {
+
+    try {
+        cvgFile.map(file.c_str());
+    }
+    catch(jellyfish::mapped_file::ErrorMMap& e) {
+        BOOST_THROW_EXCEPTION(CoverageFileException() << CoverageFileErrorInfo(string(
+                "Could not map binary coverage file: ") + file.string() + "; " + e.what()));
+    }
+
+    if (cvgFile.length() < sizeof(CoverageFileHeader) || memcmp(cvgFile.base(), MAGIC, sizeof(MAGIC)) != 0) {
+        BOOST_THROW_EXCEPTION(CoverageFileException() << CoverageFileErrorInfo(string(
+                "Not a binary KAT coverage file: ") + file.string()));
+    }
+
+    memcpy(&header, cvgFile.base(), sizeof(header));
+    header = convertHeader(header);
+
+    if (header.version > VERSION) {
+        BOOST_THROW_EXCEPTION(CoverageFileException() << CoverageFileErrorInfo(string(
+                "Binary coverage file ") + file.string() + " has format version " +
+                lexical_cast<string>(header.version) + " which is newer than the supported version: " +
+                lexical_cast<string>(VERSION)));
+    }
+
+    const string corrupt = string("Binary coverage file is truncated or corrupt: ") + file.string();
+    if (header.index_offset < sizeof(CoverageFileHeader) || header.index_offset > cvgFile.length() || header.block_size == 0) {
+        BOOST_THROW_EXCEPTION(CoverageFileException() << CoverageFileErrorInfo(corrupt));
+    }
+
+    // Each index entry takes at least this many bytes
+    const uint64_t minEntry = sizeof(uint32_t) + 3 * sizeof(uint64_t);
+    if (header.nb_seqs > (cvgFile.length() - header.index_offset) / minEntry) {
+        BOOST_THROW_EXCEPTION(CoverageFileException() << CoverageFileErrorInfo(corrupt));
+    }
+
+    // Load the index
+    const char* p = cvgFile.base() + header.index_offset;
+    const char* end = cvgFile.base() + cvgFile.length();
+    seqs.resize(header.nb_seqs);
+    for (auto& s : seqs) {
+        if (end - p < (int64_t)sizeof(uint32_t)) {
+            BOOST_THROW_EXCEPTION(CoverageFileException() << CoverageFileErrorInfo(corrupt));
+        }
+        const uint32_t nameLen = getRaw<uint32_t>(p);
+        if (end - p < (int64_t)(nameLen + 2 * sizeof(uint64_t))) {
+            BOOST_THROW_EXCEPTION(CoverageFileException() << CoverageFileErrorInfo(corrupt));
+        }
+        s.name = string(p, nameLen);
+        p += nameLen;
+        s.length = getRaw<uint64_t>(p);
+        const uint64_t nbBlocks = getRaw<uint64_t>(p);
+        if (nbBlocks != (s.length + header.block_size - 1) / header.block_size ||
+                (uint64_t)(end - p) < (nbBlocks + 1) * sizeof(uint64_t)) {
+            BOOST_THROW_EXCEPTION(CoverageFileException() << CoverageFileErrorInfo(corrupt));
+        }
+        s.offsets.resize(nbBlocks + 1);
+        for (auto& o : s.offsets) {
+            o = getRaw<uint64_t>(p);
+        }
+        if (s.offsets.back() > header.index_offset || !std::is_sorted(s.offsets.begin(), s.offsets.end())) {
+            BOOST_THROW_EXCEPTION(CoverageFileException() << CoverageFileErrorInfo(corrupt));
+        }
+    }
+
+    // Full names take priority over first words
+    for (size_t i = 0; i < seqs.size(); i++) {
+        const string& name = seqs[i].name;
+        byName.emplace(name.substr(0, name.find_first_of(" \t")), i);
+    }
+    for (size_t i = 0; i < seqs.size(); i++) {
+        byName[seqs[i].name] = i;
+    }
+}
+
+int64_t kat::CoverageFile::find(const string& name) const {
+    auto it = byName.find(name);
+    return it == byName.end() ? -1 : (int64_t)it->second;
+}
+
+void kat::CoverageFile::get(size_t index, uint64_t start, uint64_t end, vector<uint64_t>& counts) const {
+
+    counts.clear();
+
+    if (index >= seqs.size() || start > end || end > seqs[index].length) {
+        BOOST_THROW_EXCEPTION(CoverageFileException() << CoverageFileErrorInfo(string(
+                "Requested interval exceeds limits of sequence.  Sequence: ") + lexical_cast<string>(index) +
+                "; Interval: " + lexical_cast<string>(start) + "-" + lexical_cast<string>(end)));
+    }
+
+    if (start == end) {
+        return;
+    }
+
+    const Entry& s = seqs[index];
+    const uint64_t bs = header.block_size;
+    const uint64_t first = start / bs;
+    const uint64_t last = (end - 1) / bs;
+
+    vector<uint64_t> block;
+    for (uint64_t b = first; b <= last; b++) {
+        const uint64_t blockStart = b * bs;
+        const uint64_t expected = std::min(bs, s.length - blockStart);
+
+        block.clear();
+        try {
+            decodeBlock(cvgFile.base() + s.offsets[b], s.offsets[b + 1] - s.offsets[b], expected, block);
+        }
+        catch(CoverageFileException& e) {
+            BOOST_THROW_EXCEPTION(CoverageFileException() << CoverageFileErrorInfo(string(
+                    "Binary coverage file is truncated or corrupt: ") + file.string()));
+        }
+
+        if (block.size() != expected) {
+            BOOST_THROW_EXCEPTION(CoverageFileException() << CoverageFileErrorInfo(string(
+                    "Binary coverage file is truncated or corrupt: ") + file.string()));
+        }
+
+        const uint64_t from = std::max(start, blockStart) - blockStart;
+        const uint64_t to = std::min(end, blockStart + block.size()) - blockStart;
+        counts.insert(counts.end(), block.begin() + from, block.begin() + to);
+    }
+}
+
+bool kat::CoverageFile::isCoverageFile(const path& file) {
+    char magic[sizeof(MAGIC)];
+    ifstream in(file.c_str(), std::ios::binary);
+    if (!in.read(magic, sizeof(magic))) {
+        return false;
+    }
+    return memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+string kat::CoverageFile::encodeBlock(const uint64_t* counts, size_t n) {
+    string out;
+    for (size_t i = 0; i < n; ) {
+        size_t j = i + 1;
+        while (j < n && counts[j] == counts[i]) {
+            j++;
+        }
+        putVarint(out, counts[i]);
+        putVarint(out, j - i);
+        i = j;
+    }
+    return out;
+}
+
+void kat::CoverageFile::decodeBlock(const char* data, size_t len, uint64_t maxCounts, vector<uint64_t>& counts) {
+    const char* p = data;
+    const char* end = data + len;
+    uint64_t decoded = 0;
+    while (p < end) {
+        uint64_t val, run;
+        if (!getVarint(p, end, val) || !getVarint(p, end, run)) {
+            BOOST_THROW_EXCEPTION(CoverageFileException() << CoverageFileErrorInfo(string(
+                    "Corrupt block in binary coverage file")));
+        }
+        if (run > maxCounts - decoded) {
+            BOOST_THROW_EXCEPTION(CoverageFileException() << CoverageFileErrorInfo(string(
+                    "Block in binary coverage file holds more than the expected ") +
+                    lexical_cast<string>(maxCounts) + " counts"));
+        }
+        decoded += run;
+        counts.insert(counts.end(), run, val);
+    }
+}
+
+
+kat::CoverageFileWriter::CoverageFileWriter(const path& _file, uint32_t _merLen, uint32_t _blockSize) :
+        file(_file), merLen(_merLen), blockSize(_blockSize), offset(0), nbSeqs(0) {
+
+    if (blockSize == 0) {
+        BOOST_THROW_EXCEPTION(CoverageFileException() << CoverageFileErrorInfo(string(
+                "Block size for binary coverage file must be greater than 0")));
+    }
+
+    out.open(file.c_str(), std::ios::binary | std::ios::trunc);
+    if (!out) {
+        BOOST_THROW_EXCEPTION(CoverageFileException() << CoverageFileErrorInfo(string(
+                "Could not open binary coverage file for writing: ") + file.string()));
+    }
+
+    // Placeholder header, completed once the index offset is known
+    CoverageFileHeader h;
+    memset(&h, 0, sizeof(h));
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    offset = sizeof(h);
+}
+
+void kat::CoverageFileWriter::add(const string& name, uint64_t length, const vector<string>& blocks) {
+
+    if (blocks.size() != (length + blockSize - 1) / blockSize) {
+        BOOST_THROW_EXCEPTION(CoverageFileException() << CoverageFileErrorInfo(string(
+                "Wrong number of blocks for sequence ") + name + " in binary coverage file: " + file.string()));
+    }
+
+    putRaw(index, (uint32_t)name.size());
+    index.append(name);
+    putRaw(index, length);
+    putRaw(index, (uint64_t)blocks.size());
+    for (auto& b : blocks) {
+        putRaw(index, offset);
+        out.write(b.data(), b.size());
+        offset += b.size();
+    }
+    putRaw(index, offset);
+
+    nbSeqs++;
+}
+
+void kat::CoverageFileWriter::close() {
+
+    out.write(index.data(), index.size());
+
+    CoverageFileHeader h;
+    memcpy(h.magic, CoverageFile::MAGIC, sizeof(h.magic));
+    h.version = CoverageFile::VERSION;
+    h.block_size = blockSize;
+    h.mer_len = merLen;
+    h.reserved = 0;
+    h.nb_seqs = nbSeqs;
+    h.index_offset = offset;
+
+    const CoverageFileHeader le = convertHeader(h);
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&le), sizeof(le));
+
+    if (!out) {
+        BOOST_THROW_EXCEPTION(CoverageFileException() << CoverageFileErrorInfo(string(
+                "Error writing binary coverage file: ") + file.string()));
+    }
+
+    out.close();
+}
@@ -0,0 +1,221 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#include <unistd.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+using std::ifstream;
+using std::ofstream;
+using std::istringstream;
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/lexical_cast.hpp>
+namespace bfs = boost::filesystem;
+using boost::lexical_cast;
+
+#include <kat/fasta_index.hpp>
+
+kat::FastaIndex::FastaIndex(const path& _fastaFile) : fastaFile(_fastaFile) {
+
+    try {
+        fa.map(fastaFile.c_str());
+    }
+    catch(jellyfish::mapped_file::ErrorMMap& e) {
+        BOOST_THROW_EXCEPTION(FastaIndexException() << FastaIndexErrorInfo(string(
+                "Could not map FastA file: ") + fastaFile.string() + "; " + e.what()));
+    }
+
+    if (fa.length() == 0 || fa.base()[0] != '>') {
+        BOOST_THROW_EXCEPTION(FastaIndexException() << FastaIndexErrorInfo(string(
+                "Not an uncompressed FastA file: ") + fastaFile.string()));
+    }
+
+    const path faiFile = indexPath(fastaFile);
+    boost::system::error_code ec;
+    const bool upToDate = bfs::exists(faiFile, ec) &&
+            bfs::last_write_time(faiFile, ec) >= bfs::last_write_time(fastaFile, ec) && !ec;
+
+    if (!upToDate || !load(faiFile)) {
+        build();
+
+        // The index is only a cache, so carry on without saving it if the
+        // FastA file's directory isn't writable.  Write to a temporary file
+        // first so that concurrent runs never see a partial index.
+        const path tmpFile = path(faiFile.string() + ".tmp" + lexical_cast<string>(getpid()));
+        try {
+            save(tmpFile);
+            bfs::rename(tmpFile, faiFile);
+        }
+        catch(std::exception& e) {
+            bfs::remove(tmpFile, ec);
+        }
+    }
+}
+
+string kat::FastaIndex::getHeader(size_t index) const {
+
+    // The header is the line just before the first base
+    const char* base = fa.base();
+    const uint64_t offset = entries[index].offset;
+    uint64_t end = offset > 0 && base[offset - 1] == '\n' ? offset - 1 : offset;
+    uint64_t start = end;
+    while (start > 0 && base[start - 1] != '\n') {
+        start--;
+    }
+    if (end > start && base[end - 1] == '\r') {
+        end--;
+    }
+
+    // Skip the '>'
+    return start < end ? string(base + start + 1, end - start - 1) : string();
+}
+
+string kat::FastaIndex::getSequence(size_t index) const {
+
+    const FastaIndexEntry& e = entries[index];
+
+    string seq;
+    seq.reserve(e.length);
+
+    const char* p = fa.base() + e.offset;
+    uint64_t remaining = e.length;
+    while (remaining > 0) {
+        const uint64_t n = std::min(remaining, e.lineBases);
+        seq.append(p, n);
+        remaining -= n;
+        p += e.lineWidth;
+    }
+
+    return seq;
+}
+
+void kat::FastaIndex::save(const path& faiFile) const {
+
+    ofstream out(faiFile.c_str());
+    if (!out) {
+        BOOST_THROW_EXCEPTION(FastaIndexException() << FastaIndexErrorInfo(string(
+                "Could not open FastA index for writing: ") + faiFile.string()));
+    }
+
+    for (auto& e : entries) {
+        out << e.name << "\t" << e.length << "\t" << e.offset << "\t"
+            << e.lineBases << "\t" << e.lineWidth << "\n";
+    }
+
+    out.close();
+    if (!out) {
+        BOOST_THROW_EXCEPTION(FastaIndexException() << FastaIndexErrorInfo(string(
+                "Error writing FastA index: ") + faiFile.string()));
+    }
+}
+
+void kat::FastaIndex::build() {
+
+    entries.clear();
+
+    const char* const base = fa.base();
+    const char* const end = base + fa.length();
+
+    FastaIndexEntry* e = nullptr;
+    bool lastLine = false;      // Set after a short or blank line within a record
+
+    for (const char* p = base; p < end; ) {
+
+        const char* nl = (const char*)memchr(p, '\n', end - p);
+        const char* eol = nl != nullptr ? nl : end;
+        const char* next = nl != nullptr ? nl + 1 : end;
+        const char* contentEnd = eol > p && eol[-1] == '\r' ? eol - 1 : eol;
+
+        if (*p == '>') {
+            const char* nameEnd = p + 1;
+            while (nameEnd < contentEnd && *nameEnd != ' ' && *nameEnd != '\t') {
+                nameEnd++;
+            }
+            entries.push_back(FastaIndexEntry{string(p + 1, nameEnd), 0, (uint64_t)(next - base), 0, 0});
+            e = &entries.back();
+            lastLine = false;
+        }
+        else {
+            const uint64_t bases = contentEnd - p;
+            const uint64_t width = next - p;
+
+            if (bases == 0) {
+                lastLine = true;
+            }
+            else if (lastLine) {
+                BOOST_THROW_EXCEPTION(FastaIndexException() << FastaIndexErrorInfo(string(
+                        "Can't index FastA file, lines of record ") + e->name +
+                        " have different lengths: " + fastaFile.string()));
+            }
+            else {
+                if (e->lineBases == 0) {
+                    e->lineBases = bases;
+                    e->lineWidth = width;
+                }
+                else if (bases > e->lineBases || (bases == e->lineBases && width != e->lineWidth && next != end)) {
+                    BOOST_THROW_EXCEPTION(FastaIndexException() << FastaIndexErrorInfo(string(
+                            "Can't index FastA file, lines of record ") + e->name +
+                            " have different lengths: " + fastaFile.string()));
+                }
+                lastLine = bases < e->lineBases;
+                e->length += bases;
+            }
+        }
+
+        p = next;
+    }
+}
+
+bool kat::FastaIndex::load(const path& faiFile) {
+
+    entries.clear();
+
+    ifstream in(faiFile.c_str());
+    if (!in) {
+        return false;
+    }
+
+    string line;
+    while (std::getline(in, line)) {
+        FastaIndexEntry e;
+        istringstream iss(line);
+        if (!std::getline(iss, e.name, '\t') || !(iss >> e.length >> e.offset >> e.lineBases >> e.lineWidth)) {
+            return false;
+        }
+
+        // Sanity check the entry against the FastA file, in case the index is
+        // for a different file
+        if (e.offset == 0 || e.offset > fa.length() || fa.base()[e.offset - 1] != '\n') {
+            return false;
+        }
+        if (e.length > 0) {
+            if (e.lineBases == 0 || e.lineWidth < e.lineBases) {
+                return false;
+            }
+            const uint64_t lastByte = e.offset + ((e.length - 1) / e.lineBases) * e.lineWidth + (e.length - 1) % e.lineBases;
+            if (lastByte >= fa.length()) {
+                return false;
+            }
+        }
+
+        entries.push_back(e);
+    }
+
+    return !entries.empty();
+}
@@ -19,11 +19,19 @@
 #include <config.h>
 #endif
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
 #include <iostream>
 #include <fstream>
+#include <mutex>
+#include <thread>
 #include <glob.h>
 using std::fstream;
 using std::stringstream;
+using std::thread;
 
 #include <boost/filesystem/path.hpp>
 #include <boost/filesystem/operations.hpp>
@@ -181,13 +189,82 @@ void kat::InputHandler::count(const uint16_t threads) {
 
     auto_cpu_timer timer(1, "  Time taken: %ws\n\n");
 
-    hashCounter = make_shared<HashCounter>(hashSize, merLen * 2, 7, threads);
+    // No point allocating space for K-mers that we are going to throw away
+    const uint64_t size = sampleFraction < 1.0 ?
+        std::max<uint64_t>((uint64_t)(hashSize * sampleFraction * 1.2), 1024) :
+        hashSize;
+
+    if (seedHash.empty()) {
+        hashCounter = make_shared<HashCounter>(size, merLen * 2, 7, threads);
+    }
+    else {
+        seed(threads, size);
+    }
     hashCounter->do_size_doubling(!disableHashGrow);
 
     cout << "Input " << index << " is a sequence file.  Counting kmers for input " << index << " (" << pathString() << ") ...";
     cout.flush();
 
-    hash = JellyfishHelper::countSeqFile(input, *hashCounter, canonical, threads, trim5p, trim3p);
+    // Periodically hand the live hash to the snapshot callback until counting is done
+    std::mutex stopMutex;
+    std::condition_variable stopCond;
+    bool stop = false;
+    std::exception_ptr snapshotError;
+    thread snapshotThread;
+    if (snapshotInterval > 0 && snapshot) {
+        snapshotThread = thread([&]() {
+            const auto start = std::chrono::steady_clock::now();
+            std::unique_lock<std::mutex> lock(stopMutex);
+            while (!stopCond.wait_for(lock, std::chrono::seconds(snapshotInterval), [&stop]() { return stop; })) {
+                // Don't hold up stopSnapshots while the snapshot is taken and written
+                lock.unlock();
+                try {
+                    const uint64_t elapsed = std::chrono::duration_cast<std::chrono::seconds>(
+                            std::chrono::steady_clock::now() - start).count();
+                    function<void()> write;
+                    {
+                        // Stops the hash being replaced underneath us if it's doubled
+                        jellyfish::locks::pthread::mutex_lock swapLock(hashCounter->swap_mutex());
+                        write = snapshot(*hashCounter->ary(), elapsed);
+                    }
+                    if (write) write();
+                }
+                catch (...) {
+                    // Rethrown by count once counting has finished
+                    snapshotError = std::current_exception();
+                    return;
+                }
+                lock.lock();
+            }
+        });
+    }
+
+    auto stopSnapshots = [&]() {
+        if (snapshotThread.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(stopMutex);
+                stop = true;
+            }
+            stopCond.notify_one();
+            snapshotThread.join();
+        }
+    };
+
+    try {
+        hash = packed ?
+            JellyfishHelper::countPackedSequences(*packed, *hashCounter, canonical, threads, sampleFraction) :
+            JellyfishHelper::countSeqFile(input, *hashCounter, canonical, threads, trim5p, trim3p, sampleFraction);
+    }
+    catch (...) {
+        stopSnapshots();
+        throw;
+    }
+
+    stopSnapshots();
+
+    if (snapshotError) {
+        std::rethrow_exception(snapshotError);
+    }
 
     // Create header for newly counted hash
     header = make_shared<file_header>();
@@ -201,6 +278,77 @@ void kat::InputHandler::count(const uint16_t threads) {
     cout.flush();
 }
 
+void kat::InputHandler::seed(const uint16_t threads, uint64_t size) {
+
+    cout << "Seeding input " << index << " with kmers from " << seedHash.string() << " ...";
+    cout.flush();
+
+    if (!bfs::exists(seedHash)) {
+        BOOST_THROW_EXCEPTION(InputFileException() << InputFileErrorInfo(string(
+                "Could not find hash to seed counts from: ") + seedHash.string()));
+    }
+
+    MappedDump dump(seedHash);
+
+    if (dump.getMerLen() != merLen) {
+        BOOST_THROW_EXCEPTION(InputFileException() << InputFileErrorInfo(string(
+                "Can't seed counts for K=") + lexical_cast<string>(merLen) + " from a hash with K=" +
+                lexical_cast<string>(dump.getMerLen()) + ": " + seedHash.string()));
+    }
+
+    if (dump.getCanonical() != canonical) {
+        BOOST_THROW_EXCEPTION(InputFileException() << InputFileErrorInfo(string(
+                "Hash to seed counts from is ") + (dump.getCanonical() ? "" : "not ") +
+                "canonical, which doesn't match the requested counting mode: " + seedHash.string()));
+    }
+
+    mer_dna::k(merLen);
+    const uint64_t threshold = JellyfishHelper::sampleThreshold(sampleFraction);
+
+    // Start with enough room for the existing K-mers as well as the new ones.  The
+    // counter can only grow while all its counting threads cooperate, so if the
+    // existing K-mers don't fit, start again with a bigger hash.
+    size = std::max(size, dump.size() * 2);
+    while (true) {
+
+        hashCounter = make_shared<HashCounter>(size, merLen * 2, 7, threads);
+        LargeHashArray* ary = hashCounter->ary();
+
+        std::atomic<bool> full(false);
+        vector<thread> t(threads);
+        for (uint16_t i = 0; i < threads; i++) {
+            t[i] = thread([&dump, ary, &full, threshold, i, threads]() {
+                mer_dna kmer;
+                const pair<uint64_t, uint64_t> range = dump.slice(i, threads);
+                for (uint64_t j = range.first; j < range.second && !full.load(); j++) {
+                    dump.key(j, kmer);
+                    if (JellyfishHelper::inSample(kmer, threshold)) {
+                        unsigned int carry_shift = 0;
+                        if (!ary->add(kmer, dump.val(j), &carry_shift)) {
+                            full = true;
+                        }
+                    }
+                }
+            });
+        }
+        for (uint16_t i = 0; i < threads; i++) {
+            t[i].join();
+        }
+
+        if (!full.load()) break;
+
+        if (disableHashGrow) {
+            BOOST_THROW_EXCEPTION(InputFileException() << InputFileErrorInfo(string(
+                    "Hash full while seeding from ") + seedHash.string() +
+                    ".  Either increase the hash size or allow the hash to grow."));
+        }
+        size *= 2;
+    }
+
+    cout << " done (" << dump.size() << " distinct kmers)." << endl;
+    cout.flush();
+}
+
 void kat::InputHandler::loadHash() {
 
     auto_cpu_timer timer(1, "  Time taken: %ws\n\n");
@@ -209,7 +357,7 @@ void kat::InputHandler::loadHash() {
     cout.flush();
 
     hashLoader = make_shared<HashLoader>();
-    hashLoader->loadHash(input[0], false);
+    hashLoader->loadHash(input[0], false, sampleFraction);
     hash = hashLoader->getHash();
     canonical = hashLoader->getCanonical();
     merLen = hashLoader->getMerLen();
@@ -19,9 +19,13 @@
 #include <config.h>
 #endif
 
+#include <atomic>
 #include <thread>
 #include <vector>
 #include <fstream>
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#endif
 using std::thread;
 using std::vector;
 using std::fstream;
@@ -52,6 +56,67 @@ using jellyfish::quadratic_reprobes;
 #include <boost/algorithm/string/predicate.hpp>
 using kat::JellyfishHelper;
 
+namespace {
+
+void gcCountBatchScalar(const uint64_t* words, size_t n, uint8_t* gc) {
+    for (size_t i = 0; i < n; i++) {
+        gc[i] = (uint8_t)JellyfishHelper::gcCount(words[i]);
+    }
+}
+
+#if defined(__GNUC__) && defined(__x86_64__)
+
+// Counts 4 words at a time.  Bits in each byte are counted with a nibble lookup
+// table, then the bytes in each 64 bit lane are summed with SAD.
+__attribute__((target("avx2")))
+void gcCountBatchAVX2(const uint64_t* words, size_t n, uint8_t* gc) {
+
+    const __m256i lowBits = _mm256_set1_epi64x(0x5555555555555555LL);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                         0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i zero = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(words + i));
+        v = _mm256_and_si256(_mm256_xor_si256(v, _mm256_srli_epi64(v, 1)), lowBits);
+        const __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(v, nibble));
+        const __m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+        const __m256i sums = _mm256_sad_epu8(_mm256_add_epi8(lo, hi), zero);
+
+        uint64_t out[4];
+        _mm256_storeu_si256((__m256i*)out, sums);
+        gc[i] = (uint8_t)out[0];
+        gc[i + 1] = (uint8_t)out[1];
+        gc[i + 2] = (uint8_t)out[2];
+        gc[i + 3] = (uint8_t)out[3];
+    }
+
+    gcCountBatchScalar(words + i, n - i, gc + i);
+}
+
+typedef void (*GcCountBatchFn)(const uint64_t*, size_t, uint8_t*);
+
+GcCountBatchFn selectGcCountBatch() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? gcCountBatchAVX2 : gcCountBatchScalar;
+}
+
+const GcCountBatchFn gcCountBatchImpl = selectGcCountBatch();
+
+#else
+
+void (* const gcCountBatchImpl)(const uint64_t*, size_t, uint8_t*) = gcCountBatchScalar;
+
+#endif
+
+}
+
+void kat::JellyfishHelper::gcCountBatch(const uint64_t* words, size_t n, uint8_t* gc) {
+    gcCountBatchImpl(words, n, gc);
+}
+
 /**
  * Extracts the jellyfish hash file header
  * @param jfHashPath Path to the jellyfish hash file
@@ -94,7 +159,7 @@ void kat::JellyfishHelper::printHeader(const file_header& header, ostream& out)
  * @param verbose
  * @return
  */
-LargeHashArrayPtr kat::HashLoader::loadHash(const path& jfHashPath, bool verbose) {
+LargeHashArrayPtr kat::HashLoader::loadHash(const path& jfHashPath, bool verbose, double sampleFraction) {
 
     ifstream in(jfHashPath.c_str(), std::ios::in | std::ios::binary);
     header = file_header(in);
@@ -140,7 +205,12 @@ LargeHashArrayPtr kat::HashLoader::loadHash(const path& jfHashPath, bool verbose
         size_t record_len = header.counter_len() + key_len;
         size_t nbRecords = fileSizeBytes / record_len;
 
-        size_t lsize = jellyfish::ceilLog2(nbRecords * 2);
+        // When sampling, only size the hash for the records we expect to keep, plus some
+        // headroom for sampling variance
+        const uint64_t threshold = JellyfishHelper::sampleThreshold(sampleFraction);
+        const size_t expectedRecords = sampleFraction < 1.0 ? (size_t)(nbRecords * sampleFraction * 1.2) + 1024 : nbRecords;
+
+        size_t lsize = jellyfish::ceilLog2(expectedRecords * 2);
         size_t size_ = (size_t) 1 << lsize;
 
         if (verbose) {
@@ -172,7 +242,9 @@ LargeHashArrayPtr kat::HashLoader::loadHash(const path& jfHashPath, bool verbose
                 header.max_reprobe());
 
         while (reader.next()) {
-            hash->add(reader.key(), reader.val());
+            if (JellyfishHelper::inSample(reader.key(), threshold)) {
+                hash->add(reader.key(), reader.val());
+            }
         }
 
         in.close();
@@ -186,6 +258,45 @@ LargeHashArrayPtr kat::HashLoader::loadHash(const path& jfHashPath, bool verbose
 
 }
 
+kat::MappedDump::MappedDump(const path& jfHashPath) : dumpPath(jfHashPath) {
+
+    ifstream in(jfHashPath.c_str(), std::ios::in | std::ios::binary);
+    if (!header.read(in)) {
+        BOOST_THROW_EXCEPTION(JellyfishException() << JellyfishErrorInfo(string(
+                "Failed to parse header of file: ") + jfHashPath.string()));
+    }
+    in.close();
+
+    if (header.format() != binary_dumper::format) {
+        BOOST_THROW_EXCEPTION(JellyfishException() << JellyfishErrorInfo(string(
+                "Can only stream K-mers from binary jellyfish hashes.  Format of ") +
+                jfHashPath.string() + " is '" + header.format() + "'"));
+    }
+
+    try {
+        mapped.map(jfHashPath.c_str());
+    }
+    catch(mapped_file::ErrorMMap& e) {
+        BOOST_THROW_EXCEPTION(JellyfishException() << JellyfishErrorInfo(string(
+                "Could not map jellyfish hash: ") + jfHashPath.string() + "; " + e.what()));
+    }
+    mapped.sequential();
+
+    data = mapped.base() + header.offset();
+    const size_t fileSizeBytes = mapped.length() - header.offset();
+
+    keyBytes = header.key_len() / 8 + (header.key_len() % 8 != 0);
+    recordBytes = header.counter_len() + keyBytes;
+
+    if (header.counter_len() > sizeof(uint64_t) || fileSizeBytes % recordBytes != 0) {
+        BOOST_THROW_EXCEPTION(JellyfishException() << JellyfishErrorInfo(string(
+                "Size of database (") + lexical_cast<string>(fileSizeBytes) +
+                ") must be a multiple of the length of a record (" + lexical_cast<string>(recordBytes) + ")"));
+    }
+
+    nbRecords = fileSizeBytes / recordBytes;
+}
+
 uint64_t kat::JellyfishHelper::getCount(LargeHashArrayPtr hash, const mer_dna& kmer, bool canonical) {
     const mer_dna k = canonical ? kmer.get_canonical() : kmer;
     uint64_t val = 0;
@@ -199,15 +310,69 @@ uint64_t kat::JellyfishHelper::getCount(LargeHashArrayPtr hash, const mer_dna& k
  * @param parser The parser that handles the input stream and chunking
  * @param canonical whether or not the kmers should be treated as canonical or not
  */
-void kat::JellyfishHelper::countSlice(HashCounter& ary, SequenceParser& parser, bool canonical) {
+void kat::JellyfishHelper::countSlice(HashCounter& ary, SequenceParser& parser, bool canonical, uint64_t threshold) {
+
+    addMers(ary, parser, canonical, threshold);
+
+    ary.done();
+}
+
+void kat::JellyfishHelper::addMers(HashCounter& ary, SequenceParser& parser, bool canonical, uint64_t threshold) {
 
     MerIterator mers(parser, canonical);
 
-    for (; mers; ++mers) {
-        ary.add(*mers, 1);
+    if (threshold == UINT64_MAX) {
+        for (; mers; ++mers) {
+            ary.add(*mers, 1);
+        }
     }
+    else {
+        for (; mers; ++mers) {
+            if (inSample(*mers, threshold)) {
+                ary.add(*mers, 1);
+            }
+        }
+    }
+}
 
-    ary.done();
+void kat::JellyfishHelper::countPackedRecord(HashCounter& ary, const TwoBitRecord& r, const uint8_t* packed, bool canonical, uint64_t threshold) {
+
+    // .2bit codes are T=0, C=1, A=2, G=3.  Jellyfish uses A=0, C=1, G=2, T=3.
+    static const int CODES[4] = {3, 1, 0, 2};
+
+    const uint64_t k = mer_dna::k();
+
+    mer_dna mer;
+    mer_dna rc;
+    uint64_t filled = 0;
+
+    auto nBlock = r.nBlocks.begin();
+    uint64_t pos = 0;
+    while (pos < r.length) {
+
+        // Skip over Ns, starting a new kmer afterwards
+        if (nBlock != r.nBlocks.end() && nBlock->first <= pos) {
+            pos = std::max(pos, nBlock->first + nBlock->second);
+            filled = 0;
+            ++nBlock;
+            continue;
+        }
+
+        const uint64_t end = nBlock != r.nBlocks.end() ? std::min(r.length, nBlock->first) : r.length;
+        for (; pos < end; pos++) {
+            const int code = CODES[(packed[pos >> 2] >> (6 - 2 * (pos & 3))) & 3];
+            mer.shift_left(code);
+            if (canonical) {
+                rc.shift_right(mer_dna::complement(code));
+            }
+            if (++filled >= k) {
+                const mer_dna& m = canonical && rc < mer ? rc : mer;
+                if (inSample(m, threshold)) {
+                    ary.add(m, 1);
+                }
+            }
+        }
+    }
 }
 
 /**
@@ -216,26 +381,67 @@ void kat::JellyfishHelper::countSlice(HashCounter& ary, SequenceParser& parser,
  * @param seqFile Sequence file to count
  * @return The hash array
  */
-LargeHashArrayPtr kat::JellyfishHelper::countSeqFile(const vector<path>& seqFiles, HashCounter& hashCounter, bool canonical, uint16_t threads, const vector<uint16_t>& trim5p, const vector<uint16_t>& trim3p) {
+LargeHashArrayPtr kat::JellyfishHelper::countSeqFile(const vector<path>& seqFiles, HashCounter& hashCounter, bool canonical, uint16_t threads, const vector<uint16_t>& trim5p, const vector<uint16_t>& trim3p, double sampleFraction) {
 
-    // Convert paths to a format jellyfish is happy with
-    vector<const char*> paths;
-    for (auto& p : seqFiles) {
-        paths.push_back(p.c_str());
-    }
+    // .2bit files are counted separately, straight from the packed bases
+    const SeqInputs inputs = splitSeqInputs(seqFiles, trim5p);
 
     // Ensures jellyfish knows what kind of kmers we are working with
     unsigned int merLen = hashCounter.key_len() / 2;
     mer_dna::k(merLen);
 
-    StreamManager streams(paths.begin(), paths.end(), (const int) std::min(paths.size(), (size_t) threads));
+    shared_ptr<StreamManager> streams = nullptr;
+    shared_ptr<SequenceParser> parser = nullptr;
+    if (!inputs.paths.empty()) {
+        streams = make_shared<StreamManager>(inputs.paths.begin(), inputs.paths.end(), (const int) std::min(inputs.paths.size(), (size_t) threads));
+        parser = make_shared<SequenceParser>(merLen, streams->nb_streams(), 3 * threads, 4096, *streams, inputs.pathTrim5p);
+    }
+
+    // .2bit records are shared out between the threads as they finish with
+    // the other files
+    const vector<pair<size_t, size_t>>& twoBitRecords = inputs.twoBitRecords;
+    std::atomic<size_t> nextRecord(0);
+
+    const uint64_t threshold = sampleThreshold(sampleFraction);
 
-    SequenceParser parser(merLen, streams.nb_streams(), 3 * threads, 4096, streams, trim5p);
+    vector<thread> t(threads);
+
+    for (int i = 0; i < threads; i++) {
+        t[i] = thread([&]() {
+            if (parser) {
+                addMers(hashCounter, *parser, canonical, threshold);
+            }
+            for (size_t r = nextRecord++; r < twoBitRecords.size(); r = nextRecord++) {
+                countTwoBitRecord(hashCounter, *inputs.twoBits[twoBitRecords[r].first], twoBitRecords[r].second, canonical, threshold);
+            }
+            hashCounter.done();
+        });
+    }
+
+    for (int i = 0; i < threads; i++) {
+        t[i].join();
+    }
+
+    return hashCounter.ary();
+}
+
+LargeHashArrayPtr kat::JellyfishHelper::countPackedSequences(const PackedSequences& seqs, HashCounter& hashCounter, bool canonical, uint16_t threads, double sampleFraction) {
+
+    // Ensures jellyfish knows what kind of kmers we are working with
+    mer_dna::k(hashCounter.key_len() / 2);
+
+    const uint64_t threshold = sampleThreshold(sampleFraction);
+    std::atomic<size_t> nextRecord(0);
 
     vector<thread> t(threads);
 
     for (int i = 0; i < threads; i++) {
-        t[i] = thread(&kat::JellyfishHelper::countSlice, std::ref(hashCounter), std::ref(parser), canonical);
+        t[i] = thread([&]() {
+            for (size_t r = nextRecord++; r < seqs.size(); r = nextRecord++) {
+                countPackedRecord(hashCounter, seqs[r], seqs.getPacked(r), canonical, threshold);
+            }
+            hashCounter.done();
+        });
     }
 
     for (int i = 0; i < threads; i++) {
@@ -255,6 +461,34 @@ void kat::JellyfishHelper::dumpHash(LargeHashArrayPtr ary, file_header& header,
     dumper.dump(ary);
 }
 
+kat::SeqInputs kat::JellyfishHelper::splitSeqInputs(const vector<path>& seqFiles, const vector<uint16_t>& trim5p) {
+
+    SeqInputs inputs;
+    for (size_t i = 0; i < seqFiles.size(); i++) {
+        const uint16_t trim = i < trim5p.size() ? trim5p[i] : 0;
+        if (!isPipe(seqFiles[i]) && TwoBitFile::isTwoBit(seqFiles[i])) {
+            if (trim > 0) {
+                BOOST_THROW_EXCEPTION(JellyfishException() << JellyfishErrorInfo(string(
+                        "5' trimming is not supported for .2bit files: ") + seqFiles[i].string()));
+            }
+            inputs.twoBits.push_back(make_shared<TwoBitFile>(seqFiles[i]));
+            inputs.twoBitFiles.push_back(i);
+            for (size_t r = 0; r < inputs.twoBits.back()->size(); r++) {
+                inputs.twoBitRecords.push_back(std::make_pair(inputs.twoBits.size() - 1, r));
+            }
+        }
+        else {
+            inputs.paths.push_back(seqFiles[i].c_str());
+            inputs.pathFiles.push_back(i);
+            if (i < trim5p.size()) {
+                inputs.pathTrim5p.push_back(trim);
+            }
+        }
+    }
+
+    return inputs;
+}
+
 bool kat::JellyfishHelper::isPipe(const path& filename) {
     return boost::starts_with(filename.string(), "/proc") || boost::starts_with(filename.string(), "/dev");
 }
@@ -283,7 +517,8 @@ bool kat::JellyfishHelper::isSequenceFile(const path& filename) {
     }
 
     // Check extension first
-    bool seqext = boost::iequals(ext, ".fastq") ||
+    bool seqext = boost::iequals(ext, ".2bit") ||
+            boost::iequals(ext, ".fastq") ||
             boost::iequals(ext, ".fq") ||
             boost::iequals(ext, ".fasta") ||
             boost::iequals(ext, ".fa") ||
@@ -302,6 +537,8 @@ bool kat::JellyfishHelper::isSequenceFile(const path& filename) {
 
     if (ch == '>' || ch == '@') return true;
 
+    if (TwoBitFile::isTwoBit(filename)) return true;
+
     // If we've got this far then it's not obviously a fasta or fastq file.
     return false;
 }
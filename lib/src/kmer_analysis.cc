@@ -0,0 +1,320 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#include <math.h>
+#include <algorithm>
+#include <thread>
+using std::thread;
+using std::unique_ptr;
+
+#include <boost/lexical_cast.hpp>
+using boost::lexical_cast;
+
+#include <kat/kmer_analysis.hpp>
+
+namespace {
+
+/**
+ * Ordering for TopAnalysis: higher counts first, then lower K-mers
+ */
+inline bool better(const kat::TopAnalysis::Entry& a, const kat::TopAnalysis::Entry& b) {
+    return a.first != b.first ? a.first > b.first : a.second < b.second;
+}
+
+}
+
+// ********** AnalysisEngine **********
+
+void kat::AnalysisEngine::init(uint16_t merLen, uint16_t threads) {
+
+    if (analyses.empty()) {
+        BOOST_THROW_EXCEPTION(KmerAnalysisException() << KmerAnalysisErrorInfo(string(
+                "No analyses requested")));
+    }
+
+    if (threads == 0) {
+        BOOST_THROW_EXCEPTION(KmerAnalysisException() << KmerAnalysisErrorInfo(string(
+                "Need at least one thread")));
+    }
+
+    // Batches hold mer_dna, so K must be set before any are created
+    mer_dna::k(merLen);
+
+    for (auto& a : analyses) {
+        a->init(merLen, threads);
+    }
+}
+
+void kat::AnalysisEngine::visit(uint16_t th_id, KmerBatch& batch, uint16_t merLen) const {
+
+    if (batch.size == 0) return;
+
+    bool gc = false;
+    for (auto& a : analyses) {
+        gc = gc || a->needsGC();
+    }
+
+    if (gc) {
+        if (merLen <= 32) {
+            uint64_t words[KmerBatch::CAPACITY];
+            for (size_t i = 0; i < batch.size; i++) {
+                words[i] = batch.kmers[i].word(0);
+            }
+            JellyfishHelper::gcCountBatch(words, batch.size, batch.gc);
+        }
+        else {
+            for (size_t i = 0; i < batch.size; i++) {
+                batch.gc[i] = JellyfishHelper::gcCount(batch.kmers[i]);
+            }
+        }
+    }
+
+    for (auto& a : analyses) {
+        a->visit(th_id, batch);
+    }
+
+    batch.size = 0;
+}
+
+void kat::AnalysisEngine::finish() {
+    for (auto& a : analyses) {
+        a->finish();
+    }
+}
+
+void kat::AnalysisEngine::run(const LargeHashArray& hash, uint16_t merLen, uint16_t threads) {
+
+    init(merLen, threads);
+
+    vector<thread> t(threads);
+
+    for (uint16_t i = 0; i < threads; i++) {
+        t[i] = thread(&kat::AnalysisEngine::runSlice, this, std::cref(hash), merLen, i, threads);
+    }
+
+    for (uint16_t i = 0; i < threads; i++) {
+        t[i].join();
+    }
+
+    finish();
+}
+
+void kat::AnalysisEngine::run(const MappedDump& dump, uint16_t threads) {
+
+    init(dump.getMerLen(), threads);
+
+    vector<thread> t(threads);
+
+    for (uint16_t i = 0; i < threads; i++) {
+        t[i] = thread(&kat::AnalysisEngine::runDumpSlice, this, std::cref(dump), i, threads);
+    }
+
+    for (uint16_t i = 0; i < threads; i++) {
+        t[i].join();
+    }
+
+    finish();
+}
+
+void kat::AnalysisEngine::runSlice(const LargeHashArray& hash, uint16_t merLen, uint16_t th_id, uint16_t threads) const {
+
+    unique_ptr<KmerBatch> batch(new KmerBatch());
+
+    LargeHashArray::region_iterator it = hash.region_slice(th_id, threads);
+    while (it.next()) {
+        batch->kmers[batch->size] = it.key();
+        batch->counts[batch->size] = it.val();
+        if (++batch->size == KmerBatch::CAPACITY) {
+            visit(th_id, *batch, merLen);
+        }
+    }
+
+    visit(th_id, *batch, merLen);
+}
+
+void kat::AnalysisEngine::runDumpSlice(const MappedDump& dump, uint16_t th_id, uint16_t threads) const {
+
+    unique_ptr<KmerBatch> batch(new KmerBatch());
+
+    const pair<uint64_t, uint64_t> range = dump.slice(th_id, threads);
+    for (uint64_t i = range.first; i < range.second; i++) {
+        dump.key(i, batch->kmers[batch->size]);
+        batch->counts[batch->size] = dump.val(i);
+        if (++batch->size == KmerBatch::CAPACITY) {
+            visit(th_id, *batch, dump.getMerLen());
+        }
+    }
+
+    visit(th_id, *batch, dump.getMerLen());
+}
+
+// ********** SpectrumAnalysis **********
+
+kat::SpectrumAnalysis::SpectrumAnalysis(uint64_t low, uint64_t high, uint64_t _inc) : inc(_inc) {
+
+    if (inc == 0 || high < low) {
+        BOOST_THROW_EXCEPTION(KmerAnalysisException() << KmerAnalysisErrorInfo(string(
+                "Invalid spectrum range: ") + lexical_cast<string>(low) + "-" + lexical_cast<string>(high) +
+                " by " + lexical_cast<string>(inc)));
+    }
+
+    base = calcBase(low);
+    ceil = calcCeil(high);
+    nb_buckets = ceil + 1 - base;
+}
+
+void kat::SpectrumAnalysis::init(uint16_t merLen, uint16_t threads) {
+    threadedHists.assign(threads, vector<uint64_t>(nb_buckets, 0));
+    hist.assign(nb_buckets, 0);
+}
+
+void kat::SpectrumAnalysis::visit(uint16_t th_id, const KmerBatch& batch) {
+    vector<uint64_t>& h = threadedHists[th_id];
+    for (size_t i = 0; i < batch.size; i++) {
+        ++h[bucket(batch.counts[i], base, ceil, inc)];
+    }
+}
+
+void kat::SpectrumAnalysis::finish() {
+    for (auto& h : threadedHists) {
+        for (size_t i = 0; i < nb_buckets; i++) {
+            hist[i] += h[i];
+        }
+    }
+    threadedHists.clear();
+}
+
+// ********** GcpAnalysis **********
+
+kat::GcpAnalysis::GcpAnalysis(uint16_t _cvgBins, double _cvgScale) :
+        cvgBins(_cvgBins), cvgScale(_cvgScale), merLen(0) {
+}
+
+void kat::GcpAnalysis::init(uint16_t _merLen, uint16_t threads) {
+    merLen = _merLen;
+    threadedCells.assign(threads, vector<uint64_t>((merLen + 1) * (cvgBins + 1), 0));
+    matrix = SM64(merLen + 1, cvgBins + 1);
+}
+
+void kat::GcpAnalysis::visit(uint16_t th_id, const KmerBatch& batch) {
+
+    const size_t rowLen = cvgBins + 1;
+    vector<uint64_t>& cells = threadedCells[th_id];
+
+    for (size_t i = 0; i < batch.size; i++) {
+        ++cells[batch.gc[i] * rowLen + cvgPos(batch.counts[i], cvgScale, cvgBins)];
+    }
+}
+
+void kat::GcpAnalysis::finish() {
+
+    const size_t rowLen = cvgBins + 1;
+
+    for (size_t i = 0; i < (size_t)(merLen + 1) * rowLen; i++) {
+        uint64_t sum = 0;
+        for (auto& cells : threadedCells) {
+            sum += cells[i];
+        }
+        if (sum > 0) {
+            matrix.inc(i / rowLen, i % rowLen, sum);
+        }
+    }
+    threadedCells.clear();
+}
+
+// ********** BoundsAnalysis **********
+
+kat::BoundsAnalysis::BoundsAnalysis(uint64_t _lowCount, uint64_t _highCount, uint16_t _lowGC, uint16_t _highGC) :
+        lowCount(_lowCount), highCount(_highCount), lowGC(_lowGC), highGC(_highGC) {
+}
+
+void kat::BoundsAnalysis::init(uint16_t merLen, uint16_t threads) {
+    threadedCounts.assign(threads, pair<Counts, Counts>());
+    all = in = out = Counts();
+}
+
+void kat::BoundsAnalysis::visit(uint16_t th_id, const KmerBatch& batch) {
+
+    Counts& tin = threadedCounts[th_id].first;
+    Counts& tout = threadedCounts[th_id].second;
+
+    for (size_t i = 0; i < batch.size; i++) {
+        const uint64_t c = batch.counts[i];
+        Counts& counts = inBounds(batch.gc[i], c, lowCount, highCount, lowGC, highGC) ? tin : tout;
+        counts.distinct++;
+        counts.total += c;
+    }
+}
+
+void kat::BoundsAnalysis::finish() {
+    for (auto& t : threadedCounts) {
+        in.distinct += t.first.distinct;
+        in.total += t.first.total;
+        out.distinct += t.second.distinct;
+        out.total += t.second.total;
+    }
+    all.distinct = in.distinct + out.distinct;
+    all.total = in.total + out.total;
+    threadedCounts.clear();
+}
+
+// ********** TopAnalysis **********
+
+kat::TopAnalysis::TopAnalysis(size_t _n) : n(_n) {
+}
+
+void kat::TopAnalysis::init(uint16_t merLen, uint16_t threads) {
+    heaps.assign(threads, vector<Entry>());
+    top.clear();
+}
+
+void kat::TopAnalysis::visit(uint16_t th_id, const KmerBatch& batch) {
+
+    if (n == 0) return;
+
+    // Heap ordered so that the worst entry kept so far is at the front
+    vector<Entry>& heap = heaps[th_id];
+
+    for (size_t i = 0; i < batch.size; i++) {
+        const uint64_t c = batch.counts[i];
+        if (heap.size() < n) {
+            heap.push_back(Entry(c, batch.kmers[i]));
+            std::push_heap(heap.begin(), heap.end(), better);
+        }
+        else if (c >= heap.front().first) {
+            Entry e(c, batch.kmers[i]);
+            if (better(e, heap.front())) {
+                std::pop_heap(heap.begin(), heap.end(), better);
+                heap.back() = e;
+                std::push_heap(heap.begin(), heap.end(), better);
+            }
+        }
+    }
+}
+
+void kat::TopAnalysis::finish() {
+
+    for (auto& heap : heaps) {
+        top.insert(top.end(), heap.begin(), heap.end());
+    }
+    heaps.clear();
+
+    std::sort(top.begin(), top.end(), better);
+    if (top.size() > n) {
+        top.erase(top.begin() + n, top.end());
+    }
+}
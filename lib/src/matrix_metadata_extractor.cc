@@ -18,11 +18,14 @@
 #include <fstream>
 #include <iostream>
 #include <stdlib.h>
+#include <sstream>
 #include <string.h>
 
+#include <kat/binary_matrix.hpp>
+#include <kat/text_parser.hpp>
 #include <kat/matrix_metadata_extractor.hpp>
 
-using std::ifstream;
+using std::istringstream;
 using std::string;
 
 void mme::trim(string& str) {
@@ -36,44 +39,38 @@ void mme::trim(string& str) {
         str.erase(str.begin(), str.end());
 }
 
-int mme::getNumeric(const path& path, const string& key) {
+// Finds the value for key in the metadata block of either a text or a binary
+// matrix file.  Returns false if the key was not present.
+static bool findValue(const path& path, const string& key, string& val) {
+
+    istringstream in(kat::BinaryMatrix::isBinaryMatrix(path) ?
+        kat::BinaryMatrix(path).getMetadata() :
+        kat::MappedTextFile(path).header());
+
+    bool found = false;
     string line;
-    ifstream infile;
-    infile.open(path.c_str());
-    int32_t val = -1;
-    while (!infile.eof() && line.compare(mme::MX_META_END) != 0) {
-        getline(infile, line);
+    while (in.good() && line.compare(mme::MX_META_END) != 0) {
+        getline(in, line);
         size_t pos = line.find(key);
 
         if (pos != string::npos) {
             size_t start = pos + key.length();
-            string str_val = line.substr(start, string::npos);
-            trim(str_val);
-            val = atoi(str_val.c_str());
+            val = line.substr(start, string::npos);
+            mme::trim(val);
+            found = true;
         }
     }
-    infile.close();
 
-    return val;
+    return found;
+}
+
+int mme::getNumeric(const path& path, const string& key) {
+    string str_val;
+    return findValue(path, key, str_val) ? atoi(str_val.c_str()) : -1;
 }
 
 string mme::getString(const path& path, const string& key) {
-    string line;
-    ifstream infile;
-    infile.open(path.c_str());
     string val = "";
-    while (!infile.eof() && line.compare(mme::MX_META_END) != 0) {
-        getline(infile, line);
-        size_t pos = line.find(key);
-
-        if (pos != string::npos) {
-            size_t start = pos + key.length();
-            string strVal = line.substr(start, string::npos);
-            trim(strVal);
-            val = strVal;
-        }
-    }
-    infile.close();
-
+    findValue(path, key, val);
     return val;
 }
@@ -0,0 +1,307 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <thread>
+#include <utility>
+using std::make_shared;
+using std::pair;
+using std::thread;
+
+#include <boost/lexical_cast.hpp>
+using boost::lexical_cast;
+
+#include <kat/multi_k_counter.hpp>
+
+namespace {
+
+/**
+ * Counter for slot CI.  The hash can be grown while counting: threads register
+ * themselves as active while adding a buffer of K-mers, and a thread that finds
+ * the hash full waits for all active threads to leave before doubling it.  Threads
+ * never wait while registered, so there is no need for all threads to cooperate
+ * as with jellyfish's hash_counter, which would deadlock with several hashes.
+ */
+template<int CI>
+class KCounterImpl : public kat::KCounter {
+public:
+
+    typedef jellyfish::mer_dna_ns::mer_base_static<uint64_t, CI> mer_type;
+    typedef jellyfish::large_hash::array<mer_type> array_type;
+
+    KCounterImpl(uint16_t _merLen, uint64_t hashSize, bool _canonical, bool _growHash) :
+            merLen(_merLen), canonical(_canonical), growHash(_growHash), active(0), growing(false) {
+        mer_type::k(merLen);
+        ary = new array_type(hashSize, merLen * 2, 7, 126);
+    }
+
+    virtual ~KCounterImpl() {
+        delete ary;
+    }
+
+    uint16_t getMerLen() const { return merLen; }
+
+    void count(const char* start, const char* end, size_t seam) {
+
+        mer_type m, rcm;
+        unsigned int filled = 0;
+
+        // K-mers ending before this point were counted from the previous buffer
+        const char* first = start + seam;
+
+        enter();
+        for (const char* p = start; p < end; p++) {
+            const int code = m.code(*p);
+            if (code >= 0) {
+                m.shift_left(code);
+                if (canonical)
+                    rcm.shift_right(rcm.complement(code));
+                filled = std::min(filled + 1, (unsigned int)merLen);
+            }
+            else {
+                filled = 0;
+            }
+
+            if (filled >= merLen && p >= first) {
+                add(!canonical || m < rcm ? m : rcm);
+            }
+        }
+        leave();
+    }
+
+    void spectrum(uint16_t th_id, uint16_t nb_slices, vector<uint64_t>& spectrum) const {
+        const uint64_t last = spectrum.size() - 1;
+        typename array_type::region_iterator it = ary->region_slice(th_id, nb_slices);
+        while (it.next()) {
+            ++spectrum[std::min<uint64_t>(it.val(), last)];
+        }
+    }
+
+private:
+
+    uint16_t merLen;
+    bool canonical;
+    bool growHash;
+    array_type* ary;
+
+    std::atomic<uint32_t> active;
+    std::atomic<bool> growing;
+    std::mutex growMutex;
+
+    void enter() {
+        while (true) {
+            while (growing.load()) std::this_thread::yield();
+            active++;
+            if (!growing.load()) return;
+            active--;
+        }
+    }
+
+    void leave() {
+        active--;
+    }
+
+    void add(const mer_type& key) {
+        // Counts that overflow the value field are carried into further entries,
+        // which can fail part way through.  Retry with whatever is left.
+        uint64_t v = 1;
+        unsigned int carry_shift = 0;
+        while (!ary->add(key, v, &carry_shift)) {
+            array_type* full = ary;
+            leave();
+            grow(full);
+            enter();
+            v &= ~(uint64_t)0 << carry_shift;
+        }
+    }
+
+    void grow(array_type* full) {
+
+        std::lock_guard<std::mutex> lock(growMutex);
+
+        // Someone else might have already grown the hash
+        if (ary != full) return;
+
+        if (!growHash) {
+            BOOST_THROW_EXCEPTION(kat::MultiKCounterException() << kat::MultiKCounterErrorInfo(string(
+                    "Hash full for K=") + lexical_cast<string>(merLen) +
+                    ".  Either increase the hash size or allow the hash to grow."));
+        }
+
+        growing = true;
+        while (active.load() > 0) std::this_thread::yield();
+
+        // If the doubled hash hits its reprobe limit while copying, start again
+        // from an even bigger one rather than dropping K-mers
+        array_type* bigger = nullptr;
+        for (size_t size = ary->size() * 2; bigger == nullptr; size *= 2) {
+            bigger = new array_type(size, ary->key_len(), ary->val_len(), ary->max_reprobe());
+            typename array_type::eager_iterator it = ary->eager_slice(0, 1);
+            while (it.next()) {
+                if (!bigger->add(it.key(), it.val())) {
+                    delete bigger;
+                    bigger = nullptr;
+                    break;
+                }
+            }
+        }
+        delete ary;
+        ary = bigger;
+
+        growing = false;
+    }
+};
+
+}
+
+shared_ptr<kat::KCounter> kat::KCounter::create(uint16_t slot, uint16_t merLen, uint64_t hashSize, bool canonical, bool growHash) {
+
+    // Slot 0 is reserved for mer_dna, which the rest of KAT uses
+    switch(slot) {
+        case 0: return make_shared<KCounterImpl<1>>(merLen, hashSize, canonical, growHash);
+        case 1: return make_shared<KCounterImpl<2>>(merLen, hashSize, canonical, growHash);
+        case 2: return make_shared<KCounterImpl<3>>(merLen, hashSize, canonical, growHash);
+        case 3: return make_shared<KCounterImpl<4>>(merLen, hashSize, canonical, growHash);
+        case 4: return make_shared<KCounterImpl<5>>(merLen, hashSize, canonical, growHash);
+        case 5: return make_shared<KCounterImpl<6>>(merLen, hashSize, canonical, growHash);
+        case 6: return make_shared<KCounterImpl<7>>(merLen, hashSize, canonical, growHash);
+        case 7: return make_shared<KCounterImpl<8>>(merLen, hashSize, canonical, growHash);
+        default:
+            BOOST_THROW_EXCEPTION(MultiKCounterException() << MultiKCounterErrorInfo(string(
+                    "Can only count up to ") + lexical_cast<string>(MAX_MULTI_K) + " K values at once"));
+    }
+}
+
+kat::MultiKCounter::MultiKCounter(const vector<uint16_t>& merLens, uint64_t hashSize, bool canonical, bool growHash) :
+        MultiKCounter(merLens, hashSize, canonical, growHash, vector<uint16_t>()) {
+}
+
+kat::MultiKCounter::MultiKCounter(const vector<uint16_t>& merLens, uint64_t hashSize, bool canonical, bool growHash,
+        const vector<uint16_t>& _fileGroups) : fileGroups(_fileGroups) {
+
+    if (merLens.empty() || merLens.size() > MAX_MULTI_K) {
+        BOOST_THROW_EXCEPTION(MultiKCounterException() << MultiKCounterErrorInfo(string(
+                "Number of K values must be between 1 and ") + lexical_cast<string>(MAX_MULTI_K)));
+    }
+
+    maxMerLen = 0;
+    for (size_t i = 0; i < merLens.size(); i++) {
+        counters.push_back(KCounter::create(i, merLens[i], hashSize, canonical, growHash));
+        maxMerLen = std::max(maxMerLen, merLens[i]);
+    }
+
+    if (!fileGroups.empty()) {
+
+        // Each group only holds part of the input, so start with a share of the hash
+        // and always allow them to grow
+        const size_t nbGroups = *std::max_element(fileGroups.begin(), fileGroups.end()) + 1;
+        for (uint16_t g = 0; g < nbGroups; g++) {
+            if (std::find(fileGroups.begin(), fileGroups.end(), g) == fileGroups.end()) {
+                BOOST_THROW_EXCEPTION(MultiKCounterException() << MultiKCounterErrorInfo(string(
+                        "File groups must be numbered contiguously, but group ") + lexical_cast<string>(g) +
+                        " has no files"));
+            }
+        }
+        const uint64_t groupHashSize = std::max<uint64_t>(hashSize / nbGroups, 1 << 16);
+
+        groupCounters.resize(merLens.size());
+        for (size_t i = 0; i < merLens.size(); i++) {
+            for (size_t g = 0; g < nbGroups; g++) {
+                groupCounters[i].push_back(KCounter::create(i, merLens[i], groupHashSize, canonical, true));
+            }
+        }
+    }
+}
+
+void kat::MultiKCounter::count(const vector<path>& seqFiles, uint16_t threads, const vector<uint16_t>& trim5p) {
+
+    if (!fileGroups.empty() && fileGroups.size() != seqFiles.size()) {
+        BOOST_THROW_EXCEPTION(MultiKCounterException() << MultiKCounterErrorInfo(string(
+                "Expected a group for each of the ") + lexical_cast<string>(seqFiles.size()) + " input files, but got " +
+                lexical_cast<string>(fileGroups.size())));
+    }
+
+    // .2bit files are counted separately, from their unpacked records
+    const SeqInputs inputs = JellyfishHelper::splitSeqInputs(seqFiles, trim5p);
+
+    // Buffers overlap by enough for the largest K.  Smaller K-mers in the overlap are
+    // skipped by the counters using the buffer's seam length.
+    shared_ptr<StreamManager> streams = nullptr;
+    shared_ptr<SequenceParser> parser = nullptr;
+    if (!inputs.paths.empty()) {
+        streams = make_shared<StreamManager>(inputs.paths.begin(), inputs.paths.end(), (const int) std::min(inputs.paths.size(), (size_t) threads));
+        parser = make_shared<SequenceParser>(maxMerLen, streams->nb_streams(), 3 * threads, 4096, *streams, inputs.pathTrim5p);
+    }
+
+    std::atomic<size_t> nextRecord(0);
+
+    // Errors, such as a full hash that isn't allowed to grow, are caught in each
+    // thread and the first one is rethrown once all threads have finished
+    vector<thread> t(threads);
+    vector<std::exception_ptr> errors(threads);
+
+    for (int i = 0; i < threads; i++) {
+        t[i] = thread([&, i]() {
+            try {
+                if (parser) {
+                    countSlice(*parser, inputs.pathFiles);
+                }
+                for (size_t r = nextRecord++; r < inputs.twoBitRecords.size(); r = nextRecord++) {
+                    const size_t f = inputs.twoBitRecords[r].first;
+                    const string seq = inputs.twoBits[f]->getSequence(inputs.twoBitRecords[r].second);
+                    countBuffer(seq.data(), seq.data() + seq.size(), 0, inputs.twoBitFiles[f]);
+                }
+            }
+            catch(...) {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+
+    for (int i = 0; i < threads; i++) {
+        t[i].join();
+    }
+
+    for (auto& e : errors) {
+        if (e) {
+            std::rethrow_exception(e);
+        }
+    }
+}
+
+void kat::MultiKCounter::countSlice(SequenceParser& parser, const vector<size_t>& parserFiles) {
+
+    SequenceParser::job j(parser);
+
+    while (!j.is_empty()) {
+        countBuffer(j->start, j->end, j->seam, parserFiles[j->file_index]);
+        j.next();
+    }
+}
+
+void kat::MultiKCounter::countBuffer(const char* start, const char* end, size_t seam, size_t file) {
+
+    for (size_t i = 0; i < counters.size(); i++) {
+        counters[i]->count(start, end, seam);
+        if (!groupCounters.empty()) {
+            groupCounters[i][fileGroups[file]]->count(start, end, seam);
+        }
+    }
+}
@@ -0,0 +1,87 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#include <ctype.h>
+
+#include <kat/packed_sequences.hpp>
+
+void kat::PackedSequences::add(const string& header, const string& seq) {
+
+    TwoBitRecord r;
+    r.name = header;
+    r.length = seq.size();
+    r.dnaOffset = packed.size();
+
+    vector<pair<uint64_t, char>> other;
+    packed.resize(packed.size() + (r.length + 3) / 4, 0);
+    uint8_t* p = packed.data() + r.dnaOffset;
+
+    // Codes are T=0, C=1, A=2, G=3, as in .2bit files.  Anything else is an N,
+    // which is left as T in the packed bases.
+    uint64_t nStart = 0, maskStart = 0;
+    bool inN = false, inMask = false;
+    for (uint64_t i = 0; i < r.length; i++) {
+
+        const char c = seq[i];
+        int code = -1;
+        switch (c) {
+            case 'T': case 't': code = 0; break;
+            case 'C': case 'c': code = 1; break;
+            case 'A': case 'a': code = 2; break;
+            case 'G': case 'g': code = 3; break;
+            case 'N': case 'n': break;
+            default: other.push_back(std::make_pair(i, c)); break;
+        }
+
+        if (code < 0 && !inN) {
+            nStart = i;
+            inN = true;
+        }
+        else if (code >= 0 && inN) {
+            r.nBlocks.push_back(std::make_pair(nStart, i - nStart));
+            inN = false;
+        }
+
+        const bool lower = islower((unsigned char)c);
+        if (lower && !inMask) {
+            maskStart = i;
+            inMask = true;
+        }
+        else if (!lower && inMask) {
+            r.maskBlocks.push_back(std::make_pair(maskStart, i - maskStart));
+            inMask = false;
+        }
+
+        if (code > 0) {
+            p[i >> 2] |= code << (6 - 2 * (i & 3));
+        }
+    }
+    if (inN) r.nBlocks.push_back(std::make_pair(nStart, r.length - nStart));
+    if (inMask) r.maskBlocks.push_back(std::make_pair(maskStart, r.length - maskStart));
+
+    records.push_back(r);
+    others.push_back(other);
+}
+
+string kat::PackedSequences::getSequence(size_t index) const {
+
+    string seq = TwoBitFile::unpack(records[index], getPacked(index));
+    for (auto& o : others[index]) {
+        seq[o.first] = o.second;
+    }
+    return seq;
+}
@@ -0,0 +1,40 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#include <memory>
+using std::make_shared;
+
+#include <kat/fasta_index.hpp>
+#include <kat/jellyfish_helper.hpp>
+#include <kat/two_bit.hpp>
+#include <kat/sequence_index.hpp>
+
+shared_ptr<kat::SequenceIndex> kat::SequenceIndex::open(const path& file) {
+
+    // Probing a pipe would consume the start of the stream, so leave it to be
+    // read sequentially
+    if (JellyfishHelper::isPipe(file)) {
+        BOOST_THROW_EXCEPTION(FastaIndexException() << FastaIndexErrorInfo(string(
+                "Can't index a pipe: ") + file.string()));
+    }
+
+    if (TwoBitFile::isTwoBit(file)) {
+        return make_shared<TwoBitFile>(file);
+    }
+
+    return make_shared<FastaIndex>(file);
+}
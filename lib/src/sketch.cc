@@ -0,0 +1,301 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#include <math.h>
+#include <algorithm>
+#include <memory>
+#include <thread>
+using std::make_shared;
+using std::shared_ptr;
+using std::thread;
+
+#include <boost/lexical_cast.hpp>
+using boost::lexical_cast;
+
+#include <kat/jellyfish_helper.hpp>
+using kat::JellyfishHelper;
+using kat::SeqInputs;
+
+#include <kat/sketch.hpp>
+
+namespace {
+
+inline uint64_t fmix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+template<typename T>
+inline void atomicMax(std::atomic<T>& a, T val) {
+    T cur = a.load(std::memory_order_relaxed);
+    while (cur < val && !a.compare_exchange_weak(cur, val)) {}
+}
+
+}
+
+kat::CountMinSketch::CountMinSketch(uint64_t memory, uint16_t _depth) : depth(_depth), total(0) {
+
+    if (depth == 0) {
+        BOOST_THROW_EXCEPTION(SketchException() << SketchErrorInfo(string(
+                "Count-min sketch depth must be at least 1")));
+    }
+
+    // Largest power of 2 width that fits in the memory allowance
+    uint64_t width = 1;
+    while (width * 2 * depth * sizeof(uint32_t) <= memory) {
+        width *= 2;
+    }
+
+    if (width * depth * sizeof(uint32_t) > memory) {
+        BOOST_THROW_EXCEPTION(SketchException() << SketchErrorInfo(string(
+                "Not enough memory for a count-min sketch: ") + lexical_cast<string>(memory) + " bytes"));
+    }
+
+    mask = width - 1;
+
+    cells = unique_ptr<std::atomic<uint32_t>[]>(new std::atomic<uint32_t>[width * depth]);
+    for (uint64_t i = 0; i < width * depth; i++) {
+        cells[i].store(0, std::memory_order_relaxed);
+    }
+
+    locks = unique_ptr<std::atomic_flag[]>(new std::atomic_flag[NB_LOCKS]);
+    for (uint32_t i = 0; i < NB_LOCKS; i++) {
+        locks[i].clear();
+    }
+}
+
+uint64_t kat::CountMinSketch::cell(uint64_t hash, uint16_t row) const {
+    // Row hashes derived from two independent hashes (Kirsch & Mitzenmacher)
+    const uint64_t h2 = fmix(hash ^ 0x9E3779B97F4A7C15ULL) | 1;
+    return row * (mask + 1) + ((hash + row * h2) & mask);
+}
+
+void kat::CountMinSketch::update(uint64_t hash) {
+
+    std::atomic_flag& lock = locks[hash % NB_LOCKS];
+    while (lock.test_and_set(std::memory_order_acquire)) {}
+
+    uint32_t min = UINT32_MAX;
+    for (uint16_t i = 0; i < depth; i++) {
+        min = std::min(min, cells[cell(hash, i)].load(std::memory_order_relaxed));
+    }
+
+    // Only raise the counters that are below the new estimate.  Saturate rather than
+    // wrap around.
+    if (min < UINT32_MAX) {
+        for (uint16_t i = 0; i < depth; i++) {
+            atomicMax(cells[cell(hash, i)], min + 1);
+        }
+    }
+
+    lock.clear(std::memory_order_release);
+}
+
+uint32_t kat::CountMinSketch::estimate(uint64_t hash) const {
+    uint32_t min = UINT32_MAX;
+    for (uint16_t i = 0; i < depth; i++) {
+        min = std::min(min, cells[cell(hash, i)].load(std::memory_order_relaxed));
+    }
+    return min;
+}
+
+double kat::CountMinSketch::epsilon() const {
+    return M_E / (double)getWidth();
+}
+
+double kat::CountMinSketch::delta() const {
+    return exp(-(double)depth);
+}
+
+uint64_t kat::CountMinSketch::errorBound() const {
+    return (uint64_t)ceil(epsilon() * (double)getTotal());
+}
+
+kat::HyperLogLog::HyperLogLog(uint16_t _precision) : precision(_precision), registers((size_t)1 << _precision) {
+
+    if (precision < 4 || precision > 18) {
+        BOOST_THROW_EXCEPTION(SketchException() << SketchErrorInfo(string(
+                "HyperLogLog precision must be between 4 and 18")));
+    }
+
+    for (auto& r : registers) {
+        r.store(0, std::memory_order_relaxed);
+    }
+}
+
+void kat::HyperLogLog::add(uint64_t hash) {
+    const uint64_t index = hash >> (64 - precision);
+    // Position of the first set bit in the remaining bits, with a sentinel bit so the
+    // count can't run off the end
+    const uint64_t rest = (hash << precision) | ((uint64_t)1 << (precision - 1));
+    atomicMax(registers[index], (uint8_t)(__builtin_clzll(rest) + 1));
+}
+
+uint64_t kat::HyperLogLog::estimate() const {
+
+    const double m = (double)registers.size();
+
+    double sum = 0.0;
+    uint64_t zeros = 0;
+    for (auto& r : registers) {
+        const uint8_t v = r.load(std::memory_order_relaxed);
+        sum += ldexp(1.0, -v);
+        if (v == 0) zeros++;
+    }
+
+    const double alpha = 0.7213 / (1.0 + 1.079 / m);
+    double e = alpha * m * m / sum;
+
+    // Use linear counting for small cardinalities
+    if (e <= 2.5 * m && zeros > 0) {
+        e = m * log(m / (double)zeros);
+    }
+
+    return (uint64_t)llround(e);
+}
+
+double kat::HyperLogLog::standardError() const {
+    return 1.04 / sqrt((double)registers.size());
+}
+
+kat::ApproxCounter::ApproxCounter(uint16_t _merLen, uint64_t memory, bool _canonical) :
+        merLen(_merLen), canonical(_canonical), cms(memory) {
+}
+
+namespace {
+
+/**
+ * Runs f(kmer) over all K-mers in a sequence, starting again after any
+ * character that isn't a base
+ */
+void forEachKmerInSequence(const string& seq, uint16_t merLen, bool canonical, function<void(const mer_dna&)> f) {
+
+    mer_dna mer;
+    mer_dna rc;
+    uint16_t filled = 0;
+    for (char c : seq) {
+        const int code = mer_dna::code(c);
+        if (code < 0) {
+            filled = 0;
+            continue;
+        }
+        mer.shift_left(code);
+        if (canonical) {
+            rc.shift_right(mer_dna::complement(code));
+        }
+        if (filled < merLen) {
+            filled++;
+        }
+        if (filled == merLen) {
+            f(canonical && rc < mer ? rc : mer);
+        }
+    }
+}
+
+/**
+ * Runs f(th_id, kmer) over all K-mers in the input using the given number of threads.
+ * Returns the number of K-mers visited.
+ */
+uint64_t forEachKmer(const vector<path>& seqFiles, uint16_t merLen, bool canonical, uint16_t threads,
+        const vector<uint16_t>& trim5p, function<void(uint16_t, const mer_dna&)> f) {
+
+    for (const path& p : seqFiles) {
+        if (JellyfishHelper::isPipe(p)) {
+            BOOST_THROW_EXCEPTION(kat::SketchException() << kat::SketchErrorInfo(string(
+                    "Approximate counting needs to read the input twice, so can't read from a pipe: ") + p.string()));
+        }
+    }
+
+    // .2bit files are read separately, from their unpacked records
+    const SeqInputs inputs = JellyfishHelper::splitSeqInputs(seqFiles, trim5p);
+
+    mer_dna::k(merLen);
+
+    shared_ptr<StreamManager> streams = nullptr;
+    shared_ptr<SequenceParser> parser = nullptr;
+    if (!inputs.paths.empty()) {
+        streams = make_shared<StreamManager>(inputs.paths.begin(), inputs.paths.end(), (const int) std::min(inputs.paths.size(), (size_t) threads));
+        parser = make_shared<SequenceParser>(merLen, streams->nb_streams(), 3 * threads, 4096, *streams, inputs.pathTrim5p);
+    }
+
+    std::atomic<size_t> nextRecord(0);
+
+    // Each thread counts its own K-mers, so they only share the total at the end
+    std::atomic<uint64_t> visited(0);
+
+    vector<thread> t(threads);
+
+    for (uint16_t i = 0; i < threads; i++) {
+        t[i] = thread([&, i]() {
+            uint64_t n = 0;
+            if (parser) {
+                for (MerIterator mers(*parser, canonical); mers; ++mers) {
+                    f(i, *mers);
+                    n++;
+                }
+            }
+            for (size_t r = nextRecord++; r < inputs.twoBitRecords.size(); r = nextRecord++) {
+                const string seq = inputs.twoBits[inputs.twoBitRecords[r].first]->getSequence(inputs.twoBitRecords[r].second);
+                forEachKmerInSequence(seq, merLen, canonical, [&f, &n, i](const mer_dna& kmer) { f(i, kmer); n++; });
+            }
+            visited += n;
+        });
+    }
+
+    for (uint16_t i = 0; i < threads; i++) {
+        t[i].join();
+    }
+
+    return visited.load();
+}
+
+}
+
+void kat::ApproxCounter::count(const vector<path>& seqFiles, uint16_t threads, const vector<uint16_t>& trim5p) {
+
+    const uint64_t nbKmers = forEachKmer(seqFiles, merLen, canonical, threads, trim5p, [this](uint16_t th_id, const mer_dna& kmer) {
+        const uint64_t h = JellyfishHelper::hashKmer(kmer);
+        cms.update(h);
+        hll.add(h);
+    });
+
+    cms.addTotal(nbKmers);
+}
+
+void kat::ApproxCounter::visit(const vector<path>& seqFiles, uint16_t threads, const vector<uint16_t>& trim5p,
+        function<void(uint16_t, const mer_dna&, uint32_t)> visitor) const {
+
+    forEachKmer(seqFiles, merLen, canonical, threads, trim5p, [this, &visitor](uint16_t th_id, const mer_dna& kmer) {
+        visitor(th_id, kmer, cms.estimate(JellyfishHelper::hashKmer(kmer)));
+    });
+}
+
+double kat::ApproxCounter::distinctScale(double weightTotal) const {
+
+    // A shortfall within the HyperLogLog's own error is as likely to be noise in the
+    // estimate as collisions in the sketch, so leave near exact spectra alone
+    const double estimate = (double)hll.estimate();
+    if (weightTotal <= 0.0 || estimate - weightTotal <= estimate * hll.standardError()) {
+        return 1.0;
+    }
+
+    return estimate / weightTotal;
+}
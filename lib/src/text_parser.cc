@@ -0,0 +1,227 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <thread>
+using std::ifstream;
+using std::thread;
+
+#include <boost/lexical_cast.hpp>
+using boost::lexical_cast;
+
+#include <kat/text_parser.hpp>
+
+namespace {
+
+inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline const char* skipLine(const char* p, const char* end) {
+    const char* nl = (const char*)memchr(p, '\n', end - p);
+    return nl == nullptr ? end : nl + 1;
+}
+
+struct MatrixChunk {
+    vector<uint64_t> cells;
+    uint32_t rows = 0;
+    uint32_t cols = 0;
+    const char* error = nullptr;
+};
+
+void parseMatrixChunk(const char* p, const char* end, MatrixChunk& chunk) {
+
+    while (p < end) {
+
+        while (p < end && isBlank(*p)) p++;
+
+        // Skip comments and empty lines
+        if (p == end || *p == '#' || *p == '\n') {
+            p = skipLine(p, end);
+            continue;
+        }
+
+        const char* line = p;
+        uint32_t cols = 0;
+        while (p < end && *p != '\n') {
+            uint64_t val;
+            if (!kat::parseUInt64(p, end, val) || (p < end && !isBlank(*p) && *p != '\n')) {
+                chunk.error = p;
+                return;
+            }
+            chunk.cells.push_back(val);
+            cols++;
+            while (p < end && isBlank(*p)) p++;
+        }
+
+        if (chunk.rows == 0) {
+            chunk.cols = cols;
+        }
+        else if (cols != chunk.cols) {
+            chunk.error = line;
+            return;
+        }
+
+        chunk.rows++;
+        p = skipLine(p, end);
+    }
+}
+
+}
+
+kat::MappedTextFile::MappedTextFile(const path& _file) : file(_file) {
+
+    try {
+        mapped.map(file.c_str());
+        data = mapped.base();
+        length = mapped.length();
+        mapped.sequential();
+    }
+    catch(jellyfish::mapped_file::ErrorMMap& e) {
+        // Not mappable, e.g. empty file or pipe, so just read it into memory
+        ifstream in(file.c_str(), std::ios::binary);
+        if (!in) {
+            BOOST_THROW_EXCEPTION(TextParserException() << TextParserErrorInfo(string(
+                    "Could not open file: ") + file.string()));
+        }
+        buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        data = buffer.data();
+        length = buffer.size();
+    }
+}
+
+const char* kat::MappedTextFile::dataBegin() const {
+    const char* p = begin();
+    while (p < end() && *p == '#') {
+        p = skipLine(p, end());
+    }
+    return p;
+}
+
+vector<pair<const char*, const char*>> kat::MappedTextFile::chunks(size_t n) const {
+
+    vector<pair<const char*, const char*>> result;
+
+    const char* start = dataBegin();
+    const size_t size = end() - start;
+    n = std::max<size_t>(n, 1);
+
+    for (size_t i = 0; i < n && start < end(); i++) {
+        const char* stop = i == n - 1 ? end() : skipLine(std::max(start, dataBegin() + (size * (i + 1)) / n), end());
+        if (stop > start) {
+            result.push_back(pair<const char*, const char*>(start, stop));
+        }
+        start = stop;
+    }
+
+    return result;
+}
+
+uint64_t kat::MappedTextFile::lineNumber(const char* pos) const {
+    return std::count(begin(), pos, '\n') + 1;
+}
+
+void kat::TextParser::parseMatrix(const path& file, vector<uint64_t>& cells, uint32_t& rows, uint32_t& cols, uint16_t threads) {
+
+    MappedTextFile mtf(file);
+
+    size_t nb_threads = threads == 0 ? std::max<size_t>(thread::hardware_concurrency(), 1) : threads;
+    nb_threads = std::max<size_t>(std::min<size_t>(nb_threads, (mtf.end() - mtf.dataBegin()) / MIN_CHUNK_SIZE), 1);
+
+    vector<pair<const char*, const char*>> ranges = mtf.chunks(nb_threads);
+    vector<MatrixChunk> results(ranges.size());
+
+    if (ranges.size() == 1) {
+        parseMatrixChunk(ranges[0].first, ranges[0].second, results[0]);
+    }
+    else {
+        vector<thread> t(ranges.size());
+        for (size_t i = 0; i < ranges.size(); i++) {
+            t[i] = thread(parseMatrixChunk, ranges[i].first, ranges[i].second, std::ref(results[i]));
+        }
+        for (size_t i = 0; i < ranges.size(); i++) {
+            t[i].join();
+        }
+    }
+
+    // Stitch the chunks together in order, checking all rows have the same width
+    rows = 0;
+    cols = 0;
+    cells.clear();
+    for (auto& r : results) {
+        if (r.error != nullptr) {
+            BOOST_THROW_EXCEPTION(TextParserException() << TextParserErrorInfo(string(
+                    "Encountered unexpected syntax in ") + file.string() + " on line " +
+                    lexical_cast<string>(mtf.lineNumber(r.error))));
+        }
+
+        if (r.rows == 0) {
+            continue;
+        }
+
+        if (rows > 0 && r.cols != cols) {
+            BOOST_THROW_EXCEPTION(TextParserException() << TextParserErrorInfo(string(
+                    "Rows have inconsistent numbers of columns in ") + file.string()));
+        }
+
+        cols = r.cols;
+        rows += r.rows;
+
+        if (cells.empty()) {
+            cells.swap(r.cells);
+        }
+        else {
+            cells.insert(cells.end(), r.cells.begin(), r.cells.end());
+        }
+    }
+}
+
+void kat::TextParser::parseHistogram(const path& file, vector<pair<uint32_t, uint64_t>>& histo) {
+
+    MappedTextFile mtf(file);
+
+    const char* p = mtf.dataBegin();
+    const char* end = mtf.end();
+
+    while (p < end) {
+
+        while (p < end && isBlank(*p)) p++;
+
+        if (p == end || *p == '#' || *p == '\n') {
+            p = skipLine(p, end);
+            continue;
+        }
+
+        uint64_t bin, count;
+        bool ok = parseUInt64(p, end, bin) && p < end && isBlank(*p) && bin <= UINT32_MAX;
+        while (ok && p < end && isBlank(*p)) p++;
+        ok = ok && parseUInt64(p, end, count);
+
+        if (!ok) {
+            BOOST_THROW_EXCEPTION(TextParserException() << TextParserErrorInfo(string(
+                    "Encountered unexpected syntax in ") + file.string() + " on line " +
+                    lexical_cast<string>(mtf.lineNumber(p))));
+        }
+
+        histo.push_back(pair<uint32_t, uint64_t>((uint32_t)bin, count));
+
+        // Anything after the second column is ignored
+        p = skipLine(p, end);
+    }
+}
@@ -0,0 +1,209 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#include <ctype.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+using std::ifstream;
+
+#include <kat/two_bit.hpp>
+
+const uint32_t kat::TwoBitFile::SIGNATURE;
+
+namespace {
+
+    uint32_t swap32(uint32_t v) {
+        return ((v & 0xFF) << 24) | ((v & 0xFF00) << 8) | ((v >> 8) & 0xFF00) | (v >> 24);
+    }
+
+    // Bounds checked reads of little or big endian integers from the mapped file
+    class Cursor {
+    public:
+        Cursor(const char* base, uint64_t length, bool swap, const string& corrupt) :
+            base(base), length(length), swap(swap), corrupt(corrupt), pos(0) {}
+
+        void seek(uint64_t p) {
+            if (p > length) fail();
+            pos = p;
+        }
+
+        uint64_t tell() const { return pos; }
+
+        uint8_t get8() {
+            need(1);
+            return (uint8_t)base[pos++];
+        }
+
+        uint32_t get32() {
+            need(4);
+            uint32_t v;
+            memcpy(&v, base + pos, 4);
+            pos += 4;
+            return swap ? swap32(v) : v;
+        }
+
+        uint64_t get64() {
+            const uint64_t a = get32();
+            const uint64_t b = get32();
+            // The 64 bit offsets are written as a single 64 bit integer in the
+            // file's byte order
+            return swap ? (a << 32) | b : (b << 32) | a;
+        }
+
+        string getString(size_t n) {
+            need(n);
+            string s(base + pos, n);
+            pos += n;
+            return s;
+        }
+
+        void need(uint64_t n) const {
+            if (n > length - pos) fail();
+        }
+
+        void fail() const {
+            BOOST_THROW_EXCEPTION(kat::TwoBitException() << kat::TwoBitErrorInfo(corrupt));
+        }
+
+    private:
+        const char* base;
+        uint64_t length;
+        bool swap;
+        const string& corrupt;
+        uint64_t pos;
+    };
+
+    void readBlocks(Cursor& c, vector<pair<uint64_t, uint64_t>>& blocks) {
+        const uint32_t count = c.get32();
+        c.need((uint64_t)count * 8);
+        blocks.resize(count);
+        for (auto& b : blocks) b.first = c.get32();
+        for (auto& b : blocks) b.second = c.get32();
+        std::sort(blocks.begin(), blocks.end());
+    }
+
+    // Each packed byte unpacked to its four bases
+    struct UnpackTable {
+        char bases[256][4];
+
+        UnpackTable() {
+            const char code[4] = {'T', 'C', 'A', 'G'};
+            for (int i = 0; i < 256; i++) {
+                for (int j = 0; j < 4; j++) {
+                    bases[i][j] = code[(i >> (6 - 2 * j)) & 3];
+                }
+            }
+        }
+    };
+
+    const UnpackTable UNPACK;
+}
+
+kat::TwoBitFile::TwoBitFile(const path& _file) : file(_file) {
+
+    try {
+        twoBit.map(file.c_str());
+    }
+    catch(jellyfish::mapped_file::ErrorMMap& e) {
+        BOOST_THROW_EXCEPTION(TwoBitException() << TwoBitErrorInfo(string(
+                "Could not map .2bit file: ") + file.string() + "; " + e.what()));
+    }
+
+    uint32_t sig = 0;
+    if (twoBit.length() >= 16) {
+        memcpy(&sig, twoBit.base(), 4);
+    }
+    if (sig != SIGNATURE && sig != swap32(SIGNATURE)) {
+        BOOST_THROW_EXCEPTION(TwoBitException() << TwoBitErrorInfo(string(
+                "Not a .2bit file: ") + file.string()));
+    }
+
+    const string corrupt = string(".2bit file is truncated or corrupt: ") + file.string();
+    Cursor c(twoBit.base(), twoBit.length(), sig != SIGNATURE, corrupt);
+
+    c.seek(4);
+    const uint32_t version = c.get32();
+    if (version > 1) {
+        BOOST_THROW_EXCEPTION(TwoBitException() << TwoBitErrorInfo(string(
+                "Unsupported .2bit version in: ") + file.string()));
+    }
+    const uint32_t count = c.get32();
+    c.get32();   // Reserved
+
+    // Index of names and record offsets
+    records.resize(count);
+    vector<uint64_t> offsets(count);
+    for (uint32_t i = 0; i < count; i++) {
+        records[i].name = c.getString(c.get8());
+        offsets[i] = version == 1 ? c.get64() : c.get32();
+    }
+
+    // Record headers
+    for (uint32_t i = 0; i < count; i++) {
+        TwoBitRecord& r = records[i];
+        c.seek(offsets[i]);
+        r.length = c.get32();
+        readBlocks(c, r.nBlocks);
+        readBlocks(c, r.maskBlocks);
+        c.get32();   // Reserved
+        r.dnaOffset = c.tell();
+        c.need((r.length + 3) / 4);
+    }
+}
+
+string kat::TwoBitFile::getSequence(size_t index) const {
+    return unpack(records[index], getPacked(index));
+}
+
+string kat::TwoBitFile::unpack(const TwoBitRecord& r, const uint8_t* packed) {
+
+    // Unpack whole bytes, then the partial byte at the end
+    string seq(r.length, 'N');
+    const uint64_t whole = r.length / 4;
+    for (uint64_t i = 0; i < whole; i++) {
+        memcpy(&seq[i * 4], UNPACK.bases[packed[i]], 4);
+    }
+    for (uint64_t i = whole * 4; i < r.length; i++) {
+        seq[i] = UNPACK.bases[packed[whole]][i & 3];
+    }
+
+    for (auto& b : r.nBlocks) {
+        const uint64_t end = std::min(r.length, b.first + b.second);
+        for (uint64_t i = b.first; i < end; i++) {
+            seq[i] = 'N';
+        }
+    }
+
+    for (auto& b : r.maskBlocks) {
+        const uint64_t end = std::min(r.length, b.first + b.second);
+        for (uint64_t i = b.first; i < end; i++) {
+            seq[i] = tolower(seq[i]);
+        }
+    }
+
+    return seq;
+}
+
+bool kat::TwoBitFile::isTwoBit(const path& file) {
+    uint32_t sig;
+    ifstream in(file.c_str(), std::ios::binary);
+    if (!in.read(reinterpret_cast<char*>(&sig), sizeof(sig))) {
+        return false;
+    }
+    return sig == SIGNATURE || sig == swap32(SIGNATURE);
+}
@@ -11,8 +11,10 @@ matplotlib.use('Agg')
 
 try:
 	from .spectra import KmerSpectra, GCSpectra
+	from .plot.misc import load_matrix, read_matrix_header
 except:
 	from kat.spectra import KmerSpectra, GCSpectra
+	from kat.plot.misc import load_matrix, read_matrix_header
 
 version = "2.X.X"
 try:
@@ -105,19 +107,10 @@ class GCKmerSpectraAnalysis(SpectraAnalysis):
 
 
 	def read_file(self, name, freq_cutoff=10000):
-		f = open(name)
-		cov_histogram = None
-		gc_histogram = []
-		for x in f.readlines():
-			if x and x[0] != '#':
-				# Kmer coverage histo
-				parts = x.split()
-				gc_histogram.append(sum([int(y) for y in parts]))
-				if not cov_histogram:
-					cov_histogram = [0] * len(parts)
-				for i, y in enumerate(parts):
-					cov_histogram[i] += int(y)
-		f.close()
+		header, matrix = load_matrix(name)
+		# Rows are GC count, columns are kmer coverage
+		gc_histogram = [int(x) for x in matrix.sum(axis=1)]
+		cov_histogram = [int(x) for x in matrix.sum(axis=0)]
 		return cov_histogram[:freq_cutoff], gc_histogram
 
 
@@ -197,16 +190,12 @@ class MXKmerSpectraAnalysis(SpectraAnalysis):
 			self.spectras.append(KmerSpectra(self.read_mx(filename, freq_cutoff=freq_cutoff, column=i, cumulative=False), haploid=haploid, k=k))
 
 	def read_mx(self, name, freq_cutoff=10000, column=1, cumulative=False):
-		f = open(name)
-
-		histogram = []
+		header, matrix = load_matrix(name)
 		if cumulative:
-			histogram = [sum([int(y) for y in x.split()[column:]]) for x in f.readlines() if x and x[0] != '#'][
-							 :freq_cutoff][1:]
+			values = matrix[:freq_cutoff, column:].sum(axis=1)
 		else:
-			histogram = [int(x.split()[column]) for x in f.readlines() if x and x[0] != '#'][:freq_cutoff][1:]
-		f.close()
-		return histogram
+			values = matrix[:freq_cutoff, column]
+		return [int(x) for x in values][1:]
 
 	def plot(self, xmax=0, ymax=0, to_screen=False, file_prefix=None, format=None):
 		if 0 == xmax: xmax = self.limx
@@ -342,25 +331,10 @@ class MXKmerSpectraAnalysis(SpectraAnalysis):
 			return 0.0
 
 def get_properties_from_file(input_file):
-	k = 27
-	mx = False
-	gcp = False
-
-	f = open(input_file)
-	i = 0
-	for l in f.readlines():
-		if i > 10:
-			break
-		line = l.strip()
-		if line.startswith("#"):
-			if line.startswith("# Kmer value:"):
-				k = int(line.split(":")[1])
-			elif line.startswith("# Rows:"):
-				mx = True
-			elif line.startswith("# YLabel:GC count"):
-				gcp = True
-		i+=1
-	f.close()
+	header = read_matrix_header(input_file)
+	k = int(header["Kmer value"]) if "Kmer value" in header else 27
+	mx = "Rows" in header
+	gcp = header.get("YLabel", "").startswith("GC count")
 
 	return k, mx, gcp
 
@@ -1,3 +1,4 @@
+import struct
 import numpy as np
 import matplotlib
 matplotlib.use('Agg')
@@ -18,6 +19,127 @@ def readheader(input_file):
             break
     return header
 
+# Binary matrix layout, see lib/include/kat/binary_matrix.hpp
+BINARY_MX_MAGIC = b"KATBINMX"
+BINARY_MX_HEADER = struct.Struct("<8sIIQQQQQQ")
+BINARY_MX_SPARSE_ENTRY = np.dtype([("row", "<u4"), ("col", "<u4"), ("val", "<u8")])
+
+def is_binary_matrix(filename):
+    with open(filename, "rb") as f:
+        return f.read(len(BINARY_MX_MAGIC)) == BINARY_MX_MAGIC
+
+def read_binary_matrix_header(filename):
+    with open(filename, "rb") as f:
+        fields = BINARY_MX_HEADER.unpack(f.read(BINARY_MX_HEADER.size))
+        meta_offset, meta_len = fields[6], fields[7]
+        f.seek(meta_offset)
+        metadata = f.read(meta_len).decode()
+    return fields, readheader(metadata.splitlines(True))
+
+def read_matrix_header(filename):
+    """Returns the header dictionary of a KAT matrix or histogram file, in either
+    text or binary format."""
+    if is_binary_matrix(filename):
+        return read_binary_matrix_header(filename)[1]
+    with open(filename) as input_file:
+        return readheader(input_file)
+
+def load_matrix(filename):
+    """Loads a KAT matrix file, in either text or binary format.  Returns a tuple
+    containing the header dictionary and the matrix.  Dense binary matrices are
+    memory mapped rather than read into memory."""
+    if not is_binary_matrix(filename):
+        with open(filename) as input_file:
+            header = readheader(input_file)
+            input_file.seek(0)
+            matrix = np.loadtxt(input_file, ndmin=2)
+        return header, matrix
+
+    fields, header = read_binary_matrix_header(filename)
+    magic, version, storage, rows, cols, nnz, meta_offset, meta_len, data_offset = fields
+
+    if storage == 0:
+        matrix = np.memmap(filename, dtype="<u8", mode="r", offset=data_offset, shape=(rows, cols))
+    else:
+        matrix = np.zeros((rows, cols), dtype=np.uint64)
+        if nnz > 0:
+            entries = np.memmap(filename, dtype=BINARY_MX_SPARSE_ENTRY, mode="r", offset=data_offset, shape=(nnz,))
+            matrix[entries["row"], entries["col"]] = entries["val"]
+
+    return header, matrix
+
+# Binary coverage layout, see lib/include/kat/coverage_file.hpp
+BINARY_CVG_MAGIC = b"KATBINCV"
+BINARY_CVG_HEADER = struct.Struct("<8sIIIIQQ")
+
+def is_binary_coverage(filename):
+    with open(filename, "rb") as f:
+        return f.read(len(BINARY_CVG_MAGIC)) == BINARY_CVG_MAGIC
+
+def _read_varint(buf, i):
+    v = 0
+    shift = 0
+    while True:
+        b = buf[i]
+        i += 1
+        v |= (b & 0x7F) << shift
+        if not b & 0x80:
+            return v, i
+        shift += 7
+
+class CoverageFile:
+    """Random access reader for the binary K-mer coverage files produced by
+    "kat sect --binary_counts".  Only the index is loaded up front, and only the
+    blocks covering a requested interval are read and decoded."""
+
+    def __init__(self, filename):
+        self.filename = filename
+        with open(filename, "rb") as f:
+            fields = BINARY_CVG_HEADER.unpack(f.read(BINARY_CVG_HEADER.size))
+            magic, version, self.block_size, self.mer_len, reserved, nb_seqs, index_offset = fields
+            f.seek(index_offset)
+            index = f.read()
+
+        self.names = []
+        self.lengths = {}
+        self.offsets = {}
+        p = 0
+        for i in range(nb_seqs):
+            name_len, = struct.unpack_from("<I", index, p)
+            p += 4
+            name = index[p:p + name_len].decode()
+            p += name_len
+            length, nb_blocks = struct.unpack_from("<QQ", index, p)
+            p += 16
+            self.offsets[name] = struct.unpack_from("<%dQ" % (nb_blocks + 1), index, p)
+            p += 8 * (nb_blocks + 1)
+            self.lengths[name] = length
+            self.names.append(name)
+
+    def get(self, name, start=0, end=None):
+        """Returns the counts for K-mer positions [start, end) of the named sequence"""
+        length = self.lengths[name]
+        end = length if end is None else end
+        if start >= end:
+            return np.zeros(0, dtype=np.uint64)
+        offsets = self.offsets[name]
+        first = start // self.block_size
+        last = (end - 1) // self.block_size
+        with open(self.filename, "rb") as f:
+            f.seek(offsets[first])
+            buf = f.read(offsets[last + 1] - offsets[first])
+        vals = []
+        runs = []
+        i = 0
+        while i < len(buf):
+            v, i = _read_varint(buf, i)
+            r, i = _read_varint(buf, i)
+            vals.append(v)
+            runs.append(r)
+        counts = np.repeat(np.array(vals, dtype=np.uint64), np.array(runs, dtype=np.int64))
+        skip = start - first * self.block_size
+        return counts[skip:skip + end - start]
+
 def findpeaks(a):
     a = np.squeeze(np.asarray(a))
     ad = np.sign(np.diff(a))
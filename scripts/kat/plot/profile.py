@@ -9,6 +9,38 @@ try:
 except:
 	from kat.plot.misc import *
 
+class Profiles:
+	"""Profiles from a KAT sect counts file, keyed by sequence name.  Profiles are
+	only converted to numbers when requested, and with a binary counts file only
+	the requested sequences are read from disk."""
+
+	def __init__(self, filename):
+		self.names = []
+		self.text = {}
+		self.binary = None
+		if is_binary_coverage(filename):
+			self.binary = CoverageFile(filename)
+			self.names = self.binary.names
+		else:
+			last_name = ""
+			with open(filename) as input_file:
+				for line in input_file:
+					if line[0] == '>':
+						last_name = line[1:-1]
+						self.names.append(last_name)
+					else:
+						self.text[last_name] = line[:-1]
+
+	def __contains__(self, name):
+		return name in self.text if self.binary is None else name in self.binary.lengths
+
+	def __getitem__(self, name):
+		if self.binary is None:
+			return np.fromstring(self.text[name], dtype=float, sep=' ')
+		profile = self.binary.get(name).astype(float)
+		# Sequences shorter than K are written as a single 0 in text files
+		return profile if len(profile) > 0 else np.zeros(1)
+
 def main():
 
 	# ----- command line parsing -----
@@ -64,34 +96,14 @@ def main():
 	args = parser.parse_args()
 	# ----- end command line parsing -----
 
-	names = []
-	profiles = {}
+	profiles = Profiles(args.sect_profile_file)
+	names = profiles.names
+
 	names2 = []
 	profiles2 = {}
-
-	input_file = open(args.sect_profile_file)
-
-	last_name = ""
-	for line in input_file:
-		if line[0] == '>':
-			last_name = line[1:-1]
-			names.append(last_name)
-		else:
-			profiles[last_name] = line[:-1]
-	input_file.close()
-
-	input2_file = None
 	if args.sect_profile_file_2 is not None:
-		input2_file = open(args.sect_profile_file_2)
-
-		last_name = ""
-		for line in input2_file:
-			if line[0] == '>':
-				last_name = line[1:-1]
-				names2.append(last_name)
-			else:
-				profiles2[last_name] = line[:-1]
-		input2_file.close()
+		profiles2 = Profiles(args.sect_profile_file_2)
+		names2 = profiles2.names
 
 	if args.sect_profile_file_2 is not None and len(names) != len(names2):
 		print("First and second input files are not the same length", file=sys.stderr)
@@ -128,8 +140,11 @@ def main():
 
 	fig, axs = plt.subplots(len(names), 1, figsize=(args.width, args.height * (len(names) + 0.3)))
 
-	pstrs = [profiles[name] for name in names]
-	profs = [np.fromstring(pstr, dtype=float, sep=' ') for pstr in pstrs]
+	for name in names:
+		if name not in profiles:
+			sys.exit("Entry {:s} not found.".format(name))
+
+	profs = [profiles[name] for name in names]
 	if args.x_max is not None:
 		maxlen = args.x_max
 	else:
@@ -142,12 +157,10 @@ def main():
 
 	maxval1 = max(list(map(max, profs)))
 
-	pstrs2 = []
 	profs2 = []
 	maxval2 = 0
 	if args.sect_profile_file_2 is not None:
-		pstrs2 = [profiles2[name] for name in names]
-		profs2 = [np.fromstring(pstr2, dtype=float, sep=' ') for pstr2 in pstrs2]
+		profs2 = [profiles2[name] for name in names]
 		maxval2 = max(list(map(max, profs2)))
 
 	for i in range(len(names)):
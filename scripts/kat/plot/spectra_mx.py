@@ -74,10 +74,8 @@ def main():
     if args.verbose:
         print("\nDensity plotting:", args.matrix_file)
 
-    # load header information
-    input_file = open(args.matrix_file)
-
-    header = readheader(input_file)
+    # load header information and matrix data
+    header, matrix = load_matrix(args.matrix_file)
 
     if args.title is not None:
         title = args.title
@@ -96,10 +94,8 @@ def main():
     else:
         y_label = "Number of distinct k-mers"
 
-    matrix = np.loadtxt(input_file)
     if "Transpose" in header and header["Transpose"] == '1':
         matrix = np.transpose(matrix)
-    input_file.close()
     if args.verbose:
         print("{:d} by {:d} matrix file loaded.".format(matrix.shape[0],
                                                         matrix.shape[1]))
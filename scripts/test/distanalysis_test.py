@@ -2,8 +2,11 @@ import unittest
 import os
 import tempfile
 import shutil
+import struct
+import numpy as np
 
 from kat.distanalysis import *
+from kat.plot.misc import *
 
 class DistAnalysisTest(unittest.TestCase):
 
@@ -46,3 +49,41 @@ class DistAnalysisTest(unittest.TestCase):
 		a.analyse()
 		a.peak_stats(os.path.join(self.temp_dir, "system_spectracn2"))
 		assert (os.path.exists(os.path.join(self.temp_dir, "system_spectracn2.dist_analysis.json")))
+
+
+	def write_binary(self, in_file, out_file, sparse):
+		# Converts a text matrix to KAT's binary matrix format
+		with open(in_file) as f:
+			meta = "".join([l for l in f.readlines() if l.startswith("#")]).encode()
+		header, matrix = load_matrix(in_file)
+		matrix = matrix.astype(np.uint64)
+		rows, cols = matrix.shape
+		nz = np.nonzero(matrix)
+		data_offset = ((BINARY_MX_HEADER.size + len(meta) + 63) // 64) * 64
+		with open(out_file, "wb") as f:
+			f.write(BINARY_MX_HEADER.pack(BINARY_MX_MAGIC, 1, 1 if sparse else 0, rows, cols, len(nz[0]),
+										  BINARY_MX_HEADER.size, len(meta), data_offset))
+			f.write(meta)
+			f.write(b"\0" * (data_offset - BINARY_MX_HEADER.size - len(meta)))
+			if sparse:
+				entries = np.zeros(len(nz[0]), dtype=BINARY_MX_SPARSE_ENTRY)
+				entries["row"], entries["col"], entries["val"] = nz[0], nz[1], matrix[nz]
+				f.write(entries.tobytes())
+			else:
+				f.write(matrix.astype("<u8").tobytes())
+
+	def test_binary_matrix(self):
+		in_file = os.path.join(os.path.dirname(__file__), "resources", "spectracn1.mx")
+		text_header, text_matrix = load_matrix(in_file)
+		for sparse in [False, True]:
+			bin_file = os.path.join(self.temp_dir, "spectracn1.%s.mx" % ("sparse" if sparse else "dense"))
+			self.write_binary(in_file, bin_file, sparse)
+			assert(is_binary_matrix(bin_file))
+			header, matrix = load_matrix(bin_file)
+			assert(header == text_header)
+			assert(np.array_equal(matrix, text_matrix))
+			assert(get_properties_from_file(bin_file) == get_properties_from_file(in_file))
+			a = MXKmerSpectraAnalysis(in_file, haploid=False, freq_cutoff=500, k=27)
+			b = MXKmerSpectraAnalysis(bin_file, haploid=False, freq_cutoff=500, k=27)
+			assert(a.read_mx(in_file, column=1) == b.read_mx(bin_file, column=1))
+			assert(a.read_mx(in_file, column=0, cumulative=True) == b.read_mx(bin_file, column=0, cumulative=True))
@@ -80,9 +80,6 @@ kat::Cold::Cold(const vector<path> _reads_files, const path _asm_file) {
 
 void kat::Cold::execute() {
 
-    bucket_size = BATCH_SIZE / threads;
-    remaining = BATCH_SIZE % (bucket_size < 1 ? 1 : threads);
-
     // Validate input
     reads.validateInput();
     assembly.validateInput();
@@ -100,8 +97,14 @@ void kat::Cold::execute() {
         reads.loadHash();
     }
 
-    // Either count or load assembly
+    // Either count or load assembly.  Unless it's a .2bit file, whose packed bases
+    // are used directly, the assembly is parsed once into memory, and both counted
+    // and walked from there.
     if (assembly.mode == InputHandler::InputHandler::InputMode::COUNT) {
+        if (JellyfishHelper::isPipe(assembly.getSingleInput()) || !TwoBitFile::isTwoBit(assembly.getSingleInput())) {
+            loadAssembly();
+            assembly.packed = packedAssembly;
+        }
         assembly.count(threads);
     }
     else {
@@ -109,9 +112,16 @@ void kat::Cold::execute() {
         assembly.loadHash();
     }
 
+    // Put the read counts alongside the assembly counts
+    combineCounts();
+
     // Do the core of the work here
     processSeqFile();
 
+    // The in memory assembly is no longer needed
+    assembly.packed = nullptr;
+    packedAssembly = nullptr;
+
     // Dump any hashes that were previously counted to disk if requested
     // NOTE: MUST BE DONE AFTER COMPARISON AS THIS CLEARS ENTRIES FROM HASH ARRAY!
     if (this->dumpHashes()) {
@@ -123,184 +133,178 @@ void kat::Cold::execute() {
 }
 
 
-void kat::Cold::processSeqFile() {
+void kat::Cold::loadAssembly() {
 
     auto_cpu_timer timer(1, "  Time taken: %ws\n\n");
 
-    cout << "Calculating kmer coverage across sequences ...";
+    cout << "Loading assembly into memory ...";
     cout.flush();
 
-    // Setup space for storing output
-    offset = 0;
-    recordsInBatch = 0;
+    packedAssembly = make_shared<PackedSequences>();
 
-    names = seqan::StringSet<seqan::CharString>();
-    seqs = seqan::StringSet<seqan::CharString>();
-
-    // Open file, create RecordReader and check all is well
     seqan::SeqFileIn reader(assembly.pathString().c_str());
-
-    // Setup output stream for jellyfish initialisation
-    std::ostream* out_stream = verbose ? &cerr : (std::ostream*)0;
-
-
-    // Setup output streams for files
-    if (verbose)
-        *out_stream << endl;
-
-    // Average sequence coverage and GC% scores output stream
-    ofstream cvg_gc_stream(string(outputPrefix.string() + "-stats.tsv").c_str());
-    cvg_gc_stream << "seq_name\tread_median_cvg\tread_mean_cvg\tasm_cn\tgc%\tseq_length\tkmers_in_seq\tinvalid_kmers\t%_invalid\tnon_zero_kmers\t%_non_zero\t%_non_zero_corrected" << endl;
-
-    // Processes sequences in batches of records to reduce memory requirements
+    seqan::CharString name;
+    seqan::CharString seq;
     while (!seqan::atEnd(reader)) {
-        if (verbose)
-            *out_stream << "Loading Batch of sequences... ";
-
-        seqan::clear(names);
-        seqan::clear(seqs);
-
-        seqan::readRecords(names, seqs, reader, BATCH_SIZE);
-
-        recordsInBatch = seqan::length(names);
-
-        if (verbose)
-            *out_stream << "Loaded " << recordsInBatch << " records.  Processing batch... ";
-
-        // Allocate memory for output produced by this batch
-        createBatchVars(recordsInBatch);
-
-        // Process batch with worker threads
-        // Process each sequence is processed in a different thread.
-        // In each thread lookup each K-mer in the hash
-        analyseBatch();
+        seqan::readRecord(name, seq, reader);
+        packedAssembly->add(string(seqan::toCString(name), seqan::length(name)), string(seqan::toCString(seq), seqan::length(seq)));
+    }
+    seqan::close(reader);
 
-        // Output stats
-        printStatTable(cvg_gc_stream);
+    cout << " done.";
+    cout.flush();
+}
 
-        // Remove any batch specific variables from memory
-        destroyBatchVars();
+void kat::Cold::combineCounts() {
 
-        // Increment batch management vars
-        offset += recordsInBatch;
+    readCounts.clear();
 
-        if (verbose)
-            *out_stream << "done" << endl;
+    // If the reads are non-canonical but the assembly is canonical, the read count
+    // depends on which strand of the assembly a K-mer was found on, so the reads
+    // hash has to be probed directly for each K-mer
+    if (!reads.canonical && assembly.canonical) {
+        return;
     }
 
-    seqan::close(reader);
-
-    cvg_gc_stream.close();
+    auto_cpu_timer timer(1, "  Time taken: %ws\n\n");
 
-    cout << " done.";
+    cout << "Combining read counts with assembly counts ...";
     cout.flush();
-}
 
-void kat::Cold::analyseBatch() {
+    readCounts.assign(assembly.hash->size(), 0);
 
     vector<thread> t(threads);
 
     for(uint16_t i = 0; i < threads; i++) {
-        t[i] = thread(&Cold::analyseBatchSlice, this, i);
+        t[i] = thread(&Cold::combineSlice, this, i);
     }
 
     for(uint16_t i = 0; i < threads; i++){
         t[i].join();
     }
+
+    cout << " done.";
+    cout.flush();
 }
 
-void kat::Cold::analyseBatchSlice(int th_id) {
-    // Check to see if we have useful work to do for this thread, return if not
-    if (bucket_size < 1 && th_id >= recordsInBatch) {
-        return;
-    }
+void kat::Cold::combineSlice(const uint16_t th_id) {
+
+    // Each read K-mer found in the assembly fills the slot of the matching assembly
+    // K-mer, or both strands if only the reads are canonical.  No two read K-mers map
+    // to the same slot, so threads never write to the same element.
+    const bool bothStrands = reads.canonical && !assembly.canonical;
+    mer_dna tmp;
+    size_t id;
 
-    //processInBlocks(th_id);
-    processInterlaced(th_id);
+    LargeHashArray::eager_iterator it = reads.hash->eager_slice(th_id, threads);
+    while (it.next()) {
+        const uint32_t count = it.val() > UINT32_MAX ? UINT32_MAX : it.val();
+        if (assembly.hash->get_key_id(it.key(), &id, tmp)) {
+            readCounts[id] = count;
+        }
+        if (bothStrands) {
+            mer_dna rc = it.key().get_reverse_complement();
+            if (rc != it.key() && assembly.hash->get_key_id(rc, &id, tmp)) {
+                readCounts[id] = count;
+            }
+        }
+    }
 }
 
-void kat::Cold::destroyBatchVars() {
-    medians->clear();
-    means->clear();
-    asmCns->clear();
-    gcs->clear();
-    lengths->clear();
-    invalid->clear();
-    percentInvalid->clear();
-    nonZero->clear();
-    percentNonZero->clear();
-    percentNonZeroCorrected->clear();
+void kat::Cold::processSeqFile() {
 
-}
+    auto_cpu_timer timer(1, "  Time taken: %ws\n\n");
 
-void kat::Cold::createBatchVars(uint16_t batchSize) {
-    medians = make_shared<vector<uint32_t>>(batchSize);
-    means = make_shared<vector<double>>(batchSize);
-    asmCns = make_shared<vector<uint32_t>>(batchSize);
-    gcs = make_shared<vector<double>>(batchSize);
-    lengths = make_shared<vector<uint32_t>>(batchSize);
-    invalid = make_shared<vector<uint32_t>>(batchSize);
-    percentInvalid = make_shared<vector<double>>(batchSize);
-    nonZero = make_shared<vector<uint32_t>>(batchSize);
-    percentNonZero = make_shared<vector<double>>(batchSize);
-    percentNonZeroCorrected = make_shared<vector<double>>(batchSize);
-}
+    cout << "Calculating kmer coverage across sequences ...";
+    cout.flush();
 
-double kat::Cold::gcCountToPercentage(int16_t count) {
-    return count == -1 ? -0.1 : (((double)count / (double)this->getMerLen()) * 100.0);
-}
+    // Setup output stream for jellyfish initialisation
+    std::ostream* out_stream = verbose ? &cerr : (std::ostream*)0;
 
-void kat::Cold::printStatTable(std::ostream &out) {
 
-    out << std::fixed << std::setprecision(5);
+    // Setup output streams for files
+    if (verbose)
+        *out_stream << endl;
 
-    for (uint32_t i = 0; i < recordsInBatch; i++) {
-        out << names[i] << "\t"
-            << (*medians)[i] << "\t"
-            << (*means)[i] << "\t"
-            << (*asmCns)[i] << "\t"
-            << (*gcs)[i] << "\t"
-            << (*lengths)[i] << "\t"
-            << (*lengths)[i] - this->assembly.merLen + 1 << "\t"
-            << (*invalid)[i] << "\t"
-            << (*percentInvalid)[i] << "\t"
-            << (*nonZero)[i] << "\t"
-            << (*percentNonZero)[i] << "\t"
-            << (*percentNonZeroCorrected)[i] << endl;
+    // Use the assembly already in memory, a .2bit file or a FastA index if possible,
+    // so that workers can load their own records.  Otherwise fall back to reading
+    // the assembly sequentially.
+    shared_ptr<SequenceIndex> index = packedAssembly;
+    if (!index) {
+        try {
+            index = SequenceIndex::open(assembly.pathString());
+        }
+        catch(FastaIndexException& e) {
+            if (verbose)
+                *out_stream << "Reading assembly sequentially: " << *boost::get_error_info<FastaIndexErrorInfo>(e) << endl;
+        }
     }
-}
+    SequenceBatchReader batches(index, assembly.pathString());
 
+    // Batches are read, processed and written out concurrently, with each worker
+    // taking a whole batch.  The stats are written in assembly order.
+    Pipeline<SeqBatch> pipeline(threads, 2 * threads + 2);
+    chunks = make_shared<ChunkPool>();
+    pipeline.setChunkPool(chunks);
 
-// This method won't be optimal in most cases... Fasta files are normally sorted by length (largest first)
-// So first thread will be asked to do more work than the rest
+    // Average sequence coverage and GC% scores output stream
+    ofstream cvg_gc_stream(string(outputPrefix.string() + "-stats.tsv").c_str());
+    cvg_gc_stream << "seq_name\tread_median_cvg\tread_mean_cvg\tasm_cn\tgc%\tseq_length\tkmers_in_seq\tinvalid_kmers\t%_invalid\tnon_zero_kmers\t%_non_zero\t%_non_zero_corrected" << endl;
+    pipeline.addWriter([&](const SeqBatch& b) { printStatTable(cvg_gc_stream, b); });
+
+    // Process each batch in a worker thread.  In each batch lookup each K-mer in the hashes
+    pipeline.run(
+        [&](SeqBatch& b) {
+            if (!batches.read(b))
+                return false;
+            if (verbose)
+                *out_stream << "Loaded batch of " << batches.nbRecords(b) << " records" << endl;
+            return true;
+        },
+        [&](SeqBatch& b, uint16_t th_id) {
+            batches.load(b);
+            b.resize(b.size());
+            processBatch(b);
+        });
 
-void kat::Cold::processInBlocks(uint16_t th_id) {
-    size_t start = bucket_size < 1 ? th_id : th_id * bucket_size;
-    size_t end = bucket_size < 1 ? th_id : start + bucket_size - 1;
-    for (size_t i = start; i <= end; i++) {
-        processSeq(i, th_id);
-    }
+    cvg_gc_stream.close();
 
-    // Process a remainder if required
-    if (th_id < remaining) {
-        size_t rem_idx = (threads * bucket_size) + th_id;
-        processSeq(rem_idx, th_id);
+    cout << " done.";
+    cout.flush();
+}
+
+void kat::Cold::processBatch(SeqBatch& batch) {
+    for (size_t i = 0; i < batch.size(); i++) {
+        processSeq(batch, i);
     }
 }
 
-// This method is probably makes more efficient use of multiple cores on a length sorted fasta file
+double kat::Cold::gcCountToPercentage(int16_t count) {
+    return count == -1 ? -0.1 : (((double)count / (double)this->getMerLen()) * 100.0);
+}
+
+void kat::Cold::printStatTable(std::ostream &out, const SeqBatch& batch) {
+
+    out << std::fixed << std::setprecision(5);
 
-void kat::Cold::processInterlaced(uint16_t th_id) {
-    size_t start = th_id;
-    size_t end = recordsInBatch;
-    for (size_t i = start; i < end; i += threads) {
-        processSeq(i, th_id);
+    for (uint32_t i = 0; i < batch.size(); i++) {
+        out << batch.names[i] << "\t"
+            << batch.medians[i] << "\t"
+            << batch.means[i] << "\t"
+            << batch.asmCns[i] << "\t"
+            << batch.gcs[i] << "\t"
+            << batch.lengths[i] << "\t"
+            << batch.lengths[i] - this->assembly.merLen + 1 << "\t"
+            << batch.invalid[i] << "\t"
+            << batch.percentInvalid[i] << "\t"
+            << batch.nonZero[i] << "\t"
+            << batch.percentNonZero[i] << "\t"
+            << batch.percentNonZeroCorrected[i] << endl;
     }
 }
 
 
-
-void kat::Cold::processSeq(const size_t index, const uint16_t th_id) {
+void kat::Cold::processSeq(SeqBatch& batch, const size_t index) {
 
     // There's no substring functionality in SeqAn in this version (2.0.0).  So we'll just
     // use regular c++ string's for this bit.  This conversion of strings:
@@ -308,7 +312,7 @@ void kat::Cold::processSeq(const size_t index, const uint16_t th_id) {
     // inefficient. Reducing the number of conversions necessary will
     // make a big performance improvement here
     stringstream ssSeq;
-    ssSeq << seqs[index];
+    ssSeq << batch.seqs[index];
     string seq = ssSeq.str();
 
     uint64_t seqLength = seq.length();
@@ -324,64 +328,77 @@ void kat::Cold::processSeq(const size_t index, const uint16_t th_id) {
         //cerr << names[index] << ": " << seq << " is too short to compute coverage.  Sequence length is "
         //       << seqLength << " and K-mer length is " << merLen << ". Setting sequence coverage to 0." << endl;
 
-        (*medians)[index] = 0;
-        (*means)[index] = 0.0;
-        (*asmCns)[index] = 0;
+        batch.medians[index] = 0;
+        batch.means[index] = 0.0;
+        batch.asmCns[index] = 0;
 
     } else {
 
-        shared_ptr<vector<uint64_t>> readsCounts = make_shared<vector<uint64_t>>(nbCounts, 0);
-        shared_ptr<vector<uint64_t>> asmCounts = make_shared<vector<uint64_t>>(nbCounts, 0);
-
-        uint64_t sum = 0;
-
-        for (int64_t i = 0; i < nbCounts; i++) {
-
-            string merstr = seq.substr(i, reads.merLen);
-
-            // Jellyfish compacted hash does not support Ns so if we find one set this mer count to 0
-            if (!validKmer(merstr)) {
-                (*readsCounts)[i] = 0;
-                (*asmCounts)[i] = 0;
-                nbInvalid++;
-            } else {
-                mer_dna mer(merstr);
-                uint64_t readcount = JellyfishHelper::getCount(reads.hash, mer, reads.canonical);
-                sum += readcount;
-                uint64_t asmcount = JellyfishHelper::getCount(assembly.hash, mer, assembly.canonical);
-                (*readsCounts)[i] = readcount;
-                (*asmCounts)[i] = asmcount;
-                if (readcount != 0) nbNonZero++;
+        // Long sequences are split into chunks of K-mer windows, which are looked up by
+        // any workers that are free.  Each chunk keeps its own stats, which are merged afterwards.  No
+        // output needs the per K-mer counts, so they aren't kept.
+        const size_t nbChunks = (nbCounts + SEQ_CHUNK_SIZE - 1) / SEQ_CHUNK_SIZE;
+        vector<CoverageStats> readsChunkStats(nbChunks);
+        vector<CoverageStats> asmChunkStats(nbChunks);
+        chunks->run(nbCounts, SEQ_CHUNK_SIZE, [&](uint64_t start, uint64_t end) {
+
+            CoverageStats& readsStats = readsChunkStats[start / SEQ_CHUNK_SIZE];
+            CoverageStats& asmStats = asmChunkStats[start / SEQ_CHUNK_SIZE];
+            mer_dna tmp;
+            size_t id;
+
+            for (uint64_t i = start; i < end; i++) {
+
+                string merstr = seq.substr(i, reads.merLen);
+
+                // Jellyfish compacted hash does not support Ns so if we find one set this mer count to 0
+                if (!validKmer(merstr)) {
+                    readsStats.addInvalid();
+                    asmStats.addInvalid();
+                } else {
+                    mer_dna mer(merstr);
+                    uint64_t asmCount = 0;
+                    if (!readCounts.empty() &&
+                            assembly.hash->get_val_for_key(assembly.canonical ? mer.get_canonical() : mer, &asmCount, tmp, &id)) {
+                        readsStats.add(readCounts[id]);
+                    }
+                    else {
+                        readsStats.add(JellyfishHelper::getCount(reads.hash, mer, reads.canonical));
+                        asmCount = JellyfishHelper::getCount(assembly.hash, mer, assembly.canonical);
+                    }
+                    asmStats.add(asmCount);
+                }
             }
-        }
+        });
 
-        // Create a copy of the counts, and sort it first, then take median value
-        vector<uint64_t> sortedSeqCounts = *readsCounts;
-        std::sort(sortedSeqCounts.begin(), sortedSeqCounts.end());
-        (*medians)[index] = (double)(sortedSeqCounts[sortedSeqCounts.size() / 2]);
+        CoverageStats readsStats;
+        CoverageStats asmStats;
+        for (size_t i = 0; i < nbChunks; i++) {
+            readsStats.merge(readsChunkStats[i]);
+            asmStats.merge(asmChunkStats[i]);
+        }
 
-        // Calculate the mean
-        (*means)[index] = (double)sum / (double)nbCounts;
+        nbNonZero = readsStats.getNonZero();
+        nbInvalid = readsStats.getInvalid();
 
-        // Create a copy of the counts, and sort it first, then take median value
-        vector<uint64_t> sortedAsmCounts = *asmCounts;
-        std::sort(sortedAsmCounts.begin(), sortedAsmCounts.end());
-        (*asmCns)[index] = (double)(sortedAsmCounts[sortedAsmCounts.size() / 2]);
+        batch.medians[index] = readsStats.median();
+        batch.means[index] = readsStats.mean();
+        batch.asmCns[index] = asmStats.median();
     }
 
     // Add length
-    (*lengths)[index] = seqLength;
-    (*nonZero)[index] = nbNonZero;
-    (*percentNonZero)[index] = nbNonZero == 0 || nbCounts <= 0 ?
+    batch.lengths[index] = seqLength;
+    batch.nonZero[index] = nbNonZero;
+    batch.percentNonZero[index] = nbNonZero == 0 || nbCounts <= 0 ?
         0.0 :
         ((double)nbNonZero / (double)nbCounts) * 100.0;
-    (*invalid)[index] = nbInvalid;
-    (*percentInvalid)[index] = nbInvalid == 0 || nbCounts <= 0 ?
+    batch.invalid[index] = nbInvalid;
+    batch.percentInvalid[index] = nbInvalid == 0 || nbCounts <= 0 ?
         0.0 :
         ((double)nbInvalid / (double)nbCounts) * 100.0;
 
     uint64_t notInvalid = nbCounts - nbInvalid;
-    (*percentNonZeroCorrected)[index] = nbNonZero == 0 || notInvalid <= 0 ?
+    batch.percentNonZeroCorrected[index] = nbNonZero == 0 || notInvalid <= 0 ?
         0.0 :
         ((double)nbNonZero / (double)notInvalid) * 100.0;
 
@@ -403,7 +420,7 @@ void kat::Cold::processSeq(const size_t index, const uint16_t th_id) {
     }
 
     double gc_perc = ((double) (gs + cs)) / ((double) (seqLength - ns));
-    (*gcs)[index] = gc_perc;
+    batch.gcs[index] = gc_perc;
 }
 
 
@@ -49,11 +49,29 @@ using boost::lexical_cast;
 
 #include <kat/matrix_metadata_extractor.hpp>
 #include <kat/jellyfish_helper.hpp>
+#include <kat/coverage_stats.hpp>
 #include <kat/input_handler.hpp>
+#include <kat/fasta_index.hpp>
+#include <kat/packed_sequences.hpp>
+#include <kat/pipeline.hpp>
+#include <kat/sequence_index.hpp>
 #include <kat/sparse_matrix.hpp>
+#include <kat/two_bit.hpp>
+using kat::ChunkPool;
+using kat::CoverageStats;
 using kat::InputHandler;
+using kat::FastaIndexException;
+using kat::FastaIndexErrorInfo;
+using kat::PackedSequences;
+using kat::Pipeline;
+using kat::SequenceIndex;
+using kat::TwoBitFile;
 using kat::ThreadedSparseMatrix;
 
+#include "sequence_batch.hpp"
+using kat::SequenceBatch;
+using kat::SequenceBatchReader;
+
 
 namespace kat {
 
@@ -66,7 +84,36 @@ namespace kat {
     class Cold {
     private:
 
-        static const uint16_t BATCH_SIZE = 1024;
+        static const uint64_t SEQ_CHUNK_SIZE = 1000000; // Sequences with more K-mers than this are split into chunks shared between the workers
+
+        /**
+         * A batch of assembly sequences, along with the stats calculated for them.
+         */
+        struct SeqBatch : public SequenceBatch {
+            vector<uint32_t> medians; // Overall coverage calculated for each sequence from the K-mer windows.
+            vector<double> means; // Overall coverage calculated for each sequence from the K-mer windows.
+            vector<uint32_t> asmCns; // Overall coverage calculated for each sequence from the K-mer windows.
+            vector<double> gcs; // GC% for each sequence
+            vector<uint32_t> lengths; // Length in nucleotides for each sequence
+            vector<uint32_t> nonZero;
+            vector<double> percentNonZero;
+            vector<uint32_t> invalid;
+            vector<double> percentInvalid;
+            vector<double> percentNonZeroCorrected;
+
+            void resize(size_t n) {
+                medians.resize(n);
+                means.resize(n);
+                asmCns.resize(n);
+                gcs.resize(n);
+                lengths.resize(n);
+                nonZero.resize(n);
+                percentNonZero.resize(n);
+                invalid.resize(n);
+                percentInvalid.resize(n);
+                percentNonZeroCorrected.resize(n);
+            }
+        };
 
         // Input args
         InputHandler    reads;
@@ -77,28 +124,17 @@ namespace kat {
         uint16_t        threads;
         bool            verbose;
 
-        // Chunking vars
-        size_t bucket_size, remaining;
-
         // Variables that live for the lifetime of this object
         shared_ptr<ThreadedSparseMatrix> contamination_mx; // Stores cumulative base count for each sequence where GC and CVG are binned
-        uint32_t offset;
-        uint16_t recordsInBatch;
         path hashFile;
+        shared_ptr<ChunkPool> chunks;   // Lets the workers share out the chunks of long sequences
 
-        // Variables that are refreshed for each batch
-        seqan::StringSet<seqan::CharString> names;
-        seqan::StringSet<seqan::CharString> seqs;
-        shared_ptr<vector<uint32_t>> medians; // Overall coverage calculated for each sequence from the K-mer windows.
-        shared_ptr<vector<double>> means; // Overall coverage calculated for each sequence from the K-mer windows.
-        shared_ptr<vector<uint32_t>> asmCns; // Overall coverage calculated for each sequence from the K-mer windows.
-        shared_ptr<vector<double>> gcs; // GC% for each sequence
-        shared_ptr<vector<uint32_t>> lengths; // Length in nucleotides for each sequence
-        shared_ptr<vector<uint32_t>> nonZero;
-        shared_ptr<vector<double>> percentNonZero;
-        shared_ptr<vector<uint32_t>> invalid;
-        shared_ptr<vector<double>> percentInvalid;
-        shared_ptr<vector<double>> percentNonZeroCorrected;
+        // Read K-mer counts for each slot of the assembly hash, so that a single probe
+        // into the assembly hash gives both counts.  Empty if the counts can't be combined.
+        vector<uint32_t> readCounts;
+
+        // The assembly, if it had to be parsed, held in memory so that it's only parsed once
+        shared_ptr<PackedSequences> packedAssembly;
 
 
     public:
@@ -195,27 +231,19 @@ namespace kat {
 
     private:
 
-        void processSeqFile();
-
-        void analyseBatch();
-
-        void analyseBatchSlice(int th_id);
+        void loadAssembly();
 
-        void destroyBatchVars();
+        void combineCounts();
 
-        void createBatchVars(uint16_t batchSize);
-
-        void printStatTable(std::ostream &out);
+        void combineSlice(const uint16_t th_id);
 
+        void processSeqFile();
 
-        // This method won't be optimal in most cases... Fasta files are normally sorted by length (largest first)
-        // So first thread will be asked to do more work than the rest
-        void processInBlocks(uint16_t th_id);
+        void processBatch(SeqBatch& batch);
 
-        // This method is probably makes more efficient use of multiple cores on a length sorted fasta file
-        void processInterlaced(uint16_t th_id);
+        void printStatTable(std::ostream &out, const SeqBatch& batch);
 
-        void processSeq(const size_t index, const uint16_t th_id);
+        void processSeq(SeqBatch& batch, const size_t index);
 
         double gcCountToPercentage(int16_t count);
 
@@ -227,7 +255,7 @@ namespace kat {
                             "Then, assuming plotting is enabled, the results are converted into a scatter plot, where each point is colored " \
                             "according to a similar scheme used in spectra-cn plots, and sized according to its length.  The y-axis represents" \
                             "median read K-mer coverage, and x-axis represents GC%.\n\n " \
-                            "The <assembly> should be a fasta file that is NOT gzipped compressed.  The <reads> can be any number of <fasta/q> " \
+                            "The <assembly> should be a fasta file, or a UCSC .2bit file, that is NOT gzipped compressed.  The <reads> can be any number of <fasta/q> " \
                             "files, which CAN be gzipped compressed, or a pre-counted hash.\n\n" \
                             "Options";
 
@@ -26,6 +26,7 @@
 #include <math.h>
 #include <memory>
 #include <mutex>
+#include <sstream>
 #include <thread>
 #include <sys/ioctl.h>
 using std::vector;
@@ -34,6 +35,7 @@ using std::cerr;
 using std::endl;
 using std::ostream;
 using std::ofstream;
+using std::stringstream;
 using std::shared_ptr;
 using std::unique_ptr;
 using std::make_shared;
@@ -93,6 +95,9 @@ void kat::Comp::init(const vector<path>& _input1, const vector<path>& _input2) {
     d2Bins = DEFAULT_NB_BINS;
     threads = 1;
     densityPlot = false;
+    outputHists = false;
+    binaryMx = false;
+    statsOnly = false;
     threeInputs = false;
     verbose = false;
 }
@@ -107,6 +112,13 @@ void kat::Comp::setThirdInput(const vector<path>& _input3) {
 
 void kat::Comp::execute() {
 
+    // A dumped hash doesn't record that it was sampled, so anything that loads it
+    // later would take it to be a complete count
+    if (dumpHashes() && getSampleFraction() < 1.0) {
+        BOOST_THROW_EXCEPTION(CompException() << CompErrorInfo(string(
+                "Can't dump hashes when only a fraction of K-mers are sampled")));
+    }
+
     // Check input files exist and determine input mode
     for(uint16_t i = 0; i < inputSize(); i++) {
         input[i].validateInput();
@@ -116,11 +128,13 @@ void kat::Comp::execute() {
     path parentDir = bfs::absolute(outputPrefix).parent_path();
     KatFS::ensureDirectoryExists(parentDir);
 
-    // Create the final K-mer counter matrices
-    main_matrix = ThreadedSparseMatrix(d1Bins, d2Bins, threads);
+    // Create the final K-mer counter matrices (not required if we only want stats)
+    if (!statsOnly) {
+        main_matrix = ThreadedSparseMatrix(d1Bins, d2Bins, threads);
+    }
 
     // Initialise extra matrices for hash3 (only allocates space if required)
-    if (doThirdHash()) {
+    if (doThirdHash() && !statsOnly) {
         ends_matrix = ThreadedSparseMatrix(d1Bins, d2Bins, threads);
         middle_matrix = ThreadedSparseMatrix(d1Bins, d2Bins, threads);
         mixed_matrix = ThreadedSparseMatrix(d1Bins, d2Bins, threads);
@@ -190,26 +204,15 @@ void kat::Comp::save() {
     cout.flush();
 
     // Send main matrix to output file
-    ofstream main_mx_out_stream(string(outputPrefix.string() + "-main.mx").c_str());
-    printMainMatrix(main_mx_out_stream);
-    main_mx_out_stream.close();
+    if (!statsOnly) {
+        saveMatrix(getMxOutPath(), main_matrix.getFinalMatrix(), &Comp::printMainMatrixHeader);
+    }
 
     // Output ends matrices if required
-    if (doThirdHash()) {
-        // Ends matrix
-        ofstream ends_mx_out_stream(string(outputPrefix.string() + "-ends.mx").c_str());
-        printEndsMatrix(ends_mx_out_stream);
-        ends_mx_out_stream.close();
-
-        // Middle matrix
-        ofstream middle_mx_out_stream(string(outputPrefix.string() + "-middle.mx").c_str());
-        printMiddleMatrix(middle_mx_out_stream);
-        middle_mx_out_stream.close();
-
-        // Mixed matrix
-        ofstream mixed_mx_out_stream(string(outputPrefix.string() + "-mixed.mx").c_str());
-        printMixedMatrix(mixed_mx_out_stream);
-        mixed_mx_out_stream.close();
+    if (doThirdHash() && !statsOnly) {
+        saveMatrix(path(outputPrefix.string() + "-ends.mx"), ends_matrix.getFinalMatrix(), &Comp::printEndsMatrixHeader);
+        saveMatrix(path(outputPrefix.string() + "-middle.mx"), middle_matrix.getFinalMatrix(), &Comp::printMiddleMatrixHeader);
+        saveMatrix(path(outputPrefix.string() + "-mixed.mx"), mixed_matrix.getFinalMatrix(), &Comp::printMixedMatrixHeader);
     }
 
     // Send K-mer statistics to file
@@ -232,6 +235,21 @@ void kat::Comp::save() {
     cout.flush();
 }
 
+void kat::Comp::saveMatrix(const path& mx_path, const SM64& mx, void (Comp::*printHeader)(ostream&)) {
+
+    if (binaryMx) {
+        stringstream header;
+        (this->*printHeader)(header);
+        mx.saveBinary(mx_path, header.str());
+    }
+    else {
+        ofstream mx_out_stream(mx_path.c_str());
+        (this->*printHeader)(mx_out_stream);
+        mx.printMatrix(mx_out_stream);
+        mx_out_stream.close();
+    }
+}
+
 void kat::Comp::printHist(std::ostream &out, InputHandler& input, vector<uint64_t>& hist) {
 
     // Output header
@@ -251,15 +269,31 @@ void kat::Comp::merge() {
     cout << "Merging results ...";
     cout.flush();
     // Merge results from the threads
-    main_matrix.mergeThreadedMatricies();
-    if (doThirdHash()) {
-        ends_matrix.mergeThreadedMatricies();
-        middle_matrix.mergeThreadedMatricies();
-        mixed_matrix.mergeThreadedMatricies();
+    if (!statsOnly) {
+        main_matrix.mergeThreadedMatricies();
+        if (doThirdHash()) {
+            ends_matrix.mergeThreadedMatricies();
+            middle_matrix.mergeThreadedMatricies();
+            mixed_matrix.mergeThreadedMatricies();
+        }
     }
 
     comp_counters.merge();
 
+    // If we only looked at a sample of the K-mers, scale everything back up to
+    // estimate the values for the full datasets
+    const double sampleFraction = getSampleFraction();
+    if (sampleFraction < 1.0 && !statsOnly) {
+        const double factor = 1.0 / sampleFraction;
+        main_matrix.scaleFinalMatrix(factor);
+        if (doThirdHash()) {
+            ends_matrix.scaleFinalMatrix(factor);
+            middle_matrix.scaleFinalMatrix(factor);
+            mixed_matrix.scaleFinalMatrix(factor);
+        }
+    }
+    comp_counters.getFinalMatrix().scale(sampleFraction);
+
     cout << " done.";
     cout.flush();
 }
@@ -306,6 +340,11 @@ void kat::Comp::loadHashes() {
 // Print K-mer comparison matrix
 
 void kat::Comp::printMainMatrix(ostream &out) {
+    printMainMatrixHeader(out);
+    main_matrix.getFinalMatrix().printMatrix(out);
+}
+
+void kat::Comp::printMainMatrixHeader(ostream &out) {
 
     const SM64& mx = main_matrix.getFinalMatrix();
 
@@ -321,38 +360,45 @@ void kat::Comp::printMainMatrix(ostream &out) {
             << mme::KEY_INPUT_1 << input[0].pathString() << endl
             << mme::KEY_INPUT_2 << input[1].pathString() << endl
             << mme::MX_META_END << endl;
-
-    mx.printMatrix(out);
 }
 
 // Print K-mer comparison matrix
 
 void kat::Comp::printEndsMatrix(ostream &out) {
+    printEndsMatrixHeader(out);
+    ends_matrix.getFinalMatrix().printMatrix(out);
+}
+
+void kat::Comp::printEndsMatrixHeader(ostream &out) {
 
     out << "# Each row represents K-mer frequency for: " << input[0].getSingleInput().string() << endl;
     out << "# Each column represents K-mer frequency for sequence ends: " << input[2].getSingleInput().string() << endl;
-
-    ends_matrix.getFinalMatrix().printMatrix(out);
 }
 
 // Print K-mer comparison matrix
 
 void kat::Comp::printMiddleMatrix(ostream &out) {
+    printMiddleMatrixHeader(out);
+    middle_matrix.getFinalMatrix().printMatrix(out);
+}
+
+void kat::Comp::printMiddleMatrixHeader(ostream &out) {
 
     out << "# Each row represents K-mer frequency for: " << input[0].getSingleInput().string() << endl;
     out << "# Each column represents K-mer frequency for sequence middles: " << input[1].getSingleInput().string() << endl;
-
-    middle_matrix.getFinalMatrix().printMatrix(out);
 }
 
 // Print K-mer comparison matrix
 
 void kat::Comp::printMixedMatrix(ostream &out) {
+    printMixedMatrixHeader(out);
+    mixed_matrix.getFinalMatrix().printMatrix(out);
+}
+
+void kat::Comp::printMixedMatrixHeader(ostream &out) {
 
     out << "# Each row represents K-mer frequency for hash file 1: " << input[0].getSingleInput().string() << endl;
     out << "# Each column represents K-mer frequency for mixed: " << input[1].getSingleInput().string() << " and " << input[2].getSingleInput().string() << endl;
-
-    mixed_matrix.getFinalMatrix().printMatrix(out);
 }
 
 // Print K-mer statistics
@@ -373,7 +419,9 @@ void kat::Comp::compare() {
     vector<thread> t(threads);
 
     for(uint16_t i = 0; i < threads; i++) {
-        t[i] = thread(&Comp::compareSlice, this, i);
+        t[i] = statsOnly ?
+            thread(&Comp::compareSliceStatsOnly, this, i) :
+            thread(&Comp::compareSlice, this, i);
     }
 
     for(uint16_t i = 0; i < threads; i++){
@@ -444,7 +492,7 @@ void kat::Comp::compareSlice(int th_id) {
         uint64_t hash2_count = hash2Iterator.val();
 
         // Get the count for this K-mer in hash1 (assuming it exists... 0 if not)
-        uint64_t hash1_count = JellyfishHelper::getCount(input[0].hash, hash2Iterator.key(), input[0].hash);
+        uint64_t hash1_count = JellyfishHelper::getCount(input[0].hash, hash2Iterator.key(), input[0].canonical);
 
         // Increment hash2's unique counters (don't bother with shared counters... we've already done this)
         cc->updateHash2Counters(hash1_count, hash2_count);
@@ -483,6 +531,43 @@ void kat::Comp::compareSlice(int th_id) {
     mu.unlock();
 }
 
+void kat::Comp::compareSliceStatsOnly(int th_id) {
+
+    // Thread local counters, only handed over to the shared counters at the end
+    CompCounters cc(std::min(this->d1Bins, this->d2Bins));
+
+    const LargeHashArrayPtr hash1 = input[0].hash;
+    const LargeHashArrayPtr hash2 = input[1].hash;
+    const bool canonical1 = input[0].canonical;
+    const bool canonical2 = input[1].canonical;
+
+    LargeHashArray::eager_iterator hash1Iterator = hash1->eager_slice(th_id, threads);
+    while (hash1Iterator.next()) {
+        const uint64_t hash1_count = hash1Iterator.val();
+        const uint64_t hash2_count = JellyfishHelper::getCount(hash2, hash1Iterator.key(), canonical2);
+        cc.updateHash1Counters(hash1_count, hash2_count);
+        cc.updateSharedCounters(hash1_count, hash2_count);
+    }
+
+    LargeHashArray::eager_iterator hash2Iterator = hash2->eager_slice(th_id, threads);
+    while (hash2Iterator.next()) {
+        const uint64_t hash2_count = hash2Iterator.val();
+        const uint64_t hash1_count = JellyfishHelper::getCount(hash1, hash2Iterator.key(), canonical1);
+        cc.updateHash2Counters(hash1_count, hash2_count);
+    }
+
+    if (doThirdHash()) {
+        LargeHashArray::eager_iterator hash3Iterator = input[2].hash->eager_slice(th_id, threads);
+        while (hash3Iterator.next()) {
+            cc.updateHash3Counters(hash3Iterator.val());
+        }
+    }
+
+    mu.lock();
+    comp_counters.add(make_shared<CompCounters>(cc));
+    mu.unlock();
+}
+
 void kat::Comp::analysePeaks() {
 #ifdef HAVE_PYTHON
     path dascript = path("kat") / "distanalysis.py";
@@ -536,7 +621,7 @@ void kat::Comp::analysePeaks() {
 
         cout << endl;
     }
-    else if (!this->densityPlot) {
+    else if (!this->densityPlot && !this->statsOnly) {
         cout << "Analysing peaks for spectra copy number matrix" << endl
 			 << "----------------------------------------------" << endl;
 
@@ -577,7 +662,10 @@ void kat::Comp::plot(const string& output_type) {
     cout.flush();
 
     // Plot results
-    if (densityPlot) {
+    if (statsOnly) {
+        // No matrix to plot
+    }
+    else if (densityPlot) {
         path outputFile = path(getMxOutPath().string() + ".density." + output_type);
         vector<string> args;
         args.push_back("kat/plot/density.py");
@@ -654,7 +742,10 @@ int kat::Comp::main(int argc, char *argv[]) {
     uint64_t hash_size_3;
     bool dump_hashes;
     bool disable_hash_grow;
+    double sample_fraction;
     bool density_plot;
+    bool binary_mx;
+    bool stats_only;
     string plot_output_type;
     bool output_hists;
     bool verbose;
@@ -705,12 +796,18 @@ int kat::Comp::main(int argc, char *argv[]) {
                 "Dumps any jellyfish hashes to disk that were produced during this run. Normally, this is not recommended, as hashes are slow to load and will likely consume a significant amount of disk space.")
             ("disable_hash_grow,g", po::bool_switch(&disable_hash_grow)->default_value(false),
                 "By default jellyfish will double the size of the hash if it gets filled, and then attempt to recount.  Setting this option to true, disables automatic hash growing.  If the hash gets filled an error is thrown.  This option is useful if you are working with large genomes, or have strict memory limits on your system.")
+            ("sample_fraction", po::value<double>(&sample_fraction)->default_value(1.0),
+                "Only compare this fraction of distinct K-mers, chosen by hash value (FracMinHash) so that the same K-mers are selected from every input.  All counts, matrices and histograms are scaled back up by 1/fraction to estimate the full result, and the estimation error is reported in the statistics.  Useful for quick QC on large datasets, e.g. 0.01.  Can't be used with --dump_hashes.")
             ("density_plot,n", po::bool_switch(&density_plot)->default_value(false),
                 "Makes a density plot.  By default we create a spectra_cn plot.")
             ("output_type,p", po::value<string>(&plot_output_type)->default_value(DEFAULT_COMP_PLOT_OUTPUT_TYPE),
                 "The plot file type to create: png, ps, pdf.")
             ("output_hists,h", po::bool_switch(&output_hists)->default_value(false),
                 "Whether or not to output histogram data and plots for input 1 and input 2")
+            ("binary_mx", po::bool_switch(&binary_mx)->default_value(false),
+                "Write matrices in KAT's binary matrix format rather than as text.  Binary matrices are smaller and much faster to load, and are accepted by \"kat plot\".")
+            ("stats_only", po::bool_switch(&stats_only)->default_value(false),
+                "Only produce the K-mer statistics (and histograms if requested).  Skips building, saving and plotting the comparison matrices, which makes the comparison faster and uses less memory.")
             ("verbose,v", po::bool_switch(&verbose)->default_value(false),
                 "Print extra information.")
             ("help", po::bool_switch(&help)->default_value(false), "Produce help message.")
@@ -816,8 +913,11 @@ int kat::Comp::main(int argc, char *argv[]) {
     comp.setHashSize(2, hash_size_3);
     comp.setDumpHashes(dump_hashes);
     comp.setDisableHashGrow(disable_hash_grow);
+    comp.setSampleFraction(sample_fraction);
     comp.setDensityPlot(density_plot);
     comp.setOutputHists(output_hists);
+    comp.setBinaryMx(binary_mx);
+    comp.setStatsOnly(stats_only);
     comp.setVerbose(verbose);
 
     // Do the work
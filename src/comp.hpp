@@ -66,6 +66,8 @@ namespace kat {
         uint16_t threads;
         bool densityPlot;
         bool outputHists;
+        bool binaryMx;
+        bool statsOnly;
         bool threeInputs;
         bool verbose;
 
@@ -206,6 +208,21 @@ namespace kat {
             }
         }
 
+        double getSampleFraction() const {
+            return input[0].sampleFraction;
+        }
+
+        void setSampleFraction(double sampleFraction) {
+            if (sampleFraction <= 0.0 || sampleFraction > 1.0) {
+                BOOST_THROW_EXCEPTION(CompException() << CompErrorInfo(string(
+                    "Sample fraction must be greater than 0 and no greater than 1.  Value provided: ") +
+                    lexical_cast<string>(sampleFraction)));
+            }
+            for(size_t i = 0; i < input.size(); i++) {
+                this->input[i].sampleFraction = sampleFraction;
+            }
+        }
+
         bool isVerbose() const {
             return verbose;
         }
@@ -230,6 +247,22 @@ namespace kat {
             this->outputHists = outputHists;
         }
 
+        bool isBinaryMx() const {
+            return binaryMx;
+        }
+
+        void setBinaryMx(bool binaryMx) {
+            this->binaryMx = binaryMx;
+        }
+
+        bool isStatsOnly() const {
+            return statsOnly;
+        }
+
+        void setStatsOnly(bool statsOnly) {
+            this->statsOnly = statsOnly;
+        }
+
 
 
         void execute();
@@ -258,18 +291,22 @@ namespace kat {
         // Print K-mer comparison matrix
 
         void printMainMatrix(ostream &out);
+        void printMainMatrixHeader(ostream &out);
 
         // Print K-mer comparison matrix
 
         void printEndsMatrix(ostream &out);
+        void printEndsMatrixHeader(ostream &out);
 
         // Print K-mer comparison matrix
 
         void printMiddleMatrix(ostream &out);
+        void printMiddleMatrixHeader(ostream &out);
 
         // Print K-mer comparison matrix
 
         void printMixedMatrix(ostream &out);
+        void printMixedMatrixHeader(ostream &out);
 
         // Print K-mer statistics
 
@@ -289,12 +326,18 @@ namespace kat {
 
     private:
 
+        // Saves a matrix in either text or binary format depending on binaryMx
+        void saveMatrix(const path& mx_path, const SM64& mx, void (Comp::*printHeader)(ostream&));
+
         void loadHashes();
 
         void compare();
 
         void compareSlice(int th_id);
 
+        // Cut down version of compareSlice that only updates the comp counters
+        void compareSliceStatsOnly(int th_id);
+
         void merge();
 
 
@@ -260,7 +260,7 @@ void kat::filter::FilterKmer::filterSlice(int th_id, HashCounter& inCounter, Has
     LargeHashArray::region_iterator it = input.hash->region_slice(th_id, threads);
     while (it.next()) {
 
-        bool in_bounds = inBounds(it.key().to_str(), it.val());
+        bool in_bounds = inBounds(JellyfishHelper::gcCount(it.key()), it.val());
 
         all.increment(th_id, it.val());
 
@@ -293,19 +293,9 @@ void kat::filter::FilterKmer::filterSlice(int th_id, HashCounter& inCounter, Has
 
 
 
-bool kat::filter::FilterKmer::inBounds(const string& kmer_seq, const uint64_t& kmer_count) {
+bool kat::filter::FilterKmer::inBounds(const uint32_t gc_count, const uint64_t& kmer_count) {
 
-    // Calculate GC
-    uint32_t gc_count = kat::gcCount(kmer_seq);
-
-    // Are we within the limits
-    bool in_gc_limits = low_gc <= gc_count && gc_count <= high_gc;
-
-    // Are we within the limits
-    bool in_cvg_limits = low_count <= kmer_count && kmer_count <= high_count;
-
-    // Return if we want to keep this sequence or not based on the coverage (and, if we've got this far, GC)
-    return in_gc_limits && in_cvg_limits;
+    return BoundsAnalysis::inBounds(gc_count, kmer_count, low_count, high_count, low_gc, high_gc);
 }
 
 
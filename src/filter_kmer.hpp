@@ -23,6 +23,7 @@ using std::unique_ptr;
 #include <boost/exception/info.hpp>
 
 #include <kat/input_handler.hpp>
+#include <kat/kmer_analysis.hpp>
 using kat::InputHandler;
 
 
@@ -224,7 +225,7 @@ protected:
 
     void filterSlice(int th_id, HashCounter& inCounter, HashCounter& outCounter);
 
-    bool inBounds(const string& kmer_seq, const uint64_t& kmer_count);
+    bool inBounds(const uint32_t gc_count, const uint64_t& kmer_count);
 
     void dump(path& out_path, HashCounter* hash, file_header& header);
 
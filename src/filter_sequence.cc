@@ -98,6 +98,7 @@ void kat::filter::FilterSeq::init(const vector<path>& _input) {
     invert = DEFAULT_FILT_SEQ_INVERT;
     separate = DEFAULT_FILT_SEQ_SEPARATE;
     doStats = false;
+    ordered = true;
 
     keepers = 0;
     total = 0;
@@ -171,8 +172,18 @@ void kat::filter::FilterSeq::processSeqFile() {
 
     cout << "Filtering sequences ..." << endl;
 
-    // Temporary storage for sequence data
-    reader = unique_ptr<seqan::SeqFileIn>(new seqan::SeqFileIn(seq_file_1.c_str()));
+    // Temporary storage for sequence data.  .2bit files are read directly,
+    // everything else through seqan.
+    if (!JellyfishHelper::isPipe(seq_file_1) && TwoBitFile::isTwoBit(seq_file_1)) {
+        if (this->isPaired()) {
+            BOOST_THROW_EXCEPTION(FilterSeqException() << FilterSeqErrorInfo(string(
+                    "Paired filtering is not supported for .2bit files.")));
+        }
+        twoBit = unique_ptr<TwoBitFile>(new TwoBitFile(seq_file_1));
+    }
+    else {
+        reader = unique_ptr<seqan::SeqFileIn>(new seqan::SeqFileIn(seq_file_1.c_str()));
+    }
 
     if (this->isPaired()) {
         reader2 = unique_ptr<seqan::SeqFileIn>(new seqan::SeqFileIn(seq_file_2.c_str()));
@@ -185,8 +196,8 @@ void kat::filter::FilterSeq::processSeqFile() {
         (*stats_stream) << "index\tnb_bases\tnb_kmers\tnb_hits\tratio" << endl;
     }
 
-    // Setup file paths
-    path ext = seq_file_1.extension();
+    // Setup file paths.  Sequences from .2bit files are written out as FastA.
+    path ext = twoBit ? path(".fa") : seq_file_1.extension();
 
     path output_path_in(output_prefix.string() + ".in" + (this->isPaired() ? ".R1" : "") + ext.string());
     inWriter = unique_ptr<seqan::SeqFileOut>(new seqan::SeqFileOut(output_path_in.c_str()));
@@ -209,38 +220,47 @@ void kat::filter::FilterSeq::processSeqFile() {
     std::mt19937 gen(rd());
     std::uniform_real_distribution<> urd;
 
-    // Processes sequences in batches of records to reduce memory requirements
-    uint64_t index = 0;
-    while (!seqan::atEnd(*reader)) {
+    // Batches of records are read, filtered and written out concurrently.  Each
+    // worker takes a whole batch, and each output file has its own writer.  All
+    // writers see the batches in the same order, so pairs stay in sync.
+    Pipeline<SeqBatch> pipeline(threads, 2 * threads + 2);
+    pipeline.setOrdered(ordered);
 
-        seqan::readRecord(name, seq, qual, *reader);
+    pipeline.addWriter([&](const SeqBatch& b) {
+        writeBatch(*inWriter, b, false, true);
 
-        if (this->isPaired()) {
-            seqan::readRecord(name2, seq2, qual2, *reader2);
+        // Progress and totals are kept by this writer only
+        for (size_t i = 0; i < b.size(); i++) {
+            if (b.keep[i]) keepers++;
+            if (++total % 100000 == 0) {
+                cout << "Processed " << total << (this->isPaired() ? " pairs" : " entries") << endl;
+            }
         }
-
-        // Generate a random value for this sequence between 0 and 1 (we may use
-        // this for subsampling later, if requested by the user)
-        double val = urd(gen);
-
-        // Process batch with worker threads
-        // Process each sequence is processed in a different thread.
-        // In each thread lookup each K-mer in the hash
-
-        processSeq(index++, val);
-
-        if (index % 100000 == 0) {
-            cout << "Processed " << index << (this->isPaired() ? " pairs" : " entries") << endl;
+    });
+    if (separate) {
+        pipeline.addWriter([&](const SeqBatch& b) { writeBatch(*outWriter, b, false, false); });
+    }
+    if (this->isPaired()) {
+        pipeline.addWriter([&](const SeqBatch& b) { writeBatch(*inWriter2, b, true, true); });
+        if (separate) {
+            pipeline.addWriter([&](const SeqBatch& b) { writeBatch(*outWriter2, b, true, false); });
         }
-
+    }
+    if (doStats) {
+        pipeline.addWriter([&](const SeqBatch& b) { printStats(*stats_stream, b); });
     }
 
+    uint64_t index = 0;
+    pipeline.run(
+        [&](SeqBatch& b) { return readBatch(b, index, gen, urd); },
+        [&](SeqBatch& b, uint16_t th_id) { processBatch(b); });
+
     if (this->isPaired() && !seqan::atEnd(*reader2)) {
         BOOST_THROW_EXCEPTION(FilterSeqException() << FilterSeqErrorInfo(string(
                     "Second sequence file appears to be longer than the first.")));
     }
 
-    seqan::close(*reader);
+    if (reader) seqan::close(*reader);
 
     seqan::close(*inWriter);
     if (separate) {
@@ -263,71 +283,105 @@ void kat::filter::FilterSeq::processSeqFile() {
     cout.flush();
 }
 
+bool kat::filter::FilterSeq::readBatch(SeqBatch& batch, uint64_t& index, std::mt19937& gen, std::uniform_real_distribution<>& urd) {
 
-void kat::filter::FilterSeq::processSeq(uint64_t index, double random_val) {
+    batch.first = index;
 
+    seqan::CharString name, seq, qual;
+    while (batch.size() < BATCH_SIZE && (twoBit ? index < twoBit->size() : !seqan::atEnd(*reader))) {
 
-    vector<bool> kFound;
-    this->getProfile(seq, kFound);
+        if (twoBit) {
+            seqan::appendValue(batch.names, twoBit->getHeader(index));
+            seqan::appendValue(batch.seqs, twoBit->getSequence(index));
+            seqan::appendValue(batch.quals, seqan::CharString());
+        }
+        else {
+            seqan::readRecord(name, seq, qual, *reader);
+            seqan::appendValue(batch.names, name);
+            seqan::appendValue(batch.seqs, seq);
+            seqan::appendValue(batch.quals, qual);
+        }
 
-    if (this->isPaired()) {
-        vector<bool> kFound2;
-        this->getProfile(seq2, kFound2);
-        kFound.insert(kFound.end(), kFound2.begin(), kFound2.end());
-    }
+        if (this->isPaired()) {
+            if (seqan::atEnd(*reader2)) {
+                BOOST_THROW_EXCEPTION(FilterSeqException() << FilterSeqErrorInfo(string(
+                            "Second sequence file appears to be shorter than the first.")));
+            }
+            seqan::readRecord(name, seq, qual, *reader2);
+            seqan::appendValue(batch.names2, name);
+            seqan::appendValue(batch.seqs2, seq);
+            seqan::appendValue(batch.quals2, qual);
+        }
 
-    uint32_t nbFound = 0;
-    for(const auto& b : kFound) {
-        if (b) nbFound ++;
+        // Generate a random value for this sequence between 0 and 1 (we may use
+        // this for subsampling later, if requested by the user).  Drawn here so
+        // that values are taken in input order.
+        batch.randomVals.push_back(urd(gen));
+
+        index++;
     }
 
-    SeqStats stats(index, nbFound, kFound.size());
+    return batch.size() > 0;
+}
 
-    double ratio = stats.calcRatio();
+void kat::filter::FilterSeq::processBatch(SeqBatch& batch) {
 
+    batch.stats.resize(batch.size());
+    batch.keep.resize(batch.size());
 
-    bool keep = true;
+    for (size_t i = 0; i < batch.size(); i++) {
 
-    // Check to see if seq stats are within limits, if so keep the sequence
-    if ((ratio >= threshold && !invert) || (invert && ratio < threshold)) {
+        uint64_t nbKmers = 0;
+        uint64_t nbFound = 0;
+        this->getProfile(batch.seqs[i], nbKmers, nbFound);
 
-        // Also check to see if we have exceeded the threshold for subsampling
-        if (this->frequency > 0.0 && this->frequency < random_val) {
-            keep = false;
-        }
-        else {
-            // Increase keeper count and output sequence
-            keepers++;
-            seqan::writeRecord(*inWriter, name, seq, qual);
-            if (this->isPaired()) {
-                seqan::writeRecord(*inWriter2, name2, seq2, qual2);
-            }
+        if (this->isPaired()) {
+            uint64_t nbKmers2 = 0;
+            uint64_t nbFound2 = 0;
+            this->getProfile(batch.seqs2[i], nbKmers2, nbFound2);
+            nbKmers += nbKmers2;
+            nbFound += nbFound2;
         }
+
+        batch.stats[i] = SeqStats(batch.first + i, nbFound, nbKmers);
+
+        double ratio = batch.stats[i].calcRatio();
+
+        // Check to see if seq stats are within limits, if so keep the sequence, unless
+        // we have exceeded the threshold for subsampling
+        batch.keep[i] = ((ratio >= threshold && !invert) || (invert && ratio < threshold)) &&
+                !(this->frequency > 0.0 && this->frequency < batch.randomVals[i]);
     }
-    else {
-        keep = false;
-    }
+}
 
-    // If the user's requested to seperate the dataset and we are not keeping
-    // this record then output it to the discard file(s)
-    if (separate && !keep) {
-        seqan::writeRecord(*outWriter, name, seq, qual);
-        if (this->isPaired()) {
-            seqan::writeRecord(*outWriter2, name2, seq2, qual2);
+void kat::filter::FilterSeq::writeBatch(seqan::SeqFileOut& writer, const SeqBatch& batch, bool second, bool kept) {
+
+    // Writes either the kept records, or if the user's requested to separate the
+    // dataset, the discarded ones
+    for (size_t i = 0; i < batch.size(); i++) {
+        if (batch.keep[i] == kept) {
+            if (second) {
+                seqan::writeRecord(writer, batch.names2[i], batch.seqs2[i], batch.quals2[i]);
+            }
+            else {
+                seqan::writeRecord(writer, batch.names[i], batch.seqs[i], batch.quals[i]);
+            }
         }
     }
+}
 
-    if (doStats) {
-        size_t len = this->isPaired() ? seqan::length(seq) + seqan::length(seq2) : seqan::length(seq);
+void kat::filter::FilterSeq::printStats(std::ostream& out, const SeqBatch& batch) {
 
-        (*stats_stream) << index << "\t" << len << "\t" << stats.nb_kmers
-                << "\t" << stats.matches << "\t" << ratio << endl;
-    }
+    for (size_t i = 0; i < batch.size(); i++) {
+        SeqStats stats = batch.stats[i];
+        size_t len = this->isPaired() ? seqan::length(batch.seqs[i]) + seqan::length(batch.seqs2[i]) : seqan::length(batch.seqs[i]);
 
-    total++;
+        out << stats.index << "\t" << len << "\t" << stats.nb_kmers
+            << "\t" << stats.matches << "\t" << stats.calcRatio() << endl;
+    }
 }
 
-void kat::filter::FilterSeq::getProfile(seqan::CharString& sequence, vector<bool>& hits) {
+void kat::filter::FilterSeq::getProfile(const seqan::CharString& sequence, uint64_t& nbKmers, uint64_t& nbHits) {
     // There's no substring functionality in SeqAn in this version (2.0.0).  So we'll just
     // use regular c++ string's for this bit.  This conversion of strings:
     // {CharString -> c++ string -> substring -> jellyfish mer_dna} is
@@ -339,8 +393,9 @@ void kat::filter::FilterSeq::getProfile(seqan::CharString& sequence, vector<bool
 
     uint64_t seqLength = s.length();
     int64_t nbCounts = seqLength - input.merLen + 1;
-    uint64_t nbInvalid = 0;
 
+    nbKmers = 0;
+    nbHits = 0;
 
     if (nbCounts <= 0) {
 
@@ -350,18 +405,18 @@ void kat::filter::FilterSeq::getProfile(seqan::CharString& sequence, vector<bool
 
     } else {
 
+        nbKmers = nbCounts;
+
         for (int64_t i = 0; i < nbCounts; i++) {
 
             string merstr = s.substr(i, input.merLen);
 
-            // Jellyfish compacted hash does not support Ns so if we find one set this kmer to false
-            if (!validKmer(merstr)) {
-                hits.push_back(false);
-                nbInvalid++;
-            } else {
+            // Jellyfish compacted hash does not support Ns so if we find one this kmer is not a hit
+            if (validKmer(merstr)) {
                 mer_dna mer(merstr);
-                uint64_t count = JellyfishHelper::getCount(input.hash, mer, input.canonical);
-                hits.push_back(count > 0);
+                if (JellyfishHelper::getCount(input.hash, mer, input.canonical) > 0) {
+                    nbHits++;
+                }
             }
         }
     }
@@ -380,6 +435,7 @@ int kat::filter::FilterSeq::main(int argc, char *argv[]) {
     bool            invert;
     bool            separate;
     bool            stats;
+    bool            unordered;
     bool            non_canonical;
     uint16_t        mer_len;
     uint64_t        hash_size;
@@ -404,13 +460,15 @@ int kat::filter::FilterSeq::main(int argc, char *argv[]) {
             ("separate,s", po::bool_switch(&separate)->default_value(false),
                 "Whether to partition the sequences into two sets, those with k-mers detected and those without.  Works in combination with \"invert\".")
             ("seq", po::value<path>(&seq_file_1),
-                "The sequence file to filter")
+                "The sequence file to filter.  FastA, FastQ and UCSC .2bit files are supported.  Sequences from .2bit files are output as FastA.")
             ("seq2", po::value<path>(&seq_file_2),
                 "The second sequence file to filter (use this if you want to filter paired end reads)")
             ("frequency,f", po::value<double>(&frequency)->default_value(DEFAULT_FILT_SEQ_FREQUENCY),
                 "If a value is set here then only keep the sequence if matching the kmer dataset and a random number is generated between 0 and 1 that exceeds this threshold.  The default is 0.0 which means keep every hit.")
             ("stats", po::bool_switch(&stats)->default_value(false),
                 "Whether to emit statistics about quantity of found k-mers in each sequence.  If the user specifies seq2, then each entry will represent both sequences combined.")
+            ("unordered", po::bool_switch(&unordered)->default_value(false),
+                "Write sequences out as soon as they are filtered, rather than in input order.  This can be faster when using many threads.  Paired sequences are still kept together.")
             ("non_canonical,N", po::bool_switch(&non_canonical)->default_value(false),
                 "If counting fast(a/q), store explicit kmer as found.  By default, we store 'canonical' k-mers, which means we count both strands.")
             ("mer_len,m", po::value<uint16_t>(&mer_len)->default_value(DEFAULT_MER_LEN),
@@ -469,6 +527,7 @@ int kat::filter::FilterSeq::main(int argc, char *argv[]) {
     filter.setSeparate(separate);
     filter.setFrequency(frequency);
     filter.setDoStats(stats);
+    filter.setOrdered(!unordered);
     filter.setMerLen(mer_len);
     filter.setHashSize(hash_size);
     filter.setVerbose(verbose);
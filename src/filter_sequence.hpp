@@ -32,7 +32,11 @@ using std::ofstream;
 #include <seqan/seq_io.h>
 
 #include <kat/input_handler.hpp>
+#include <kat/pipeline.hpp>
+#include <kat/two_bit.hpp>
 using kat::InputHandler;
+using kat::Pipeline;
+using kat::TwoBitFile;
 
 
 typedef boost::error_info<struct FilterSeqError,string> FilterSeqErrorInfo;
@@ -77,6 +81,30 @@ class FilterSeq
 {
 private:
 
+    static const uint16_t BATCH_SIZE = 1024;    // Maximum number of records, or pairs, in a batch
+
+    /**
+     * A batch of records, or pairs of records, read from the sequence files, along
+     * with the K-mer hits and filtering decision for each one.  Batches are filled
+     * by the reader, processed by a single worker and then handed to the writers.
+     */
+    struct SeqBatch {
+        uint64_t first;         // Index of the first record in the batch
+        seqan::StringSet<seqan::CharString> names;
+        seqan::StringSet<seqan::CharString> seqs;
+        seqan::StringSet<seqan::CharString> quals;
+        seqan::StringSet<seqan::CharString> names2;
+        seqan::StringSet<seqan::CharString> seqs2;
+        seqan::StringSet<seqan::CharString> quals2;
+        vector<double> randomVals;  // Used for subsampling
+        vector<SeqStats> stats;
+        vector<bool> keep;
+
+        size_t size() const {
+            return seqan::length(names);
+        }
+    };
+
     // Args
     InputHandler    input;
     path            seq_file_1;
@@ -89,21 +117,15 @@ private:
 	double		frequency;
     bool        doStats;
     uint16_t    threads;
+    bool        ordered;
     bool        verbose;
 
     uint64_t    keepers;
     uint64_t    total;
 
-    seqan::CharString name;
-    seqan::CharString seq;
-    seqan::CharString qual;
-    seqan::CharString name2;
-    seqan::CharString seq2;
-    seqan::CharString qual2;
-    string extension;
-
     unique_ptr<seqan::SeqFileIn> reader = nullptr;
     unique_ptr<seqan::SeqFileIn> reader2 = nullptr;
+    unique_ptr<TwoBitFile> twoBit = nullptr;        // Used instead of reader for .2bit input
 
     unique_ptr<seqan::SeqFileOut> inWriter = nullptr;
     unique_ptr<seqan::SeqFileOut> outWriter = nullptr;
@@ -214,6 +236,18 @@ public:
         this->input.hashSize = hashSize;
     }
 
+    bool isOrdered() const {
+        return ordered;
+    }
+
+    /**
+     * Whether records are written out in input order (the default), or as soon
+     * as they are processed.  Pairs are kept together either way.
+     */
+    void setOrdered(bool ordered) {
+        this->ordered = ordered;
+    }
+
     bool isVerbose() const {
         return verbose;
     }
@@ -229,11 +263,16 @@ public:
 protected:
 
     void processSeqFile();
-    void processPairedSeqFile();
 
-    void processSeq(uint64_t index, double random_val);
+    bool readBatch(SeqBatch& batch, uint64_t& index, std::mt19937& gen, std::uniform_real_distribution<>& urd);
+
+    void processBatch(SeqBatch& batch);
+
+    void writeBatch(seqan::SeqFileOut& writer, const SeqBatch& batch, bool second, bool kept);
+
+    void printStats(std::ostream& out, const SeqBatch& batch);
 
-    void getProfile(seqan::CharString& s, vector<bool>& hits);
+    void getProfile(const seqan::CharString& s, uint64_t& nbKmers, uint64_t& nbHits);
 
 
     static string helpMessage() {
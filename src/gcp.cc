@@ -24,12 +24,14 @@
 #include <math.h>
 #include <memory>
 #include <thread>
+#include <sstream>
 #include <vector>
 #include <sys/ioctl.h>
 using std::shared_ptr;
 using std::make_shared;
 using std::ostream;
 using std::ofstream;
+using std::stringstream;
 using std::thread;
 using std::vector;
 
@@ -54,6 +56,7 @@ using kat::InputHandler;
 using kat::HashLoader;
 using kat::ThreadedSparseMatrix;
 using kat::SparseMatrix;
+using kat::JellyfishHelper;
 
 #include "plot.hpp"
 using kat::Plot;
@@ -69,6 +72,9 @@ kat::Gcp::Gcp(vector<path>& _inputs) {
     cvgScale = 1.0;
     cvgBins = 1000;
     threads = 1;
+    binaryMx = false;
+    approxMemory = 0;
+    approxScale = 1.0;
 }
 
 void kat::Gcp::execute() {
@@ -80,6 +86,23 @@ void kat::Gcp::execute() {
     path parentDir = bfs::absolute(outputPrefix).parent_path();
     KatFS::ensureDirectoryExists(parentDir);
 
+    if (!input.seedHash.empty() && (input.mode != InputHandler::InputMode::COUNT || isApprox())) {
+        BOOST_THROW_EXCEPTION(GcpException() << GcpErrorInfo(string(
+            "Seeding from an existing hash can only be done when exactly counting K-mers from sequence files")));
+    }
+
+    if (isApprox()) {
+        if (input.mode != InputHandler::InputMode::COUNT || input.dumpHash) {
+            BOOST_THROW_EXCEPTION(GcpException() << GcpErrorInfo(string(
+                "Approximate counting can only be used when counting K-mers from sequence files, without dumping hashes")));
+        }
+
+        gcp_mx = make_shared<ThreadedSparseMatrix>(input.merLen + 1, cvgBins + 1, threads);
+        analyseApprox();
+        merge();
+        return;
+    }
+
     // Either count or load input
     if (input.mode == InputHandler::InputHandler::InputMode::COUNT) {
         input.count(threads);
@@ -89,8 +112,8 @@ void kat::Gcp::execute() {
         input.loadHash();
     }
 
-    // Create matrix of appropriate size (adds 1 to cvg bins to account for 0)
-    gcp_mx = make_shared<ThreadedSparseMatrix>(input.header->key_len() / 2, cvgBins + 1, threads);
+    // Create matrix of appropriate size (adds 1 to GC and cvg bins to account for 0)
+    gcp_mx = make_shared<ThreadedSparseMatrix>(input.header->key_len() / 2 + 1, cvgBins + 1, threads);
 
     // Process batch with worker threads
     // Process each sequence is processed in a different thread.
@@ -117,9 +140,17 @@ void kat::Gcp::save() {
     cout.flush();
 
     // Send main matrix to output file
-    ofstream main_mx_out_stream(string(outputPrefix.string() + ".mx").c_str());
-    printMainMatrix(main_mx_out_stream);
-    main_mx_out_stream.close();
+    path mx_path(outputPrefix.string() + ".mx");
+    if (binaryMx) {
+        stringstream header;
+        printMainMatrixHeader(header);
+        gcp_mx->getFinalMatrix().saveBinary(mx_path, header.str());
+    }
+    else {
+        ofstream main_mx_out_stream(mx_path.c_str());
+        printMainMatrix(main_mx_out_stream);
+        main_mx_out_stream.close();
+    }
 
     cout << " done.";
     cout.flush();
@@ -138,7 +169,12 @@ void kat::Gcp::merge() {
 }
 
 void kat::Gcp::printMainMatrix(ostream &out) {
-    SM64 mx = gcp_mx->getFinalMatrix();
+    printMainMatrixHeader(out);
+    gcp_mx->getFinalMatrix().printMatrix(out);
+}
+
+void kat::Gcp::printMainMatrixHeader(ostream &out) {
+    const SM64& mx = gcp_mx->getFinalMatrix();
 
     out << mme::KEY_TITLE << "K-mer coverage vs GC count plot for: " << input.fileName() << endl;
     out << mme::KEY_X_LABEL << input.merLen << "-mer frequency" << endl;
@@ -150,9 +186,14 @@ void kat::Gcp::printMainMatrix(ostream &out) {
     out << mme::KEY_TRANSPOSE << "0" << endl;
     out << mme::KEY_KMER << input.merLen << endl;
     out << mme::KEY_INPUT_1 << input.pathString() << endl;
+    if (approx) {
+        const CountMinSketch& cms = approx->getSketch();
+        out << mme::KEY_APPROXIMATE << "1" << endl;
+        out << mme::KEY_MAX_OVERCOUNT << cms.errorBound() << " (probability " << 1.0 - cms.delta() << ")" << endl;
+        out << mme::KEY_DISTINCT_ESTIMATE << approx->getDistinct().estimate() << " (+/- " << approx->getDistinct().standardError() * 100.0 << "%)" << endl;
+        out << mme::KEY_DISTINCT_SCALE << approxScale << endl;
+    }
     out << mme::MX_META_END << endl;
-
-    mx.printMatrix(out);
 }
 
 void kat::Gcp::analyse() {
@@ -178,22 +219,94 @@ void kat::Gcp::analyse() {
 
 void kat::Gcp::analyseSlice(int th_id) {
 
+    // Tally into a dense (K+1) x bins matrix local to this thread, then hand it over
+    // in one go.  The matrix is small enough to stay in cache.
+    const uint16_t merLen = input.header->key_len() / 2;
+    const size_t rowLen = cvgBins + 1;
+    vector<uint64_t> cells((merLen + 1) * rowLen, 0);
+
     LargeHashArray::region_iterator it = input.hash->region_slice(th_id, threads);
-    while (it.next()) {
-        string kmer = it.key().to_str();
-        uint64_t kmer_count = it.val();
 
-        // Count gs and cs
-        uint16_t g_or_c = gcCount(kmer);
+    if (merLen <= 32) {
+        // K-mers fit in a single word, so count GC for a batch of them at a time
+        uint64_t words[GC_BATCH_SIZE];
+        uint64_t counts[GC_BATCH_SIZE];
+        uint8_t gc[GC_BATCH_SIZE];
+
+        bool more = true;
+        while (more) {
+            size_t n = 0;
+            while (n < GC_BATCH_SIZE && (more = it.next())) {
+                words[n] = it.key().word(0);
+                counts[n] = it.val();
+                n++;
+            }
+
+            JellyfishHelper::gcCountBatch(words, n, gc);
+
+            for (size_t i = 0; i < n; i++) {
+                ++cells[gc[i] * rowLen + cvgPos(counts[i])];
+            }
+        }
+    }
+    else {
+        while (it.next()) {
+            ++cells[JellyfishHelper::gcCount(it.key()) * rowLen + cvgPos(it.val())];
+        }
+    }
+
+    for (size_t i = 0; i < cells.size(); i++) {
+        if (cells[i] > 0) {
+            gcp_mx->incTM(th_id, i / rowLen, i % rowLen, cells[i]);
+        }
+    }
+}
+
+void kat::Gcp::analyseApprox() {
+
+    auto_cpu_timer timer(1, "  Time taken: %ws\n\n");
+
+    cout << "Approximately counting kmers in " << input.pathString() << " using at most " << approxMemory << " bytes ...";
+    cout.flush();
 
-        // Apply scaling factor
-        uint64_t cvg_pos = kmer_count == 0 ? 0 : ceil((double) kmer_count * cvgScale);
+    approx = make_shared<ApproxCounter>(input.merLen, approxMemory, input.canonical);
+    approx->count(input.input, threads, input.trim5p);
+
+    // Every occurrence of a K-mer gets the same estimated count c, so adding 1/c
+    // per occurrence approximates the number of distinct K-mers in each cell.
+    // Overestimated K-mers add less than one, so the matrix is scaled up to the
+    // distinct K-mer estimate.
+    const size_t rowLen = cvgBins + 1;
+    vector<vector<double>> cells(threads, vector<double>((input.merLen + 1) * rowLen, 0.0));
+    approx->visit(input.input, threads, input.trim5p, [this, &cells, rowLen](uint16_t th_id, const mer_dna& kmer, uint32_t count) {
+        cells[th_id][JellyfishHelper::gcCount(kmer) * rowLen + cvgPos(count)] += 1.0 / (double)count;
+    });
+
+    vector<double> sums(cells[0].size(), 0.0);
+    double weightTotal = 0.0;
+    for (size_t i = 0; i < sums.size(); i++) {
+        for (auto& c : cells) {
+            sums[i] += c[i];
+        }
+        weightTotal += sums[i];
+    }
 
-        if (cvg_pos > cvgBins)
-            gcp_mx->incTM(th_id, g_or_c, cvgBins, 1);
-        else
-            gcp_mx->incTM(th_id, g_or_c, cvg_pos, 1);
+    approxScale = approx->distinctScale(weightTotal);
+    for (size_t i = 0; i < sums.size(); i++) {
+        const uint64_t val = llround(sums[i] * approxScale);
+        if (val > 0) {
+            gcp_mx->incTM(0, i / rowLen, i % rowLen, val);
+        }
     }
+
+    const CountMinSketch& cms = approx->getSketch();
+    cout << " done." << endl
+         << "  Sketch: " << cms.getDepth() << " x " << cms.getWidth() << " counters" << endl
+         << "  Counts overestimated by at most " << cms.errorBound() << " with probability " << 1.0 - cms.delta() << endl
+         << "  Estimated distinct kmers: " << approx->getDistinct().estimate()
+         << " (+/- " << approx->getDistinct().standardError() * 100.0 << "%)" << endl
+         << "  Matrix scaled by " << approxScale << " to match" << endl;
+    cout.flush();
 }
 
 void kat::Gcp::plot(const string& output_type) {
@@ -265,7 +378,10 @@ int kat::Gcp::main(int argc, char *argv[]) {
     uint16_t        mer_len;
     uint64_t        hash_size;
     bool            dump_hash;
+    path            seed_hash;
     string          plot_output_type;
+    bool            binary_mx;
+    uint64_t        approx_mem;
     bool            verbose;
     bool            help;
 
@@ -294,8 +410,14 @@ int kat::Gcp::main(int argc, char *argv[]) {
                 "If kmer counting is required for the input, then use this value as the hash size.  If this hash size is not large enough for your dataset then the default behaviour is to double the size of the hash and recount, which will increase runtime and memory usage.")
             ("dump_hash,d", po::bool_switch(&dump_hash)->default_value(false),
                         "Dumps any jellyfish hashes to disk that were produced during this run. Normally, this is not recommended, as hashes are slow to load and will likely consume a significant amount of disk space.")
+            ("seed_hash", po::value<path>(&seed_hash),
+                "Existing jellyfish hash, e.g. dumped by a previous run with --dump_hash, whose counts are added to those from the input sequence files.  Use this to update the results when more reads arrive, counting only the new reads rather than everything again.  The combined hash is dumped to disk (implies --dump_hash), so it can seed the next update.  K and the counting mode must match the hash.")
             ("output_type,p", po::value<string>(&plot_output_type)->default_value(DEFAULT_GCP_PLOT_OUTPUT_TYPE),
                 "The plot file type to create: png, ps, pdf.")
+            ("binary_mx", po::bool_switch(&binary_mx)->default_value(false),
+                "Write the matrix in KAT's binary matrix format rather than as text.  Binary matrices are smaller and much faster to load, and are accepted by \"kat plot\".")
+            ("approx_mem", po::value<uint64_t>(&approx_mem)->default_value(0),
+                "Count K-mers approximately, using a count-min sketch of at most this many MB instead of a hash.  Memory usage is then fixed regardless of the input size, at the cost of overestimating some counts.  The matrix is flagged as approximate and the error bounds are reported in its metadata.  Overestimated K-mers fall into too high a bin, and the matrix is scaled so that its total matches the estimated number of distinct K-mers.  The input must be sequence files, which are read twice.  0 (default) counts K-mers exactly.")
             ("verbose,v", po::bool_switch(&verbose)->default_value(false),
                 "Print extra information.")
             ("help", po::bool_switch(&help)->default_value(false), "Produce help message.")
@@ -348,6 +470,9 @@ int kat::Gcp::main(int argc, char *argv[]) {
     gcp.setMerLen(mer_len);
     gcp.setOutputPrefix(output_prefix);
     gcp.setDumpHash(dump_hash);
+    gcp.setSeedHash(seed_hash);
+    gcp.setBinaryMx(binary_mx);
+    gcp.setApproxMemory(approx_mem * 1024 * 1024);
     gcp.setVerbose(verbose);
 
     // Do the work (outputs data to files as it goes)
@@ -41,11 +41,14 @@ using boost::lexical_cast;
 #include <kat/pyhelper.hpp>
 #include <kat/jellyfish_helper.hpp>
 #include <kat/input_handler.hpp>
+#include <kat/kmer_analysis.hpp>
 #include <kat/matrix_metadata_extractor.hpp>
+#include <kat/sketch.hpp>
 #include <kat/sparse_matrix.hpp>
 using kat::PyHelper;
 using kat::InputHandler;
 using kat::ThreadedSparseMatrix;
+using kat::ApproxCounter;
 
 
 using std::ostream;
@@ -57,6 +60,7 @@ struct GcpException: virtual boost::exception, virtual std::exception { };
 namespace kat {
 
     const string     DEFAULT_GCP_PLOT_OUTPUT_TYPE     = "png";
+    const size_t     GC_BATCH_SIZE                    = 256;  // K-mers per call to the GC kernel
 
     class Gcp {
     private:
@@ -67,7 +71,13 @@ namespace kat {
         uint16_t        threads;
         double          cvgScale;
         uint16_t        cvgBins;
+        bool            binaryMx;
         bool            verbose;
+        uint64_t        approxMemory;               // Sketch size in bytes for approximate counting, 0 means exact
+
+        // Approximate mode counter, if used
+        shared_ptr<ApproxCounter> approx;
+        double approxScale;     // Applied to the matrix so its total matches the distinct K-mer estimate
 
         // Stores results
         shared_ptr<ThreadedSparseMatrix> gcp_mx; // Stores cumulative base count for each sequence where GC and CVG are binned
@@ -147,6 +157,40 @@ namespace kat {
             this->input.dumpHash = dumpHash;
         }
 
+        /**
+         * Adds the counts from an existing dump, e.g. from a previous run over the
+         * rest of the project, to those counted from the input.  The combined hash
+         * is dumped so it can seed the next run.
+         */
+        void setSeedHash(const path& seedHash) {
+            this->input.seedHash = seedHash;
+            this->input.dumpHash = this->input.dumpHash || !seedHash.empty();
+        }
+
+        bool isBinaryMx() const {
+            return binaryMx;
+        }
+
+        void setBinaryMx(bool binaryMx) {
+            this->binaryMx = binaryMx;
+        }
+
+        uint64_t getApproxMemory() const {
+            return approxMemory;
+        }
+
+        /**
+         * Count K-mers approximately using a sketch of at most this many bytes,
+         * rather than with an exact hash.  0 counts exactly.
+         */
+        void setApproxMemory(uint64_t approxMemory) {
+            this->approxMemory = approxMemory;
+        }
+
+        bool isApprox() const {
+            return approxMemory > 0;
+        }
+
         bool isVerbose() const {
             return verbose;
         }
@@ -163,6 +207,8 @@ namespace kat {
 
         void printMainMatrix(ostream &out);
 
+        void printMainMatrixHeader(ostream &out);
+
         void save();
 
         void plot(const string& output_type);
@@ -175,6 +221,13 @@ namespace kat {
 
         void analyseSlice(int th_id);
 
+        // Counts K-mers into a sketch, then builds the matrix from a second pass
+        void analyseApprox();
+
+        uint64_t cvgPos(uint64_t kmer_count) const {
+            return GcpAnalysis::cvgPos(kmer_count, cvgScale, cvgBins);
+        }
+
         void merge();
 
         static const string helpMessage() {
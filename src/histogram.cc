@@ -63,6 +63,8 @@ kat::Histogram::Histogram(vector<path> _inputs, uint64_t _low, uint64_t _high, u
 	high = _high;
 	inc = _inc;
 	threads = 1;
+	approxMemory = 0;
+	approxScale = 1.0;
 
 	// Calculate other vars required for this run
 	base = calcBase();
@@ -82,24 +84,83 @@ void kat::Histogram::execute() {
 	// Validate input
 	input.validateInput();
 
+	if (isMultiK() || isGrouped()) {
+		if (input.mode != InputHandler::InputMode::COUNT) {
+			BOOST_THROW_EXCEPTION(HistogramException() << HistogramErrorInfo(string(
+				"Multiple K values and per group histograms can only be used when counting K-mers from sequence files")));
+		}
+		if (input.dumpHash) {
+			BOOST_THROW_EXCEPTION(HistogramException() << HistogramErrorInfo(string(
+				"Dumping hashes is not supported when counting multiple K values or per group histograms")));
+		}
+		if (isGrouped() && fileGroups.size() != input.input.size()) {
+			BOOST_THROW_EXCEPTION(HistogramException() << HistogramErrorInfo(string(
+				"Expected a group for each of the ") + lexical_cast<string>(input.input.size()) +
+				" input files, but got " + lexical_cast<string>(fileGroups.size())));
+		}
+		for (size_t g = 0; g < nbGroups(); g++) {
+			if (std::find(fileGroups.begin(), fileGroups.end(), g) == fileGroups.end()) {
+				BOOST_THROW_EXCEPTION(HistogramException() << HistogramErrorInfo(string(
+					"Group numbers must be contiguous, starting from 1, but no files were assigned to group ") +
+					lexical_cast<string>(g + 1)));
+			}
+		}
+	}
+
+	if (isApprox()) {
+		if (input.mode != InputHandler::InputMode::COUNT) {
+			BOOST_THROW_EXCEPTION(HistogramException() << HistogramErrorInfo(string(
+				"Approximate counting can only be used when counting K-mers from sequence files")));
+		}
+		if (input.dumpHash || isMultiK() || isGrouped()) {
+			BOOST_THROW_EXCEPTION(HistogramException() << HistogramErrorInfo(string(
+				"Approximate counting can't be combined with dumping hashes, multiple K values or per group histograms")));
+		}
+	}
+
+	if (!input.seedHash.empty()) {
+		if (input.mode != InputHandler::InputMode::COUNT || isMultiK() || isGrouped() || isApprox()) {
+			BOOST_THROW_EXCEPTION(HistogramException() << HistogramErrorInfo(string(
+				"Seeding from an existing hash can only be done when exactly counting a single K value from sequence files")));
+		}
+	}
+
+	if (input.snapshotInterval > 0) {
+		if (input.mode != InputHandler::InputMode::COUNT || isMultiK() || isGrouped() || isApprox()) {
+			BOOST_THROW_EXCEPTION(HistogramException() << HistogramErrorInfo(string(
+				"Snapshots can only be taken when exactly counting a single K value from sequence files")));
+		}
+		input.snapshot = [this](const LargeHashArray& ary, uint64_t elapsed) { return snapshot(ary, elapsed); };
+	}
+
 	// Create output directory
 	path parentDir = bfs::absolute(outputPrefix).parent_path();
 	KatFS::ensureDirectoryExists(parentDir);
 
-	// Either count or load input
+	data = vector<uint64_t>(nb_buckets, 0);
+	threadedData = vector<shared_ptr<vector < uint64_t>>>(threads);
+
+	if (isMultiK() || isGrouped()) {
+		countMultiK();
+		return;
+	}
+
+	if (isApprox()) {
+		countApprox();
+		return;
+	}
+
+	// Either count then bin the hash, or stream the counts directly from the
+	// existing dump.  The histogram only needs a single pass over the counts so
+	// there's no point building a hash from the dump first.
 	if (input.mode == InputHandler::InputHandler::InputMode::COUNT) {
 		input.count(threads);
+		bin();
 	} else {
 		input.loadHeader();
-		input.loadHash();
+		binDump();
 	}
 
-	data = vector<uint64_t>(nb_buckets, 0);
-	threadedData = vector<shared_ptr<vector < uint64_t>>>();
-
-	// Do the work
-	bin();
-
 	// Dump any hashes that were previously counted to disk if requested
 	// NOTE: MUST BE DONE AFTER COMPARISON AS THIS CLEARS ENTRIES FROM HASH ARRAY!
 	if (input.dumpHash) {
@@ -119,27 +180,97 @@ void kat::Histogram::save() {
 	cout << "Saving results to disk ...";
 	cout.flush();
 
-	// Send main matrix to output file
-	ofstream main_hist_out_stream(outputPrefix.c_str());
-	print(main_hist_out_stream);
-	main_hist_out_stream.close();
+	// Send histogram(s) to output file
+	for (size_t i = 0; i < nbHists(); i++) {
+		ofstream main_hist_out_stream(getHistPath(i).c_str());
+		print(main_hist_out_stream, i);
+		main_hist_out_stream.close();
+	}
 
 	cout << " done.";
 	cout.flush();
 }
 
 void kat::Histogram::print(std::ostream &out) {
+	print(out, input.merLen, data, input.input);
+}
+
+void kat::Histogram::print(std::ostream &out, size_t index) {
+
+	if (!isMultiK() && !isGrouped()) {
+		print(out);
+		return;
+	}
+
+	const size_t group = index % (1 + nbGroups());
+	const uint16_t merLen = merLens[index / (1 + nbGroups())];
+
+	if (group == 0) {
+		print(out, merLen, multiData[index], input.input);
+	}
+	else {
+		vector<path> files;
+		for (size_t i = 0; i < fileGroups.size(); i++) {
+			if (fileGroups[i] == group - 1) {
+				files.push_back(input.input[i]);
+			}
+		}
+		print(out, merLen, multiData[index], files);
+	}
+}
+
+void kat::Histogram::print(std::ostream &out, uint16_t merLen, const vector<uint64_t>& hist, const vector<path>& files) {
+
+	InputHandler in;
+	in.input = files;
+
 	// Output header
-	out << mme::KEY_TITLE << input.merLen << "-mer spectra for: " << input.fileName() << endl;
-	out << mme::KEY_X_LABEL << input.merLen << "-mer frequency" << endl;
-	out << mme::KEY_Y_LABEL << "# distinct " << input.merLen << "-mers" << endl;
-	out << mme::KEY_KMER << input.merLen << endl;
-	out << mme::KEY_INPUT_1 << input.pathString() << endl;
+	out << mme::KEY_TITLE << merLen << "-mer spectra for: " << in.fileName() << endl;
+	out << mme::KEY_X_LABEL << merLen << "-mer frequency" << endl;
+	out << mme::KEY_Y_LABEL << "# distinct " << merLen << "-mers" << endl;
+	out << mme::KEY_KMER << merLen << endl;
+	out << mme::KEY_INPUT_1 << in.pathString() << endl;
+	if (approx) {
+		const CountMinSketch& cms = approx->getSketch();
+		out << mme::KEY_APPROXIMATE << "1" << endl;
+		out << mme::KEY_MAX_OVERCOUNT << cms.errorBound() << " (probability " << 1.0 - cms.delta() << ")" << endl;
+		out << mme::KEY_DISTINCT_ESTIMATE << approx->getDistinct().estimate() << " (+/- " << approx->getDistinct().standardError() * 100.0 << "%)" << endl;
+		out << mme::KEY_DISTINCT_SCALE << approxScale << endl;
+	}
 	out << mme::MX_META_END << endl;
 
 	uint64_t col = base;
 	for (uint64_t i = 0; i < nb_buckets; i++, col += inc) {
-		out << col << " " << data[i] << "\n";
+		out << col << " " << hist[i] << "\n";
+	}
+}
+
+function<void()> kat::Histogram::snapshot(const LargeHashArray& ary, uint64_t elapsed) {
+
+	// Single threaded, to stay out of the way of the counting threads
+	vector<uint64_t> hist(nb_buckets, 0);
+	LargeHashArray::region_iterator it = ary.region_slice(0, 1);
+	while (it.next()) {
+		++hist[bucket(it.val())];
+	}
+
+	// Written once the hash is released, so counting threads aren't held up on disk
+	return [this, hist, elapsed]() { writeSnapshot(hist, elapsed); };
+}
+
+void kat::Histogram::writeSnapshot(const vector<uint64_t>& hist, uint64_t elapsed) {
+
+	// Write to a temporary file first, so anyone watching never sees a partial snapshot
+	const path snapshotPath = getSnapshotPath(elapsed);
+	const path tmpPath(snapshotPath.string() + ".tmp");
+	ofstream out(tmpPath.c_str());
+	print(out, input.merLen, hist, input.input);
+	out.close();
+	bfs::rename(tmpPath, snapshotPath);
+
+	if (verbose) {
+		cout << endl << "  Wrote snapshot after " << elapsed << "s to " << snapshotPath.string();
+		cout.flush();
 	}
 }
 
@@ -186,16 +317,149 @@ void kat::Histogram::binSlice(int th_id) {
 
 	LargeHashArray::region_iterator it = input.hash->region_slice(th_id, threads);
 	while (it.next()) {
-		uint64_t val = it.val();
-		if (val < base)
-			++(*hist)[0];
-		else if (val > ceil)
-			++(*hist)[nb_buckets - 1];
-		else
-			++(*hist)[(val - base) / inc];
+		++(*hist)[bucket(it.val())];
+	}
+
+	threadedData[th_id] = hist;
+}
+
+void kat::Histogram::binDump() {
+
+	auto_cpu_timer timer(1, "  Time taken: %ws\n\n");
+
+	cout << "Streaming kmer counts from " << input.pathString() << " ...";
+	cout.flush();
+
+	MappedDump dump(input.getSingleInput());
+	input.merLen = dump.getMerLen();
+	input.canonical = dump.getCanonical();
+
+	vector<thread> t(threads);
+
+	for (uint16_t i = 0; i < threads; i++) {
+		t[i] = thread(&Histogram::binDumpSlice, this, std::cref(dump), i);
+	}
+
+	for (uint16_t i = 0; i < threads; i++) {
+		t[i].join();
+	}
+
+	cout << " done.";
+	cout.flush();
+}
+
+void kat::Histogram::binDumpSlice(const MappedDump& dump, int th_id) {
+
+	shared_ptr<vector < uint64_t>> hist = make_shared<vector < uint64_t >> (nb_buckets);
+
+	const pair<uint64_t, uint64_t> range = dump.slice(th_id, threads);
+	for (uint64_t i = range.first; i < range.second; i++) {
+		++(*hist)[bucket(dump.val(i))];
+	}
+
+	threadedData[th_id] = hist;
+}
+
+void kat::Histogram::countMultiK() {
+
+	auto_cpu_timer timer(1, "  Time taken: %ws\n\n");
+
+	if (merLens.empty()) {
+		merLens.push_back(input.merLen);
+	}
+
+	string kstr;
+	for (auto k : merLens) {
+		kstr += (kstr.empty() ? "" : ",") + lexical_cast<string>(k);
+	}
+
+	cout << "Counting kmers for K=" << kstr;
+	if (isGrouped()) {
+		cout << " and " << nbGroups() << " groups";
+	}
+	cout << " in a single pass over " << input.pathString() << " ...";
+	cout.flush();
+
+	MultiKCounter counter(merLens, input.hashSize, input.canonical, !input.disableHashGrow, fileGroups);
+	counter.count(input.input, threads, input.trim5p);
+
+	// Histograms are ordered as in getHistPath, i.e. merged then groups for each K
+	multiData = vector<vector<uint64_t>>(nbHists(), vector<uint64_t>(nb_buckets, 0));
+	for (size_t k = 0; k < counter.size(); k++) {
+		const size_t first = k * (1 + nbGroups());
+		binCounter(counter.getCounter(k), multiData[first]);
+		for (size_t g = 0; g < nbGroups(); g++) {
+			binCounter(counter.getGroupCounter(k, g), multiData[first + 1 + g]);
+		}
+	}
+
+	cout << " done.";
+	cout.flush();
+}
+
+void kat::Histogram::binCounter(const KCounter& counter, vector<uint64_t>& hist) {
+
+	// Build the spectrum, with a final element for counts above the ceiling, then
+	// convert to the requested bins
+	vector<vector<uint64_t>> spectra(threads, vector<uint64_t>(ceil + 2, 0));
+	vector<thread> t(threads);
+
+	for (uint16_t i = 0; i < threads; i++) {
+		t[i] = thread(&kat::KCounter::spectrum, &counter, i, threads, std::ref(spectra[i]));
+	}
+
+	for (uint16_t i = 0; i < threads; i++) {
+		t[i].join();
+	}
+
+	for (auto& spectrum : spectra) {
+		for (uint64_t val = 0; val < spectrum.size(); val++) {
+			hist[bucket(val)] += spectrum[val];
+		}
+	}
+}
+
+void kat::Histogram::countApprox() {
+
+	auto_cpu_timer timer(1, "  Time taken: %ws\n\n");
+
+	cout << "Approximately counting kmers in " << input.pathString() << " using at most " << approxMemory << " bytes ...";
+	cout.flush();
+
+	approx = make_shared<ApproxCounter>(input.merLen, approxMemory, input.canonical);
+	approx->count(input.input, threads, input.trim5p);
+
+	// Every occurrence of a K-mer gets the same estimated count c, so adding 1/c
+	// per occurrence approximates the number of distinct K-mers with that count.
+	// Overestimated K-mers add less than one, so the spectrum is scaled up to the
+	// distinct K-mer estimate.
+	vector<vector<double>> spectra(threads, vector<double>(ceil + 2, 0.0));
+	approx->visit(input.input, threads, input.trim5p, [this, &spectra](uint16_t th_id, const mer_dna& kmer, uint32_t count) {
+		spectra[th_id][std::min<uint64_t>(count, ceil + 1)] += 1.0 / (double)count;
+	});
+
+	vector<double> spectrum(ceil + 2, 0.0);
+	double weightTotal = 0.0;
+	for (uint64_t val = 0; val < ceil + 2; val++) {
+		for (auto& s : spectra) {
+			spectrum[val] += s[val];
+		}
+		weightTotal += spectrum[val];
 	}
 
-	threadedData.push_back(hist);
+	approxScale = approx->distinctScale(weightTotal);
+	for (uint64_t val = 0; val < ceil + 2; val++) {
+		data[bucket(val)] += llround(spectrum[val] * approxScale);
+	}
+
+	const CountMinSketch& cms = approx->getSketch();
+	cout << " done." << endl
+		 << "  Sketch: " << cms.getDepth() << " x " << cms.getWidth() << " counters" << endl
+		 << "  Counts overestimated by at most " << cms.errorBound() << " with probability " << 1.0 - cms.delta() << endl
+		 << "  Estimated distinct kmers: " << approx->getDistinct().estimate()
+		 << " (+/- " << approx->getDistinct().standardError() * 100.0 << "%)" << endl
+		 << "  Spectrum scaled by " << approxScale << " to match" << endl;
+	cout.flush();
 }
 
 void kat::Histogram::analysePeaks() {
@@ -205,28 +469,37 @@ void kat::Histogram::analysePeaks() {
 	
 	path dascript = path("kat") / "distanalysis.py";
 
-	vector<string> args;
-	args.push_back(dascript.string());
-	if (verbose) {
-		args.push_back("--verbose");
-	}
-	args.push_back("--from_kat");
-	args.push_back("--output_prefix=" + outputPrefix.string());
-	args.push_back(outputPrefix.string());
+	for (size_t h = 0; h < nbHists(); h++) {
 
-	char* char_args[50];
+		const path histPath = getHistPath(h);
 
-	for (size_t i = 0; i < args.size(); i++) {
-		char_args[i] = strdup(args[i].c_str());
-	}
+		if (nbHists() > 1) {
+			cout << histPath.leaf().string() << endl;
+		}
 
-	PyHelper::getInstance().execute(dascript.string(), (int) args.size(), char_args);
+		vector<string> args;
+		args.push_back(dascript.string());
+		if (verbose) {
+			args.push_back("--verbose");
+		}
+		args.push_back("--from_kat");
+		args.push_back("--output_prefix=" + histPath.string());
+		args.push_back(histPath.string());
 
-	for (size_t i = 0; i < args.size(); i++) {
-		free(char_args[i]);
-	}
+		char* char_args[50];
+
+		for (size_t i = 0; i < args.size(); i++) {
+			char_args[i] = strdup(args[i].c_str());
+		}
+
+		PyHelper::getInstance().execute(dascript.string(), (int) args.size(), char_args);
+
+		for (size_t i = 0; i < args.size(); i++) {
+			free(char_args[i]);
+		}
 
-	cout << endl;
+		cout << endl;
+	}
 #endif
 }
 
@@ -238,16 +511,19 @@ void kat::Histogram::plot(const string& output_type) {
 	cout << "Creating plot ...";
 	cout.flush();
 
-	path outputFile1 = path(outputPrefix.string() + "." + output_type);
+	for (size_t h = 0; h < nbHists(); h++) {
 
-	vector<string> args;
-	args.push_back("kat/plot/spectra-hist.py");
-	args.push_back(string("--output=") + outputFile1.string());
-	if (verbose) {
-		args.push_back("--verbose");
+		path outputFile1 = path(getHistPath(h).string() + "." + output_type);
+
+		vector<string> args;
+		args.push_back("kat/plot/spectra-hist.py");
+		args.push_back(string("--output=") + outputFile1.string());
+		if (verbose) {
+			args.push_back("--verbose");
+		}
+		args.push_back(getHistPath(h).string());
+		Plot::executePythonPlot(Plot::PlotMode::SPECTRA_HIST, args);
 	}
-	args.push_back(outputPrefix.string());
-	Plot::executePythonPlot(Plot::PlotMode::SPECTRA_HIST, args);
 
 	cout << " done.";
 	cout.flush();
@@ -264,9 +540,14 @@ int kat::Histogram::main(int argc, char *argv[]) {
 	uint64_t inc;
 	string trim5p;
 	bool non_canonical;
-	uint16_t mer_len;
+	string mer_len;
 	uint64_t hash_size;
 	bool dump_hash;
+	path seed_hash;
+	bool per_file;
+	string groups;
+	uint32_t snapshot_interval;
+	uint64_t approx_mem;
 	string plot_output_type;
 	bool verbose;
 	bool help;
@@ -292,12 +573,22 @@ int kat::Histogram::main(int argc, char *argv[]) {
 		"Ignore the first X bases from reads.  If more that one file is provided you can specify different values for each file by seperating with commas.")
 		("non_canonical,N", po::bool_switch(&non_canonical)->default_value(false),
 		"If counting fast(a/q), store explicit kmer as found.  By default, we store 'canonical' k-mers, which means we count both strands.")
-		("mer_len,m", po::value<uint16_t>(&mer_len)->default_value(DEFAULT_MER_LEN),
-		"The kmer length to use in the kmer hashes.  Larger values will provide more discriminating power between kmers but at the expense of additional memory and lower coverage.")
+		("mer_len,m", po::value<string>(&mer_len)->default_value(lexical_cast<string>(DEFAULT_MER_LEN)),
+		"The kmer length to use in the kmer hashes.  Larger values will provide more discriminating power between kmers but at the expense of additional memory and lower coverage.  When counting from sequence files, up to 8 comma separated values may be given (e.g. 17,21,25,31).  The input is then read only once and a histogram is created for each value, with the K value appended to the output prefix.  Note that a hash of the requested size is created for each K value.")
 		("hash_size,H", po::value<uint64_t>(&hash_size)->default_value(DEFAULT_HASH_SIZE),
 		"If kmer counting is required for the input, then use this value as the hash size.  If this hash size is not large enough for your dataset then the default behaviour is to double the size of the hash and recount, which will increase runtime and memory usage.")
 		("dump_hash,d", po::bool_switch(&dump_hash)->default_value(false),
 		"Dumps any jellyfish hashes to disk that were produced during this run. Normally, this is not recommended, as hashes are slow to load and will likely consume a significant amount of disk space.")
+		("seed_hash", po::value<path>(&seed_hash),
+		"Existing jellyfish hash, e.g. dumped by a previous run with --dump_hash, whose counts are added to those from the input sequence files.  Use this to update the results when more reads arrive, counting only the new reads rather than everything again.  The combined hash is dumped to disk (implies --dump_hash), so it can seed the next update.  K and the counting mode must match the hash.")
+		("per_file", po::bool_switch(&per_file)->default_value(false),
+		"As well as the histogram for all the input, create a histogram for each input file.  The input is still only read once.  Output files have \"-group<N>\" appended to the output prefix, where N is the position of the file in the input list.")
+		("groups", po::value<string>(&groups)->default_value(""),
+		"Like --per_file, but assigns the input files to groups, e.g. one per lane or library, and creates a histogram for each group.  Takes a comma separated list of group numbers, with one entry for each input file (e.g. 1,1,2,2).  Groups must be numbered contiguously from 1.")
+		("snapshot_interval", po::value<uint32_t>(&snapshot_interval)->default_value(0),
+		"Online mode.  While counting, write a snapshot of the histogram every this many seconds, to \"<output_prefix>.snapshot-<seconds>s\".  Counting carries on while snapshots are taken, so they are approximate.  Useful for watching the spectrum converge while reading from a pipe (e.g. /dev/stdin) that is still being written.  0 (default) disables snapshots.")
+		("approx_mem", po::value<uint64_t>(&approx_mem)->default_value(0),
+		"Count K-mers approximately, using a count-min sketch of at most this many MB instead of a hash.  Memory usage is then fixed regardless of the input size, at the cost of overestimating some counts.  The histogram is flagged as approximate and the error bounds are reported in its metadata.  Overestimated K-mers fall into too high a bin, and the histogram is scaled so that its total matches the estimated number of distinct K-mers.  The input must be sequence files, which are read twice.  0 (default) counts K-mers exactly.")
 		("output_type,p", po::value<string>(&plot_output_type)->default_value(DEFAULT_HIST_PLOT_OUTPUT_TYPE),
 		"The plot file type to create: png, ps, pdf.")
 		("verbose,v", po::bool_switch(&verbose)->default_value(false),
@@ -336,6 +627,25 @@ int kat::Histogram::main(int argc, char *argv[]) {
 	boost::split(d1_5ptrim_strs, trim5p, boost::is_any_of(","));
 	for (auto& v : d1_5ptrim_strs) d1_5ptrim_vals.push_back(boost::lexical_cast<uint16_t>(v));
 
+	vector<string> mer_len_strs;
+	vector<uint16_t> mer_len_vals;
+	boost::split(mer_len_strs, mer_len, boost::is_any_of(","));
+	for (auto& v : mer_len_strs) mer_len_vals.push_back(boost::lexical_cast<uint16_t>(v));
+
+	vector<uint16_t> group_vals;
+	if (!groups.empty()) {
+		vector<string> group_strs;
+		boost::split(group_strs, groups, boost::is_any_of(","));
+		for (auto& v : group_strs) {
+			uint16_t g = boost::lexical_cast<uint16_t>(v);
+			if (g == 0) {
+				BOOST_THROW_EXCEPTION(HistogramException() << HistogramErrorInfo(string(
+					"Group numbers must start from 1")));
+			}
+			group_vals.push_back(g - 1);
+		}
+	}
+
 
 	auto_cpu_timer timer(1, "KAT HIST completed.\nTotal runtime: %ws\n\n");
 
@@ -348,9 +658,18 @@ int kat::Histogram::main(int argc, char *argv[]) {
 	histo.setThreads(threads);
 	histo.setTrim(d1_5ptrim_vals);
 	histo.setCanonical(!non_canonical);
-	histo.setMerLen(mer_len);
+	histo.setMerLens(mer_len_vals);
 	histo.setHashSize(hash_size);
 	histo.setDumpHash(dump_hash);
+	histo.setSeedHash(seed_hash);
+	histo.setApproxMemory(approx_mem * 1024 * 1024);
+	histo.setSnapshotInterval(snapshot_interval);
+	if (!group_vals.empty()) {
+		histo.setFileGroups(group_vals);
+	}
+	else if (per_file) {
+		histo.setPerFile();
+	}
 	histo.setVerbose(verbose);
 
 	// Do the work
@@ -21,8 +21,11 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <iomanip>
+#include <sstream>
 #include <vector>
 #include <memory>
 #include <thread>
@@ -40,7 +43,14 @@ using bfs::path;
 
 #include <kat/matrix_metadata_extractor.hpp>
 #include <kat/input_handler.hpp>
+#include <kat/kmer_analysis.hpp>
+#include <kat/multi_k_counter.hpp>
+#include <kat/sketch.hpp>
 using kat::InputHandler;
+using kat::MultiKCounter;
+using kat::KCounter;
+using kat::ApproxCounter;
+using kat::MappedDump;
 
 typedef boost::error_info<struct HistogramError,string> HistogramErrorInfo;
 struct HistogramException: virtual boost::exception, virtual std::exception { };
@@ -65,6 +75,18 @@ namespace kat {
         vector<uint64_t> data;
         vector<shared_ptr<vector<uint64_t>>> threadedData;
 
+        // Multi-K mode: one histogram per K, all counted from a single pass over the input
+        vector<uint16_t> merLens;
+        vector<vector<uint64_t>> multiData;
+
+        // Group mode: extra histograms per group of input files, from the same pass
+        vector<uint16_t> fileGroups;
+
+        // Approximate mode: K-mers counted in a fixed amount of memory using a sketch
+        uint64_t approxMemory;
+        shared_ptr<ApproxCounter> approx;
+        double approxScale;     // Applied to the spectrum so its total matches the distinct K-mer estimate
+
     public:
 
         Histogram(vector<path> _inputs, uint64_t _low, uint64_t _high, uint64_t _inc);
@@ -100,6 +122,112 @@ namespace kat {
             this->input.merLen = merLen;
         }
 
+        const vector<uint16_t>& getMerLens() const {
+            return merLens;
+        }
+
+        /**
+         * Sets the K values to create histograms for.  If more than one is given, all
+         * are counted from a single pass over the input.
+         */
+        void setMerLens(const vector<uint16_t>& merLens) {
+            this->merLens = merLens;
+            this->input.merLen = merLens.empty() ? DEFAULT_MER_LEN : merLens[0];
+        }
+
+        bool isMultiK() const {
+            return merLens.size() > 1;
+        }
+
+        const vector<uint16_t>& getFileGroups() const {
+            return fileGroups;
+        }
+
+        /**
+         * Assigns each input file to a group, numbered from 0.  A histogram is then
+         * created for each group as well as for all the input.  Empty disables grouping.
+         */
+        void setFileGroups(const vector<uint16_t>& fileGroups) {
+            this->fileGroups = fileGroups;
+        }
+
+        /**
+         * Puts each input file in its own group
+         */
+        void setPerFile() {
+            fileGroups.clear();
+            for (size_t i = 0; i < input.input.size(); i++) {
+                fileGroups.push_back(i);
+            }
+        }
+
+        bool isGrouped() const {
+            return !fileGroups.empty();
+        }
+
+        size_t nbGroups() const {
+            return isGrouped() ? *std::max_element(fileGroups.begin(), fileGroups.end()) + 1 : 0;
+        }
+
+        /**
+         * Histograms are ordered by K value, and for each K the merged histogram
+         * comes first, followed by one for each group
+         */
+        size_t nbHists() const {
+            return (isMultiK() ? merLens.size() : 1) * (1 + nbGroups());
+        }
+
+        /**
+         * Path of the index'th histogram.  In multi-K mode the K value is appended to
+         * the output prefix, and in group mode the group number, from 1.
+         */
+        path getHistPath(size_t index) const {
+            const size_t group = index % (1 + nbGroups());
+            string p = outputPrefix.string();
+            if (isMultiK())
+                p += "-k" + lexical_cast<string>(merLens[index / (1 + nbGroups())]);
+            if (group > 0)
+                p += "-group" + lexical_cast<string>(group);
+            return path(p);
+        }
+
+        uint64_t getApproxMemory() const {
+            return approxMemory;
+        }
+
+        /**
+         * Count K-mers approximately using a sketch of at most this many bytes,
+         * rather than with an exact hash.  0 counts exactly.
+         */
+        void setApproxMemory(uint64_t approxMemory) {
+            this->approxMemory = approxMemory;
+        }
+
+        bool isApprox() const {
+            return approxMemory > 0;
+        }
+
+        uint32_t getSnapshotInterval() const {
+            return input.snapshotInterval;
+        }
+
+        /**
+         * Online mode: while counting, write a snapshot of the histogram every this
+         * many seconds.  0 disables snapshots.
+         */
+        void setSnapshotInterval(uint32_t snapshotInterval) {
+            this->input.snapshotInterval = snapshotInterval;
+        }
+
+        /**
+         * Path of the snapshot taken after the given number of seconds
+         */
+        path getSnapshotPath(uint64_t elapsed) const {
+            std::ostringstream ss;
+            ss << outputPrefix.string() << ".snapshot-" << std::setw(6) << std::setfill('0') << elapsed << "s";
+            return path(ss.str());
+        }
+
         path getOutputPrefix() const {
             return outputPrefix;
         }
@@ -148,6 +276,16 @@ namespace kat {
             this->input.dumpHash = dumpHash;
         }
 
+        /**
+         * Adds the counts from an existing dump, e.g. from a previous run over the
+         * rest of the project, to those counted from the input.  The combined hash
+         * is dumped so it can seed the next run.
+         */
+        void setSeedHash(const path& seedHash) {
+            this->input.seedHash = seedHash;
+            this->input.dumpHash = this->input.dumpHash || !seedHash.empty();
+        }
+
 
         bool isVerbose() const {
             return verbose;
@@ -162,6 +300,8 @@ namespace kat {
 
         void print(std::ostream &out);
 
+        void print(std::ostream &out, size_t index);
+
         void save();
 
         void plot(const string& output_type);
@@ -170,11 +310,11 @@ namespace kat {
     protected:
 
         uint64_t calcBase() {
-            return low > 1 ? (1 >= low ? 1 : low - 1) : 1;
+            return SpectrumAnalysis::calcBase(low);
         }
 
         uint64_t calcCeil() {
-            return high + 1;
+            return SpectrumAnalysis::calcCeil(high);
         }
 
         void merge();
@@ -183,6 +323,31 @@ namespace kat {
 
         void binSlice(int th_id);
 
+        // Bins counts straight from a jellyfish dump, without loading it into a hash
+        void binDump();
+
+        void binDumpSlice(const MappedDump& dump, int th_id);
+
+        // Counts K-mers for all K values and groups in a single pass, then bins each
+        void countMultiK();
+
+        void binCounter(const KCounter& counter, vector<uint64_t>& hist);
+
+        // Bins the live hash while it's being counted, returning a function which
+        // writes the snapshot to disk
+        function<void()> snapshot(const LargeHashArray& ary, uint64_t elapsed);
+
+        void writeSnapshot(const vector<uint64_t>& hist, uint64_t elapsed);
+
+        // Counts K-mers into a sketch, then builds the histogram from a second pass
+        void countApprox();
+
+        void print(std::ostream &out, uint16_t merLen, const vector<uint64_t>& hist, const vector<path>& files);
+
+        inline uint64_t bucket(const uint64_t val) const {
+            return SpectrumAnalysis::bucket(val, base, ceil, inc);
+        }
+
         static string helpMessage(){
 
             return string("Usage: kat hist [options] (<input>)+\n\n") +
@@ -48,14 +48,18 @@ using kat::KatFS;
 #include "gcp.hpp"
 #include "histogram.hpp"
 #include "plot.hpp"
+#include "qc.hpp"
 #include "sect.hpp"
+#include "top.hpp"
 #include "cold.hpp"
 using kat::Comp;
 using kat::Filter;
 using kat::Gcp;
 using kat::Histogram;
 using kat::Plot;
+using kat::Qc;
 using kat::Sect;
+using kat::Top;
 using kat::Cold;
 
 
@@ -73,7 +77,9 @@ enum Mode {
     GCP,
     HIST,
     PLOT,
+    QC,
     SECT,
+    TOP,
     COLD
 };
 
@@ -98,9 +104,15 @@ Mode parseMode(string mode) {
         return PLOT;
     }
 #endif
+    else if (upperMode == string("QC")) {
+        return QC;
+    }
     else if (upperMode == string("SECT")) {
         return SECT;
     }
+    else if (upperMode == string("TOP")) {
+        return TOP;
+    }
     else if (upperMode == string("COLD")) {
         return COLD;
     }
@@ -126,6 +138,10 @@ const string helpMessage() {
                    "   * cold:   Given, reads and an assembly, calculates both the read and assembly K-mer\n" \
                    "             coverage along with GC% for each sequence in the assembly.\n" \
                    "             a file using K-mers from another sequence file.\n" \
+                   "   * qc:     Runs several K-mer analyses (spectrum, GC vs coverage, filter bounds and most\n" \
+                   "             abundant K-mers) in a single pass over a hash or sequence files.\n" \
+                   "   * top:    Lists the most abundant K-mers, along with their GC content, from a hash or\n" \
+                   "             sequence files.\n" \
                    "   * filter: Filtering tools.  Contains tools for filtering k-mers and sequences based on\n" \
                    "             user-defined GC and coverage limits.\n" \
                    "   * plot:   Plotting tools.  Contains several plotting tools to visualise K-mer and compare\n" \
@@ -146,6 +162,10 @@ const string helpMessage() {
                    "   * cold:   Given, reads and an assembly, calculates both the read and assembly K-mer\n" \
                    "             coverage along with GC% for each sequence in the assembly.\n" \
                    "             a file using K-mers from another sequence file.\n" \
+                   "   * qc:     Runs several K-mer analyses (spectrum, GC vs coverage, filter bounds and most\n" \
+                   "             abundant K-mers) in a single pass over a hash or sequence files.\n" \
+                   "   * top:    Lists the most abundant K-mers, along with their GC content, from a hash or\n" \
+                   "             sequence files.\n" \
                    "   * filter: Filtering tools.  Contains tools for filtering k-mers and sequences based on\n" \
                    "             user-defined GC and coverage limits.\n\n" \
                    "Options";
@@ -272,9 +292,15 @@ int main(int argc, char *argv[])
             case PLOT:
                 Plot::main(modeArgC, modeArgV);
                 break;
+            case QC:
+                Qc::main(modeArgC, modeArgV);
+                break;
             case SECT:
                 Sect::main(modeArgC, modeArgV);
                 break;
+            case TOP:
+                Top::main(modeArgC, modeArgV);
+                break;
             case COLD:
                 Cold::main(modeArgC, modeArgV);
                 break;
@@ -0,0 +1,423 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdint.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <sys/ioctl.h>
+using std::cout;
+using std::endl;
+using std::make_shared;
+using std::ofstream;
+using std::ostream;
+using std::vector;
+
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/program_options/parsers.hpp>
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/positional_options.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <boost/timer/timer.hpp>
+namespace po = boost::program_options;
+using boost::lexical_cast;
+using boost::timer::auto_cpu_timer;
+
+#include <kat/jellyfish_helper.hpp>
+#include <kat/kat_fs.hpp>
+#include <kat/matrix_metadata_extractor.hpp>
+using kat::JellyfishHelper;
+using kat::KatFS;
+using kat::MappedDump;
+
+#include "plot.hpp"
+using kat::Plot;
+
+#include "top.hpp"
+using kat::Top;
+
+#include "qc.hpp"
+
+kat::Qc::Qc(const vector<path>& _inputs) {
+
+    input.setMultipleInputs(_inputs);
+    input.index = 1;
+    outputPrefix = "kat-qc";
+    threads = 1;
+    verbose = false;
+    setAnalyses(DEFAULT_QC_ANALYSES);
+    low = 1;
+    high = 10000;
+    inc = 1;
+    cvgScale = 1.0;
+    cvgBins = 1000;
+    lowCount = 1;
+    highCount = 10000;
+    lowGC = 1;
+    highGC = 100;
+    topN = 100;
+    merLen = 0;
+}
+
+void kat::Qc::setAnalyses(const string& _analyses) {
+
+    vector<string> names;
+    boost::split(names, _analyses, boost::is_any_of(","));
+
+    analyses.clear();
+    for (auto& n : names) {
+        const string name = boost::to_lower_copy(boost::trim_copy(n));
+        if (name.empty()) continue;
+        if (name != "hist" && name != "gcp" && name != "bounds" && name != "top") {
+            BOOST_THROW_EXCEPTION(QcException() << QcErrorInfo(string(
+                    "Unknown analysis: ") + name + ".  Valid analyses are hist, gcp, bounds and top."));
+        }
+        analyses.push_back(name);
+    }
+
+    if (analyses.empty()) {
+        BOOST_THROW_EXCEPTION(QcException() << QcErrorInfo(string(
+                "No analyses requested")));
+    }
+}
+
+bool kat::Qc::wanted(const string& analysis) const {
+    return std::find(analyses.begin(), analyses.end(), analysis) != analyses.end();
+}
+
+void kat::Qc::execute() {
+
+    // Validate input
+    input.validateInput();
+
+    // Create output directory
+    path parentDir = bfs::absolute(outputPrefix).parent_path();
+    KatFS::ensureDirectoryExists(parentDir);
+
+    AnalysisEngine engine;
+    if (wanted("hist")) {
+        spectrum = make_shared<SpectrumAnalysis>(low, high, inc);
+        engine.add(spectrum);
+    }
+    if (wanted("gcp")) {
+        gcp = make_shared<GcpAnalysis>(cvgBins, cvgScale);
+        engine.add(gcp);
+    }
+    if (wanted("bounds")) {
+        bounds = make_shared<BoundsAnalysis>(lowCount, highCount, lowGC, highGC);
+        engine.add(bounds);
+    }
+    if (wanted("top")) {
+        top = make_shared<TopAnalysis>(topN);
+        engine.add(top);
+    }
+
+    if (input.mode == InputHandler::InputMode::COUNT) {
+
+        input.count(threads);
+        merLen = input.merLen;
+
+        auto_cpu_timer timer(1, "  Time taken: %ws\n\n");
+        cout << "Analysing kmers in hash ...";
+        cout.flush();
+
+        engine.run(*input.hash, merLen, threads);
+    }
+    else {
+
+        auto_cpu_timer timer(1, "  Time taken: %ws\n\n");
+        cout << "Analysing kmers in " << input.pathString() << " ...";
+        cout.flush();
+
+        // No need to load the hash, as every K-mer is only visited once
+        MappedDump dump(input.getSingleInput());
+        merLen = dump.getMerLen();
+        input.merLen = merLen;
+
+        engine.run(dump, threads);
+    }
+
+    cout << " done.";
+    cout.flush();
+}
+
+void kat::Qc::printHist(ostream& out) {
+
+    out << mme::KEY_TITLE << merLen << "-mer spectra for: " << input.fileName() << endl;
+    out << mme::KEY_X_LABEL << merLen << "-mer frequency" << endl;
+    out << mme::KEY_Y_LABEL << "# distinct " << merLen << "-mers" << endl;
+    out << mme::KEY_KMER << merLen << endl;
+    out << mme::KEY_INPUT_1 << input.pathString() << endl;
+    out << mme::MX_META_END << endl;
+
+    const vector<uint64_t>& hist = spectrum->getHistogram();
+    uint64_t col = spectrum->getBase();
+    for (size_t i = 0; i < hist.size(); i++, col += spectrum->getInc()) {
+        out << col << " " << hist[i] << "\n";
+    }
+}
+
+void kat::Qc::printGcp(ostream& out) {
+
+    const SM64& mx = gcp->getMatrix();
+
+    out << mme::KEY_TITLE << "K-mer coverage vs GC count plot for: " << input.fileName() << endl;
+    out << mme::KEY_X_LABEL << merLen << "-mer frequency" << endl;
+    out << mme::KEY_Y_LABEL << "GC count" << endl;
+    out << mme::KEY_Z_LABEL << "# distinct " << merLen << "-mers" << endl;
+    out << mme::KEY_NB_COLUMNS << mx.height() << endl;
+    out << mme::KEY_NB_ROWS << mx.width() << endl;
+    out << mme::KEY_MAX_VAL << mx.getMaxVal() << endl;
+    out << mme::KEY_TRANSPOSE << "0" << endl;
+    out << mme::KEY_KMER << merLen << endl;
+    out << mme::KEY_INPUT_1 << input.pathString() << endl;
+    out << mme::MX_META_END << endl;
+
+    mx.printMatrix(out);
+}
+
+void kat::Qc::printBounds(ostream& out) {
+
+    const BoundsAnalysis::Counts& all = bounds->getAll();
+    const BoundsAnalysis::Counts& in = bounds->getIn();
+    const BoundsAnalysis::Counts& out_ = bounds->getOut();
+
+    out << "Input: " << input.pathString() << endl
+        << "K: " << merLen << endl
+        << "Coverage bounds: " << bounds->getLowCount() << "-" << bounds->getHighCount() << endl
+        << "GC bounds: " << bounds->getLowGC() << "-" << bounds->getHighGC() << endl
+        << endl
+        << "\tDistinct\tTotal" << endl
+        << "All\t" << all.distinct << "\t" << all.total << endl
+        << "In bounds\t" << in.distinct << "\t" << in.total << endl
+        << "Out of bounds\t" << out_.distinct << "\t" << out_.total << endl;
+}
+
+void kat::Qc::printTop(ostream& out) {
+    Top::print(out, merLen, top->getTop());
+}
+
+void kat::Qc::save() {
+
+    auto_cpu_timer timer(1, "  Time taken: %ws\n\n");
+
+    cout << "Saving results to disk ...";
+    cout.flush();
+
+    if (spectrum) {
+        ofstream out(outputPrefix.string() + ".hist");
+        printHist(out);
+    }
+    if (gcp) {
+        ofstream out(outputPrefix.string() + "-gcp.mx");
+        printGcp(out);
+    }
+    if (bounds) {
+        ofstream out(outputPrefix.string() + ".bounds");
+        printBounds(out);
+    }
+    if (top) {
+        ofstream out(outputPrefix.string() + ".top");
+        printTop(out);
+    }
+
+    cout << " done.";
+    cout.flush();
+}
+
+void kat::Qc::plot(const string& output_type) {
+
+#ifdef HAVE_PYTHON
+    auto_cpu_timer timer(1, "  Time taken: %ws\n\n");
+
+    cout << "Creating plots ...";
+    cout.flush();
+
+    if (spectrum) {
+        const string hist = outputPrefix.string() + ".hist";
+        vector<string> args;
+        args.push_back("kat/plot/spectra-hist.py");
+        args.push_back(string("--output=") + hist + "." + output_type);
+        if (verbose) {
+            args.push_back("--verbose");
+        }
+        args.push_back(hist);
+        Plot::executePythonPlot(Plot::PlotMode::SPECTRA_HIST, args);
+    }
+
+    if (gcp) {
+        const string mx = outputPrefix.string() + "-gcp.mx";
+        vector<string> args;
+        args.push_back("plot/density.py");
+        args.push_back(string("--output=") + mx + "." + output_type);
+        if (verbose) {
+            args.push_back("--verbose");
+        }
+        args.push_back(mx);
+        Plot::executePythonPlot(Plot::PlotMode::DENSITY, args);
+    }
+
+    cout << " done.";
+    cout.flush();
+#endif
+}
+
+int kat::Qc::main(int argc, char *argv[]) {
+
+    vector<path>    inputs;
+    path            output_prefix;
+    uint16_t        threads;
+    string          analyses;
+    uint64_t        low;
+    uint64_t        high;
+    uint64_t        inc;
+    double          cvg_scale;
+    uint16_t        cvg_bins;
+    uint64_t        low_count;
+    uint64_t        high_count;
+    uint16_t        low_gc;
+    uint16_t        high_gc;
+    size_t          top;
+    string          trim5p;
+    bool            non_canonical;
+    uint16_t        mer_len;
+    uint64_t        hash_size;
+    string          plot_output_type;
+    bool            verbose;
+    bool            help;
+
+    struct winsize w;
+    ioctl(STDOUT_FILENO, TIOCGWINSZ, &w);
+
+
+    // Declare the supported options.
+    po::options_description generic_options(Qc::helpMessage(), w.ws_col);
+    generic_options.add_options()
+            ("output_prefix,o", po::value<path>(&output_prefix)->default_value(path("kat-qc")),
+                "Path prefix for files generated by this program.")
+            ("threads,t", po::value<uint16_t>(&threads)->default_value(1),
+                "The number of threads to use")
+            ("analyses,a", po::value<string>(&analyses)->default_value(DEFAULT_QC_ANALYSES),
+                "Comma separated list of analyses to run.  \"hist\" writes the K-mer spectrum to <output_prefix>.hist, \"gcp\" writes the GC vs coverage matrix to <output_prefix>-gcp.mx, \"bounds\" writes the number of K-mers within the coverage and GC bounds to <output_prefix>.bounds and \"top\" writes the most abundant K-mers to <output_prefix>.top.")
+            ("low,l", po::value<uint64_t>(&low)->default_value(1),
+                "Low count value of histogram")
+            ("high,h", po::value<uint64_t>(&high)->default_value(10000),
+                "High count value of histogram")
+            ("inc,i", po::value<uint64_t>(&inc)->default_value(1),
+                "Increment for each bin")
+            ("cvg_scale,x", po::value<double>(&cvg_scale)->default_value(1.0),
+                "Scaling factor for the coverage axis of the GC vs coverage matrix.")
+            ("cvg_bins,y", po::value<uint16_t>(&cvg_bins)->default_value(1000),
+                "Number of bins for the cvg data when creating the GC vs coverage matrix.")
+            ("low_count", po::value<uint64_t>(&low_count)->default_value(1),
+                "Low count threshold for the bounds analysis")
+            ("high_count", po::value<uint64_t>(&high_count)->default_value(10000),
+                "High count threshold for the bounds analysis")
+            ("low_gc", po::value<uint16_t>(&low_gc)->default_value(1),
+                "Low GC count threshold for the bounds analysis")
+            ("high_gc", po::value<uint16_t>(&high_gc)->default_value(100),
+                "High GC count threshold for the bounds analysis")
+            ("top", po::value<size_t>(&top)->default_value(100),
+                "Number of most abundant K-mers to report")
+            ("5ptrim", po::value<string>(&trim5p)->default_value("0"),
+                "Ignore the first X bases from reads.  If more that one file is provided you can specify different values for each file by seperating with commas.")
+            ("non_canonical,N", po::bool_switch(&non_canonical)->default_value(false),
+                "If counting fast(a/q), store explicit kmer as found.  By default, we store 'canonical' k-mers, which means we count both strands.")
+            ("mer_len,m", po::value<uint16_t>(&mer_len)->default_value(DEFAULT_MER_LEN),
+                "The kmer length to use in the kmer hashes.  Larger values will provide more discriminating power between kmers but at the expense of additional memory and lower coverage.")
+            ("hash_size,H", po::value<uint64_t>(&hash_size)->default_value(DEFAULT_HASH_SIZE),
+                "If kmer counting is required for the input, then use this value as the hash size.  If this hash size is not large enough for your dataset then the default behaviour is to double the size of the hash and recount, which will increase runtime and memory usage.")
+            ("output_type,p", po::value<string>(&plot_output_type)->default_value(DEFAULT_QC_PLOT_OUTPUT_TYPE),
+                "The plot file type to create: png, ps, pdf.")
+            ("verbose,v", po::bool_switch(&verbose)->default_value(false),
+                "Print extra information.")
+            ("help", po::bool_switch(&help)->default_value(false), "Produce help message.")
+            ;
+
+    // Hidden options, will be allowed both on command line and
+    // in config file, but will not be shown to the user.
+    po::options_description hidden_options("Hidden options");
+    hidden_options.add_options()
+            ("inputs", po::value<std::vector<path>>(&inputs), "Path to the input file(s) to process.")
+            ;
+
+    // Positional option for the input bam file
+    po::positional_options_description p;
+    p.add("inputs", -1);
+
+    // Combine non-positional options
+    po::options_description cmdline_options;
+    cmdline_options.add(generic_options).add(hidden_options);
+
+    // Parse command line
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(cmdline_options).positional(p).run(), vm);
+    po::notify(vm);
+
+    // Output help information the exit if requested
+    if (help || argc <= 1) {
+        cout << generic_options << endl;
+        return 1;
+    }
+
+    vector<string> d1_5ptrim_strs;
+    vector<uint16_t> d1_5ptrim_vals;
+    boost::split(d1_5ptrim_strs,trim5p,boost::is_any_of(","));
+    for (auto& v : d1_5ptrim_strs) d1_5ptrim_vals.push_back(boost::lexical_cast<uint16_t>(v));
+
+    auto_cpu_timer timer(1, "KAT QC completed.\nTotal runtime: %ws\n\n");
+
+    cout << "Running KAT in QC mode" << endl
+         << "----------------------" << endl << endl;
+
+    Qc qc(inputs);
+    qc.setThreads(threads);
+    qc.setCanonical(!non_canonical);
+    qc.setTrim(d1_5ptrim_vals);
+    qc.setHashSize(hash_size);
+    qc.setMerLen(mer_len);
+    qc.setOutputPrefix(output_prefix);
+    qc.setAnalyses(analyses);
+    qc.setSpectrumRange(low, high, inc);
+    qc.setCvgScale(cvg_scale);
+    qc.setCvgBins(cvg_bins);
+    qc.setBounds(low_count, high_count, low_gc, high_gc);
+    qc.setTopN(top);
+    qc.setVerbose(verbose);
+
+    // Do the work
+    qc.execute();
+
+    // Save results
+    qc.save();
+
+#ifdef HAVE_PYTHON
+
+    // Plot results
+    qc.plot(plot_output_type);
+
+#endif
+
+    return 0;
+}
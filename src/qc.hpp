@@ -0,0 +1,196 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#pragma once
+
+#include <stdint.h>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+using std::ostream;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+#include <boost/exception/exception.hpp>
+#include <boost/exception/info.hpp>
+#include <boost/filesystem/path.hpp>
+namespace bfs = boost::filesystem;
+using bfs::path;
+
+#include <kat/input_handler.hpp>
+#include <kat/kmer_analysis.hpp>
+using kat::InputHandler;
+using kat::AnalysisEngine;
+using kat::SpectrumAnalysis;
+using kat::GcpAnalysis;
+using kat::BoundsAnalysis;
+using kat::TopAnalysis;
+
+typedef boost::error_info<struct QcError,string> QcErrorInfo;
+struct QcException: virtual boost::exception, virtual std::exception { };
+
+
+namespace kat {
+
+    const string     DEFAULT_QC_ANALYSES       = "hist,gcp,bounds,top";
+    const string     DEFAULT_QC_PLOT_OUTPUT_TYPE = "png";
+
+    /**
+     * Runs any combination of the spectrum, GC vs coverage, filter bounds and top
+     * K-mer analyses from a single pass over the K-mers.  A jellyfish dump is streamed
+     * straight from disk without being loaded into a hash.
+     */
+    class Qc {
+    private:
+
+        // Input args
+        InputHandler    input;
+        path            outputPrefix;
+        uint16_t        threads;
+        bool            verbose;
+
+        // Analysis args
+        vector<string>  analyses;
+        uint64_t        low;
+        uint64_t        high;
+        uint64_t        inc;
+        double          cvgScale;
+        uint16_t        cvgBins;
+        uint64_t        lowCount;
+        uint64_t        highCount;
+        uint16_t        lowGC;
+        uint16_t        highGC;
+        size_t          topN;
+
+        // Results
+        uint16_t        merLen;
+        shared_ptr<SpectrumAnalysis> spectrum;
+        shared_ptr<GcpAnalysis> gcp;
+        shared_ptr<BoundsAnalysis> bounds;
+        shared_ptr<TopAnalysis> top;
+
+    public:
+
+        Qc(const vector<path>& _inputs);
+
+        virtual ~Qc() {
+        }
+
+        void setTrim(const vector<uint16_t>& _5ptrim) {
+            this->input.set5pTrim(_5ptrim);
+        }
+
+        void setCanonical(bool canonical) {
+            this->input.canonical = canonical;
+        }
+
+        void setHashSize(uint64_t hashSize) {
+            this->input.hashSize = hashSize;
+        }
+
+        uint16_t getMerLen() const {
+            return merLen;
+        }
+
+        void setMerLen(uint16_t merLen) {
+            this->input.merLen = merLen;
+        }
+
+        path getOutputPrefix() const {
+            return outputPrefix;
+        }
+
+        void setOutputPrefix(path outputPrefix) {
+            this->outputPrefix = outputPrefix;
+        }
+
+        void setThreads(uint16_t threads) {
+            this->threads = threads;
+        }
+
+        void setVerbose(bool verbose) {
+            this->verbose = verbose;
+        }
+
+        /**
+         * Comma separated list of analyses to run, from "hist", "gcp", "bounds" and "top"
+         */
+        void setAnalyses(const string& analyses);
+
+        void setSpectrumRange(uint64_t low, uint64_t high, uint64_t inc) {
+            this->low = low;
+            this->high = high;
+            this->inc = inc;
+        }
+
+        void setCvgScale(double cvgScale) {
+            this->cvgScale = cvgScale;
+        }
+
+        void setCvgBins(uint16_t cvgBins) {
+            this->cvgBins = cvgBins;
+        }
+
+        void setBounds(uint64_t lowCount, uint64_t highCount, uint16_t lowGC, uint16_t highGC) {
+            this->lowCount = lowCount;
+            this->highCount = highCount;
+            this->lowGC = lowGC;
+            this->highGC = highGC;
+        }
+
+        void setTopN(size_t topN) {
+            this->topN = topN;
+        }
+
+        shared_ptr<SpectrumAnalysis> getSpectrum() const { return spectrum; }
+        shared_ptr<GcpAnalysis> getGcp() const { return gcp; }
+        shared_ptr<BoundsAnalysis> getBounds() const { return bounds; }
+        shared_ptr<TopAnalysis> getTop() const { return top; }
+
+        void execute();
+
+        void printHist(ostream& out);
+        void printGcp(ostream& out);
+        void printBounds(ostream& out);
+        void printTop(ostream& out);
+
+        void save();
+
+        void plot(const string& output_type);
+
+    protected:
+
+        bool wanted(const string& analysis) const;
+
+        static const string helpMessage() {
+             return string("Usage: kat qc [options] (<input>)+\n\n") +
+                            "Runs several K-mer analyses in a single pass.\n\n" +
+                            "Takes either a jellyfish hash or one or more FastA or FastQ files.  Sequence files are counted " \
+                            "first, whereas hashes are read straight from disk without being loaded.  Each K-mer is then visited " \
+                            "once, with its GC count computed a single time, and passed to every requested analysis: the K-mer " \
+                            "spectrum (as \"kat hist\"), the GC vs coverage matrix (as \"kat gcp\"), the number of K-mers within " \
+                            "filter bounds (as \"kat filter kmer\") and the most abundant K-mers.\n\n" \
+                            "Options";
+        }
+
+    public:
+
+        static int main(int argc, char *argv[]);
+    };
+}
@@ -25,6 +25,7 @@
 #include <vector>
 #include <math.h>
 #include <memory>
+#include <sstream>
 #include <thread>
 #include <sys/ioctl.h>
 using std::vector;
@@ -62,9 +63,16 @@ using kat::KatFS;
 
 #include "sect.hpp"
 
-kat::Sect::Sect(const vector<path> _counts_files, const path _seq_file) {
-    input.setMultipleInputs(_counts_files);
-    input.index = 1;
+kat::Sect::Sect(const vector<path> _counts_files, const path _seq_file) :
+    Sect(vector<vector<path>>(1, _counts_files), _seq_file) {
+}
+
+kat::Sect::Sect(const vector<vector<path>> _samples, const path _seq_file) {
+    input.resize(_samples.size());
+    for (size_t i = 0; i < _samples.size(); i++) {
+        input[i].setMultipleInputs(_samples[i]);
+        input[i].index = i + 1;
+    }
     seqFile = _seq_file;
     outputPrefix = "kat-sect";
     gcBins = 1001;
@@ -72,9 +80,13 @@ kat::Sect::Sect(const vector<path> _counts_files, const path _seq_file) {
     cvgLogscale = false;
     threads = 1;
     noCountStats = false;
+    binaryCounts = false;
     outputGCStats = false;
     extractNR = false;
     extractR = false;
+    binaryMx = false;
+    windowSize = 0;
+    windowStep = 0;
     minRepeat = 2;
     maxRepeat = 0;
     verbose = false;
@@ -89,23 +101,39 @@ void kat::Sect::execute() {
                 "Could not find sequence file at: " + seqFile.string() + "; please check the path and try again.")));
     }
 
-    bucket_size = BATCH_SIZE / threads;
-    remaining = BATCH_SIZE % (bucket_size < 1 ? 1 : threads);
+    if (input.empty()) {
+        BOOST_THROW_EXCEPTION(SectException() << SectErrorInfo(string(
+                "No K-mer counts inputs were provided.")));
+    }
 
     // Validate input
-    input.validateInput();
+    for(auto& i : input) {
+        i.validateInput();
+    }
 
     // Create output directory
     path parentDir = bfs::absolute(outputPrefix).parent_path();
     KatFS::ensureDirectoryExists(parentDir);
 
     // Either count or load input
-    if (input.mode == InputHandler::InputHandler::InputMode::COUNT) {
-        input.count(threads);
+    for(auto& i : input) {
+        if (i.mode == InputHandler::InputHandler::InputMode::COUNT) {
+            i.count(threads);
+        }
+        else {
+            i.loadHeader();
+            i.loadHash();
+        }
     }
-    else {
-        input.loadHeader();
-        input.loadHash();
+
+    // Every K-mer from the sequence file is looked up in all samples, so they must share a K-mer length
+    for(auto& i : input) {
+        if (i.merLen != input[0].merLen) {
+            BOOST_THROW_EXCEPTION(SectException() << SectErrorInfo(string(
+                "Cannot process samples with different K-mer lengths.  Sample 1 has K=") +
+                lexical_cast<string>(input[0].merLen) + " but sample " + lexical_cast<string>(i.index) +
+                " has K=" + lexical_cast<string>(i.merLen)));
+        }
     }
 
     contamination_mx = make_shared<ThreadedSparseMatrix>(gcBins, cvgBins, threads);
@@ -115,9 +143,10 @@ void kat::Sect::execute() {
 
     // Dump any hashes that were previously counted to disk if requested
     // NOTE: MUST BE DONE AFTER COMPARISON AS THIS CLEARS ENTRIES FROM HASH ARRAY!
-    if (input.dumpHash) {
-        path outputPath(outputPrefix.string() + "-hash.jf" + lexical_cast<string>(input.merLen));
-        input.dump(outputPath, threads);
+    for (size_t s = 0; s < input.size(); s++) {
+        if (input[s].dumpHash) {
+            input[s].dump(samplePath("hash", ".jf" + lexical_cast<string>(input[s].merLen), s), threads);
+        }
     }
 
     // Merge results from contamination matrix
@@ -132,9 +161,17 @@ void kat::Sect::save() {
     cout.flush();
 
     // Send contamination matrix to file
-    ofstream contamination_mx_stream(string(outputPrefix.string() + "-contamination.mx").c_str());
-    printContaminationMatrix(contamination_mx_stream, seqFile);
-    contamination_mx_stream.close();
+    path mx_path(outputPrefix.string() + "-contamination.mx");
+    if (binaryMx) {
+        stringstream header;
+        printContaminationMatrixHeader(header, seqFile);
+        contamination_mx->getFinalMatrix().saveBinary(mx_path, header.str());
+    }
+    else {
+        ofstream contamination_mx_stream(mx_path.c_str());
+        printContaminationMatrix(contamination_mx_stream, seqFile);
+        contamination_mx_stream.close();
+    }
 
     cout << " done.";
     cout.flush();
@@ -147,16 +184,6 @@ void kat::Sect::processSeqFile() {
     cout << "Calculating kmer coverage across sequences ...";
     cout.flush();
 
-    // Setup space for storing output
-    offset = 0;
-    recordsInBatch = 0;
-
-    names = seqan::StringSet<seqan::CharString>();
-    seqs = seqan::StringSet<seqan::CharString>();
-
-    // Open file, create RecordReader and check all is well
-    seqan::SeqFileIn reader(seqFile.c_str());
-
     // Setup output stream for jellyfish initialisation
     std::ostream* out_stream = verbose ? &cerr : (std::ostream*)0;
 
@@ -165,90 +192,122 @@ void kat::Sect::processSeqFile() {
     if (verbose)
         *out_stream << endl;
 
-    // Sequence K-mer counts output stream
-    shared_ptr<ofstream> count_path_stream = nullptr;
+    // Use a .2bit file or a FastA index if possible, so that workers can load their
+    // own records and the reader isn't a bottleneck.  Otherwise fall back to
+    // reading the file sequentially.
+    shared_ptr<SequenceIndex> index = nullptr;
+    try {
+        index = SequenceIndex::open(seqFile);
+    }
+    catch(FastaIndexException& e) {
+        if (verbose)
+            *out_stream << "Reading sequence file sequentially: " << *boost::get_error_info<FastaIndexErrorInfo>(e) << endl;
+    }
+    SequenceBatchReader batches(index, seqFile);
+
+    // Batches are read, processed and written out concurrently.  Each worker takes a
+    // whole batch, and every output file has its own writer, which sees batches in
+    // the same order as the sequence file.  Limiting the number of batches in flight
+    // bounds memory usage.
+    Pipeline<SeqBatch> pipeline(threads, 2 * threads + 2);
+    chunks = make_shared<ChunkPool>();
+    pipeline.setChunkPool(chunks);
+
+    const size_t nbSamples = input.size();
+
+    // Sequence K-mer counts output streams, one for each sample
+    vector<shared_ptr<ofstream>> count_path_streams(nbSamples);
+    vector<shared_ptr<CoverageFileWriter>> count_writers(nbSamples);
     if (!noCountStats) {
-        count_path_stream = make_shared<ofstream>(string(outputPrefix.string() + "-counts.cvg").c_str());
+        for (size_t s = 0; s < nbSamples; s++) {
+            if (binaryCounts) {
+                count_writers[s] = make_shared<CoverageFileWriter>(samplePath("counts", ".cvgb", s), input[s].merLen);
+                pipeline.addWriter([&, s](const SeqBatch& b) { writeBinaryCounts(*count_writers[s], b, s); });
+            }
+            else {
+                count_path_streams[s] = make_shared<ofstream>(samplePath("counts", ".cvg", s).c_str());
+                pipeline.addWriter([&, s](const SeqBatch& b) { printCounts(*count_path_streams[s], b, s); });
+            }
+        }
     }
 
     // Sequence GC counts output stream
     shared_ptr<ofstream> gc_count_path_stream = nullptr;
     if (outputGCStats) {
         gc_count_path_stream = make_shared<ofstream>(string(outputPrefix.string() + "-counts.gc").c_str());
+        pipeline.addWriter([&](const SeqBatch& b) { printGCCounts(*gc_count_path_stream, b); });
     }
 
-    shared_ptr<ofstream> nr_path_stream = nullptr;
-    if (extractNR) {
-        nr_path_stream = make_shared<ofstream>(string(outputPrefix.string() + "-non_repetitive.fa").c_str());
-    }
-
-    shared_ptr<ofstream> r_path_stream = nullptr;
-    if (extractR) {
-        r_path_stream = make_shared<ofstream>(string(outputPrefix.string() + "-repetitive.fa").c_str());
+    vector<shared_ptr<ofstream>> nr_path_streams(nbSamples);
+    vector<shared_ptr<ofstream>> r_path_streams(nbSamples);
+    for (size_t s = 0; s < nbSamples; s++) {
+        if (extractNR) {
+            nr_path_streams[s] = make_shared<ofstream>(samplePath("non_repetitive", ".fa", s).c_str());
+            pipeline.addWriter([&, s](const SeqBatch& b) { printRegions(*nr_path_streams[s], b, s, 1, minRepeat); });
+        }
+        if (extractR) {
+            r_path_streams[s] = make_shared<ofstream>(samplePath("repetitive", ".fa", s).c_str());
+            pipeline.addWriter([&, s](const SeqBatch& b) { printRegions(*r_path_streams[s], b, s, minRepeat, maxRepeat); });
+        }
     }
 
-    // Average sequence coverage and GC% scores output stream
+    // Average sequence coverage and GC% scores output stream.  With several samples,
+    // each coverage column is repeated for each sample, suffixed with the sample number.
     ofstream cvg_gc_stream(string(outputPrefix.string() + "-stats.tsv").c_str());
-    cvg_gc_stream << "seq_name\tmedian\tmean\tgc%\tseq_length\tkmers_in_seq\tinvalid_kmers\t%_invalid\tnon_zero_kmers\t%_non_zero\t%_non_zero_corrected" << endl;
-
-    // Processes sequences in batches of records to reduce memory requirements
-    while (!seqan::atEnd(reader)) {
-        if (verbose)
-            *out_stream << "Loading Batch of sequences... ";
-
-        seqan::clear(names);
-        seqan::clear(seqs);
-
-        seqan::readRecords(names, seqs, reader, BATCH_SIZE);
-
-        recordsInBatch = seqan::length(names);
-
-        if (verbose)
-            *out_stream << "Loaded " << recordsInBatch << " records.  Processing batch... ";
-
-        // Allocate memory for output produced by this batch
-        createBatchVars(recordsInBatch);
-
-        // Process batch with worker threads
-        // Process each sequence is processed in a different thread.
-        // In each thread lookup each K-mer in the hash
-        analyseBatch();
-
-        // Output counts for this batch if (not not) requested
-        if (!noCountStats)
-            printCounts(*count_path_stream);
-
-        // Output counts for this batch if (not not) requested
-        if (outputGCStats)
-            printGCCounts(*gc_count_path_stream);
-
-        if (extractNR)
-            printRegions(*nr_path_stream, 1, minRepeat);
-
-        if (extractR)
-            printRegions(*r_path_stream, minRepeat, maxRepeat);
-
-
-        // Output stats
-        printStatTable(cvg_gc_stream);
-
-        // Remove any batch specific variables from memory
-        destroyBatchVars();
-
-        // Increment batch management vars
-        offset += recordsInBatch;
-
-        if (verbose)
-            *out_stream << "done" << endl;
+    auto sampleColumns = [&](const string& name) {
+        if (nbSamples == 1) {
+            return string("\t") + name;
+        }
+        string cols;
+        for (size_t s = 0; s < nbSamples; s++) {
+            cols += string("\t") + name + "_" + lexical_cast<string>(input[s].index);
+        }
+        return cols;
+    };
+    cvg_gc_stream << "seq_name" << sampleColumns("median") << sampleColumns("mean")
+                  << "\tgc%\tseq_length\tkmers_in_seq\tinvalid_kmers\t%_invalid"
+                  << sampleColumns("non_zero_kmers") << sampleColumns("%_non_zero") << sampleColumns("%_non_zero_corrected") << endl;
+    pipeline.addWriter([&](const SeqBatch& b) { printStatTable(cvg_gc_stream, b); });
+
+    // Windowed coverage stats and bedGraph track output streams
+    vector<shared_ptr<ofstream>> windows_streams(nbSamples);
+    vector<shared_ptr<ofstream>> bedgraph_streams(nbSamples);
+    if (windowSize > 0) {
+        for (size_t s = 0; s < nbSamples; s++) {
+            windows_streams[s] = make_shared<ofstream>(samplePath("windows", ".bed", s).c_str());
+            *windows_streams[s] << "#seq_name\tstart\tend\tmean\tmedian\tmin\tmax\tfrac_zero\tgc%" << endl;
+            pipeline.addWriter([&, s](const SeqBatch& b) { printWindows(*windows_streams[s], b, s); });
+
+            bedgraph_streams[s] = make_shared<ofstream>(samplePath("cvg", ".bedgraph", s).c_str());
+            pipeline.addWriter([&, s](const SeqBatch& b) { printBedGraph(*bedgraph_streams[s], b, s); });
+        }
     }
 
-    // Close output streams
-    if (!noCountStats)  count_path_stream->close();
-    if (outputGCStats)  gc_count_path_stream->close();
-    if (extractNR)      nr_path_stream->close();
-    if (extractR)       r_path_stream->close();
+    // Process each batch in a worker thread.  In each batch lookup each K-mer in the hash
+    pipeline.run(
+        [&](SeqBatch& b) {
+            if (!batches.read(b))
+                return false;
+            if (verbose)
+                *out_stream << "Loaded batch of " << batches.nbRecords(b) << " records" << endl;
+            return true;
+        },
+        [&](SeqBatch& b, uint16_t th_id) {
+            batches.load(b);
+            b.resize(b.size(), input.size());
+            processBatch(b, th_id);
+        });
 
-    seqan::close(reader);
+    // Close output streams
+    for (size_t s = 0; s < nbSamples; s++) {
+        if (count_path_streams[s])  count_path_streams[s]->close();
+        if (count_writers[s])       count_writers[s]->close();
+        if (nr_path_streams[s])     nr_path_streams[s]->close();
+        if (r_path_streams[s])      r_path_streams[s]->close();
+        if (windows_streams[s])     windows_streams[s]->close();
+        if (bedgraph_streams[s])    bedgraph_streams[s]->close();
+    }
+    if (outputGCStats)      gc_count_path_stream->close();
 
     cvg_gc_stream.close();
 
@@ -268,68 +327,24 @@ void kat::Sect::merge() {
     cout.flush();
 }
 
-void kat::Sect::analyseBatch() {
-
-    vector<thread> t(threads);
-
-    for(uint16_t i = 0; i < threads; i++) {
-        t[i] = thread(&Sect::analyseBatchSlice, this, i);
-    }
-
-    for(uint16_t i = 0; i < threads; i++){
-        t[i].join();
-    }
-}
-
-void kat::Sect::analyseBatchSlice(int th_id) {
-    // Check to see if we have useful work to do for this thread, return if not
-    if (bucket_size < 1 && th_id >= recordsInBatch) {
-        return;
-    }
-
-    //processInBlocks(th_id);
-    processInterlaced(th_id);
-}
-
-void kat::Sect::destroyBatchVars() {
-    for (size_t i = 0; i < counts->size(); i++) {
-        counts->at(i)->clear();
-        gc_counts->at(i)->clear();
+void kat::Sect::processBatch(SeqBatch& batch, const uint16_t th_id) {
+    for (size_t i = 0; i < batch.size(); i++) {
+        processSeq(batch, i, th_id);
     }
-
-    counts->clear();
-    gc_counts->clear();
-    medians->clear();
-    means->clear();
-    gcs->clear();
-    lengths->clear();
-    invalid->clear();
-    percentInvalid->clear();
-    nonZero->clear();
-    percentNonZero->clear();
-    percentNonZeroCorrected->clear();
-
 }
 
-void kat::Sect::createBatchVars(uint16_t batchSize) {
-    counts = make_shared<vector<shared_ptr<vector<uint64_t>>>>(batchSize);
-    gc_counts = make_shared<vector<shared_ptr<vector<int16_t>>>>(batchSize);
-    medians = make_shared<vector<uint32_t>>(batchSize);
-    means = make_shared<vector<double>>(batchSize);
-    gcs = make_shared<vector<double>>(batchSize);
-    lengths = make_shared<vector<uint32_t>>(batchSize);
-    invalid = make_shared<vector<uint32_t>>(batchSize);
-    percentInvalid = make_shared<vector<double>>(batchSize);
-    nonZero = make_shared<vector<uint32_t>>(batchSize);
-    percentNonZero = make_shared<vector<double>>(batchSize);
-    percentNonZeroCorrected = make_shared<vector<double>>(batchSize);
+path kat::Sect::samplePath(const string& name, const string& ext, const size_t sample) const {
+    // Only number the outputs when there is more than one sample, so single sample
+    // runs keep their usual file names
+    return path(outputPrefix.string() + "-" + name +
+            (input.size() > 1 ? lexical_cast<string>(input[sample].index) : string()) + ext);
 }
 
-void kat::Sect::printCounts(std::ostream &out) {
-    for (uint32_t i = 0; i < recordsInBatch; i++) {
-        out << ">" << seqan::toCString(names[i]) << endl;
+void kat::Sect::printCounts(std::ostream &out, const SeqBatch& batch, const size_t sample) {
+    for (uint32_t i = 0; i < batch.size(); i++) {
+        out << ">" << seqan::toCString(batch.names[i]) << endl;
 
-        shared_ptr<vector<uint64_t>> seqCounts = counts->at(i);
+        shared_ptr<vector<uint64_t>> seqCounts = batch.samples[sample].counts[i];
 
         if (seqCounts != NULL && !seqCounts->empty()) {
             out << seqCounts->at(0);
@@ -349,11 +364,11 @@ double kat::Sect::gcCountToPercentage(int16_t count) {
     return count == -1 ? -0.1 : (((double)count / (double)this->getMerLen()) * 100.0);
 }
 
-void kat::Sect::printGCCounts(std::ostream &out) {
-    for (uint32_t i = 0; i < recordsInBatch; i++) {
-        out << ">" << seqan::toCString(names[i]) << std::fixed << std::setprecision(1) << endl;
+void kat::Sect::printGCCounts(std::ostream &out, const SeqBatch& batch) {
+    for (uint32_t i = 0; i < batch.size(); i++) {
+        out << ">" << seqan::toCString(batch.names[i]) << std::fixed << std::setprecision(1) << endl;
 
-        shared_ptr<vector<int16_t>> gcCounts = gc_counts->at(i);
+        shared_ptr<vector<int16_t>> gcCounts = batch.gc_counts[i];
 
         if (gcCounts != NULL && !gcCounts->empty()) {
             out << gcCountToPercentage(gcCounts->at(0));
@@ -369,12 +384,12 @@ void kat::Sect::printGCCounts(std::ostream &out) {
     }
 }
 
-void kat::Sect::printRegions(std::ostream &out, const uint32_t min_count, const uint32_t max_count) {
-    for (uint32_t i = 0; i < recordsInBatch; i++) {
+void kat::Sect::printRegions(std::ostream &out, const SeqBatch& batch, const size_t sample, const uint32_t min_count, const uint32_t max_count) {
+    for (uint32_t i = 0; i < batch.size(); i++) {
 
         uint32_t index = 1;
         uint32_t start = 0;
-        shared_ptr<vector<uint64_t>> seqCounts = counts->at(i);
+        shared_ptr<vector<uint64_t>> seqCounts = batch.samples[sample].counts[i];
         
         string maxcntstr = max_count > 0 ? (string("-") + lexical_cast<string>(max_count)) : "+";
 
@@ -389,14 +404,14 @@ void kat::Sect::printRegions(std::ostream &out, const uint32_t min_count, const
                         start = j;
                         inRegion = true;
                     }
-                    ss << seqs[i][j];
+                    ss << batch.seqs[i][j];
                 }
                 else if (inRegion) {
                     uint32_t end = j+this->getMerLen() - 1;
-                    out << ">" << seqan::toCString(names[i]) << "___region:" << index++ << "_length:" << end - start - 1 << "_pos:" << start+1 << ":" << end << "_cov:" << min_count << maxcntstr << endl;
+                    out << ">" << seqan::toCString(batch.names[i]) << "___region:" << index++ << "_length:" << end - start - 1 << "_pos:" << start+1 << ":" << end << "_cov:" << min_count << maxcntstr << endl;
                     out << ss.str();
                     for(size_t k = j+1; k < end; k++) {
-                        out << seqs[i][k];
+                        out << batch.seqs[i][k];
                     }
                     out << endl;
                     inRegion = false;
@@ -408,10 +423,10 @@ void kat::Sect::printRegions(std::ostream &out, const uint32_t min_count, const
             if (inRegion) {
                 uint32_t end = seqCounts->size() + this->getMerLen() - 1;
 
-                out << ">" << seqan::toCString(names[i]) << "___region:" << index++ << "_length:" << end - start - 1 << "_pos:" << start+1 << ":" << end << "_cov:" << min_count << maxcntstr << endl;
+                out << ">" << seqan::toCString(batch.names[i]) << "___region:" << index++ << "_length:" << end - start - 1 << "_pos:" << start+1 << ":" << end << "_cov:" << min_count << maxcntstr << endl;
                 out << ss.str();
                 for(size_t k = seqCounts->size(); k < end; k++) {
-                    out << seqs[i][k];
+                    out << batch.seqs[i][k];
                 }
                 out << endl;
             }
@@ -421,73 +436,242 @@ void kat::Sect::printRegions(std::ostream &out, const uint32_t min_count, const
 }
 
 
-void kat::Sect::printStatTable(std::ostream &out) {
+void kat::Sect::printStatTable(std::ostream &out, const SeqBatch& batch) {
 
     out << std::fixed << std::setprecision(5);
 
-    for (uint32_t i = 0; i < recordsInBatch; i++) {
-        out << names[i] << "\t"
-            << (*medians)[i] << "\t"
-            << (*means)[i] << "\t"
-            << (*gcs)[i] << "\t"
-            << (*lengths)[i] << "\t"
-            << (*lengths)[i] - this->input.merLen + 1 << "\t"
-            << (*invalid)[i] << "\t"
-            << (*percentInvalid)[i] << "\t"
-            << (*nonZero)[i] << "\t"
-            << (*percentNonZero)[i] << "\t"
-            << (*percentNonZeroCorrected)[i] << endl;
+    for (uint32_t i = 0; i < batch.size(); i++) {
+        out << batch.names[i];
+        for (auto& s : batch.samples) out << "\t" << s.medians[i];
+        for (auto& s : batch.samples) out << "\t" << s.means[i];
+        out << "\t" << batch.gcs[i]
+            << "\t" << batch.lengths[i]
+            << "\t" << batch.lengths[i] - this->getMerLen() + 1
+            << "\t" << batch.invalid[i]
+            << "\t" << batch.percentInvalid[i];
+        for (auto& s : batch.samples) out << "\t" << s.nonZero[i];
+        for (auto& s : batch.samples) out << "\t" << s.percentNonZero[i];
+        for (auto& s : batch.samples) out << "\t" << s.percentNonZeroCorrected[i];
+        out << endl;
     }
 }
 
-// Print K-mer comparison matrix
+void kat::Sect::calcWindows(SeqBatch& batch, const size_t index, const size_t sample, const string& seq) {
 
-void kat::Sect::printContaminationMatrix(std::ostream &out, const path seqFile) {
-    SM64 mx = contamination_mx->getFinalMatrix();
+    const vector<uint64_t>& seqCounts = *batch.samples[sample].counts[index];
+    const uint64_t nbCounts = seqCounts.size();
+    const uint64_t step = windowStep == 0 ? windowSize : windowStep;
 
-    out << mme::KEY_TITLE << "Contamination Plot for " << seqFile.string() << " and " << hashFile << endl;
-    out << mme::KEY_X_LABEL << "GC%" << endl;
-    out << mme::KEY_Y_LABEL << "Average K-mer Coverage" << endl;
-    out << mme::KEY_Z_LABEL << "Base Count per bin" << endl;
-    out << mme::KEY_NB_COLUMNS << gcBins << endl;
-    out << mme::KEY_NB_ROWS << cvgBins << endl;
-    out << mme::KEY_MAX_VAL << mx.getMaxVal() << endl;
-    out << mme::KEY_TRANSPOSE << "0" << endl;
-    out << mme::MX_META_END << endl;
+    vector<CoverageWindow>& windows = batch.samples[sample].windows[index];
+    vector<uint64_t> values;
+
+    for (uint64_t start = 0; start < nbCounts; start += step) {
+
+        CoverageWindow w;
+        w.start = start;
+        w.end = std::min<uint64_t>(start + windowSize, nbCounts);
+
+        values.assign(seqCounts.begin() + w.start, seqCounts.begin() + w.end);
 
-    mx.printMatrix(out);
+        uint64_t sum = 0;
+        uint64_t zeros = 0;
+        w.min = values[0];
+        w.max = values[0];
+        for (auto c : values) {
+            sum += c;
+            if (c == 0) zeros++;
+            if (c < w.min) w.min = c;
+            if (c > w.max) w.max = c;
+        }
+
+        // Same median as used for the whole sequence, but found in linear time
+        auto mid = values.begin() + values.size() / 2;
+        std::nth_element(values.begin(), mid, values.end());
+        w.median = *mid;
+
+        w.mean = (double)sum / (double)values.size();
+        w.fracZero = (double)zeros / (double)values.size();
+
+        // GC% of the bases spanned by the K-mers in this window.  Windows are the same
+        // for every sample, so this is only worked out for the first one.
+        if (sample > 0) {
+            w.gc = batch.samples[0].windows[index][windows.size()].gc;
+        }
+        else {
+            uint64_t gcs = 0;
+            uint64_t ns = 0;
+            const uint64_t baseEnd = w.end + this->getMerLen() - 1;
+            for (uint64_t i = w.start; i < baseEnd; i++) {
+                char c = seq[i];
+                if (c == 'G' || c == 'g' || c == 'C' || c == 'c')
+                    gcs++;
+                else if (c == 'N' || c == 'n')
+                    ns++;
+            }
+            const uint64_t bases = baseEnd - w.start - ns;
+            w.gc = bases == 0 ? -1.0 : ((double)gcs / (double)bases) * 100.0;
+        }
+
+        windows.push_back(w);
+
+        if (w.end == nbCounts) {
+            break;
+        }
+    }
 }
 
-// This method won't be optimal in most cases... Fasta files are normally sorted by length (largest first)
-// So first thread will be asked to do more work than the rest
+void kat::Sect::encodeCounts(SeqBatch& batch, const size_t index, const size_t sample) {
+
+    const vector<uint64_t>& seqCounts = *batch.samples[sample].counts[index];
+    const uint64_t blockSize = CoverageFile::DEFAULT_BLOCK_SIZE;
+    const uint64_t nbBlocks = (seqCounts.size() + blockSize - 1) / blockSize;
+
+    // Blocks are independent, so those of long sequences are shared between the workers
+    vector<string>& blocks = batch.samples[sample].encodedCounts[index];
+    blocks.resize(nbBlocks);
+    chunks->run(nbBlocks, SEQ_CHUNK_SIZE / blockSize, [&](uint64_t start, uint64_t end) {
+        for (uint64_t b = start; b < end; b++) {
+            const uint64_t first = b * blockSize;
+            blocks[b] = CoverageFile::encodeBlock(seqCounts.data() + first, std::min(blockSize, seqCounts.size() - first));
+        }
+    });
+}
 
-void kat::Sect::processInBlocks(uint16_t th_id) {
-    size_t start = bucket_size < 1 ? th_id : th_id * bucket_size;
-    size_t end = bucket_size < 1 ? th_id : start + bucket_size - 1;
-    for (size_t i = start; i <= end; i++) {
-        processSeq(i, th_id);
+void kat::Sect::writeBinaryCounts(CoverageFileWriter& writer, const SeqBatch& batch, const size_t sample) {
+    for (uint32_t i = 0; i < batch.size(); i++) {
+        const int64_t nbCounts = (int64_t)batch.lengths[i] - this->getMerLen() + 1;
+        writer.add(seqan::toCString(batch.names[i]), nbCounts > 0 ? nbCounts : 0, batch.samples[sample].encodedCounts[i]);
     }
+}
 
-    // Process a remainder if required
-    if (th_id < remaining) {
-        size_t rem_idx = (threads * bucket_size) + th_id;
-        processSeq(rem_idx, th_id);
+void kat::Sect::query(const path& cvgFile, const vector<string>& regions, std::ostream& out) {
+
+    CoverageFile cf(cvgFile);
+    vector<uint64_t> counts;
+
+    auto print = [&](const string& header, size_t index, uint64_t start, uint64_t end) {
+        cf.get(index, start, end, counts);
+        out << ">" << header << "\n";
+        if (counts.empty()) {
+            out << "0\n";
+            return;
+        }
+        out << counts[0];
+        for (size_t j = 1; j < counts.size(); j++) {
+            out << " " << counts[j];
+        }
+        out << "\n";
+    };
+
+    if (regions.empty()) {
+        for (size_t i = 0; i < cf.size(); i++) {
+            print(cf.getName(i), i, 0, cf.getLength(i));
+        }
+        return;
+    }
+
+    for (auto& region : regions) {
+
+        // Whole sequence names take priority, as they may contain colons
+        int64_t index = cf.find(region);
+        if (index >= 0) {
+            print(region, index, 0, cf.getLength(index));
+            continue;
+        }
+
+        const size_t colon = region.rfind(':');
+        const size_t dash = region.find('-', colon == string::npos ? 0 : colon);
+        if (colon != string::npos && dash != string::npos) {
+            index = cf.find(region.substr(0, colon));
+            if (index >= 0) {
+                uint64_t start = 0, end = 0;
+                try {
+                    start = lexical_cast<uint64_t>(region.substr(colon + 1, dash - colon - 1));
+                    end = lexical_cast<uint64_t>(region.substr(dash + 1));
+                }
+                catch(boost::bad_lexical_cast& e) {
+                    BOOST_THROW_EXCEPTION(SectException() << SectErrorInfo(string(
+                            "Could not parse interval in region: ") + region));
+                }
+                if (start < 1 || start > end || end > cf.getLength(index)) {
+                    BOOST_THROW_EXCEPTION(SectException() << SectErrorInfo(string(
+                            "Interval is outside of the sequence in region: ") + region +
+                            "; sequence has " + lexical_cast<string>(cf.getLength(index)) + " K-mer positions"));
+                }
+                print(region, index, start - 1, end);
+                continue;
+            }
+        }
+
+        BOOST_THROW_EXCEPTION(SectException() << SectErrorInfo(string(
+                "Could not find sequence in ") + cvgFile.string() + " for region: " + region));
     }
 }
 
-// This method is probably makes more efficient use of multiple cores on a length sorted fasta file
+void kat::Sect::printWindows(std::ostream &out, const SeqBatch& batch, const size_t sample) {
+
+    out << std::fixed << std::setprecision(5);
 
-void kat::Sect::processInterlaced(uint16_t th_id) {
-    size_t start = th_id;
-    size_t end = recordsInBatch;
-    for (size_t i = start; i < end; i += threads) {
-        processSeq(i, th_id);
+    for (uint32_t i = 0; i < batch.size(); i++) {
+        const string name = bedName(batch.names[i]);
+        for (auto& w : batch.samples[sample].windows[i]) {
+            out << name << "\t"
+                << w.start << "\t"
+                << w.end << "\t"
+                << w.mean << "\t"
+                << w.median << "\t"
+                << w.min << "\t"
+                << w.max << "\t"
+                << w.fracZero << "\t"
+                << w.gc << "\n";
+        }
     }
 }
 
+void kat::Sect::printBedGraph(std::ostream &out, const SeqBatch& batch, const size_t sample) {
+
+    // bedGraph intervals must not overlap, so when windows do, each value only
+    // covers the step up to the start of the next window
+    const uint64_t step = windowStep == 0 ? windowSize : windowStep;
+
+    out << std::fixed << std::setprecision(5);
 
+    for (uint32_t i = 0; i < batch.size(); i++) {
+        const string name = bedName(batch.names[i]);
+        for (auto& w : batch.samples[sample].windows[i]) {
+            out << name << "\t" << w.start << "\t" << std::min(w.end, w.start + step) << "\t" << w.mean << "\n";
+        }
+    }
+}
 
-void kat::Sect::processSeq(const size_t index, const uint16_t th_id) {
+string kat::Sect::bedName(const seqan::CharString& name) {
+    // BED style formats identify sequences by the first word of the header only
+    string id = seqan::toCString(name);
+    return id.substr(0, id.find_first_of(" \t"));
+}
+
+// Print K-mer comparison matrix
+
+void kat::Sect::printContaminationMatrix(std::ostream &out, const path seqFile) {
+    printContaminationMatrixHeader(out, seqFile);
+    contamination_mx->getFinalMatrix().printMatrix(out);
+}
+
+void kat::Sect::printContaminationMatrixHeader(std::ostream &out, const path seqFile) {
+    const SM64& mx = contamination_mx->getFinalMatrix();
+
+    out << mme::KEY_TITLE << "Contamination Plot for " << seqFile.string() << " and " << input[0].pathString() << endl;
+    out << mme::KEY_X_LABEL << "GC%" << endl;
+    out << mme::KEY_Y_LABEL << "Average K-mer Coverage" << endl;
+    out << mme::KEY_Z_LABEL << "Base Count per bin" << endl;
+    out << mme::KEY_NB_COLUMNS << gcBins << endl;
+    out << mme::KEY_NB_ROWS << cvgBins << endl;
+    out << mme::KEY_MAX_VAL << mx.getMaxVal() << endl;
+    out << mme::KEY_TRANSPOSE << "0" << endl;
+    out << mme::MX_META_END << endl;
+}
+
+void kat::Sect::processSeq(SeqBatch& batch, const size_t index, const uint16_t th_id) {
 
     // There's no substring functionality in SeqAn in this version (2.0.0).  So we'll just
     // use regular c++ string's for this bit.  This conversion of strings:
@@ -495,13 +679,15 @@ void kat::Sect::processSeq(const size_t index, const uint16_t th_id) {
     // inefficient. Reducing the number of conversions necessary will
     // make a big performance improvement here
     stringstream ssSeq;
-    ssSeq << seqs[index];
+    ssSeq << batch.seqs[index];
     string seq = ssSeq.str();
 
+    const size_t nbSamples = input.size();
+    const uint16_t merLen = this->getMerLen();
     uint64_t seqLength = seq.length();
-    int64_t nbCounts = seqLength - input.merLen + 1;
+    int64_t nbCounts = seqLength - merLen + 1;
     double average_cvg = 0.0;
-    uint64_t nbNonZero = 0;
+    vector<uint64_t> nbNonZero(nbSamples, 0);
     uint64_t nbInvalid = 0;
 
     if (nbCounts <= 0) {
@@ -510,65 +696,120 @@ void kat::Sect::processSeq(const size_t index, const uint16_t th_id) {
         //cerr << names[index] << ": " << seq << " is too short to compute coverage.  Sequence length is "
         //       << seqLength << " and K-mer length is " << merLen << ". Setting sequence coverage to 0." << endl;
 
-        (*counts)[index] = make_shared<vector<uint64_t>>();
-        (*gc_counts)[index] = make_shared<vector<int16_t>>();
-        (*medians)[index] = 0;
-        (*means)[index] = 0.0;
+        batch.gc_counts[index] = make_shared<vector<int16_t>>();
+        for (auto& sc : batch.samples) {
+            sc.counts[index] = make_shared<vector<uint64_t>>();
+            sc.medians[index] = 0;
+            sc.means[index] = 0.0;
+        }
 
     } else {
 
-        shared_ptr<vector<uint64_t>> seqCounts = make_shared<vector<uint64_t>>(nbCounts, 0);
-        shared_ptr<vector<int16_t>> gcCounts = make_shared<vector<int16_t>>(nbCounts, 0);
+        // Only keep per K-mer values if some output needs them
+        const bool keepCounts = !noCountStats || extractNR || extractR || windowSize > 0;
+        const bool keepGC = outputGCStats;
 
-        uint64_t sum = 0;
+        vector<shared_ptr<vector<uint64_t>>> seqCounts(nbSamples);
+        for (auto& sc : seqCounts) {
+            sc = make_shared<vector<uint64_t>>(keepCounts ? nbCounts : 0, 0);
+        }
+        shared_ptr<vector<int16_t>> gcCounts = make_shared<vector<int16_t>>(keepGC ? nbCounts : 0, 0);
+
+        // Long sequences are split into chunks of K-mer windows, which are looked up by
+        // any workers that are free.  Consecutive chunks overlap by K-1 bases of sequence and each one
+        // fills its own part of the count vectors and keeps its own stats, so results
+        // are the same as a single pass.  Each K-mer is checked, built and canonicalised
+        // once, then looked up in every sample.
+        const size_t nbChunks = (nbCounts + SEQ_CHUNK_SIZE - 1) / SEQ_CHUNK_SIZE;
+        vector<vector<CoverageStats>> chunkStats(nbChunks, vector<CoverageStats>(nbSamples));
+        chunks->run(nbCounts, SEQ_CHUNK_SIZE, [&](uint64_t start, uint64_t end) {
+
+            vector<CoverageStats>& stats = chunkStats[start / SEQ_CHUNK_SIZE];
+
+            for (uint64_t i = start; i < end; i++) {
+
+                string merstr = seq.substr(i, merLen);
 
-        for (int64_t i = 0; i < nbCounts; i++) {
-
-            string merstr = seq.substr(i, input.merLen);
-
-            // Jellyfish compacted hash does not support Ns so if we find one set this mer count to 0
-            if (!validKmer(merstr)) {
-                (*seqCounts)[i] = 0;
-                (*gcCounts)[i] = -1;
-                nbInvalid++;
-            } else {
-                mer_dna mer(merstr);
-                uint64_t count = JellyfishHelper::getCount(input.hash, mer, input.canonical);
-                sum += count;
-                (*seqCounts)[i] = count;
-                (*gcCounts)[i] = gcCount(merstr);
-                if (count != 0) nbNonZero++;
+                // Jellyfish compacted hash does not support Ns so if we find one set this mer count to 0
+                if (!validKmer(merstr)) {
+                    for (size_t s = 0; s < nbSamples; s++) {
+                        if (keepCounts) (*seqCounts[s])[i] = 0;
+                        stats[s].addInvalid();
+                    }
+                    if (keepGC) (*gcCounts)[i] = -1;
+                } else {
+                    mer_dna mer(merstr);
+                    const mer_dna canon = mer.get_canonical();
+                    for (size_t s = 0; s < nbSamples; s++) {
+                        uint64_t count = JellyfishHelper::getCount(input[s].hash, input[s].canonical ? canon : mer, false);
+                        if (keepCounts) (*seqCounts[s])[i] = count;
+                        stats[s].add(count);
+                    }
+                    if (keepGC) (*gcCounts)[i] = gcCount(merstr);
+                }
+            }
+        });
+
+        batch.gc_counts[index] = gcCounts;
+
+        for (size_t s = 0; s < nbSamples; s++) {
+
+            CoverageStats stats;
+            for (auto& cs : chunkStats) {
+                stats.merge(cs[s]);
+            }
+
+            nbNonZero[s] = stats.getNonZero();
+            nbInvalid = stats.getInvalid();
+
+            SampleCoverage& sc = batch.samples[s];
+            sc.counts[index] = seqCounts[s];
+            sc.medians[index] = stats.median();
+            sc.means[index] = stats.mean();
+
+            // The contamination matrix is binned on the first sample's coverage
+            if (s == 0) {
+                average_cvg = stats.mean();
+            }
+
+            if (windowSize > 0) {
+                calcWindows(batch, index, s, seq);
             }
-        }
 
-        (*counts)[index] = seqCounts;
-        (*gc_counts)[index] = gcCounts;
+            // Don't hold on to per K-mer values that no writer needs
+            if (noCountStats && !extractNR && !extractR) {
+                sc.counts[index] = make_shared<vector<uint64_t>>();
+            }
 
-        // Create a copy of the counts, and sort it first, then take median value
-        vector<uint64_t> sortedSeqCounts = *seqCounts;
-        std::sort(sortedSeqCounts.begin(), sortedSeqCounts.end());
-        (*medians)[index] = (double)(sortedSeqCounts[sortedSeqCounts.size() / 2]);
+            if (!noCountStats && binaryCounts) {
+                encodeCounts(batch, index, s);
 
-        // Calculate the mean
-        (*means)[index] = (double)sum / (double)nbCounts;
+                // The counts are now held in the encoded blocks
+                if (!extractNR && !extractR) {
+                    sc.counts[index] = make_shared<vector<uint64_t>>();
+                }
+            }
+        }
     }
 
     // Add length
-    (*lengths)[index] = seqLength;
-    (*nonZero)[index] = nbNonZero;
-    (*percentNonZero)[index] = nbNonZero == 0 || nbCounts <= 0 ?
-        0.0 :
-        ((double)nbNonZero / (double)nbCounts) * 100.0;
-    (*invalid)[index] = nbInvalid;
-    (*percentInvalid)[index] = nbInvalid == 0 || nbCounts <= 0 ?
+    batch.lengths[index] = seqLength;
+    batch.invalid[index] = nbInvalid;
+    batch.percentInvalid[index] = nbInvalid == 0 || nbCounts <= 0 ?
         0.0 :
         ((double)nbInvalid / (double)nbCounts) * 100.0;
 
     uint64_t notInvalid = nbCounts - nbInvalid;
-    (*percentNonZeroCorrected)[index] = nbNonZero == 0 || notInvalid <= 0 ?
-        0.0 :
-        ((double)nbNonZero / (double)notInvalid) * 100.0;
-
+    for (size_t s = 0; s < nbSamples; s++) {
+        SampleCoverage& sc = batch.samples[s];
+        sc.nonZero[index] = nbNonZero[s];
+        sc.percentNonZero[index] = nbNonZero[s] == 0 || nbCounts <= 0 ?
+            0.0 :
+            ((double)nbNonZero[s] / (double)nbCounts) * 100.0;
+        sc.percentNonZeroCorrected[index] = nbNonZero[s] == 0 || notInvalid <= 0 ?
+            0.0 :
+            ((double)nbNonZero[s] / (double)notInvalid) * 100.0;
+    }
 
     // Calc GC%
     uint64_t gs = 0;
@@ -587,7 +828,7 @@ void kat::Sect::processSeq(const size_t index, const uint16_t th_id) {
     }
 
     double gc_perc = ((double) (gs + cs)) / ((double) (seqLength - ns));
-    (*gcs)[index] = gc_perc;
+    batch.gcs[index] = gc_perc;
 
     double log_cvg = cvgLogscale ? log10(average_cvg) : average_cvg;
 
@@ -595,7 +836,7 @@ void kat::Sect::processSeq(const size_t index, const uint16_t th_id) {
     double compressed_cvg = cvgLogscale ? log_cvg * (cvgBins / 5.0) : average_cvg * 0.1;
 
     uint16_t x = gc_perc * gcBins; // Convert double to 1.dp
-    uint16_t y = compressed_cvg >= cvgBins ? cvgBins - 1 : compressed_cvg; // Simply cap the y value
+    uint16_t y = compressed_cvg >= cvgBins ? cvgBins - 1 : compressed_cvg > 0.0 ? compressed_cvg : 0; // Simply cap the y value
 
     // Add bases to matrix
     contamination_mx->incTM(th_id, x, y, seqLength);
@@ -603,7 +844,7 @@ void kat::Sect::processSeq(const size_t index, const uint16_t th_id) {
 
 int kat::Sect::main(int argc, char *argv[]) {
 
-    vector<path>    counts_files;
+    vector<string>  counts_files;
     path            seq_file;
     path            output_prefix;
     uint16_t        gc_bins;
@@ -615,12 +856,18 @@ int kat::Sect::main(int argc, char *argv[]) {
     uint16_t        mer_len;
     uint64_t        hash_size;
     bool            no_count_stats;
+    bool            binary_counts;
+    path            query_file;
     bool            output_gc_stats;
     bool            extract_nr;
     bool            extract_r;
+    bool            binary_mx;
+    uint32_t        window_size;
+    uint32_t        window_step;
     uint32_t        min_repeat;
     uint32_t        max_repeat;
     bool            dump_hash;
+    bool            multi_sample;
     bool            verbose;
     bool            help;
 
@@ -651,6 +898,10 @@ int kat::Sect::main(int argc, char *argv[]) {
                 "If kmer counting is required for the input, then use this value as the hash size.  If this hash size is not large enough for your dataset then the default behaviour is to double the size of the hash and recount, which will increase runtime and memory usage.")
             ("no_count_stats,n", po::bool_switch(&no_count_stats)->default_value(false),
                 "Tells SECT not to output count stats.  Sometimes when using SECT on read files the output can get very large.  When flagged this just outputs summary stats for each sequence.")
+            ("binary_counts", po::bool_switch(&binary_counts)->default_value(false),
+                "Write K-mer counts to a compact, indexed binary file (<output_prefix>-counts.cvgb) rather than as text.  Any sequence or interval can be read back from this file without scanning it, using \"kat sect --query\" or \"kat plot profile\".")
+            ("query", po::value<path>(&query_file),
+                "Instead of analysing sequences, print K-mer counts from a binary counts file produced with --binary_counts.  The counts are written to <output_prefix>-query.cvg in the same format as the text counts file.  Any positional arguments are taken as regions to print, either as a sequence name or as \"name:start-end\", where start and end are 1-based, inclusive K-mer positions.  By default all sequences are printed.")
             ("output_gc_stats,g", po::bool_switch(&output_gc_stats)->default_value(false),
                 "Tells SECT to output GC counts for each k-mer.  Output is a FastA like counts file similar to that produce for the k-mer counts.  This can be slow.")
             ("extract_nr,E", po::bool_switch(&extract_nr)->default_value(false),
@@ -663,6 +914,14 @@ int kat::Sect::main(int argc, char *argv[]) {
                 "If user requests repeat region extraction (--extract_r), this value allows the user to override the default maximum limit on the amount of repetition allowed.  This allows users to avoid regions that are likely to be due to low complexity sequences.  A value of 0 means no limit on max repeats.")
             ("dump_hash,d", po::bool_switch(&dump_hash)->default_value(false),
                         "Dumps any jellyfish hashes to disk that were produced during this run. Normally, this is not recommended, as hashes are slow to load and will likely consume a significant amount of disk space.")
+            ("binary_mx", po::bool_switch(&binary_mx)->default_value(false),
+                "Write the contamination matrix in KAT's binary matrix format rather than as text.  Binary matrices are smaller and much faster to load, and are accepted by \"kat plot\".")
+            ("window_size,w", po::value<uint32_t>(&window_size)->default_value(0),
+                "If non-zero, summarise K-mer coverage over windows of this many K-mer positions along each sequence.  The mean, median, min and max coverage, the fraction of zero coverage K-mers and the GC% of each window are written to a BED style table, and the mean coverage is also written as a bedGraph track.  Using this with --no_count_stats avoids producing per K-mer output altogether.")
+            ("window_step", po::value<uint32_t>(&window_step)->default_value(0),
+                "The distance between the starts of consecutive windows.  A value of 0 means use the window size, so that windows don't overlap.")
+            ("multi_sample", po::bool_switch(&multi_sample)->default_value(false),
+                "Treat each counts input as a separate sample, rather than pooling them.  Each input is either a jellyfish hash, or a quoted, space separated list or glob of sequence files to count.  Every K-mer in the sequence file is looked up in all samples in a single pass.  The stats table gets one set of coverage columns per sample, and other per sample outputs are numbered, e.g. <output_prefix>-counts1.cvg.")
             ("verbose,v", po::bool_switch(&verbose)->default_value(false),
                 "Print extra information.")
             ("help", po::bool_switch(&help)->default_value(false), "Produce help message.")
@@ -673,7 +932,7 @@ int kat::Sect::main(int argc, char *argv[]) {
     po::options_description hidden_options("Hidden options");
     hidden_options.add_options()
             ("seq_file", po::value<path>(&seq_file), "Path to the sequnce file to analyse for kmer coverage.")
-            ("counts_files", po::value<std::vector<path>>(&counts_files), "Path(s) to the input files containing kmer counts.")
+            ("counts_files", po::value<std::vector<string>>(&counts_files), "Path(s) to the input files containing kmer counts.")
             ;
 
     // Positional option for the input bam file
@@ -697,6 +956,28 @@ int kat::Sect::main(int argc, char *argv[]) {
         return 1;
     }
 
+    // Query mode reads back a binary counts file, and the positional arguments are regions
+    if (vm.count("query")) {
+        vector<string> regions;
+        if (vm.count("seq_file")) regions.push_back(seq_file.string());
+        for (auto& r : counts_files) regions.push_back(r);
+
+        auto_cpu_timer timer(1, "KAT SECT completed.\nTotal runtime: %ws\n\n");
+
+        path out_path(output_prefix.string() + "-query.cvg");
+        cout << "Running KAT in SECT query mode" << endl
+             << "------------------------------" << endl << endl
+             << "Writing counts from " << query_file.string() << " to " << out_path.string() << " ...";
+        cout.flush();
+
+        ofstream out(out_path.c_str());
+        Sect::query(query_file, regions, out);
+        out.close();
+
+        cout << " done." << endl << endl;
+        return 0;
+    }
+
     vector<string> d1_5ptrim_strs;
     vector<uint16_t> d1_5ptrim_vals;
     boost::split(d1_5ptrim_strs,trim5p,boost::is_any_of(","));
@@ -708,8 +989,19 @@ int kat::Sect::main(int argc, char *argv[]) {
     cout << "Running KAT in SECT mode" << endl
          << "------------------------" << endl << endl;
 
+    // Each counts input is a sample of its own, or they are all pooled into one
+    vector<vector<path>> samples;
+    if (multi_sample) {
+        for (auto& c : counts_files) {
+            samples.push_back(*InputHandler::globFiles(c));
+        }
+    }
+    else {
+        samples.push_back(vector<path>(counts_files.begin(), counts_files.end()));
+    }
+
     // Create the sequence coverage object
-    Sect sect(counts_files, seq_file);
+    Sect sect(samples, seq_file);
     sect.setOutputPrefix(output_prefix);
     sect.setGcBins(gc_bins);
     sect.setCvgBins(cvg_bins);
@@ -720,16 +1012,23 @@ int kat::Sect::main(int argc, char *argv[]) {
     sect.setMerLen(mer_len);
     sect.setHashSize(hash_size);
     sect.setNoCountStats(no_count_stats);
+    sect.setBinaryCounts(binary_counts);
     sect.setOutputGCStats(output_gc_stats);
     sect.setExtractNR(extract_nr);
     sect.setExtractR(extract_r);
     sect.setMinRepeat(min_repeat);
     sect.setMaxRepeat(max_repeat);
     sect.setDumpHash(dump_hash);
+    sect.setBinaryMx(binary_mx);
+    sect.setWindowSize(window_size);
+    sect.setWindowStep(window_step);
     sect.setVerbose(verbose);
 
     // Do the work (outputs data to files as it goes)
     sect.execute();
 
+    // Save the contamination matrix
+    sect.save();
+
     return 0;
 }
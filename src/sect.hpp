@@ -49,11 +49,28 @@ using boost::lexical_cast;
 
 #include <kat/matrix_metadata_extractor.hpp>
 #include <kat/jellyfish_helper.hpp>
+#include <kat/coverage_file.hpp>
+#include <kat/coverage_stats.hpp>
+#include <kat/fasta_index.hpp>
 #include <kat/input_handler.hpp>
+#include <kat/pipeline.hpp>
+#include <kat/sequence_index.hpp>
 #include <kat/sparse_matrix.hpp>
+using kat::CoverageFile;
+using kat::CoverageFileWriter;
+using kat::ChunkPool;
+using kat::CoverageStats;
+using kat::FastaIndexException;
+using kat::FastaIndexErrorInfo;
 using kat::InputHandler;
+using kat::Pipeline;
+using kat::SequenceIndex;
 using kat::ThreadedSparseMatrix;
 
+#include "sequence_batch.hpp"
+using kat::SequenceBatch;
+using kat::SequenceBatchReader;
+
 
 namespace kat {
 
@@ -63,10 +80,79 @@ namespace kat {
     class Sect {
     private:
 
-        static const uint16_t BATCH_SIZE = 1024;
+        static const uint64_t SEQ_CHUNK_SIZE = 1000000; // Sequences with more K-mers than this are split into chunks shared between the workers
+
+        /**
+         * Coverage statistics for a window of K-mer positions along a sequence.  Start
+         * and end are zero based and half open, like BED coordinates.
+         */
+        struct CoverageWindow {
+            uint64_t start;
+            uint64_t end;
+            double mean;
+            uint64_t median;
+            uint64_t min;
+            uint64_t max;
+            double fracZero;
+            double gc;              // GC% of the bases covered by the window, or -1 if there are only Ns
+        };
+
+        /**
+         * Coverage calculated for a batch of sequences from one sample's K-mer counts.
+         * Vectors are in the same order as the sequences in the batch.
+         */
+        struct SampleCoverage {
+            vector<shared_ptr<vector<uint64_t>>> counts; // K-mer counts for each K-mer window in sequence
+            vector<uint32_t> medians; // Overall coverage calculated for each sequence from the K-mer windows.
+            vector<double> means; // Overall coverage calculated for each sequence from the K-mer windows.
+            vector<uint32_t> nonZero;
+            vector<double> percentNonZero;
+            vector<double> percentNonZeroCorrected;
+            vector<vector<CoverageWindow>> windows; // Windowed coverage stats for each sequence, if requested
+            vector<vector<string>> encodedCounts; // K-mer counts for each sequence encoded as binary coverage file blocks, if requested
+
+            void resize(size_t n) {
+                counts.resize(n);
+                medians.resize(n);
+                means.resize(n);
+                nonZero.resize(n);
+                percentNonZero.resize(n);
+                percentNonZeroCorrected.resize(n);
+                windows.resize(n);
+                encodedCounts.resize(n);
+            }
+        };
+
+        /**
+         * A batch of sequences read from the sequence file, along with everything
+         * calculated for them.  Batches are filled by the reader, processed by a
+         * single worker and then handed to the output writers in file order.
+         * Values that only depend on the sequences are held once, coverage is held
+         * for each sample.
+         */
+        struct SeqBatch : public SequenceBatch {
+            vector<shared_ptr<vector<int16_t>>> gc_counts; // GC counts for each K-mer window in sequence (in same order as seqs and names; built by this class)
+            vector<double> gcs; // GC% for each sequence
+            vector<uint32_t> lengths; // Length in nucleotides for each sequence
+            vector<uint32_t> invalid;
+            vector<double> percentInvalid;
+            vector<SampleCoverage> samples; // Coverage from each sample's K-mer counts
+
+            void resize(size_t n, size_t nbSamples) {
+                gc_counts.resize(n);
+                gcs.resize(n);
+                lengths.resize(n);
+                invalid.resize(n);
+                percentInvalid.resize(n);
+                samples.resize(nbSamples);
+                for (auto& s : samples) {
+                    s.resize(n);
+                }
+            }
+        };
 
         // Input args
-        InputHandler    input;
+        vector<InputHandler> input;     // One for each sample
         path            seqFile;
         path            outputPrefix;
         uint16_t        gcBins;
@@ -74,42 +160,33 @@ namespace kat {
         bool            cvgLogscale;
         uint16_t        threads;
         bool            noCountStats;
+        bool            binaryCounts;
         bool            outputGCStats;
         bool            extractNR;
         bool            extractR;
+        bool            binaryMx;
+        uint32_t        windowSize;
+        uint32_t        windowStep;
         uint32_t        minRepeat;
         uint32_t        maxRepeat;
         bool            verbose;
 
-        // Chunking vars
-        size_t bucket_size, remaining;
-
         // Variables that live for the lifetime of this object
         shared_ptr<ThreadedSparseMatrix> contamination_mx; // Stores cumulative base count for each sequence where GC and CVG are binned
-        uint32_t offset;
-        uint16_t recordsInBatch;
-        path hashFile;
-
-        // Variables that are refreshed for each batch
-        seqan::StringSet<seqan::CharString> names;
-        seqan::StringSet<seqan::CharString> seqs;
-        shared_ptr<vector<shared_ptr<vector<uint64_t>>>> counts; // K-mer counts for each K-mer window in sequence (in same order as seqs and names; built by this class)
-        shared_ptr<vector<shared_ptr<vector<int16_t>>>> gc_counts; // GC counts for each K-mer window in sequence (in same order as seqs and names; built by this class)
-        shared_ptr<vector<uint32_t>> medians; // Overall coverage calculated for each sequence from the K-mer windows.
-        shared_ptr<vector<double>> means; // Overall coverage calculated for each sequence from the K-mer windows.
-        shared_ptr<vector<double>> gcs; // GC% for each sequence
-        shared_ptr<vector<uint32_t>> lengths; // Length in nucleotides for each sequence
-        shared_ptr<vector<uint32_t>> nonZero;
-        shared_ptr<vector<double>> percentNonZero;
-        shared_ptr<vector<uint32_t>> invalid;
-        shared_ptr<vector<double>> percentInvalid;
-        shared_ptr<vector<double>> percentNonZeroCorrected;
+        shared_ptr<ChunkPool> chunks;   // Lets the workers share out the chunks of long sequences
 
 
     public:
 
         Sect(const vector<path> _counts_files, const path _seq_file);
 
+        /**
+         * Estimates coverage from several samples in a single pass over the
+         * sequence file.  Each element of _samples holds the counts files for
+         * one sample, which is either a jellyfish hash or sequence files to count.
+         */
+        Sect(const vector<vector<path>> _samples, const path _seq_file);
+
         virtual ~Sect() {
         }
 
@@ -122,15 +199,15 @@ namespace kat {
         }
 
         void setTrim(const vector<uint16_t>& _5ptrim) {
-            this->input.set5pTrim(_5ptrim);
+            for (auto& i : input) i.set5pTrim(_5ptrim);
         }
 
         bool isCanonical() const {
-            return input.canonical;
+            return input[0].canonical;
         }
 
         void setCanonical(bool canonical) {
-            this->input.canonical = canonical;
+            for (auto& i : input) i.canonical = canonical;
         }
 
         uint16_t getCvgBins() const {
@@ -165,6 +242,17 @@ namespace kat {
             this->noCountStats = no_count_stats;
         }
 
+        bool isBinaryCounts() const {
+            return binaryCounts;
+        }
+
+        /**
+         * Write K-mer counts to a compact binary coverage file, rather than as text
+         */
+        void setBinaryCounts(bool binaryCounts) {
+            this->binaryCounts = binaryCounts;
+        }
+
         bool isOutputGCStats() const {
             return outputGCStats;
         }
@@ -222,27 +310,59 @@ namespace kat {
         }
 
         uint64_t getHashSize() const {
-            return input.hashSize;
+            return input[0].hashSize;
         }
 
         void setHashSize(uint64_t hashSize) {
-            this->input.hashSize = hashSize;
+            for (auto& i : input) i.hashSize = hashSize;
         }
 
         uint16_t getMerLen() const {
-            return input.merLen;
+            return input[0].merLen;
         }
 
         void setMerLen(uint16_t merLen) {
-            this->input.merLen = merLen;
+            for (auto& i : input) i.merLen = merLen;
         }
 
         bool isDumpHash() const {
-            return input.dumpHash;
+            return input[0].dumpHash;
         }
 
         void setDumpHash(bool dumpHash) {
-            this->input.dumpHash = dumpHash;
+            for (auto& i : input) i.dumpHash = dumpHash;
+        }
+
+        bool isBinaryMx() const {
+            return binaryMx;
+        }
+
+        void setBinaryMx(bool binaryMx) {
+            this->binaryMx = binaryMx;
+        }
+
+        uint32_t getWindowSize() const {
+            return windowSize;
+        }
+
+        /**
+         * Sets the number of K-mer positions in each coverage window.  0 disables
+         * windowed output.
+         */
+        void setWindowSize(uint32_t windowSize) {
+            this->windowSize = windowSize;
+        }
+
+        uint32_t getWindowStep() const {
+            return windowStep;
+        }
+
+        /**
+         * Sets the distance between the starts of consecutive windows.  0 means
+         * the same as the window size, i.e. windows don't overlap.
+         */
+        void setWindowStep(uint32_t windowStep) {
+            this->windowStep = windowStep;
         }
 
         bool isVerbose() const {
@@ -254,45 +374,60 @@ namespace kat {
         }
 
 
+        size_t getNbSamples() const {
+            return input.size();
+        }
+
         void execute();
 
         void save();
 
+        /**
+         * Writes out K-mer counts from a binary coverage file produced by sect, in the same
+         * format as the text counts file.  Regions are either a sequence name, or
+         * "name:start-end" for an interval of 1-based, inclusive K-mer positions.  If
+         * no regions are given, all sequences are printed.
+         */
+        static void query(const path& cvgFile, const vector<string>& regions, std::ostream& out);
+
 
     private:
 
         void processSeqFile();
 
-        void analyseBatch();
-
-        void analyseBatchSlice(int th_id);
+        void processBatch(SeqBatch& batch, const uint16_t th_id);
 
         void merge();
 
-        void destroyBatchVars();
+        path samplePath(const string& name, const string& ext, const size_t sample) const;
+
+        void printCounts(std::ostream &out, const SeqBatch& batch, const size_t sample);
+
+        void printGCCounts(std::ostream &out, const SeqBatch& batch);
+
+        void printRegions(std::ostream &out, const SeqBatch& batch, const size_t sample, const uint32_t min_count, const uint32_t max_count);
 
-        void createBatchVars(uint16_t batchSize);
+        void printStatTable(std::ostream &out, const SeqBatch& batch);
 
-        void printCounts(std::ostream &out);
+        void printWindows(std::ostream &out, const SeqBatch& batch, const size_t sample);
 
-        void printGCCounts(std::ostream &out);
+        void printBedGraph(std::ostream &out, const SeqBatch& batch, const size_t sample);
 
-        void printRegions(std::ostream &out, const uint32_t min_count, const uint32_t max_count);
+        void calcWindows(SeqBatch& batch, const size_t index, const size_t sample, const string& seq);
 
-        void printStatTable(std::ostream &out);
+        void encodeCounts(SeqBatch& batch, const size_t index, const size_t sample);
+
+        void writeBinaryCounts(CoverageFileWriter& writer, const SeqBatch& batch, const size_t sample);
+
+        static string bedName(const seqan::CharString& name);
 
         // Print K-mer comparison matrix
 
         void printContaminationMatrix(std::ostream &out, const path seqFile);
 
-        // This method won't be optimal in most cases... Fasta files are normally sorted by length (largest first)
-        // So first thread will be asked to do more work than the rest
-        void processInBlocks(uint16_t th_id);
-
-        // This method is probably makes more efficient use of multiple cores on a length sorted fasta file
-        void processInterlaced(uint16_t th_id);
+        void printContaminationMatrixHeader(std::ostream &out, const path seqFile);
 
-        void processSeq(const size_t index, const uint16_t th_id);
+        void processSeq(SeqBatch& batch, const size_t index, const uint16_t th_id);
 
         double gcCountToPercentage(int16_t count);
 
@@ -303,10 +438,11 @@ namespace kat {
                             "This tool will produce a fasta style representation of the input sequence file containing " \
                             "K-mer coverage counts mapped across each sequence.  K-mer coverage is determined from the " \
                             "provided counts input file, which can be either one jellyfish hash, or one or more FastA / " \
-                            "FastQ files.  In addition, a space separated table file containing the mean coverage score and GC " \
+                            "FastQ files.  With --multi_sample, coverage from several count inputs is estimated in a single pass " \
+                            "over the sequence file.  In addition, a space separated table file containing the mean coverage score and GC " \
                             "of each sequence is produced.  The row order is identical to the original sequence file.\n\n" \
                             "NOTE: K-mers containing any Ns derived from sequences in the sequence file not be included.\n\n" \
-                            "WARNING: The <sequence_file> cannot be gzipped compressed.\n\n" \
+                            "WARNING: The <sequence_file> cannot be gzipped compressed.  It may be a FastA, FastQ or UCSC .2bit file.\n\n" \
                             "Options";
 
         }
@@ -0,0 +1,74 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <memory>
+using std::make_shared;
+
+#include "sequence_batch.hpp"
+
+kat::SequenceBatchReader::SequenceBatchReader(shared_ptr<SequenceIndex> _index, const path& seqFile) :
+        index(_index), reader(nullptr), nextRecord(0) {
+    if (!index) {
+        reader = make_shared<seqan::SeqFileIn>(seqFile.c_str());
+    }
+}
+
+kat::SequenceBatchReader::~SequenceBatchReader() {
+    if (reader) seqan::close(*reader);
+}
+
+bool kat::SequenceBatchReader::read(SequenceBatch& batch) {
+
+    // Fill the batch by bases rather than records, so that batches of long
+    // sequences and batches of short sequences involve similar amounts of work
+    uint64_t bases = 0;
+
+    if (index) {
+        // Only assign the records here, they are loaded by the worker
+        while (nextRecord < index->size() && bases < BATCH_BASES && batch.records.size() < BATCH_SIZE) {
+            bases += index->getLength(nextRecord);
+            batch.records.push_back(nextRecord++);
+        }
+
+        return !batch.records.empty();
+    }
+
+    seqan::CharString name;
+    seqan::CharString seq;
+    while (!seqan::atEnd(*reader) && bases < BATCH_BASES && seqan::length(batch.names) < BATCH_SIZE) {
+        seqan::readRecord(name, seq, *reader);
+        seqan::appendValue(batch.names, name);
+        seqan::appendValue(batch.seqs, seq);
+        bases += seqan::length(seq);
+    }
+
+    return batch.size() > 0;
+}
+
+void kat::SequenceBatchReader::load(SequenceBatch& batch) const {
+
+    if (!index) return;
+
+    for (auto r : batch.records) {
+        seqan::appendValue(batch.names, index->getHeader(r));
+        seqan::appendValue(batch.seqs, index->getSequence(r));
+    }
+}
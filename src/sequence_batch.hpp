@@ -0,0 +1,98 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+using std::shared_ptr;
+using std::vector;
+
+#include <seqan/basic.h>
+#include <seqan/sequence.h>
+#include <seqan/seq_io.h>
+
+#include <boost/filesystem/path.hpp>
+using boost::filesystem::path;
+
+#include <kat/sequence_index.hpp>
+using kat::SequenceIndex;
+
+namespace kat {
+
+    /**
+     * Sequences read from a sequence file as one batch of a pipeline.  Tools
+     * derive from this to hold whatever they calculate for the sequences.
+     */
+    struct SequenceBatch {
+        vector<size_t> records; // Records in the sequence index assigned to this batch, if indexed
+        seqan::StringSet<seqan::CharString> names;
+        seqan::StringSet<seqan::CharString> seqs;
+
+        size_t size() const {
+            return seqan::length(names);
+        }
+    };
+
+    /**
+     * Splits a sequence file into batches for a pipeline.  When the file is
+     * indexed or .2bit, read only assigns records to a batch and the worker
+     * loads them itself, so the reader isn't a bottleneck.  Otherwise the file
+     * is read sequentially and load does nothing.
+     */
+    class SequenceBatchReader {
+    public:
+
+        static const uint16_t BATCH_SIZE = 1024;        // Maximum number of records in a batch
+        static const uint64_t BATCH_BASES = 1000000;    // Batches are closed once they hold at least this many bases
+
+        /**
+         * Reads from the index if there is one, otherwise reads the file sequentially
+         */
+        SequenceBatchReader(shared_ptr<SequenceIndex> _index, const path& seqFile);
+
+        ~SequenceBatchReader();
+
+        bool isIndexed() const { return index != nullptr; }
+
+        /**
+         * Fills the next batch, returning false once the file is exhausted.  Not
+         * thread safe; call from the pipeline's reader.
+         */
+        bool read(SequenceBatch& batch);
+
+        /**
+         * Loads the records assigned to an indexed batch.  Safe to call from any
+         * worker.
+         */
+        void load(SequenceBatch& batch) const;
+
+        /**
+         * Number of records in a batch just returned by read
+         */
+        size_t nbRecords(const SequenceBatch& batch) const {
+            return index ? batch.records.size() : batch.size();
+        }
+
+    private:
+
+        shared_ptr<SequenceIndex> index;
+        shared_ptr<seqan::SeqFileIn> reader;
+        size_t nextRecord;
+    };
+}
@@ -0,0 +1,230 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdint.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <sys/ioctl.h>
+using std::cout;
+using std::endl;
+using std::make_shared;
+using std::ofstream;
+using std::ostream;
+using std::vector;
+
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/program_options/parsers.hpp>
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/positional_options.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <boost/timer/timer.hpp>
+namespace po = boost::program_options;
+using boost::lexical_cast;
+using boost::timer::auto_cpu_timer;
+
+#include <kat/jellyfish_helper.hpp>
+#include <kat/kat_fs.hpp>
+using kat::JellyfishHelper;
+using kat::KatFS;
+using kat::MappedDump;
+
+#include "top.hpp"
+
+kat::Top::Top(const vector<path>& _inputs) {
+
+    input.setMultipleInputs(_inputs);
+    input.index = 1;
+    outputPath = "kat.top";
+    threads = 1;
+    nbKmers = DEFAULT_TOP_NB_KMERS;
+    verbose = false;
+    merLen = 0;
+}
+
+void kat::Top::execute() {
+
+    // Validate input
+    input.validateInput();
+
+    // Create output directory
+    path parentDir = bfs::absolute(outputPath).parent_path();
+    KatFS::ensureDirectoryExists(parentDir);
+
+    top = make_shared<TopAnalysis>(nbKmers);
+    AnalysisEngine engine;
+    engine.add(top);
+
+    if (input.mode == InputHandler::InputMode::COUNT) {
+
+        input.count(threads);
+        merLen = input.merLen;
+
+        auto_cpu_timer timer(1, "  Time taken: %ws\n\n");
+        cout << "Finding the " << nbKmers << " most abundant kmers ...";
+        cout.flush();
+
+        engine.run(*input.hash, merLen, threads);
+    }
+    else {
+
+        auto_cpu_timer timer(1, "  Time taken: %ws\n\n");
+        cout << "Finding the " << nbKmers << " most abundant kmers in " << input.pathString() << " ...";
+        cout.flush();
+
+        // Stream the K-mers from the dump rather than loading it
+        MappedDump dump(input.getSingleInput());
+        merLen = dump.getMerLen();
+        input.merLen = merLen;
+
+        engine.run(dump, threads);
+    }
+
+    cout << " done.";
+    cout.flush();
+}
+
+void kat::Top::print(ostream& out) {
+    out << "# Most abundant " << merLen << "-mers in: " << input.pathString() << endl;
+    print(out, merLen, top->getTop());
+}
+
+void kat::Top::print(ostream& out, uint16_t merLen, const vector<TopAnalysis::Entry>& entries) {
+
+    out << "# " << merLen << "-mer\tcount\tgc_count\tgc%" << endl;
+    for (auto& e : entries) {
+        const uint32_t gc = JellyfishHelper::gcCount(e.second);
+        out << e.second.to_str() << "\t" << e.first << "\t" << gc << "\t"
+            << std::fixed << std::setprecision(1) << (100.0 * gc / merLen) << "\n";
+    }
+}
+
+void kat::Top::save() {
+
+    auto_cpu_timer timer(1, "  Time taken: %ws\n\n");
+
+    cout << "Saving results to disk ...";
+    cout.flush();
+
+    ofstream out(outputPath.c_str());
+    print(out);
+    out.close();
+
+    cout << " done.";
+    cout.flush();
+}
+
+int kat::Top::main(int argc, char *argv[]) {
+
+    vector<path>    inputs;
+    path            output_path;
+    uint16_t        threads;
+    size_t          nb_kmers;
+    string          trim5p;
+    bool            non_canonical;
+    uint16_t        mer_len;
+    uint64_t        hash_size;
+    bool            verbose;
+    bool            help;
+
+    struct winsize w;
+    ioctl(STDOUT_FILENO, TIOCGWINSZ, &w);
+
+
+    // Declare the supported options.
+    po::options_description generic_options(Top::helpMessage(), w.ws_col);
+    generic_options.add_options()
+            ("output,o", po::value<path>(&output_path)->default_value(path("kat.top")),
+                "Path to the output file.")
+            ("threads,t", po::value<uint16_t>(&threads)->default_value(1),
+                "The number of threads to use")
+            ("nb_kmers,n", po::value<size_t>(&nb_kmers)->default_value(DEFAULT_TOP_NB_KMERS),
+                "The number of K-mers to report")
+            ("5ptrim", po::value<string>(&trim5p)->default_value("0"),
+                "Ignore the first X bases from reads.  If more that one file is provided you can specify different values for each file by seperating with commas.")
+            ("non_canonical,N", po::bool_switch(&non_canonical)->default_value(false),
+                "If counting fast(a/q), store explicit kmer as found.  By default, we store 'canonical' k-mers, which means we count both strands.")
+            ("mer_len,m", po::value<uint16_t>(&mer_len)->default_value(DEFAULT_MER_LEN),
+                "The kmer length to use in the kmer hashes.  Larger values will provide more discriminating power between kmers but at the expense of additional memory and lower coverage.")
+            ("hash_size,H", po::value<uint64_t>(&hash_size)->default_value(DEFAULT_HASH_SIZE),
+                "If kmer counting is required for the input, then use this value as the hash size.  If this hash size is not large enough for your dataset then the default behaviour is to double the size of the hash and recount, which will increase runtime and memory usage.")
+            ("verbose,v", po::bool_switch(&verbose)->default_value(false),
+                "Print extra information.")
+            ("help", po::bool_switch(&help)->default_value(false), "Produce help message.")
+            ;
+
+    // Hidden options, will be allowed both on command line and
+    // in config file, but will not be shown to the user.
+    po::options_description hidden_options("Hidden options");
+    hidden_options.add_options()
+            ("inputs", po::value<std::vector<path>>(&inputs), "Path to the input file(s) to process.")
+            ;
+
+    // Positional option for the input bam file
+    po::positional_options_description p;
+    p.add("inputs", -1);
+
+    // Combine non-positional options
+    po::options_description cmdline_options;
+    cmdline_options.add(generic_options).add(hidden_options);
+
+    // Parse command line
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(cmdline_options).positional(p).run(), vm);
+    po::notify(vm);
+
+    // Output help information the exit if requested
+    if (help || argc <= 1) {
+        cout << generic_options << endl;
+        return 1;
+    }
+
+    vector<string> d1_5ptrim_strs;
+    vector<uint16_t> d1_5ptrim_vals;
+    boost::split(d1_5ptrim_strs,trim5p,boost::is_any_of(","));
+    for (auto& v : d1_5ptrim_strs) d1_5ptrim_vals.push_back(boost::lexical_cast<uint16_t>(v));
+
+    auto_cpu_timer timer(1, "KAT TOP completed.\nTotal runtime: %ws\n\n");
+
+    cout << "Running KAT in TOP mode" << endl
+         << "-----------------------" << endl << endl;
+
+    Top top(inputs);
+    top.setThreads(threads);
+    top.setCanonical(!non_canonical);
+    top.setTrim(d1_5ptrim_vals);
+    top.setHashSize(hash_size);
+    top.setMerLen(mer_len);
+    top.setOutputPath(output_path);
+    top.setNbKmers(nb_kmers);
+    top.setVerbose(verbose);
+
+    // Do the work
+    top.execute();
+
+    // Save results
+    top.save();
+
+    return 0;
+}
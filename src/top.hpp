@@ -0,0 +1,151 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#pragma once
+
+#include <stdint.h>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+using std::ostream;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+#include <boost/exception/exception.hpp>
+#include <boost/exception/info.hpp>
+#include <boost/filesystem/path.hpp>
+namespace bfs = boost::filesystem;
+using bfs::path;
+
+#include <kat/input_handler.hpp>
+#include <kat/kmer_analysis.hpp>
+using kat::InputHandler;
+using kat::AnalysisEngine;
+using kat::TopAnalysis;
+
+typedef boost::error_info<struct TopError,string> TopErrorInfo;
+struct TopException: virtual boost::exception, virtual std::exception { };
+
+
+namespace kat {
+
+    const size_t     DEFAULT_TOP_NB_KMERS = 100;
+
+    /**
+     * Finds the most abundant K-mers.  Each thread keeps a bounded heap of the best
+     * K-mers in its slice of the hash, and the heaps are merged at the end, so only
+     * N K-mers per thread are ever held.
+     */
+    class Top {
+    private:
+
+        // Input args
+        InputHandler    input;
+        path            outputPath;
+        uint16_t        threads;
+        size_t          nbKmers;
+        bool            verbose;
+
+        // Results
+        uint16_t        merLen;
+        shared_ptr<TopAnalysis> top;
+
+    public:
+
+        Top(const vector<path>& _inputs);
+
+        virtual ~Top() {
+        }
+
+        void setTrim(const vector<uint16_t>& _5ptrim) {
+            this->input.set5pTrim(_5ptrim);
+        }
+
+        void setCanonical(bool canonical) {
+            this->input.canonical = canonical;
+        }
+
+        void setHashSize(uint64_t hashSize) {
+            this->input.hashSize = hashSize;
+        }
+
+        uint16_t getMerLen() const {
+            return merLen;
+        }
+
+        void setMerLen(uint16_t merLen) {
+            this->input.merLen = merLen;
+        }
+
+        path getOutputPath() const {
+            return outputPath;
+        }
+
+        void setOutputPath(path outputPath) {
+            this->outputPath = outputPath;
+        }
+
+        void setThreads(uint16_t threads) {
+            this->threads = threads;
+        }
+
+        size_t getNbKmers() const {
+            return nbKmers;
+        }
+
+        void setNbKmers(size_t nbKmers) {
+            this->nbKmers = nbKmers;
+        }
+
+        void setVerbose(bool verbose) {
+            this->verbose = verbose;
+        }
+
+        const vector<TopAnalysis::Entry>& getTop() const {
+            return top->getTop();
+        }
+
+        void execute();
+
+        void print(ostream& out);
+
+        void save();
+
+        /**
+         * Writes one line per K-mer, with its count, GC count and GC percentage
+         */
+        static void print(ostream& out, uint16_t merLen, const vector<TopAnalysis::Entry>& entries);
+
+    protected:
+
+        static const string helpMessage() {
+             return string("Usage: kat top [options] (<input>)+\n\n") +
+                            "Lists the most abundant K-mers.\n\n" +
+                            "Takes either a jellyfish hash or one or more FastA or FastQ files.  Sequence files are counted " \
+                            "first, whereas hashes are read straight from disk without being loaded.  The N K-mers with the " \
+                            "highest counts are written out in descending order of count, along with their GC content.  This is " \
+                            "useful for spotting adapters and organelle or other high copy contamination.\n\n" \
+                            "Options";
+        }
+
+    public:
+
+        static int main(int argc, char *argv[]);
+    };
+}
@@ -18,12 +18,17 @@
 #include <gtest/gtest.h>
 
 #include <memory>
+#include <vector>
 using std::shared_ptr;
 using std::make_shared;
+using std::vector;
 
 #include <kat/comp_counters.hpp>
+#include <kat/jellyfish_helper.hpp>
 using kat::ThreadedCompCounters;
 using kat::CompCounters;
+using kat::HashLoader;
+using kat::JellyfishHelper;
     
 
 
@@ -60,3 +65,128 @@ TEST( comp_counters, threaded_counters ) {
     EXPECT_EQ( tcc.getFinalMatrix().hash1_total, 60);
     
 }
+
+TEST( comp_counters, sample_scaling ) {
+
+    CompCounters cc;
+
+    cc.updateHash1Counters(10, 2);
+    cc.updateHash1Counters(20, 0);
+    cc.updateSharedCounters(10, 2);
+    cc.updateHash2Counters(10, 2);
+
+    cc.scale(0.25);
+
+    EXPECT_EQ( cc.sample_fraction, 0.25 );
+    EXPECT_EQ( cc.hash1_total, 120 );
+    EXPECT_EQ( cc.hash1_distinct, 8 );
+    EXPECT_EQ( cc.hash1_only_distinct, 4 );
+    EXPECT_EQ( cc.shared_distinct, 4 );
+    EXPECT_EQ( cc.spectrum1[10], 4 );
+    EXPECT_EQ( cc.spectrum2[2], 4 );
+
+    // Copies keep the fraction
+    CompCounters copy(cc);
+    EXPECT_EQ( copy.sample_fraction, 0.25 );
+
+    EXPECT_DOUBLE_EQ( CompCounters::relativeStdError(100, 1.0), 0.0 );
+    EXPECT_DOUBLE_EQ( CompCounters::relativeStdError(400, 0.5), 0.05 );
+}
+
+TEST( comp_counters, sample_selection ) {
+
+    const vector<uint16_t> trim = { 0, 0 };
+    const vector<path> r1 = { DATADIR "/ecoli_r1.1K.fastq" };
+    const vector<path> both = { DATADIR "/ecoli_r1.1K.fastq", DATADIR "/ecoli_r2.1K.fastq" };
+    const double fraction = 0.25;
+    const uint64_t threshold = JellyfishHelper::sampleThreshold(fraction);
+
+    EXPECT_EQ( JellyfishHelper::sampleThreshold(1.0), UINT64_MAX );
+
+    mer_dna::k(27);
+    HashCounter hcFull(100000, 27 * 2, 7, 1);
+    LargeHashArrayPtr full = JellyfishHelper::countSeqFile(r1, hcFull, true, 1, trim, trim);
+    mer_dna::k(27);
+    HashCounter hc1(100000, 27 * 2, 7, 2);
+    LargeHashArrayPtr sampled1 = JellyfishHelper::countSeqFile(r1, hc1, true, 2, trim, trim, fraction);
+    mer_dna::k(27);
+    HashCounter hc2(100000, 27 * 2, 7, 2);
+    LargeHashArrayPtr sampled2 = JellyfishHelper::countSeqFile(both, hc2, true, 2, trim, trim, fraction);
+
+    // Every K-mer is either kept from both hashes, with its full count, or from neither
+    uint64_t distinct = 0, kept = 0;
+    LargeHashArray::region_iterator it = full->region_slice(0, 1);
+    while (it.next()) {
+        const bool in = JellyfishHelper::inSample(it.key(), threshold);
+        EXPECT_EQ( JellyfishHelper::getCount(sampled1, it.key(), false), in ? it.val() : 0 );
+        EXPECT_EQ( JellyfishHelper::getCount(sampled2, it.key(), false) > 0, in );
+        distinct++;
+        if (in) kept++;
+    }
+
+    ASSERT_GT( distinct, 10000 );
+    EXPECT_NEAR( (double)kept / distinct, fraction, 0.02 );
+}
+
+TEST( comp_counters, sample_mixed_modes ) {
+
+    const vector<uint16_t> trim = { 0 };
+    const vector<path> r1 = { DATADIR "/ecoli_r1.1K.fastq" };
+    const double fraction = 0.25;
+    const uint64_t threshold = JellyfishHelper::sampleThreshold(fraction);
+
+    mer_dna::k(27);
+    HashCounter hcFull(100000, 27 * 2, 7, 1);
+    LargeHashArrayPtr full = JellyfishHelper::countSeqFile(r1, hcFull, true, 1, trim, trim);
+    mer_dna::k(27);
+    HashCounter hcCanon(100000, 27 * 2, 7, 2);
+    LargeHashArrayPtr canon = JellyfishHelper::countSeqFile(r1, hcCanon, true, 2, trim, trim, fraction);
+    mer_dna::k(27);
+    HashCounter hcRaw(100000, 27 * 2, 7, 2);
+    LargeHashArrayPtr raw = JellyfishHelper::countSeqFile(r1, hcRaw, false, 2, trim, trim, fraction);
+
+    // An input counted without canonical K-mers keeps the same K-mers, on either
+    // strand, as one counted with them, so comp can look them up in each other
+    LargeHashArray::region_iterator it = full->region_slice(0, 1);
+    while (it.next()) {
+        const bool in = JellyfishHelper::inSample(it.key(), threshold);
+        mer_dna rc(it.key());
+        rc.reverse_complement();
+        EXPECT_EQ( JellyfishHelper::getCount(canon, it.key(), false) > 0, in );
+        EXPECT_EQ( JellyfishHelper::getCount(raw, it.key(), false) + JellyfishHelper::getCount(raw, rc, false),
+                in ? it.val() : 0 );
+        EXPECT_EQ( JellyfishHelper::inSample(rc, threshold), in );
+    }
+}
+
+TEST( comp_counters, sample_load ) {
+
+    const path jf = DATADIR "/ecoli.header.jf27";
+    const double fraction = 0.5;
+    const uint64_t threshold = JellyfishHelper::sampleThreshold(fraction);
+
+    HashLoader fullLoader;
+    LargeHashArrayPtr full = fullLoader.loadHash(jf, false);
+    HashLoader sampledLoader;
+    LargeHashArrayPtr sampled = sampledLoader.loadHash(jf, false, fraction);
+
+    // Only the sampled K-mers are loaded, with their counts unchanged
+    uint64_t distinct = 0, kept = 0, loaded = 0;
+    LargeHashArray::region_iterator it = full->region_slice(0, 1);
+    while (it.next()) {
+        const bool in = JellyfishHelper::inSample(it.key(), threshold);
+        EXPECT_EQ( JellyfishHelper::getCount(sampled, it.key(), false), in ? it.val() : 0 );
+        distinct++;
+        if (in) kept++;
+    }
+    LargeHashArray::region_iterator it2 = sampled->region_slice(0, 1);
+    while (it2.next()) {
+        EXPECT_TRUE( JellyfishHelper::inSample(it2.key(), threshold) );
+        loaded++;
+    }
+
+    EXPECT_EQ( loaded, kept );
+    EXPECT_NEAR( (double)kept / distinct, fraction, 0.05 );
+
+    mer_dna::k(27);
+}
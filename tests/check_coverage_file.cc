@@ -0,0 +1,149 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <iterator>
+#include <vector>
+using std::ifstream;
+using std::vector;
+
+#include <kat/coverage_file.hpp>
+using kat::CoverageFile;
+using kat::CoverageFileWriter;
+
+namespace kat {
+
+vector<string> encode(const vector<uint64_t>& counts, uint32_t blockSize) {
+    vector<string> blocks;
+    for (size_t i = 0; i < counts.size(); i += blockSize) {
+        blocks.push_back(CoverageFile::encodeBlock(counts.data() + i, std::min<size_t>(blockSize, counts.size() - i)));
+    }
+    return blocks;
+}
+
+TEST(coverage_file, roundtrip) {
+
+    // Runs, large values and values that need multi-byte varints
+    vector<uint64_t> seq1;
+    for (uint64_t i = 0; i < 1000; i++) {
+        seq1.push_back(i < 100 ? 0 : i < 500 ? (i / 7) : i * 1000003);
+    }
+    seq1.push_back(UINT64_MAX);
+    vector<uint64_t> seq2(33, 5);
+    vector<uint64_t> empty;
+
+    const uint32_t blockSize = 64;
+    path file("temp_coverage.cvgb");
+
+    CoverageFileWriter writer(file, 27, blockSize);
+    writer.add("seq1 first sequence", seq1.size(), encode(seq1, blockSize));
+    writer.add("short", 0, encode(empty, blockSize));
+    writer.add("seq2", seq2.size(), encode(seq2, blockSize));
+    EXPECT_THROW( writer.add("bad", 100, encode(seq2, blockSize)), CoverageFileException );
+    writer.close();
+
+    EXPECT_TRUE( CoverageFile::isCoverageFile(file) );
+    EXPECT_FALSE( CoverageFile::isCoverageFile(DATADIR "/sect_test.fa") );
+
+    CoverageFile cf(file);
+    ASSERT_EQ( cf.size(), 3 );
+    EXPECT_EQ( cf.getMerLen(), 27 );
+    EXPECT_EQ( cf.getBlockSize(), blockSize );
+    EXPECT_EQ( cf.getName(0), "seq1 first sequence" );
+    EXPECT_EQ( cf.getLength(0), seq1.size() );
+    EXPECT_EQ( cf.getLength(1), 0 );
+    EXPECT_EQ( cf.find("seq1 first sequence"), 0 );
+    EXPECT_EQ( cf.find("seq1"), 0 );
+    EXPECT_EQ( cf.find("seq2"), 2 );
+    EXPECT_EQ( cf.find("seq3"), -1 );
+
+    vector<uint64_t> counts;
+    cf.get(0, counts);
+    EXPECT_EQ( counts, seq1 );
+    cf.get(1, counts);
+    EXPECT_TRUE( counts.empty() );
+    cf.get(2, counts);
+    EXPECT_EQ( counts, seq2 );
+
+    // Intervals within and across block boundaries
+    for (uint64_t start : {0, 1, 63, 64, 65, 500, 990}) {
+        for (uint64_t len : {0, 1, 2, 63, 64, 65, 200}) {
+            const uint64_t end = std::min<uint64_t>(start + len, seq1.size());
+            cf.get(0, start, end, counts);
+            EXPECT_EQ( counts, vector<uint64_t>(seq1.begin() + start, seq1.begin() + end) );
+        }
+    }
+
+    EXPECT_THROW( cf.get(0, 10, seq1.size() + 1, counts), CoverageFileException );
+    EXPECT_THROW( cf.get(3, counts), CoverageFileException );
+    EXPECT_THROW( CoverageFile(DATADIR "/sect_test.fa"), CoverageFileException );
+
+    remove("temp_coverage.cvgb");
+}
+
+TEST(coverage_file, corrupt) {
+
+    vector<uint64_t> counts;
+    const vector<uint64_t> five(5, 3);
+    const string block = CoverageFile::encodeBlock(five.data(), five.size());
+    CoverageFile::decodeBlock(block.data(), block.size(), 5, counts);
+    EXPECT_EQ( counts, five );
+
+    // A run longer than the block must be refused before anything is allocated
+    counts.clear();
+    EXPECT_THROW( CoverageFile::decodeBlock(block.data(), block.size(), 4, counts), CoverageFileException );
+
+    // Value 7, run of 2^63
+    const string huge("\x07\x80\x80\x80\x80\x80\x80\x80\x80\x80\x01", 11);
+    counts.clear();
+    EXPECT_THROW( CoverageFile::decodeBlock(huge.data(), huge.size(), 65536, counts), CoverageFileException );
+    EXPECT_TRUE( counts.empty() );
+}
+
+TEST(coverage_file, little_endian) {
+
+    const vector<uint64_t> seq(3, 0x0102);
+    path file("temp_endian.cvgb");
+    CoverageFileWriter writer(file, 27, 0x0100);
+    writer.add("s", seq.size(), encode(seq, 0x0100));
+    writer.close();
+
+    // Check the bytes on disk, whatever the host order
+    ifstream in(file.c_str(), std::ios::binary);
+    string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+
+    ASSERT_GE( bytes.size(), sizeof(CoverageFileHeader) );
+    EXPECT_EQ( bytes[8], 1 );       // version
+    EXPECT_EQ( bytes[12], 0 );      // block size, low byte first
+    EXPECT_EQ( bytes[13], 1 );
+    EXPECT_EQ( bytes[16], 27 );     // K
+    EXPECT_EQ( bytes[24], 1 );      // number of sequences
+    EXPECT_EQ( bytes[31], 0 );
+
+    CoverageFile cf(file);
+    EXPECT_EQ( cf.getBlockSize(), 0x0100 );
+    vector<uint64_t> counts;
+    cf.get(0, counts);
+    EXPECT_EQ( counts, seq );
+
+    remove("temp_endian.cvgb");
+}
+
+}
@@ -0,0 +1,74 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+using std::vector;
+
+#include <kat/coverage_stats.hpp>
+using kat::CoverageStats;
+
+namespace kat {
+
+TEST(coverage_stats, median) {
+
+    CoverageStats empty;
+    EXPECT_EQ( empty.median(), 0 );
+    EXPECT_EQ( empty.mean(), 0.0 );
+
+    // Mostly low counts with some very high ones, so both the histogram and the
+    // high count fallback get used
+    std::mt19937_64 rng(42);
+    for (uint32_t n : {1, 2, 3, 10, 101, 5000}) {
+        for (uint64_t highFreq : {0, 3, 1}) {
+
+            vector<uint64_t> counts;
+            CoverageStats a, b;
+            uint64_t sum = 0, nonZero = 0, invalid = 0;
+            for (uint32_t i = 0; i < n; i++) {
+                const bool isInvalid = rng() % 10 == 0;
+                const uint64_t c = isInvalid ? 0 :
+                        highFreq > 0 && rng() % highFreq == 0 ? CoverageStats::MAX_HIST + rng() % 1000000 : rng() % 50;
+                CoverageStats& s = i < n / 3 ? a : b;
+                if (isInvalid) {
+                    s.addInvalid();
+                    invalid++;
+                }
+                else {
+                    s.add(c);
+                }
+                counts.push_back(c);
+                sum += c;
+                if (c != 0) nonZero++;
+            }
+
+            a.merge(b);
+            std::sort(counts.begin(), counts.end());
+
+            EXPECT_EQ( a.size(), n );
+            EXPECT_EQ( a.median(), counts[counts.size() / 2] );
+            EXPECT_EQ( a.mean(), (double)sum / (double)n );
+            EXPECT_EQ( a.getNonZero(), nonZero );
+            EXPECT_EQ( a.getInvalid(), invalid );
+        }
+    }
+}
+
+}
@@ -0,0 +1,102 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <sstream>
+using std::ifstream;
+using std::ofstream;
+using std::stringstream;
+
+#include <boost/filesystem/operations.hpp>
+namespace bfs = boost::filesystem;
+
+#include <kat/fasta_index.hpp>
+using kat::FastaIndex;
+
+namespace kat {
+
+void writeFile(const path& file, const string& contents) {
+    ofstream out(file.c_str(), std::ios::binary);
+    out << contents;
+}
+
+TEST(fasta_index, build) {
+
+    path fa("temp_fasta_index.fa");
+    bfs::remove(FastaIndex::indexPath(fa));
+    writeFile(fa,
+        ">seq1 first sequence\n"
+        "ACGTA\nCGTAC\nGT\n"
+        ">empty\n"
+        ">seq2\r\n"
+        "AAAA\r\nCC\r\n"
+        "\n"
+        ">seq3\tlast\n"
+        "GGGGG\nTT");
+
+    FastaIndex index(fa);
+    ASSERT_EQ( index.size(), 4 );
+    EXPECT_EQ( index[0].name, "seq1" );
+    EXPECT_EQ( index[0].length, 12 );
+    EXPECT_EQ( index[0].offset, 21 );
+    EXPECT_EQ( index[0].lineBases, 5 );
+    EXPECT_EQ( index[0].lineWidth, 6 );
+    EXPECT_EQ( index[1].length, 0 );
+    EXPECT_EQ( index[2].lineWidth, 6 );
+
+    EXPECT_EQ( index.getHeader(0), "seq1 first sequence" );
+    EXPECT_EQ( index.getHeader(1), "empty" );
+    EXPECT_EQ( index.getHeader(2), "seq2" );
+    EXPECT_EQ( index.getHeader(3), "seq3\tlast" );
+    EXPECT_EQ( index.getSequence(0), "ACGTACGTACGT" );
+    EXPECT_EQ( index.getSequence(1), "" );
+    EXPECT_EQ( index.getSequence(2), "AAAACC" );
+    EXPECT_EQ( index.getSequence(3), "GGGGGTT" );
+
+    // The index should have been saved in samtools format, and is used next time
+    ifstream in(FastaIndex::indexPath(fa).c_str());
+    ASSERT_TRUE( in.good() );
+    stringstream fai;
+    fai << in.rdbuf();
+    EXPECT_EQ( fai.str().substr(0, 20), "seq1\t12\t21\t5\t6\nempty" );
+
+    FastaIndex reloaded(fa);
+    ASSERT_EQ( reloaded.size(), 4 );
+    EXPECT_EQ( reloaded.getSequence(3), "GGGGGTT" );
+
+    bfs::remove(FastaIndex::indexPath(fa));
+}
+
+TEST(fasta_index, unindexable) {
+
+    path fa("temp_fasta_index_bad.fa");
+    bfs::remove(FastaIndex::indexPath(fa));
+
+    // Inconsistent line lengths
+    writeFile(fa, ">seq1\nACG\nACGT\n");
+    EXPECT_THROW( FastaIndex index(fa), FastaIndexException );
+
+    // Not FastA
+    writeFile(fa, "@read1\nACGT\n+\nIIII\n");
+    EXPECT_THROW( FastaIndex index(fa), FastaIndexException );
+
+    EXPECT_FALSE( bfs::exists(FastaIndex::indexPath(fa)) );
+}
+
+}
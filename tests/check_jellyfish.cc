@@ -27,11 +27,15 @@ using std::chrono::duration_cast;
 template<typename DtnType>
 inline double as_seconds(DtnType dtn) { return duration_cast<duration<double>>(dtn).count(); }
 
+#include <kat/str_utils.hpp>
 #include <kat/jellyfish_helper.hpp>
 #include <kat/input_handler.hpp>
+#include <kat/multi_k_counter.hpp>
 using kat::JellyfishHelper;
 using kat::InputHandler;
 using kat::HashLoader;
+using kat::MappedDump;
+using kat::MultiKCounter;
 
 namespace kat {
 
@@ -90,6 +94,133 @@ TEST(jellyfish, query) {
     EXPECT_EQ( countEndCan, 0 );
 }
 
+TEST(jellyfish, mapped_dump) {
+
+    HashLoader hl;
+    LargeHashArrayPtr hash = hl.loadHash(DATADIR "/ecoli.header.jf27", false);
+
+    MappedDump dump(DATADIR "/ecoli.header.jf27");
+    EXPECT_EQ( dump.getMerLen(), 27 );
+
+    // Slices cover every record exactly once
+    pair<uint64_t, uint64_t> s1 = dump.slice(0, 3);
+    pair<uint64_t, uint64_t> s3 = dump.slice(2, 3);
+    EXPECT_EQ( s1.first, 0 );
+    EXPECT_EQ( s3.second, dump.size() );
+    EXPECT_EQ( dump.slice(1, 3).first, s1.second );
+
+    // Every record matches the count in the loaded hash
+    mer_dna kmer;
+    uint64_t nbRecords = 0;
+    for (uint64_t i = 0; i < dump.size(); i++) {
+        dump.key(i, kmer);
+        EXPECT_EQ( dump.val(i), JellyfishHelper::getCount(hash, kmer, false) );
+        nbRecords++;
+    }
+    EXPECT_GT( nbRecords, 0 );
+}
+
+TEST(jellyfish, multi_k) {
+
+    const vector<path> reads = { DATADIR "/ecoli_r1.1K.fastq" };
+    const vector<uint16_t> trim = { 0 };
+
+    // Spectrum for K=21 counted the normal way
+    mer_dna::k(21);
+    HashCounter hc(100000, 21 * 2, 7, 1);
+    LargeHashArrayPtr hash = JellyfishHelper::countSeqFile(reads, hc, true, 1, trim, trim);
+    vector<uint64_t> expected(1001, 0);
+    LargeHashArray::region_iterator it = hash->region_slice(0, 1);
+    while (it.next()) {
+        ++expected[std::min<uint64_t>(it.val(), 1000)];
+    }
+    mer_dna::k(27);
+
+    // Start with a tiny hash so that it has to grow while counting
+    MultiKCounter mkc({ 27, 21 }, 1000, true, true);
+    mkc.count(reads, 4, trim);
+    ASSERT_EQ( mkc.size(), 2 );
+    EXPECT_EQ( mkc.getCounter(1).getMerLen(), 21 );
+
+    vector<uint64_t> spectrum(1001, 0);
+    mkc.getCounter(1).spectrum(0, 2, spectrum);
+    mkc.getCounter(1).spectrum(1, 2, spectrum);
+    EXPECT_EQ( spectrum, expected );
+
+    // Counting 27-mers alongside doesn't disturb the global mer_dna K
+    EXPECT_EQ( mer_dna::k(), 27 );
+
+    // A full hash that isn't allowed to grow is reported from the counting threads
+    MultiKCounter fixed({ 27 }, 1000, true, false);
+    EXPECT_THROW( fixed.count(reads, 4, trim), kat::MultiKCounterException );
+}
+
+TEST(jellyfish, multi_k_groups) {
+
+    const vector<path> r1 = { DATADIR "/ecoli_r1.1K.fastq" };
+    const vector<path> both = { DATADIR "/ecoli_r1.1K.fastq", DATADIR "/ecoli_r2.1K.fastq" };
+    const vector<uint16_t> trim = { 0, 0 };
+
+    MultiKCounter single({ 27 }, 100000, true, true);
+    single.count(r1, 2, { 0 });
+
+    MultiKCounter grouped({ 27 }, 100000, true, true, { 0, 1 });
+    grouped.count(both, 2, trim);
+    ASSERT_EQ( grouped.nbGroups(), 2 );
+
+    vector<uint64_t> expected(1001, 0), group1(1001, 0), group2(1001, 0), merged(1001, 0);
+    single.getCounter(0).spectrum(0, 1, expected);
+    grouped.getGroupCounter(0, 0).spectrum(0, 1, group1);
+    grouped.getGroupCounter(0, 1).spectrum(0, 1, group2);
+    grouped.getCounter(0).spectrum(0, 1, merged);
+
+    // The first group only contains the first file
+    EXPECT_EQ( group1, expected );
+    EXPECT_NE( group2, expected );
+    EXPECT_NE( merged, expected );
+
+    EXPECT_THROW( grouped.count(r1, 1, { 0 }), kat::MultiKCounterException );
+
+    // Groups must be contiguous
+    EXPECT_THROW( MultiKCounter({ 27 }, 100000, true, true, { 0, 4 }), kat::MultiKCounterException );
+}
+
+TEST(jellyfish, gc_count) {
+
+    mer_dna::k(21);
+    EXPECT_EQ( JellyfishHelper::gcCount(mer_dna("AAAAAAAAAAAAAAAAAAAAA")), 0 );
+    EXPECT_EQ( JellyfishHelper::gcCount(mer_dna("GCGCGCGCGCGCGCGCGCGCG")), 21 );
+    EXPECT_EQ( JellyfishHelper::gcCount(mer_dna("ACGTACGTACGTACGTACGTA")), 10 );
+
+    // Multi-word K-mers and batches of single word K-mers agree with counting the string
+    const string bases = "ACGT";
+    for (unsigned int k : { 31u, 47u }) {
+        mer_dna::k(k);
+        vector<uint64_t> words;
+        vector<uint32_t> expected;
+        for (uint32_t i = 0; i < 103; i++) {
+            string seq;
+            for (unsigned int j = 0; j < k; j++) {
+                seq += bases[(i * 7 + j * j + (j >> i % 3)) % 4];
+            }
+            mer_dna m(seq);
+            EXPECT_EQ( JellyfishHelper::gcCount(m), kat::gcCount(seq) );
+            words.push_back(m.word(0));
+            expected.push_back(kat::gcCount(seq));
+        }
+
+        if (k <= 32) {
+            vector<uint8_t> gc(words.size());
+            JellyfishHelper::gcCountBatch(words.data(), words.size(), gc.data());
+            for (size_t i = 0; i < words.size(); i++) {
+                EXPECT_EQ( gc[i], expected[i] );
+            }
+        }
+    }
+
+    mer_dna::k(27);
+}
+
 TEST(jellyfish, slice) {
 
     HashLoader hl;
@@ -179,6 +310,61 @@ TEST(jellyfish, dump) {
     remove("temp_dump.jf");
 }
 
+TEST(jellyfish, seed_count) {
+
+    // Count the first file and dump it, as a previous run would
+    InputHandler first;
+    first.setSingleInput(DATADIR "/ecoli_r1.1K.fastq");
+    first.canonical = true;
+    first.merLen = 27;
+    first.hashSize = 100000;
+    first.count(2);
+    first.dump("temp_seed.jf27", 2);
+
+    // Then only count the new file on top of the old counts, starting from a small
+    // hash so that it has to grow
+    InputHandler update;
+    update.setSingleInput(DATADIR "/ecoli_r2.1K.fastq");
+    update.canonical = true;
+    update.merLen = 27;
+    update.hashSize = 1000;
+    update.seedHash = "temp_seed.jf27";
+    update.count(2);
+
+    // Should be the same as counting everything at once
+    InputHandler both;
+    both.setMultipleInputs({ DATADIR "/ecoli_r1.1K.fastq", DATADIR "/ecoli_r2.1K.fastq" });
+    both.canonical = true;
+    both.merLen = 27;
+    both.hashSize = 100000;
+    both.count(2);
+
+    uint64_t distinct = 0;
+    LargeHashArray::region_iterator it = both.hash->region_slice(0, 1);
+    while (it.next()) {
+        EXPECT_EQ( JellyfishHelper::getCount(update.hash, it.key(), false), it.val() );
+        distinct++;
+    }
+
+    uint64_t updateDistinct = 0;
+    LargeHashArray::region_iterator uit = update.hash->region_slice(0, 1);
+    while (uit.next()) {
+        updateDistinct++;
+    }
+    EXPECT_EQ( updateDistinct, distinct );
+
+    // K must match
+    InputHandler wrongK;
+    wrongK.setSingleInput(DATADIR "/ecoli_r2.1K.fastq");
+    wrongK.canonical = true;
+    wrongK.merLen = 21;
+    wrongK.seedHash = "temp_seed.jf27";
+    EXPECT_THROW( wrongK.count(1), kat::InputFileException );
+
+    remove("temp_seed.jf27");
+    mer_dna::k(27);
+}
+
 TEST(jellyfish, negseqtest) {
     path jfpath = path(DATADIR "/ecoli.header.jf27");
 
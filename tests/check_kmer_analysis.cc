@@ -0,0 +1,122 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#include <gtest/gtest.h>
+
+#include <math.h>
+#include <memory>
+using std::make_shared;
+
+#include <kat/jellyfish_helper.hpp>
+#include <kat/kmer_analysis.hpp>
+using kat::AnalysisEngine;
+using kat::BoundsAnalysis;
+using kat::GcpAnalysis;
+using kat::HashLoader;
+using kat::JellyfishHelper;
+using kat::MappedDump;
+using kat::SpectrumAnalysis;
+using kat::TopAnalysis;
+
+namespace kat {
+
+TEST(kmer_analysis, engine) {
+
+    HashLoader hl;
+    LargeHashArrayPtr hash = hl.loadHash(DATADIR "/ecoli.header.jf27", false);
+
+    // Expected results from a plain iteration over the hash
+    vector<uint64_t> spectrum(101, 0);
+    vector<uint64_t> gcp(28 * 11, 0);
+    uint64_t inDistinct = 0, inTotal = 0, allTotal = 0, distinct = 0;
+    uint64_t maxCount = 0;
+    LargeHashArray::region_iterator it = hash->region_slice(0, 1);
+    while (it.next()) {
+        const uint64_t c = it.val();
+        const uint32_t gc = JellyfishHelper::gcCount(it.key());
+        ++spectrum[std::min<uint64_t>(c, 101) - 1];
+        ++gcp[gc * 11 + std::min<uint64_t>(c, 10)];
+        if (c >= 2 && c <= 50 && gc >= 10 && gc <= 17) {
+            inDistinct++;
+            inTotal += c;
+        }
+        allTotal += c;
+        distinct++;
+        maxCount = std::max(maxCount, c);
+    }
+
+    auto sa = make_shared<SpectrumAnalysis>(1, 100, 1);
+    auto ga = make_shared<GcpAnalysis>(10, 1.0);
+    auto ba = make_shared<BoundsAnalysis>(2, 50, 10, 17);
+    auto ta = make_shared<TopAnalysis>(5);
+
+    AnalysisEngine engine;
+    engine.add(sa);
+    engine.add(ga);
+    engine.add(ba);
+    engine.add(ta);
+    engine.run(*hash, 27, 3);
+
+    EXPECT_EQ( sa->getBase(), 1 );
+    EXPECT_EQ( sa->getHistogram(), spectrum );
+
+    SM64 mx = ga->getMatrix();
+    EXPECT_EQ( mx.width(), 28 );
+    EXPECT_EQ( mx.height(), 11 );
+    for (uint32_t i = 0; i <= 27; i++) {
+        for (uint32_t j = 0; j <= 10; j++) {
+            EXPECT_EQ( mx(i, j), gcp[i * 11 + j] );
+        }
+    }
+
+    EXPECT_EQ( ba->getAll().distinct, distinct );
+    EXPECT_EQ( ba->getAll().total, allTotal );
+    EXPECT_EQ( ba->getIn().distinct, inDistinct );
+    EXPECT_EQ( ba->getIn().total, inTotal );
+    EXPECT_EQ( ba->getOut().distinct, distinct - inDistinct );
+
+    // Top K-mers are in descending order of count, and actually in the hash
+    const vector<TopAnalysis::Entry>& top = ta->getTop();
+    ASSERT_EQ( top.size(), std::min<uint64_t>(5, distinct) );
+    EXPECT_EQ( top[0].first, maxCount );
+    for (size_t i = 0; i < top.size(); i++) {
+        EXPECT_EQ( JellyfishHelper::getCount(hash, top[i].second, false), top[i].first );
+        if (i > 0) {
+            EXPECT_GE( top[i - 1].first, top[i].first );
+        }
+    }
+
+    // Streaming the dump gives exactly the same results, whatever the number of threads
+    auto sa2 = make_shared<SpectrumAnalysis>(1, 100, 1);
+    auto ta2 = make_shared<TopAnalysis>(5);
+    AnalysisEngine engine2;
+    engine2.add(sa2);
+    engine2.add(ta2);
+    MappedDump dump(DATADIR "/ecoli.header.jf27");
+    engine2.run(dump, 2);
+
+    EXPECT_EQ( sa2->getHistogram(), spectrum );
+    ASSERT_EQ( ta2->getTop().size(), top.size() );
+    for (size_t i = 0; i < top.size(); i++) {
+        EXPECT_EQ( ta2->getTop()[i].first, top[i].first );
+        EXPECT_EQ( ta2->getTop()[i].second, top[i].second );
+    }
+
+    EXPECT_THROW( AnalysisEngine().run(*hash, 27, 1), kat::KmerAnalysisException );
+}
+
+}
@@ -0,0 +1,99 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#include <gtest/gtest.h>
+
+#include <boost/filesystem/operations.hpp>
+namespace bfs = boost::filesystem;
+
+#include <kat/fasta_index.hpp>
+#include <kat/jellyfish_helper.hpp>
+#include <kat/packed_sequences.hpp>
+using kat::FastaIndex;
+using kat::JellyfishHelper;
+using kat::PackedSequences;
+
+namespace kat {
+
+TEST(packed_sequences, roundtrip) {
+
+    PackedSequences ps;
+    ps.add("seq1 first", "ACGTacgtNNnnA");
+    ps.add("seq2", "");
+    ps.add("seq3", "GATRYcagk-*TTG");
+
+    ASSERT_EQ( ps.size(), 3 );
+    EXPECT_EQ( ps.getHeader(0), "seq1 first" );
+    EXPECT_EQ( ps.getSequence(0), "ACGTacgtNNnnA" );
+    EXPECT_EQ( ps.getLength(1), 0 );
+    EXPECT_EQ( ps.getSequence(1), "" );
+    EXPECT_EQ( ps.getSequence(2), "GATRYcagk-*TTG" );
+
+    // Ns and IUPAC codes are both N blocks, lower case runs are mask blocks
+    EXPECT_EQ( ps[0].nBlocks.size(), 1 );
+    EXPECT_EQ( ps[0].maskBlocks.size(), 2 );
+    EXPECT_EQ( ps[2].nBlocks.size(), 2 );
+    EXPECT_EQ( ps[2].maskBlocks.size(), 1 );
+}
+
+TEST(packed_sequences, count) {
+
+    // Index a copy, so the .fai file isn't written into the source tree
+    path faCopy("temp_packed_sequences.fa");
+    bfs::remove(FastaIndex::indexPath(faCopy));
+    bfs::remove(faCopy);
+    bfs::copy_file(DATADIR "/sect_test.fa", faCopy);
+    FastaIndex fi(faCopy);
+    PackedSequences ps;
+    for (size_t i = 0; i < fi.size(); i++) {
+        ps.add(fi.getHeader(i), fi.getSequence(i));
+    }
+
+    // Counting kmers from the packed sequences should give the same counts as
+    // parsing the FastA
+    mer_dna::k(11);
+    for (bool canonical : { true, false }) {
+        HashCounter hcFa(10000, 11 * 2, 7, 1);
+        LargeHashArrayPtr fa = JellyfishHelper::countSeqFile(DATADIR "/sect_test.fa", hcFa, canonical, 1, 0, 0);
+        mer_dna::k(11);
+        HashCounter hcPs(10000, 11 * 2, 7, 2);
+        LargeHashArrayPtr packed = JellyfishHelper::countPackedSequences(ps, hcPs, canonical, 2);
+
+        uint64_t faKmers = 0;
+        LargeHashArray::region_iterator it = fa->region_slice(0, 1);
+        while (it.next()) {
+            EXPECT_EQ( JellyfishHelper::getCount(packed, it.key(), false), it.val() );
+            faKmers++;
+        }
+
+        uint64_t psKmers = 0;
+        LargeHashArray::region_iterator it2 = packed->region_slice(0, 1);
+        while (it2.next()) {
+            psKmers++;
+        }
+
+        EXPECT_GT( faKmers, 0 );
+        EXPECT_EQ( psKmers, faKmers );
+    }
+    mer_dna::k(27);
+
+    bfs::remove(FastaIndex::indexPath(faCopy));
+    bfs::remove(FastaIndex::indexPath(faCopy));
+    bfs::remove(faCopy);
+}
+
+}
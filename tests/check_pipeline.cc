@@ -0,0 +1,183 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+using std::vector;
+
+#include <kat/pipeline.hpp>
+using kat::ChunkPool;
+using kat::Pipeline;
+
+namespace kat {
+
+TEST(pipeline, ordered) {
+
+    // Workers finish out of order, but writers must still see items in input order
+    Pipeline<uint32_t> pipeline(4, 3);
+    vector<uint32_t> out1, out2;
+    pipeline.addWriter([&](const uint32_t& v) { out1.push_back(v); });
+    pipeline.addWriter([&](const uint32_t& v) { out2.push_back(v); });
+
+    uint32_t next = 0;
+    pipeline.run(
+        [&](uint32_t& v) {
+            if (next == 100) return false;
+            v = next++;
+            return true;
+        },
+        [&](uint32_t& v, uint16_t th_id) {
+            EXPECT_LT( th_id, 4 );
+            std::this_thread::sleep_for(std::chrono::microseconds((v * 7919) % 500));
+            v *= 2;
+        });
+
+    ASSERT_EQ( out1.size(), 100 );
+    for (uint32_t i = 0; i < 100; i++) {
+        EXPECT_EQ( out1[i], i * 2 );
+    }
+    EXPECT_EQ( out1, out2 );
+}
+
+TEST(pipeline, unordered) {
+
+    // Writers see items as they finish, but every item exactly once and all
+    // writers in the same order
+    Pipeline<uint32_t> pipeline(4, 3);
+    pipeline.setOrdered(false);
+    vector<uint32_t> out1, out2;
+    pipeline.addWriter([&](const uint32_t& v) { out1.push_back(v); });
+    pipeline.addWriter([&](const uint32_t& v) { out2.push_back(v); });
+
+    uint32_t next = 0;
+    pipeline.run(
+        [&](uint32_t& v) {
+            if (next == 100) return false;
+            v = next++;
+            return true;
+        },
+        [&](uint32_t& v, uint16_t th_id) {
+            std::this_thread::sleep_for(std::chrono::microseconds((v * 7919) % 500));
+            v *= 2;
+        });
+
+    EXPECT_EQ( out1, out2 );
+    std::sort(out1.begin(), out1.end());
+    ASSERT_EQ( out1.size(), 100 );
+    for (uint32_t i = 0; i < 100; i++) {
+        EXPECT_EQ( out1[i], i * 2 );
+    }
+}
+
+TEST(pipeline, error) {
+
+    Pipeline<uint32_t> pipeline(2, 2);
+    uint32_t next = 0;
+    EXPECT_THROW( pipeline.run(
+        [&](uint32_t& v) { v = next++; return true; },
+        [&](uint32_t& v, uint16_t th_id) {
+            if (v == 10) throw std::runtime_error("failed");
+        }), std::runtime_error );
+}
+
+TEST(pipeline, chunks) {
+
+    // Every index is visited exactly once, whatever the number of helpers
+    for (uint16_t helpers = 0; helpers <= 4; helpers++) {
+        ChunkPool pool;
+        std::atomic<bool> done(false);
+        vector<std::thread> t;
+        for (uint16_t i = 0; i < helpers; i++) {
+            t.push_back(std::thread([&]() {
+                while (!done) {
+                    const uint64_t gen = pool.getGeneration();
+                    if (!pool.help() && !done) pool.wait(gen);
+                }
+            }));
+        }
+
+        vector<uint32_t> visits(1003, 0);
+        std::atomic<uint32_t> nbChunks(0);
+        pool.run(visits.size(), 100, [&](uint64_t start, uint64_t end) {
+            EXPECT_LE( end - start, 100 );
+            for (uint64_t i = start; i < end; i++) {
+                visits[i]++;
+            }
+            nbChunks++;
+        });
+        EXPECT_EQ( nbChunks, 11 );
+        EXPECT_EQ( vector<uint32_t>(1003, 1), visits );
+
+        EXPECT_THROW( pool.run(1000, 10, [&](uint64_t start, uint64_t end) {
+                if (start == 500) throw std::runtime_error("failed");
+            }), std::runtime_error );
+
+        done = true;
+        pool.notify();
+        for (auto& th : t) {
+            th.join();
+        }
+    }
+}
+
+TEST(pipeline, shared_chunks) {
+
+    // Chunks of large items are only ever processed by the pipeline's three workers
+    Pipeline<uint32_t> pipeline(3, 8);
+    auto pool = std::make_shared<ChunkPool>();
+    pipeline.setChunkPool(pool);
+
+    std::mutex mtx;
+    std::set<std::thread::id> chunkIds;
+    vector<uint64_t> sums;
+    pipeline.addWriter([&](const uint32_t& v) { sums.push_back(v); });
+
+    uint32_t next = 0;
+    pipeline.run(
+        [&](uint32_t& v) { v = next++; return v < 20; },
+        [&](uint32_t& v, uint16_t th_id) {
+            // Every fifth item is large, and split into chunks
+            const uint64_t n = v % 5 == 0 ? 10000 : 10;
+            std::atomic<uint64_t> sum(0);
+            pool->run(n, 100, [&](uint64_t start, uint64_t end) {
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    chunkIds.insert(std::this_thread::get_id());
+                }
+                for (uint64_t i = start; i < end; i++) {
+                    sum += i;
+                }
+            });
+            v = sum == n * (n - 1) / 2 ? v : 1000;
+        });
+
+    ASSERT_EQ( sums.size(), 20 );
+    for (uint32_t i = 0; i < 20; i++) {
+        EXPECT_EQ( sums[i], i );
+    }
+    EXPECT_LE( chunkIds.size(), 3 );
+    EXPECT_EQ( chunkIds.count(std::this_thread::get_id()), 0 );
+}
+
+}
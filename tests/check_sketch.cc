@@ -0,0 +1,162 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#include <gtest/gtest.h>
+
+#include <math.h>
+
+#include <kat/jellyfish_helper.hpp>
+#include <kat/sketch.hpp>
+using kat::ApproxCounter;
+using kat::CountMinSketch;
+using kat::HyperLogLog;
+using kat::JellyfishHelper;
+
+namespace kat {
+
+uint64_t testHash(uint64_t i) {
+    uint64_t h = i + 0x9E3779B97F4A7C15ULL;
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+    return h ^ (h >> 31);
+}
+
+TEST(sketch, count_min) {
+
+    // Plenty of room, so counts should be exact
+    CountMinSketch big(1 << 20);
+    // Far too small, so counts are shared between items
+    CountMinSketch small(64);
+
+    EXPECT_EQ( small.getWidth(), 4 );
+    EXPECT_EQ( small.getDepth(), 4 );
+
+    for (uint64_t i = 0; i < 1000; i++) {
+        for (uint64_t j = 0; j <= i % 10; j++) {
+            big.add(testHash(i));
+            small.add(testHash(i));
+        }
+    }
+
+    EXPECT_EQ( big.getTotal(), 5500 );
+
+    for (uint64_t i = 0; i < 1000; i++) {
+        EXPECT_EQ( big.estimate(testHash(i)), i % 10 + 1 );
+
+        // Never an underestimate
+        EXPECT_GE( small.estimate(testHash(i)), i % 10 + 1 );
+        EXPECT_LE( small.estimate(testHash(i)), small.getTotal() );
+    }
+
+    EXPECT_EQ( big.estimate(testHash(5000)), 0 );
+
+    EXPECT_THROW( CountMinSketch(8), kat::SketchException );
+}
+
+TEST(sketch, hyperloglog) {
+
+    HyperLogLog hll;
+    EXPECT_EQ( hll.estimate(), 0 );
+
+    for (uint64_t i = 0; i < 100000; i++) {
+        hll.add(testHash(i));
+        hll.add(testHash(i));
+    }
+
+    EXPECT_NEAR( (double)hll.estimate(), 100000.0, 100000.0 * 4.0 * hll.standardError() );
+}
+
+TEST(sketch, approx_spectrum) {
+
+    const vector<path> reads = { DATADIR "/ecoli_r1.1K.fastq" };
+    const vector<uint16_t> trim = { 0 };
+
+    // Exact spectrum
+    mer_dna::k(21);
+    HashCounter hc(100000, 21 * 2, 7, 1);
+    LargeHashArrayPtr hash = JellyfishHelper::countSeqFile(reads, hc, true, 1, trim, trim);
+    vector<uint64_t> expected(101, 0);
+    uint64_t distinct = 0, total = 0;
+    LargeHashArray::region_iterator it = hash->region_slice(0, 1);
+    while (it.next()) {
+        ++expected[std::min<uint64_t>(it.val(), 100)];
+        distinct++;
+        total += it.val();
+    }
+
+    // With enough memory the sketch gives the same spectrum
+    ApproxCounter ac(21, 64 << 20, true);
+    ac.count(reads, 2, trim);
+    EXPECT_EQ( ac.getSketch().getTotal(), total );
+
+    vector<double> spectra[2] = { vector<double>(101, 0.0), vector<double>(101, 0.0) };
+    ac.visit(reads, 2, trim, [&spectra](uint16_t th_id, const mer_dna& kmer, uint32_t count) {
+        spectra[th_id][std::min<uint32_t>(count, 100)] += 1.0 / count;
+    });
+
+    vector<uint64_t> spectrum(101, 0);
+    double weightTotal = 0.0;
+    for (size_t i = 0; i < spectrum.size(); i++) {
+        spectrum[i] = llround(spectra[0][i] + spectra[1][i]);
+        weightTotal += spectra[0][i] + spectra[1][i];
+    }
+
+    EXPECT_EQ( spectrum, expected );
+
+    // The weights are exact, so they shouldn't be scaled to the noisier estimate
+    EXPECT_EQ( ac.distinctScale(weightTotal), 1.0 );
+    EXPECT_NEAR( (double)ac.getDistinct().estimate(), (double)distinct, distinct * 4.0 * ac.getDistinct().standardError() );
+
+    mer_dna::k(27);
+}
+
+TEST(sketch, approx_spectrum_undersized) {
+
+    const vector<path> reads = { DATADIR "/ecoli_r1.1K.fastq" };
+    const vector<uint16_t> trim = { 0 };
+
+    mer_dna::k(21);
+    HashCounter hc(100000, 21 * 2, 7, 1);
+    LargeHashArrayPtr hash = JellyfishHelper::countSeqFile(reads, hc, true, 1, trim, trim);
+    uint64_t distinct = 0;
+    LargeHashArray::region_iterator it = hash->region_slice(0, 1);
+    while (it.next()) {
+        distinct++;
+    }
+
+    // Far fewer counters than distinct K-mers, so many counts are overestimated
+    ApproxCounter ac(21, 1 << 14, true);
+    ac.count(reads, 2, trim);
+    ASSERT_LT( ac.getSketch().getWidth(), distinct / 4 );
+
+    double weights[2] = { 0.0, 0.0 };
+    ac.visit(reads, 2, trim, [&weights](uint16_t th_id, const mer_dna& kmer, uint32_t count) {
+        weights[th_id] += 1.0 / count;
+    });
+    const double weightTotal = weights[0] + weights[1];
+
+    // The 1/count weights undercount distinct K-mers, but scaling corrects the
+    // total to within the distinct estimate's error
+    const double err = distinct * 4.0 * ac.getDistinct().standardError();
+    EXPECT_LT( weightTotal, distinct - err );
+    EXPECT_NEAR( weightTotal * ac.distinctScale(weightTotal), (double)distinct, err );
+    EXPECT_EQ( ac.distinctScale(0.0), 1.0 );
+
+    mer_dna::k(27);
+}
+
+}
@@ -0,0 +1,248 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <iostream>
+#include <thread>
+using std::cout;
+using std::endl;
+using std::ifstream;
+using std::ofstream;
+using std::stringstream;
+
+#include <boost/filesystem/operations.hpp>
+using boost::filesystem::remove;
+
+#include <kat/binary_matrix.hpp>
+#include <kat/matrix_metadata_extractor.hpp>
+#include <kat/sparse_matrix.hpp>
+using kat::BinaryMatrix;
+using kat::BinaryMatrixException;
+using kat::SM64;
+using kat::ThreadedSparseMatrix;
+
+namespace kat {
+
+string testHeader() {
+    stringstream header;
+    header << mme::KEY_TITLE << "Test matrix" << endl
+           << mme::KEY_NB_COLUMNS << 4 << endl
+           << mme::KEY_NB_ROWS << 3 << endl
+           << mme::KEY_KMER << 27 << endl
+           << mme::MX_META_END << endl;
+    return header.str();
+}
+
+void checkSame(const SM64& a, const SM64& b) {
+    EXPECT_EQ( a.width(), b.width() );
+    EXPECT_EQ( a.height(), b.height() );
+    for (uint32_t i = 0; i < a.width(); i++) {
+        for (uint32_t j = 0; j < a.height(); j++) {
+            EXPECT_EQ( a.get(i, j), b.get(i, j) );
+        }
+    }
+}
+
+TEST(sparse_matrix, binary_sparse) {
+
+    SM64 mx(3, 4);
+    mx.inc(0, 1, 5);
+    mx.inc(2, 3, 1234567890123ULL);
+
+    mx.saveBinary("temp_sparse.mx", testHeader());
+    EXPECT_TRUE( BinaryMatrix::isBinaryMatrix("temp_sparse.mx") );
+
+    BinaryMatrix bm("temp_sparse.mx");
+    EXPECT_FALSE( bm.isDense() );
+    EXPECT_EQ( bm.nnz(), 2 );
+    EXPECT_EQ( bm.get(0, 1), 5 );
+    EXPECT_EQ( bm.get(1, 1), 0 );
+    EXPECT_EQ( bm.get(2, 3), 1234567890123ULL );
+    EXPECT_EQ( bm.getMetadata(), testHeader() );
+
+    checkSame(mx, SM64(path("temp_sparse.mx")));
+
+    EXPECT_EQ( mme::getNumeric("temp_sparse.mx", mme::KEY_KMER), 27 );
+    EXPECT_EQ( mme::getString("temp_sparse.mx", mme::KEY_TITLE), "Test matrix" );
+
+    remove("temp_sparse.mx");
+}
+
+TEST(sparse_matrix, binary_dense) {
+
+    SM64 mx(3, 4);
+    for (uint32_t i = 0; i < 3; i++) {
+        for (uint32_t j = 0; j < 4; j++) {
+            mx.inc(i, j, i * 4 + j + 1);
+        }
+    }
+
+    mx.saveBinary("temp_dense.mx", testHeader());
+
+    BinaryMatrix bm("temp_dense.mx");
+    EXPECT_TRUE( bm.isDense() );
+    EXPECT_EQ( bm.cell(5), 6 );
+    EXPECT_EQ( bm.get(2, 3), 12 );
+
+    checkSame(mx, SM64(path("temp_dense.mx")));
+
+    remove("temp_dense.mx");
+}
+
+TEST(sparse_matrix, binary_little_endian) {
+
+    SM64 mx(3, 4);
+    mx.inc(1, 2, 0x0102);
+
+    mx.saveBinary("temp_endian.mx", testHeader());
+
+    // Check the bytes on disk, whatever the host order
+    ifstream in("temp_endian.mx", std::ios::binary);
+    string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+
+    ASSERT_GE( bytes.size(), sizeof(kat::BinaryMatrixHeader) );
+    EXPECT_EQ( bytes[8], 1 );       // version
+    EXPECT_EQ( bytes[12], 1 );      // sparse storage
+    EXPECT_EQ( bytes[16], 3 );      // rows
+    EXPECT_EQ( bytes[23], 0 );
+    EXPECT_EQ( bytes[24], 4 );      // cols
+
+    BinaryMatrix bm("temp_endian.mx");
+    ASSERT_FALSE( bm.isDense() );
+    const char* e = reinterpret_cast<const char*>(bm.sparseData());
+    EXPECT_EQ( e[0], 1 );           // row
+    EXPECT_EQ( e[4], 2 );           // col
+    EXPECT_EQ( e[8], 2 );           // val, low byte first
+    EXPECT_EQ( e[9], 1 );
+    EXPECT_EQ( bm.get(1, 2), 0x0102 );
+    EXPECT_EQ( bm.get(1, 1), 0 );
+
+    remove("temp_endian.mx");
+}
+
+TEST(sparse_matrix, binary_corrupt) {
+
+    SM64 mx(3, 4);
+    mx.inc(1, 2, 5);
+
+    // Sizes whose payload wraps around to zero bytes must still be rejected
+    for (bool dense : { false, true }) {
+        if (dense) {
+            for (uint32_t i = 0; i < 3; i++) {
+                for (uint32_t j = 0; j < 4; j++) {
+                    mx.inc(i, j, 1);
+                }
+            }
+        }
+        mx.saveBinary("temp_corrupt.mx", testHeader());
+        EXPECT_EQ( BinaryMatrix(path("temp_corrupt.mx")).isDense(), dense );
+
+        std::fstream f("temp_corrupt.mx", std::ios::binary | std::ios::in | std::ios::out);
+        if (dense) {
+            f.seekp(16);
+            f.write("\x00\x00\x00\x00\x00\x00\x00\x20", 8);   // rows = 2^61
+            f.write("\x08\x00\x00\x00\x00\x00\x00\x00", 8);   // cols = 8
+        }
+        else {
+            f.seekp(32);
+            f.write("\x00\x00\x00\x00\x00\x00\x00\x10", 8);   // nnz = 2^60
+        }
+        f.close();
+
+        EXPECT_THROW( BinaryMatrix(path("temp_corrupt.mx")), BinaryMatrixException );
+    }
+
+    remove("temp_corrupt.mx");
+}
+
+TEST(sparse_matrix, text_and_binary) {
+
+    SM64 mx(3, 4);
+    mx.inc(1, 2, 7);
+    mx.inc(2, 0, 3);
+
+    ofstream out("temp_text.mx");
+    out << testHeader();
+    mx.printMatrix(out);
+    out.close();
+
+    mx.saveBinary("temp_binary.mx", testHeader());
+
+    EXPECT_FALSE( BinaryMatrix::isBinaryMatrix("temp_text.mx") );
+    checkSame(SM64(path("temp_text.mx")), SM64(path("temp_binary.mx")));
+    EXPECT_EQ( mme::getNumeric("temp_text.mx", mme::KEY_NB_ROWS), mme::getNumeric("temp_binary.mx", mme::KEY_NB_ROWS) );
+
+    remove("temp_text.mx");
+    remove("temp_binary.mx");
+}
+
+void fillThreaded(ThreadedSparseMatrix& tsm, uint16_t threads) {
+    vector<std::thread> t(threads);
+    for (uint16_t k = 0; k < threads; k++) {
+        t[k] = std::thread([&tsm, k]() {
+            // Lots of repeats on a few cells, plus a sweep over all of them
+            for (uint32_t r = 0; r < 1000; r++) {
+                tsm.incTM(k, r % 3, 1, 1);
+            }
+            for (uint32_t i = 0; i < 50; i++) {
+                for (uint32_t j = 0; j < 40; j++) {
+                    tsm.incTM(k, i, j, i + j);
+                }
+            }
+        });
+    }
+    for (auto& th : t) {
+        th.join();
+    }
+}
+
+TEST(sparse_matrix, threaded_modes) {
+
+    const uint16_t threads = 4;
+
+    ThreadedSparseMatrix perThread(50, 40, threads, ThreadedSparseMatrix::Mode::PER_THREAD);
+    ThreadedSparseMatrix shared(50, 40, threads, ThreadedSparseMatrix::Mode::SHARED);
+    EXPECT_FALSE( perThread.isShared() );
+    EXPECT_TRUE( shared.isShared() );
+
+    fillThreaded(perThread, threads);
+    fillThreaded(shared, threads);
+
+    // Out of bounds increments never make it into the final matrix
+    shared.incTM(0, 50, 0, 1);
+
+    perThread.mergeThreadedMatricies();
+    shared.mergeThreadedMatricies();
+
+    checkSame(perThread.getFinalMatrix(), shared.getFinalMatrix());
+    EXPECT_EQ( shared.getFinalMatrix().get(0, 1), threads * (334 + 1) );
+    EXPECT_EQ( shared.getFinalMatrix().get(49, 39), threads * 88 );
+}
+
+TEST(sparse_matrix, threaded_auto_mode) {
+
+    EXPECT_FALSE( ThreadedSparseMatrix(1001, 1001, 1).isShared() );
+    EXPECT_FALSE( ThreadedSparseMatrix(1001, 1001, 4).isShared() );
+    EXPECT_TRUE( ThreadedSparseMatrix(5000, 5000, 64).isShared() );
+}
+
+}
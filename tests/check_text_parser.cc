@@ -0,0 +1,127 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <iostream>
+using std::cout;
+using std::endl;
+using std::ofstream;
+
+#include <boost/filesystem/operations.hpp>
+using boost::filesystem::remove;
+
+#include <kat/text_parser.hpp>
+using kat::parseUInt64;
+using kat::TextParser;
+using kat::TextParserException;
+
+namespace kat {
+
+bool parse(const string& s, uint64_t& val) {
+    const char* p = s.data();
+    bool ok = parseUInt64(p, s.data() + s.size(), val);
+    return ok && p == s.data() + s.size();
+}
+
+TEST(text_parser, parse_uint64) {
+
+    uint64_t val;
+
+    EXPECT_TRUE( parse("0", val) );
+    EXPECT_EQ( val, 0 );
+    EXPECT_TRUE( parse("7", val) );
+    EXPECT_EQ( val, 7 );
+    EXPECT_TRUE( parse("12345678", val) );
+    EXPECT_EQ( val, 12345678 );
+    EXPECT_TRUE( parse("123456789", val) );
+    EXPECT_EQ( val, 123456789 );
+    EXPECT_TRUE( parse("9876543210123456", val) );
+    EXPECT_EQ( val, 9876543210123456ULL );
+    EXPECT_TRUE( parse("18446744073709551615", val) );
+    EXPECT_EQ( val, 18446744073709551615ULL );
+
+    EXPECT_FALSE( parse("18446744073709551616", val) );
+    EXPECT_FALSE( parse("", val) );
+    EXPECT_FALSE( parse("x1", val) );
+
+    // Stops at the first non-digit, even within an 8 byte block
+    string s("1234 5678");
+    const char* p = s.data();
+    EXPECT_TRUE( parseUInt64(p, s.data() + s.size(), val) );
+    EXPECT_EQ( val, 1234 );
+    EXPECT_EQ( *p, ' ' );
+}
+
+TEST(text_parser, matrix) {
+
+    // Large enough to be split across threads
+    const uint32_t rows = 5000;
+    const uint32_t cols = 200;
+
+    ofstream out("temp_parser.mx");
+    out << "# Title:Test" << endl << "###" << endl;
+    for (uint32_t i = 0; i < rows; i++) {
+        out << (uint64_t)i * 1000000007ULL;
+        for (uint32_t j = 1; j < cols; j++) {
+            out << " " << i * j;
+        }
+        out << endl;
+    }
+    out.close();
+
+    vector<uint64_t> cells;
+    uint32_t r, c;
+    TextParser::parseMatrix("temp_parser.mx", cells, r, c, 4);
+
+    EXPECT_EQ( r, rows );
+    EXPECT_EQ( c, cols );
+    ASSERT_EQ( cells.size(), (size_t)rows * cols );
+    EXPECT_EQ( cells[0], 0 );
+    EXPECT_EQ( cells[cols], 1000000007ULL );
+    EXPECT_EQ( cells[(size_t)4999 * cols + 199], 4999 * 199 );
+
+    remove("temp_parser.mx");
+}
+
+TEST(text_parser, bad_matrix) {
+
+    ofstream out("temp_bad.mx");
+    out << "# Title:Test" << endl << "1 2 3" << endl << "4 5" << endl;
+    out.close();
+
+    vector<uint64_t> cells;
+    uint32_t r, c;
+    EXPECT_THROW( TextParser::parseMatrix("temp_bad.mx", cells, r, c), TextParserException );
+
+    remove("temp_bad.mx");
+}
+
+TEST(text_parser, histogram) {
+
+    vector<pair<uint32_t, uint64_t>> hist;
+    TextParser::parseHistogram(DATADIR "/kat.hist", hist);
+
+    EXPECT_EQ( hist.size(), 10001 );
+    EXPECT_EQ( hist[0].first, 1 );
+    EXPECT_EQ( hist[0].second, 54015667 );
+    EXPECT_EQ( hist[10000].first, 10001 );
+    EXPECT_EQ( hist[10000].second, 358 );
+}
+
+}
@@ -0,0 +1,138 @@
+//  ********************************************************************
+//  This file is part of KAT - the K-mer Analysis Toolkit.
+//
+//  KAT is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  KAT is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with KAT.  If not, see <http://www.gnu.org/licenses/>.
+//  *******************************************************************
+
+#include <algorithm>
+#include <mutex>
+
+#include <gtest/gtest.h>
+
+#include <kat/jellyfish_helper.hpp>
+#include <kat/multi_k_counter.hpp>
+#include <kat/sketch.hpp>
+#include <kat/two_bit.hpp>
+using kat::ApproxCounter;
+using kat::JellyfishException;
+using kat::JellyfishHelper;
+using kat::MultiKCounter;
+using kat::TwoBitFile;
+
+namespace kat {
+
+TEST(two_bit, read) {
+
+    EXPECT_TRUE( TwoBitFile::isTwoBit(DATADIR "/sect_test.2bit") );
+    EXPECT_FALSE( TwoBitFile::isTwoBit(DATADIR "/sect_test.fa") );
+    EXPECT_THROW( TwoBitFile tb(DATADIR "/sect_test.fa"), TwoBitException );
+
+    // Same records as sect_test.fa, except for the soft masked start of seq3
+    TwoBitFile tb(DATADIR "/sect_test.2bit");
+    ASSERT_EQ( tb.size(), 6 );
+    EXPECT_EQ( tb.getHeader(0), "seq1" );
+    EXPECT_EQ( tb.getHeader(5), "seq6" );
+    EXPECT_EQ( tb.getSequence(0), "ATATATATAGCCGCGCGCGCGCGCATCG" );
+    EXPECT_EQ( tb.getSequence(1), "GCATGCNNNGCAT" );
+    EXPECT_EQ( tb.getSequence(2), "gtttgtGTTTGTGTTATAAGTAGTAGTAGTGCCC" );
+    EXPECT_EQ( tb.getSequence(4), "ATATGCNCNCGT" );
+    EXPECT_EQ( tb.getLength(5), 63 );
+    EXPECT_EQ( tb[1].nBlocks.size(), 1 );
+    EXPECT_EQ( tb[2].maskBlocks.size(), 1 );
+}
+
+TEST(two_bit, count) {
+
+    // Counting kmers straight from the packed bases should give the same
+    // counts as parsing the FastA, with and without canonical kmers
+    mer_dna::k(11);
+    for (bool canonical : { true, false }) {
+        HashCounter hcFa(10000, 11 * 2, 7, 1);
+        LargeHashArrayPtr fa = JellyfishHelper::countSeqFile(DATADIR "/sect_test.fa", hcFa, canonical, 1, 0, 0);
+        mer_dna::k(11);
+        HashCounter hcTb(10000, 11 * 2, 7, 2);
+        LargeHashArrayPtr tb = JellyfishHelper::countSeqFile(DATADIR "/sect_test.2bit", hcTb, canonical, 2, 0, 0);
+
+        uint64_t faKmers = 0;
+        LargeHashArray::region_iterator it = fa->region_slice(0, 1);
+        while (it.next()) {
+            EXPECT_EQ( JellyfishHelper::getCount(tb, it.key(), false), it.val() );
+            faKmers++;
+        }
+
+        uint64_t tbKmers = 0;
+        LargeHashArray::region_iterator it2 = tb->region_slice(0, 1);
+        while (it2.next()) {
+            tbKmers++;
+        }
+
+        EXPECT_GT( faKmers, 0 );
+        EXPECT_EQ( tbKmers, faKmers );
+    }
+    mer_dna::k(27);
+}
+
+TEST(two_bit, multi_k_and_approx) {
+
+    // .2bit files can't be parsed as text, so check that the multi-K and
+    // approximate counters see the same K-mers in them as in the FastA
+    const vector<path> files = { DATADIR "/sect_test.fa", DATADIR "/sect_test.2bit" };
+    const vector<uint16_t> trim = { 0, 0 };
+
+    MultiKCounter mkc({ 11, 7 }, 1000, true, true, { 0, 1 });
+    mkc.count(files, 2, trim);
+    for (size_t i = 0; i < mkc.size(); i++) {
+        vector<uint64_t> fa(101, 0);
+        mkc.getGroupCounter(i, 0).spectrum(0, 1, fa);
+        vector<uint64_t> tb(101, 0);
+        mkc.getGroupCounter(i, 1).spectrum(0, 1, tb);
+        EXPECT_GT( fa[1], 0 );
+        EXPECT_EQ( tb, fa );
+    }
+
+    vector<uint64_t> approx[2];
+    for (size_t f = 0; f < files.size(); f++) {
+        const vector<path> file = { files[f] };
+        ApproxCounter ac(11, 1 << 20, true);
+        ac.count(file, 2, { 0 });
+        approx[f].resize(101, 0);
+        std::mutex mtx;
+        ac.visit(file, 2, { 0 }, [&](uint16_t th_id, const mer_dna& kmer, uint32_t count) {
+            std::lock_guard<std::mutex> lock(mtx);
+            ++approx[f][std::min<uint32_t>(count, 100)];
+        });
+    }
+    EXPECT_GT( approx[0][1], 0 );
+    EXPECT_EQ( approx[1], approx[0] );
+
+    mer_dna::k(27);
+}
+
+TEST(two_bit, split_inputs) {
+
+    // .2bit files are taken out of the parser's input.  Their 5' trim can't be
+    // honoured, so a non-zero one is refused rather than silently dropped.
+    const vector<path> files = { DATADIR "/sect_test.fa", DATADIR "/sect_test.2bit" };
+
+    const SeqInputs inputs = JellyfishHelper::splitSeqInputs(files, { 5, 0 });
+    EXPECT_EQ( inputs.paths.size(), 1 );
+    EXPECT_EQ( inputs.pathTrim5p, vector<uint16_t>({ 5 }) );
+    EXPECT_EQ( inputs.pathFiles, vector<size_t>({ 0 }) );
+    EXPECT_EQ( inputs.twoBitFiles, vector<size_t>({ 1 }) );
+    EXPECT_EQ( inputs.twoBitRecords.size(), inputs.twoBits[0]->size() );
+
+    EXPECT_THROW( JellyfishHelper::splitSeqInputs(files, { 0, 5 }), JellyfishException );
+}
+
+}
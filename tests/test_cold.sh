@@ -0,0 +1,12 @@
+#! /bin/sh
+
+. ./compat.sh
+
+mkdir -p temp
+$KAT cold -t 2 -o temp/cold_reads ${data}/cold_test.fa ${data}/ecoli_r1.1K.fastq ${data}/ecoli_r2.1K.fastq
+cmp temp/cold_reads-stats.tsv ${data}/cold_test_reads-stats.tsv
+$KAT cold -t 2 -o temp/cold_hash ${data}/cold_test.fa ${data}/ecoli.header.jf27
+cmp temp/cold_hash-stats.tsv ${data}/cold_test_hash-stats.tsv
+$KAT hist -d -H 100000 -o temp/cold_reads_hist ${data}/ecoli_r1.1K.fastq ${data}/ecoli_r2.1K.fastq
+$KAT cold -t 2 -o temp/cold_canonical ${data}/cold_test.fa temp/cold_reads_hist-hash.jf27
+cmp temp/cold_canonical-stats.tsv ${data}/cold_test_canonical-stats.tsv
@@ -2,6 +2,13 @@
 
 . ./compat.sh
 
+$KAT comp -m13 -o temp/stats_full_test ${data}/ecoli_r1.1K.fastq ${data}/ecoli_r2.1K.fastq
+$KAT comp -m13 --stats_only -o temp/stats_only_test ${data}/ecoli_r1.1K.fastq ${data}/ecoli_r2.1K.fastq
+cmp temp/stats_full_test.stats temp/stats_only_test.stats
+if $KAT comp -m13 -d --sample_fraction 0.5 -o temp/sample_dump_test ${data}/ecoli_r1.1K.fastq ${data}/ecoli_r2.1K.fastq; then
+    echo "Dumping sampled hashes should fail" >&2
+    exit 1
+fi
 $KAT comp -m13 -o temp/spectra-cn_test ${data}/ecoli_r1.1K.fastq ${data}/EcoliK12.fasta
 $KAT comp -m13 -v -n -o temp/density_test ${data}/ecoli_r1.1K.fastq ${data}/ecoli_r2.1K.fastq
 $KAT comp -m13 -o temp/glob_test ${data}'/ecoli_r?.1K.fastq' ${data}/EcoliK12.fasta
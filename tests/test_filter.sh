@@ -0,0 +1,25 @@
+#! /bin/sh
+
+. ./compat.sh
+
+$KAT filter seq -t 1 -s --stats -m 17 -T 0.6 -o temp/filter_single_t1 --seq ${data}/ecoli_r1.1K.fastq ${data}/ecoli_r2.1K.fastq
+$KAT filter seq -t 4 -s --stats -m 17 -T 0.6 -o temp/filter_single_t4 --seq ${data}/ecoli_r1.1K.fastq ${data}/ecoli_r2.1K.fastq
+cmp temp/filter_single_t1.in.fastq temp/filter_single_t4.in.fastq
+cmp temp/filter_single_t1.out.fastq temp/filter_single_t4.out.fastq
+cmp temp/filter_single_t1.stats temp/filter_single_t4.stats
+$KAT filter seq -t 1 -s --stats -m 17 -T 0.6 -o temp/filter_paired_t1 --seq ${data}/ecoli_r1.1K.fastq --seq2 ${data}/ecoli_r2.1K.fastq ${data}/ecoli_r2.1K.fastq
+$KAT filter seq -t 4 -s --stats -m 17 -T 0.6 -o temp/filter_paired_t4 --seq ${data}/ecoli_r1.1K.fastq --seq2 ${data}/ecoli_r2.1K.fastq ${data}/ecoli_r2.1K.fastq
+cmp temp/filter_paired_t1.in.R1.fastq temp/filter_paired_t4.in.R1.fastq
+cmp temp/filter_paired_t1.in.R2.fastq temp/filter_paired_t4.in.R2.fastq
+cmp temp/filter_paired_t1.out.R1.fastq temp/filter_paired_t4.out.R1.fastq
+cmp temp/filter_paired_t1.out.R2.fastq temp/filter_paired_t4.out.R2.fastq
+cmp temp/filter_paired_t1.stats temp/filter_paired_t4.stats
+$KAT filter seq -t 4 -s --unordered -m 17 -T 0.6 -o temp/filter_unordered --seq ${data}/ecoli_r1.1K.fastq --seq2 ${data}/ecoli_r2.1K.fastq ${data}/ecoli_r2.1K.fastq
+awk 'NR%4==1 {sub(/\/[12]$/, ""); print}' temp/filter_unordered.in.R1.fastq > temp/filter_unordered.in.R1.names
+awk 'NR%4==1 {sub(/\/[12]$/, ""); print}' temp/filter_unordered.in.R2.fastq > temp/filter_unordered.in.R2.names
+cmp temp/filter_unordered.in.R1.names temp/filter_unordered.in.R2.names
+awk 'NR%4==1 {sub(/\/[12]$/, ""); print}' temp/filter_unordered.out.R1.fastq > temp/filter_unordered.out.R1.names
+awk 'NR%4==1 {sub(/\/[12]$/, ""); print}' temp/filter_unordered.out.R2.fastq > temp/filter_unordered.out.R2.names
+cmp temp/filter_unordered.out.R1.names temp/filter_unordered.out.R2.names
+sort temp/filter_unordered.in.R1.names > temp/filter_unordered.sorted.names
+awk 'NR%4==1 {sub(/\/[12]$/, ""); print}' temp/filter_paired_t1.in.R1.fastq | sort | cmp - temp/filter_unordered.sorted.names
@@ -0,0 +1,11 @@
+#! /bin/sh
+
+. ./compat.sh
+
+$KAT qc -t 4 -o temp/qc_test ${data}/ecoli.header.jf27
+$KAT hist -t 4 -o temp/qc_test_hist ${data}/ecoli.header.jf27
+$KAT gcp -t 4 -o temp/qc_test_gcp ${data}/ecoli.header.jf27
+grep -v '^#' temp/qc_test.hist > temp/qc_test.hist.data
+grep -v '^#' temp/qc_test_hist | cmp - temp/qc_test.hist.data
+grep -v '^#' temp/qc_test-gcp.mx > temp/qc_test-gcp.mx.data
+grep -v '^#' temp/qc_test_gcp.mx | cmp - temp/qc_test-gcp.mx.data
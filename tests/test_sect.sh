@@ -2,5 +2,24 @@
 
 . ./compat.sh
 
-$KAT sect -o temp/sect_length ${data}/sect_length_test.fa ${data}/ecoli.header.jf27
-$KAT sect -o temp/sect_test ${data}/sect_length_test.fa ${data}/ecoli.header.jf27
+# Work on a copy so the FastA index is written to temp rather than the source tree
+mkdir -p temp
+cp ${data}/sect_length_test.fa temp/
+$KAT sect -o temp/sect_length temp/sect_length_test.fa ${data}/ecoli.header.jf27
+$KAT sect -o temp/sect_test temp/sect_length_test.fa ${data}/ecoli.header.jf27
+$KAT sect -n -w 100 --window_step 50 -o temp/sect_windows temp/sect_length_test.fa ${data}/ecoli.header.jf27
+$KAT sect --binary_counts -o temp/sect_binary temp/sect_length_test.fa ${data}/ecoli.header.jf27
+$KAT sect --query temp/sect_binary-counts.cvgb -o temp/sect_region seq1 seq1:1-2
+$KAT sect --query temp/sect_binary-counts.cvgb -o temp/sect_binary
+cmp temp/sect_binary-query.cvg temp/sect_length-counts.cvg
+$KAT sect --binary_mx -o temp/sect_bmx temp/sect_length_test.fa ${data}/ecoli.header.jf27
+test "$(head -c 8 temp/sect_bmx-contamination.mx)" = "KATBINMX"
+test "$(head -c 1 temp/sect_length-contamination.mx)" = "#"
+$KAT sect -o temp/sect_2bit ${data}/sect_length_test.2bit ${data}/ecoli.header.jf27
+cmp temp/sect_2bit-counts.cvg temp/sect_length-counts.cvg
+cmp temp/sect_2bit-stats.tsv temp/sect_length-stats.tsv
+cat ${data}/sect_length_test.fa | $KAT sect -o temp/sect_pipe /dev/stdin ${data}/ecoli.header.jf27
+cmp temp/sect_pipe-stats.tsv temp/sect_length-stats.tsv
+$KAT sect --multi_sample -o temp/sect_multi temp/sect_length_test.fa ${data}/ecoli.header.jf27 ${data}/ecoli.header.jf27
+cmp temp/sect_multi-counts1.cvg temp/sect_length-counts.cvg
+cmp temp/sect_multi-counts2.cvg temp/sect_length-counts.cvg
@@ -0,0 +1,8 @@
+#! /bin/sh
+
+. ./compat.sh
+
+$KAT top -m17 -n 20 -t 1 -o temp/top_test_t1 ${data}/ecoli_r?.1K.fastq
+$KAT top -m17 -n 20 -t 4 -o temp/top_test_t4 ${data}/ecoli_r?.1K.fastq
+cmp temp/top_test_t1 temp/top_test_t4
+$KAT top -n 20 -t 4 -o temp/top_test_hash ${data}/ecoli.header.jf27